@@ -0,0 +1,51 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef AGGREGATE_PROTOCOL_H
+#define AGGREGATE_PROTOCOL_H
+
+#include <cstdint>
+
+/**
+ * Records sent to an aggregator (--aggregator) and republished by it start
+ * with this envelope, the record follows unchanged. Nodes leave node zero,
+ * the aggregator fills in the address the record came from. Readers skip
+ * headerSize bytes, so fields can be appended. All fields little endian.
+ */
+struct __attribute__((__packed__)) AggregateRecordHeader {
+    uint64_t timestamp;         // us since epoch on the coordinator's clock
+    uint32_t clockUncertainty;  // us, 0 when the node is not synchronized
+    uint8_t format;             // streamFormat
+    uint8_t reserved;
+    uint16_t derivedType;  // derivedRecordType of STREAM_FORMAT_DERIVED
+    uint8_t srcMac[6];
+    uint16_t headerSize;
+    uint8_t node[16];  // IPv6 address of the node, IPv4 ones mapped
+};  // size 40 bytes
+
+/**
+ * Entry of the .idx file next to every shard written by the aggregator,
+ * one per record in the order of the shard.
+ */
+struct __attribute__((__packed__)) AggregateIndexEntry {
+    uint64_t timestamp;  // us since epoch on the coordinator's clock
+    uint64_t offset;     // of the record in the shard
+    uint32_t size;
+    uint32_t clockUncertainty;  // us
+};  // size 24 bytes
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "MulticastSink.h"
+#include "ShmRingSink.h"
+#include "StreamFramer.h"
+#include "StreamServer.h"
+
+// Records buffered by a receiving thread, above the oldest are released early
+#define AGGREGATE_BUFFER_RECORDS (1 << 20)
+#define AGGREGATE_TICK_MS 5
+// Nodes not heard from are forgotten, their lost records reported
+#define AGGREGATE_SOURCE_TIMEOUT_S 60
+
+struct AggregateConfig {
+    std::string listen;     // udp:[HOST:]PORT and tcp:[HOST:]PORT, comma separated
+    std::string directory;  // shards are written here when set
+    uint32_t jitter = 100;  // ms records wait for earlier ones of other nodes
+    uint32_t threads = 0;   // receiving threads, one per core by default
+    uint32_t shardSize = 256;  // MiB
+};
+
+struct AggregateStats {
+    uint64_t datagrams = 0;
+    uint64_t records = 0;   // received
+    uint64_t released = 0;  // written or republished in timestamp order
+    uint64_t late = 0;      // arrived after newer records were released
+    uint64_t lost = 0;      // records a node sent that never arrived whole
+    uint64_t invalid = 0;
+    uint64_t nacks = 0;
+    uint64_t buffered = 0;
+};
+
+/**
+ * Collects the records of many nodes (StreamUplink.h) into one timeline.
+ * Every receiving thread has its own epoll and its own sockets bound with
+ * SO_REUSEPORT, the kernel keeps every node on one thread so reassembly
+ * needs no locks. Records wait in the thread's heap until the corrected
+ * clock is the jitter past their timestamp, then the merging thread takes
+ * them from all heaps in timestamp order.
+ *
+ * Released records are written per node, transmitter MAC and format into
+ * shards of the output directory, NODE/MAC/PREFIXNNNNNN.dat with the
+ * AggregateIndexEntry of every record in a .idx file next to it. CSI shards
+ * are FeitCSI recordings. With --stream, --multicast or --shm the merged
+ * stream is republished, every record behind its AggregateRecordHeader.
+ * The UDP ports also answer clock requests (ClockSync.h).
+ */
+class Aggregator {
+   public:
+    explicit Aggregator(const AggregateConfig& config);
+    ~Aggregator();
+
+    // Receives until SIGINT, SIGTERM or stop, then releases all buffered records.
+    // Both signals have to be blocked before the first thread of the process starts
+    void run();
+    void stop();
+    AggregateStats getStats();
+
+   private:
+    struct Worker;
+    struct Shard;
+
+    AggregateConfig config;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> stopping = false;
+    uint64_t lastReleased = 0;  // timestamp
+    std::atomic<uint64_t> released = 0;
+    std::atomic<uint64_t> late = 0;
+
+    std::unordered_map<std::string, std::unique_ptr<Shard>> shards;
+    std::unique_ptr<StreamServer> stream;
+    std::unique_ptr<MulticastSink> multicast;
+    std::unique_ptr<ShmRingSink> shm;
+
+    void openSockets(Worker& worker);
+    void receive(Worker& worker);
+    void receiveDatagrams(Worker& worker, int fd);
+    void receiveConnection(Worker& worker, int fd);
+    void addRecord(Worker& worker, const uint8_t* node, const uint8_t* record, size_t size);
+    void release(bool all);
+    void output(const StreamRecordData& data);
+    void write(const StreamRecordData& data);
+};
+
+#endif
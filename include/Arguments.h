@@ -20,9 +20,13 @@
 #define ARGUMENTS_PARSER_H
 
 #include <argp.h>
+#include <atomic>
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 #include "main.h"
 
 #define ETH_ALEN 6
@@ -63,18 +67,163 @@ struct Args {
     uint8_t ftmTargetMac[ETH_ALEN];
     std::string inputFile;
     std::map<enum processor, bool> processors;
+    uint32_t cirOversample = 1;
+    bool rawOutput = true;
+    uint32_t statsWindow = 100;
+    uint32_t statsHop = 0;
+    std::vector<double> statsPercentiles = {5, 50, 95};
+    double dopplerRate = 100;
+    uint32_t dopplerWindow = 128;
+    uint32_t dopplerHop = 16;
+    uint32_t dopplerGroup = 0;
+    bool dopplerRatio = false;
+    std::string pipelineFile;
+    std::string resampleGrid;
+    bool resampleCubic = false;
+    std::string ratioPairs = "0:1";
+    bool ratioProduct = false;
+    bool ratioFloat = false;
+    uint32_t covarianceWindow = 100;
+    uint32_t covarianceHop = 0;
+    uint32_t covarianceGroup = 1;
+    uint32_t musicWindow = 10;
+    double antennaSpacing = 0.026;
+    uint32_t tofAlign = 50;
+    std::string ftmFile;
+    uint32_t hampelWindow = 11;
+    double hampelThreshold = 3;
+    uint32_t medianWindow = 5;
+    uint32_t pcaComponents = 4;
+    uint32_t pcaMemory = 1000;
+    uint32_t pcaBasis = 0;
+    std::string exportDirectory;
+    std::string exportInputs;
+    uint32_t exportWindow = 100;
+    uint32_t exportHop = 0;
+    bool exportInt8 = false;
+    bool exportComplex = false;
+    uint32_t exportShard = 1024;
+    uint64_t exportSeed = 0;
+    std::string triggerDetector = "variance";
+    double triggerThreshold = 0.01;
+    double triggerPre = 2;
+    double triggerHold = 5;
+    uint32_t udpBatch = 32;
+    uint32_t udpFrame = 0;  // MTU of stream protocol datagrams, 0 sends whole records
+    std::string shmName;
+    uint32_t shmSize = 64;  // MiB
+    std::string streamListen;
+    uint32_t streamBuffer = 16;  // MiB per client
+    std::string streamBackpressure = "drop";
+    std::string multicastGroup;
+    uint32_t multicastTtl = 1;
+    std::string multicastInterface;
+    std::string clockSync;
+    uint32_t clockInterval = 1000;  // ms
+    std::string aggregator;
+    std::string aggregateListen;
+    std::string aggregateOutput;
+    uint32_t aggregateJitter = 100;  // ms
+    uint32_t aggregateThreads = 0;
+    uint32_t aggregateShard = 256;  // MiB
+
+    bool operator==(const Args&) const = default;
+};
+
+// Long only options
+enum longOption {
+    OPTION_CIR = 256,
+    OPTION_CIR_OVERSAMPLE,
+    OPTION_NO_RAW,
+    OPTION_STATS,
+    OPTION_STATS_WINDOW,
+    OPTION_STATS_HOP,
+    OPTION_STATS_PERCENTILES,
+    OPTION_DOPPLER,
+    OPTION_DOPPLER_RATE,
+    OPTION_DOPPLER_WINDOW,
+    OPTION_DOPPLER_HOP,
+    OPTION_DOPPLER_GROUP,
+    OPTION_DOPPLER_RATIO,
+    OPTION_PIPELINE,
+    OPTION_RESAMPLE,
+    OPTION_RESAMPLE_CUBIC,
+    OPTION_CSI_RATIO,
+    OPTION_CSI_RATIO_PRODUCT,
+    OPTION_CSI_RATIO_FLOAT,
+    OPTION_COVARIANCE,
+    OPTION_COVARIANCE_WINDOW,
+    OPTION_COVARIANCE_HOP,
+    OPTION_COVARIANCE_GROUP,
+    OPTION_MUSIC,
+    OPTION_MUSIC_WINDOW,
+    OPTION_ANTENNA_SPACING,
+    OPTION_INPUT_FILE,
+    OPTION_TOF_FUSION,
+    OPTION_TOF_ALIGN,
+    OPTION_FTM_FILE,
+    OPTION_HAMPEL,
+    OPTION_HAMPEL_WINDOW,
+    OPTION_HAMPEL_THRESHOLD,
+    OPTION_MEDIAN_FILTER,
+    OPTION_PCA,
+    OPTION_PCA_COMPONENTS,
+    OPTION_PCA_MEMORY,
+    OPTION_PCA_BASIS,
+    OPTION_EXPORT,
+    OPTION_EXPORT_INPUTS,
+    OPTION_EXPORT_WINDOW,
+    OPTION_EXPORT_HOP,
+    OPTION_EXPORT_INT8,
+    OPTION_EXPORT_COMPLEX,
+    OPTION_EXPORT_SHARD,
+    OPTION_EXPORT_SEED,
+    OPTION_TRIGGER,
+    OPTION_TRIGGER_THRESHOLD,
+    OPTION_TRIGGER_PRE,
+    OPTION_TRIGGER_HOLD,
+    OPTION_UDP_BATCH,
+    OPTION_UDP_FRAME,
+    OPTION_SHM,
+    OPTION_SHM_SIZE,
+    OPTION_STREAM,
+    OPTION_STREAM_BUFFER,
+    OPTION_STREAM_BACKPRESSURE,
+    OPTION_MULTICAST,
+    OPTION_MULTICAST_TTL,
+    OPTION_MULTICAST_INTERFACE,
+    OPTION_CLOCK_SYNC,
+    OPTION_CLOCK_INTERVAL,
+    OPTION_AGGREGATOR,
+    OPTION_AGGREGATE,
+    OPTION_AGGREGATE_OUTPUT,
+    OPTION_AGGREGATE_JITTER,
+    OPTION_AGGREGATE_THREADS,
+    OPTION_AGGREGATE_SHARD,
 };
 
 class Arguments {
    public:
+    // Parsed at start and changed by the GUI, read only by the thread changing
+    // them. Everything else, including threads started later, reads snapshot
     inline static struct Args arguments;
 
     static void init();
     static void parse(int argc, char* argv[]);
+    static void parse(int argc, char* argv[], Args& args);
+    // Arguments for threads other than the one changing them, see publish
+    static std::shared_ptr<const Args> snapshot();
+    // Makes the current arguments the snapshot, after every change of them
+    static void publish();
+    // Replaces the snapshot with args, the running capture sees them with its next record
+    static void publish(const Args& args);
+    static bool parse(const std::vector<std::pair<int, std::string>>& values, Args& args);
 
     static error_t parse_opt(int key, char* arg, argp_state* state);
 
    private:
+    inline static std::atomic<std::shared_ptr<const Args>> published;
+
     /* Program documentation. */
     inline static char doc[] =
         "FeitCSI - FeitCSI, the tool that enables CSI extraction and injection IEEE 802.11 frames";
@@ -118,6 +267,143 @@ class Arguments {
          "Strict mode: filter out values that do not contain a specific MCS"},
         {"mac", '#', "MAC", 0,
          "Default NICs MAC will be change to providing MAC xx:xx:xx:xx:xx:xx"},
+        {"cir", OPTION_CIR, 0, OPTION_ARG_OPTIONAL,
+         "Compute channel impulse response and power delay profile of every CSI"},
+        {"cir-oversample", OPTION_CIR_OVERSAMPLE, "FACTOR", 0,
+         "Zero padding factor of the channel impulse response [1-16]"},
+        {"no-raw", OPTION_NO_RAW, 0, OPTION_ARG_OPTIONAL,
+         "Do not store or send raw CSI, only results of enabled processing stages"},
+        {"stats", OPTION_STATS, 0, OPTION_ARG_OPTIONAL,
+         "Emit windowed amplitude and phase statistics per subcarrier"},
+        {"stats-window", OPTION_STATS_WINDOW, "RECORDS", 0, "Statistics window length in records"},
+        {"stats-hop", OPTION_STATS_HOP, "RECORDS", 0,
+         "Records between statistics snapshots, less than window for sliding windows"},
+        {"stats-percentiles", OPTION_STATS_PERCENTILES, "LIST", 0,
+         "Comma separated percentiles of statistics snapshots, default 5,50,95"},
+        {"doppler", OPTION_DOPPLER, 0, OPTION_ARG_OPTIONAL,
+         "Compute Doppler spectrogram over consecutive CSI records"},
+        {"doppler-rate", OPTION_DOPPLER_RATE, "HZ", 0,
+         "Uniform sample rate the CSI series is resampled to, default 100"},
+        {"doppler-window", OPTION_DOPPLER_WINDOW, "SAMPLES", 0, "Doppler FFT window, default 128"},
+        {"doppler-hop", OPTION_DOPPLER_HOP, "SAMPLES", 0,
+         "Samples between Doppler spectra, default 16"},
+        {"doppler-group", OPTION_DOPPLER_GROUP, "SUBCARRIERS", 0,
+         "Subcarriers averaged into one Doppler stream, whole band by default"},
+        {"doppler-ratio", OPTION_DOPPLER_RATIO, 0, OPTION_ARG_OPTIONAL,
+         "Use CSI ratio of the first two rx chains instead of raw CSI"},
+        {"pipeline", OPTION_PIPELINE, "FILE", 0,
+         "Processing pipeline definition, overrides processing options"},
+        {"resample", OPTION_RESAMPLE, "GRID", 0,
+         "Resample CSI of all formats onto common subcarrier grid FIRST:LAST:COUNT, frequency "
+         "offsets from the channel center in MHz"},
+        {"resample-cubic", OPTION_RESAMPLE_CUBIC, 0, OPTION_ARG_OPTIONAL,
+         "Use cubic instead of linear resampling weights"},
+        {"csi-ratio", OPTION_CSI_RATIO, "PAIRS", OPTION_ARG_OPTIONAL,
+         "Emit CSI ratio of rx chain pairs RX:REFERENCE,... free of CFO and STO, default 0:1"},
+        {"csi-ratio-product", OPTION_CSI_RATIO_PRODUCT, 0, OPTION_ARG_OPTIONAL,
+         "Emit conjugate product instead of ratio of the chain pairs"},
+        {"csi-ratio-float", OPTION_CSI_RATIO_FLOAT, 0, OPTION_ARG_OPTIONAL,
+         "Emit CSI ratio as 32 bit instead of 16 bit floats"},
+        {"covariance", OPTION_COVARIANCE, 0, OPTION_ARG_OPTIONAL,
+         "Emit eigenvalues, condition numbers and singular values of spatial covariance"},
+        {"covariance-window", OPTION_COVARIANCE_WINDOW, "RECORDS", 0,
+         "Covariance window length in records"},
+        {"covariance-hop", OPTION_COVARIANCE_HOP, "RECORDS", 0,
+         "Records between covariance snapshots, less than window for sliding windows"},
+        {"covariance-group", OPTION_COVARIANCE_GROUP, "SUBCARRIERS", 0,
+         "Subcarriers accumulated into one covariance matrix, default 1"},
+        {"music", OPTION_MUSIC, 0, OPTION_ARG_OPTIONAL,
+         "Estimate angle of arrival and time of flight of paths with smoothed MUSIC"},
+        {"music-window", OPTION_MUSIC_WINDOW, "RECORDS", 0,
+         "Records estimated in parallel in one batch, default 10"},
+        {"antenna-spacing", OPTION_ANTENNA_SPACING, "METERS", 0,
+         "Distance of receiving antennas, default 0.026"},
+        {"input-file", OPTION_INPUT_FILE, "FILE", 0,
+         "Run processing stages over recorded CSI instead of capturing, raw output is disabled"},
+        {"tof-fusion", OPTION_TOF_FUSION, 0, OPTION_ARG_OPTIONAL,
+         "Estimate distance from CSI phase slope calibrated by FTM RTT, use with FTM initiator"},
+        {"tof-align", OPTION_TOF_ALIGN, "MS", 0,
+         "CSI within this time around a FTM result is paired with it, default 50"},
+        {"ftm-file", OPTION_FTM_FILE, "FILE", 0,
+         "Recorded FTM results for --tof-fusion with --input-file, FTM_ file next to the input "
+         "file by default"},
+        {"hampel", OPTION_HAMPEL, 0, OPTION_ARG_OPTIONAL,
+         "Replace magnitude outliers of every subcarrier by median of the last records"},
+        {"hampel-window", OPTION_HAMPEL_WINDOW, "RECORDS", 0, "Hampel filter window, default 11"},
+        {"hampel-threshold", OPTION_HAMPEL_THRESHOLD, "SIGMAS", 0,
+         "Distance from median in scaled MADs marking an outlier, default 3"},
+        {"median-filter", OPTION_MEDIAN_FILTER, "RECORDS", 0,
+         "Replace magnitude of every subcarrier by median of the last RECORDS records"},
+        {"pca", OPTION_PCA, 0, OPTION_ARG_OPTIONAL,
+         "Emit projections of magnitude onto its principal components, learned online"},
+        {"pca-components", OPTION_PCA_COMPONENTS, "COUNT", 0, "Principal components, default 4"},
+        {"pca-memory", OPTION_PCA_MEMORY, "RECORDS", 0,
+         "Records the principal components are learned from, default 1000"},
+        {"pca-basis", OPTION_PCA_BASIS, "RECORDS", 0,
+         "Emit mean and principal components every RECORDS records, none by default"},
+        {"export", OPTION_EXPORT, "DIR", 0,
+         "Export recorded CSI as sharded fp16 tensors of fixed length windows for training"},
+        {"export-inputs", OPTION_EXPORT_INPUTS, "FILE", 0,
+         "Lines 'FILE [LABEL]' of recorded CSI to export, --input-file by default"},
+        {"export-window", OPTION_EXPORT_WINDOW, "RECORDS", 0, "Records per window, default 100"},
+        {"export-hop", OPTION_EXPORT_HOP, "RECORDS", 0,
+         "Records between windows, window length by default"},
+        {"export-int8", OPTION_EXPORT_INT8, 0, OPTION_ARG_OPTIONAL,
+         "Export int8 values scaled per rx/tx/subcarrier instead of fp16"},
+        {"export-complex", OPTION_EXPORT_COMPLEX, 0, OPTION_ARG_OPTIONAL,
+         "Export real and imaginary part instead of magnitude"},
+        {"export-shard", OPTION_EXPORT_SHARD, "WINDOWS", 0, "Windows per shard, default 1024"},
+        {"export-seed", OPTION_EXPORT_SEED, "SEED", 0,
+         "Shuffle windows deterministically by SEED, capture order by default"},
+        {"trigger", OPTION_TRIGGER, "DETECTOR", OPTION_ARG_OPTIONAL,
+         "Write raw records only around detected events [variance|ratio], default variance"},
+        {"trigger-threshold", OPTION_TRIGGER_THRESHOLD, "VALUE", 0,
+         "Normalized variance firing the trigger, default 0.01"},
+        {"trigger-pre", OPTION_TRIGGER_PRE, "SECONDS", 0,
+         "Buffered records written when the trigger fires, default 2"},
+        {"trigger-hold", OPTION_TRIGGER_HOLD, "SECONDS", 0,
+         "Recording continues this long after the last detection, default 5"},
+        {"udp-batch", OPTION_UDP_BATCH, "DATAGRAMS", 0,
+         "Datagrams sent to the UDP peer by one call, 1 sends each right away, default 32"},
+        {"udp-frame", OPTION_UDP_FRAME, "MTU", OPTION_ARG_OPTIONAL,
+         "Split records sent over UDP into stream protocol fragments of MTU bytes (128 - 65507), "
+         "default 1472"},
+        {"shm", OPTION_SHM, "NAME", 0,
+         "Also write streamed records to the shared memory ring /dev/shm/NAME"},
+        {"shm-size", OPTION_SHM_SIZE, "MIB", 0, "Size of the shared memory ring, default 64"},
+        {"stream", OPTION_STREAM, "ADDRESSES", 0,
+         "Also stream records losslessly to clients of tcp:[HOST:]PORT or unix:PATH, comma "
+         "separated"},
+        {"stream-buffer", OPTION_STREAM_BUFFER, "MIB", 0,
+         "High watermark of records queued for a stream client, default 16"},
+        {"stream-backpressure", OPTION_STREAM_BACKPRESSURE, "POLICY", 0,
+         "Stream client over the high watermark: block capture, drop oldest records or "
+         "disconnect, default drop"},
+        {"multicast", OPTION_MULTICAST, "GROUP:PORT", 0,
+         "Also send records once to an IPv4 or [IPv6] multicast group in stream protocol "
+         "fragments of the --udp-frame MTU"},
+        {"multicast-ttl", OPTION_MULTICAST_TTL, "HOPS", 0,
+         "Routers multicast datagrams may pass, default 1 stays on the local network"},
+        {"multicast-interface", OPTION_MULTICAST_INTERFACE, "NAME", 0,
+         "Interface multicast datagrams are sent from, chosen by routing by default"},
+        {"clock-sync", OPTION_CLOCK_SYNC, "HOST[:PORT]", 0,
+         "Timestamp records on the clock of a coordinator, any FeitCSI with --udp-socket, "
+         "default port 8008"},
+        {"clock-interval", OPTION_CLOCK_INTERVAL, "MS", 0,
+         "Time between clock synchronization exchanges, default 1000"},
+        {"aggregator", OPTION_AGGREGATOR, "ADDRESS", 0,
+         "Also push records to an aggregator at udp:HOST:PORT or tcp:HOST:PORT"},
+        {"aggregate", OPTION_AGGREGATE, "ADDRESSES", 0,
+         "Run as aggregator receiving records of nodes on udp:[HOST:]PORT and tcp:[HOST:]PORT, "
+         "comma separated"},
+        {"aggregate-output", OPTION_AGGREGATE_OUTPUT, "DIR", 0,
+         "Write aggregated records into shards per node, MAC and format"},
+        {"aggregate-jitter", OPTION_AGGREGATE_JITTER, "MS", 0,
+         "Records wait this long for earlier ones of other nodes, default 100"},
+        {"aggregate-threads", OPTION_AGGREGATE_THREADS, "THREADS", 0,
+         "Receiving threads, one per core by default"},
+        {"aggregate-shard", OPTION_AGGREGATE_SHARD, "MIB", 0,
+         "Size a shard is closed at and the next started, default 256"},
         {0}};
 };
 
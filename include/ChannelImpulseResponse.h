@@ -0,0 +1,53 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHANNEL_IMPULSE_RESPONSE_H
+#define CHANNEL_IMPULSE_RESPONSE_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "Csi.h"
+
+struct ToneMap {
+    uint32_t fftSize;
+    std::vector<int32_t> tones;  // signed subcarrier index of every reported CSI value
+};
+
+/**
+ * Transforms CSI into the time domain. Reported subcarriers are placed on
+ * their OFDM tone positions, guard and null (DC) tones are left zero and the
+ * spectrum is zero padded by the oversampling factor before the IFFT.
+ */
+class ChannelImpulseResponse {
+   public:
+    static void compute(Csi& csi, uint32_t oversample = 1);
+
+    static const ToneMap& getToneMap(const Csi& csi);
+    static const ToneMap& getToneMap(uint32_t format, uint32_t numSubCarriers);
+
+   private:
+    inline static std::mutex toneMapsMutex;
+    inline static std::map<uint64_t, ToneMap> toneMaps;
+
+    static ToneMap buildToneMap(uint32_t format, uint32_t numSubCarriers);
+    static void addTones(ToneMap& map, int32_t first, int32_t last);
+};
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <sys/socket.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define CLOCK_MAGIC 0x4b4c4346  // "FCLK" little endian
+#define CLOCK_VERSION 1
+
+// Exchanges the offset is chosen from, the one with the shortest round trip wins
+#define CLOCK_SAMPLES 8
+// Frequency error assumed between two exchanges, same as NTP
+#define CLOCK_DRIFT_PPM 15
+// Offset changes below are slewed so timestamps never go back, larger are stepped
+#define CLOCK_STEP_NS 128000000
+#define CLOCK_SLEW_PPM 500
+
+enum clockMessageType : uint8_t {
+    CLOCK_REQUEST = 1,
+    CLOCK_RESPONSE = 2,
+};
+
+/**
+ * Two way time transfer, NTP like. The node sends t1, the coordinator
+ * answers with the time the request arrived t2 and the time the answer
+ * left t3, the node notes its arrival t4. Times are ns since epoch, the
+ * coordinator's are already corrected by its own synchronization so
+ * coordinators can be chained. All fields are little endian.
+ */
+struct __attribute__((__packed__)) ClockPacket {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint16_t reserved;
+    uint32_t sequence;
+    uint32_t uncertainty;  // of the coordinator's own clock, ns
+    int64_t t1;
+    int64_t t2;
+    int64_t t3;
+};  // size 40 bytes
+
+struct ClockSyncStats {
+    bool synchronized = false;
+    int64_t offset = 0;       // ns added to the local clock, slewing towards target
+    int64_t target = 0;       // ns, of the best exchange
+    int64_t delay = 0;        // round trip of the best exchange, ns
+    uint64_t uncertainty = 0;  // ns, now
+    uint64_t exchanges = 0;
+    uint64_t timeouts = 0;
+    uint64_t steps = 0;
+};
+
+/**
+ * Keeps the local clock on the timebase of a coordinator. A thread polls
+ * the coordinator every interval, the offset is taken from the exchange
+ * of the last CLOCK_SAMPLES with the shortest round trip, which suffers
+ * least from queuing. Half of its round trip bounds the error of an
+ * asymmetric path, the bound grows by CLOCK_DRIFT_PPM while the exchange
+ * ages. Every FeitCSI UDP socket answers requests, so any node started
+ * with --udp-socket can be the coordinator.
+ */
+class ClockSync {
+   public:
+    static ClockSync& getInstance();
+
+    ~ClockSync();
+
+    // coordinator is HOST[:PORT] or [HOST]:PORT, port 8008 by default
+    void start(const std::string& coordinator, uint32_t intervalMs);
+    void stop();
+    const std::string& getCoordinator() const;
+    uint32_t getInterval() const;
+
+    // Corrected time in us since epoch, uncertainty 0 while not synchronized
+    uint64_t now(uint32_t* uncertainty = nullptr);
+    // Local CLOCK_REALTIME in ns since epoch
+    static int64_t localTime();
+    // Corrected time of a local time in ns, uncertainty in ns
+    int64_t correct(int64_t local, uint64_t* uncertainty = nullptr);
+    ClockSyncStats getStats();
+
+    // Answers a request received at local time received, false when buf is none
+    static bool answer(int fd,
+                       const char* buf,
+                       size_t size,
+                       int64_t received,
+                       const struct sockaddr* from,
+                       socklen_t fromLen);
+
+   private:
+    ClockSync() = default;
+
+    struct Sample {
+        int64_t offset;
+        int64_t delay;
+        int64_t time;  // local time the answer arrived
+        uint32_t remoteUncertainty;
+    };
+
+    int fd = -1;
+    std::string coordinator;
+    std::thread worker;
+    std::atomic<bool> running = false;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    uint32_t interval = 1000;
+
+    std::mutex mutex;
+    std::deque<Sample> samples;
+    bool synchronized = false;
+    int64_t base = 0;        // offset applied at baseTime
+    int64_t baseTime = 0;    // local time the slew towards target started
+    int64_t target = 0;
+    Sample best = {};
+    ClockSyncStats stats;
+
+    void run();
+    bool exchange(uint32_t sequence);
+    void addSample(const Sample& sample);
+    int64_t appliedOffset(int64_t local) const;
+};
+
+#endif
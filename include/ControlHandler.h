@@ -0,0 +1,54 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTROL_HANDLER_H
+#define CONTROL_HANDLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ControlProtocol.h"
+
+class UdpSocket;
+
+/**
+ * Executes requests of the binary control protocol (ControlProtocol.h)
+ * received by the UDP socket and builds their replies.
+ */
+class ControlHandler {
+   public:
+    // False when buf is no control request, started tells a START succeeded
+    static bool handle(const char* buf,
+                       size_t size,
+                       UdpSocket* udpSocket,
+                       std::vector<char>& reply,
+                       bool& started);
+
+   private:
+    inline static uint32_t lastCorrelationId = 0;
+    inline static std::vector<char> lastReply;
+    inline static uint32_t applyMicroseconds = 0;
+
+    static controlResult apply(const ControlHeader& header, const char* payload);
+    static void buildReply(const ControlHeader& request,
+                           controlResult result,
+                           UdpSocket* udpSocket,
+                           std::vector<char>& reply);
+};
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTROL_PROTOCOL_H
+#define CONTROL_PROTOCOL_H
+
+#include <cstdint>
+
+/**
+ * Binary control protocol on the UDP control port, replacing the text
+ * commands. All fields are little endian. A request is a ControlHeader
+ * followed by payloadSize bytes, the reply has the same command with
+ * CONTROL_REPLY set and the correlation id of the request. A request
+ * repeated with the correlation id of the last one is answered again
+ * without being applied twice.
+ *
+ * START and RECONFIGURE carry ControlOption entries, each followed by size
+ * bytes of the option value as on the command line. key is the short option
+ * character or the longOption value (Arguments.h), new options are only
+ * appended. Options not given keep their current value. Only what changed
+ * is applied: a new frequency retunes the monitor interface, other capture
+ * settings restart capture, changes of MAC, TX power or phy recreate the
+ * interface. STOP halts capture but keeps the interface.
+ *
+ * START, STOP and RECONFIGURE replies carry ControlStatusData, STATUS too,
+ * STATS replies carry ControlStatsData.
+ */
+
+#define CONTROL_MAGIC 0x4c544346  // "FCTL"
+#define CONTROL_VERSION 1
+#define CONTROL_REPLY 0x8000
+
+enum controlCommand : uint16_t {
+    CONTROL_START = 1,
+    CONTROL_STOP = 2,
+    CONTROL_RECONFIGURE = 3,
+    CONTROL_STATUS = 4,
+    CONTROL_STATS = 5,
+};
+
+enum controlResult : uint16_t {
+    CONTROL_OK = 0,
+    CONTROL_BAD_VERSION = 1,
+    CONTROL_BAD_COMMAND = 2,
+    CONTROL_BAD_PAYLOAD = 3,
+    CONTROL_BAD_OPTIONS = 4,
+};
+
+struct __attribute__((__packed__)) ControlHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t command;
+    uint32_t correlationId;
+    uint16_t result;  // controlResult of replies
+    uint16_t reserved;
+    uint32_t payloadSize;
+};  // size 20 bytes
+
+struct __attribute__((__packed__)) ControlOption {
+    uint16_t key;
+    uint16_t size;
+};  // size 4 bytes
+
+struct __attribute__((__packed__)) ControlStatusData {
+    uint8_t capturing;
+    uint8_t interfaceReady;
+    uint8_t measure;
+    uint8_t inject;
+    uint8_t ftm;
+    uint8_t ftmResponder;
+    uint16_t frequency;
+    char bandwidth[8];
+    uint32_t applyMicroseconds;  // taken by the last START, STOP or RECONFIGURE
+};  // size 24 bytes
+
+struct __attribute__((__packed__)) ControlStatsData {
+    uint64_t sent;
+    uint64_t dropped;
+    uint64_t batches;
+    uint64_t bytes;
+    uint64_t retransmitted;
+};  // size 40 bytes
+
+#endif
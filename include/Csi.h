@@ -22,11 +22,22 @@
 #include <cstdint>
 #include <string>
 #include <complex>
+#include <deque>
+#include <map>
+#include <memory>
 #include <vector>
 #include "UdpSocket.h"
+#include "rs.h"
 
 #define CSI_HEADER_LENGTH 272
 
+struct CsiGap {
+    uint32_t format;
+    uint32_t numSubCarriers;  // after the gap is removed
+    uint32_t start;           // first bogus subcarrier
+    uint32_t count;
+};
+
 struct __attribute__((__packed__)) RawHeaderData
 {
     uint32_t csiDataSize;
@@ -48,6 +59,19 @@ struct __attribute__((__packed__)) RawHeaderData
     uint32_t space96[44];
 };
 
+// Immutable state of CSI values, shared between a record and its layer cache.
+// A representation that is not valid in the layer is not stored
+struct CsiLayer {
+    std::shared_ptr<const std::vector<std::complex<double>>> csi;  // when complexValid
+    std::shared_ptr<const std::vector<double>> magnitude;           // when polarValid
+    std::shared_ptr<const std::vector<double>> phase;
+    uint32_t numSubCarriers = 0;
+    bool polarValid = true;  // magnitude and phase match csi
+    bool complexValid = true;
+};
+
+#define CSI_LAYER_CACHE_SIZE 8
+
 class Csi
 {
 
@@ -60,23 +84,38 @@ public:
     void loadFromMemory(uint8_t *rawData);
     void save();
     void sendUDP(UdpSocket *udpSocket);
-    void backup();
-    void restore();
+    // Record kept apart from its Csi, e.g. buffered before a trigger
+    static void save(const RawHeaderData &header, const uint8_t *rawCsiData);
+    static void sendUDP(UdpSocket *udpSocket, const RawHeaderData &header, const uint8_t *rawCsiData,
+                        uint32_t clockUncertainty);
+    const std::shared_ptr<const CsiLayer>& baseLayer();
+    std::shared_ptr<const CsiLayer> cachedLayer(uint64_t key);
+    void cacheLayer(uint64_t key, std::shared_ptr<const CsiLayer> layer);
+    std::shared_ptr<const CsiLayer> snapshot(bool polarValid, bool complexValid);
+    void view(const CsiLayer& layer);
     void magnitudePhaseToComplex();
     void recalcMagnitudePhase();
     void unwrapPhase();
     const std::vector<uint32_t> getPilotIndices();
+    const uint8_t *getRawCsiData() const;
 
     RawHeaderData rawHeaderData;
+    // us of the timestamp to the coordinator, 0 when not synchronized. Not part of the
+    // record, the firmware header has no spare field for it
+    uint32_t clockUncertainty = 0;
     uint32_t numRx;
     uint32_t numTx;
     uint32_t numSubCarriers = 0;
     uint32_t format = 0;
     uint32_t channelWidth = 0;
     std::vector<std::complex<double>> csi;
-    std::vector<std::complex<double>> csiBackup;
     std::vector<double> magnitude;
     std::vector<double> phase;
+    std::vector<std::complex<double>> cir;
+    std::vector<double> powerDelayProfile;
+    uint32_t cirLength = 0;
+    std::vector<double> dopplerSpectrum;
+    uint32_t dopplerLength = 0;
 
 private:
     const std::vector<uint32_t> NO_NHT_20_PILOT_INDICES = {5, 19, 32, 46};                                                                                                                                                              // 52 subcarriers
@@ -89,7 +128,21 @@ private:
     const std::vector<uint32_t> HE_80_PILOT_INDICES = {32, 100, 166, 234, 274, 342, 408, 476, 519, 587, 653, 721, 761, 829, 895, 963};                                                                                                  // 996 subcarriers
     const std::vector<uint32_t> HE_160_PILOT_INDICES = {32, 100, 166, 234, 274, 342, 408, 476, 519, 587, 653, 721, 761, 829, 895, 963, 1028, 1096, 1162, 1230, 1270, 1338, 1404, 1472, 1515, 1583, 1649, 1717, 1757, 1825, 1891, 1959}; // 1992 subcarriers
 
+    // Bogus subcarriers reported by firmware in 160 MHz
+    static constexpr CsiGap CSI_160_GAPS[] = {
+        {RATE_MCS_VHT_MSK, 484, 242, 14},
+        {RATE_MCS_HE_MSK, 1992, 996, 28},
+    };
+
     std::string saveFilePath;
+
+    // Unprocessed values, decoded from rawCsiData on first use
+    std::shared_ptr<const CsiLayer> base;
+    uint32_t rawNumSubCarriers = 0;  // after fixCsiBug
+    uint32_t rawNumValues = 0;
+    // Processed values keyed by hash of the processing applied to the base
+    std::map<uint64_t, std::shared_ptr<const CsiLayer>> layers;
+    std::deque<uint64_t> layerOrder;
     uint8_t *rawCsiData = nullptr;
 
     void fixCsiBug();
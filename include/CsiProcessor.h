@@ -19,9 +19,12 @@
 #ifndef CSI_PROCESSOR_H
 #define CSI_PROCESSOR_H
 
+#include <memory>
 #include <string>
 #include <vector>
+#include "Arguments.h"
 #include "Csi.h"
+#include "ProcessingGraph.h"
 #include "main.h"
 
 class CsiProcessor
@@ -33,13 +36,15 @@ public:
     bool loadCsi();
     void saveCsi();
     void process(Csi &csi);
+    void run();
 
 
     ~CsiProcessor();
 private:
     void clearState();
-    void interpolate(Csi &csi, enum processor type);
-    void phaseCalibLinearTransform(Csi &csi);
+
+    std::unique_ptr<ProcessingGraph> graph;
+    Args graphArguments;  // the graph was created with
 };
 
 #endif
\ No newline at end of file
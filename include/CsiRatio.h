@@ -0,0 +1,54 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSI_RATIO_H
+#define CSI_RATIO_H
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Csi.h"
+#include "DerivedRecord.h"
+
+struct AntennaPair {
+    uint32_t rx;
+    uint32_t reference;
+};
+
+/**
+ * Removes CFO and STO common to all antennas of a receiver by multiplying CSI
+ * of one rx chain by the conjugate of another, or dividing them. Computed
+ * directly from raw int16 values, one output chain for every pair and tx.
+ */
+class CsiRatio {
+   public:
+    void configure(const std::vector<AntennaPair>& pairs, bool product, bool half);
+    std::unique_ptr<DerivedRecord> compute(const Csi& csi);
+
+    static std::vector<AntennaPair> parsePairs(const std::string& pairs);
+
+   private:
+    std::vector<AntennaPair> pairs = {{0, 1}};
+    bool product = false;
+    bool half = true;
+    std::vector<std::complex<float>> values;
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CSI_STATISTICS_H
+#define CSI_STATISTICS_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "Csi.h"
+#include "DerivedRecord.h"
+
+struct StatisticsWindow {
+    uint32_t numRx = 0;
+    uint32_t numTx = 0;
+    uint32_t numSubCarriers = 0;
+    uint32_t numValues = 0;  // amplitudes followed by phases of all rx/tx pairs
+    uint32_t count = 0;
+    uint32_t head = 0;
+    uint32_t sinceSnapshot = 0;
+    std::vector<double> ring;  // windowSize records of numValues
+    std::vector<double> mean;  // amplitudes
+    std::vector<double> m2;
+    std::vector<double> sinSum;  // phases
+    std::vector<double> cosSum;
+};
+
+/**
+ * Per transmitter running statistics of amplitude and phase of every
+ * subcarrier and rx/tx pair. Amplitude mean and variance are updated
+ * incrementally (Welford), phase mean and variance are circular, from the
+ * running sums of sine and cosine. Min, max and percentiles are evaluated
+ * over the window only when a snapshot is emitted. The sums are recomputed
+ * from the window every time a sliding window wraps, so rounding errors of
+ * removed values do not accumulate.
+ *
+ * Window of N records with hop H emits a snapshot every H records once the
+ * window is full. H == N gives tumbling windows, H < N sliding windows.
+ *
+ * Snapshot values per rx/tx pair and subcarrier:
+ * amplitude mean, variance, min, max, percentiles..., then the same for phase
+ * with the circular mean, circular variance 1 - R (R mean resultant length)
+ * and min, max and percentiles of the wrapped values
+ */
+class CsiStatistics {
+   public:
+    void configure(uint32_t windowSize, uint32_t hop, const std::vector<double>& percentiles);
+
+    std::unique_ptr<DerivedRecord> update(const Csi& csi);
+
+    uint32_t valuesPerMetric() const;
+
+   private:
+    uint32_t windowSize = 100;
+    uint32_t hop = 100;
+    std::vector<double> percentiles = {5, 50, 95};
+    std::map<uint64_t, StatisticsWindow> windows;
+
+    void reset(StatisticsWindow& w, const Csi& csi);
+    void recompute(StatisticsWindow& w);
+    std::unique_ptr<DerivedRecord> snapshot(StatisticsWindow& w, const Csi& csi);
+};
+
+#endif
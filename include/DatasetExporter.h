@@ -0,0 +1,109 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATASET_EXPORTER_H
+#define DATASET_EXPORTER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ExportInput {
+    std::string file;
+    std::string label;
+};
+
+struct ExportConfig {
+    std::string directory;
+    uint32_t window = 100;  // records per tensor
+    uint32_t hop = 0;       // records between windows, 0 for the window length
+    bool int8 = false;      // per channel scaled int8 instead of fp16
+    bool complex = false;   // real and imaginary part instead of magnitude
+    uint32_t shardSize = 1024;  // windows per shard
+    uint64_t seed = 0;          // shuffles windows of a shard group, 0 keeps capture order
+    uint32_t threads = 0;
+};
+
+// Quantized window of one transmitter
+struct TensorWindow {
+    uint32_t input = 0;
+    uint8_t srcMac[6];
+    uint32_t numRx = 0;
+    uint32_t numTx = 0;
+    uint32_t numSubCarriers = 0;
+    std::vector<uint64_t> timestamps;
+    std::vector<uint8_t> values;  // window x rx x tx x subcarriers [x re, im]
+    std::vector<float> scales;    // int8 only, rx x tx x subcarriers
+};
+
+// Window spooled to disk, values, timestamps and scales back to back
+struct WindowIndex {
+    uint32_t input = 0;
+    uint64_t offset = 0;  // in the spool of the input
+    uint8_t srcMac[6];
+    uint32_t numRx = 0;
+    uint32_t numTx = 0;
+    uint32_t numSubCarriers = 0;
+    uint64_t firstTimestamp = 0;
+    uint64_t lastTimestamp = 0;
+};
+
+/**
+ * Converts recorded CSI into fixed length windows for training, after the
+ * transform stages of the pipeline. Inputs are read in parallel, windows of
+ * the same shape are shuffled deterministically by seed and split into
+ * shards written in parallel:
+ *
+ *   shard-NNNNN.bin             fp16 or int8 tensor [windows, T, rx, tx, sc(, 2)]
+ *   shard-NNNNN.scales.bin      int8 only, float32 [windows, rx, tx, sc]
+ *   shard-NNNNN.timestamps.bin  uint64 [windows, T]
+ *   shard-NNNNN.labels.csv      label, source and MAC of every window
+ *   manifest.json               shapes and files of all shards
+ *
+ * Values are little endian, int8 value times its channel scale restores the
+ * original. Windows are appended to a spool file of their input as they are
+ * produced, only their index is kept in memory to shuffle and group them.
+ * Shards are then copied from the spools, which are removed afterwards.
+ */
+class DatasetExporter {
+   public:
+    explicit DatasetExporter(const ExportConfig& config);
+
+    // Lines "FILE [LABEL]", label is the file name without extension by default
+    static std::vector<ExportInput> readInputs(const std::string& path);
+    static ExportInput input(const std::string& file);
+
+    void run(const std::vector<ExportInput>& inputs);
+
+   private:
+    ExportConfig config;
+
+    std::vector<WindowIndex> extract(const ExportInput& input, uint32_t index);
+    void quantize(const std::vector<float>& values, uint32_t valuesPerRecord, TensorWindow& w);
+    void writeShard(const std::string& name,
+                    const std::vector<const WindowIndex*>& windows,
+                    const std::vector<ExportInput>& inputs);
+    void writeManifest(const std::vector<std::string>& names,
+                       const std::vector<std::vector<const WindowIndex*>>& shards);
+    std::vector<uint32_t> shape(const WindowIndex& w, size_t numWindows);
+    size_t valuesSize(const WindowIndex& w);
+    size_t scalesSize(const WindowIndex& w);
+    std::string spoolPath(uint32_t input);
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DERIVED_RECORD_H
+#define DERIVED_RECORD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Csi.h"
+#include "UdpSocket.h"
+
+#define DERIVED_HEADER_LENGTH 40
+
+enum derivedRecordType : uint16_t {
+    DERIVED_CIR = 1,
+    DERIVED_STATISTICS = 2,
+    DERIVED_DOPPLER = 3,
+    DERIVED_PROCESSED = 4,
+    DERIVED_RATIO = 5,
+    DERIVED_COVARIANCE = 6,
+    DERIVED_AOA_TOF = 7,
+    DERIVED_DISTANCE = 8,
+    DERIVED_PCA = 9,
+    DERIVED_PCA_BASIS = 10,
+    DERIVED_PROJECTION = 11,  // CSI chains and subcarriers chosen by a subscriber
+};
+
+enum derivedValueType : uint16_t {
+    VALUE_FLOAT32 = 0,
+    VALUE_COMPLEX_FLOAT32 = 1,
+    VALUE_COMPLEX_FLOAT16 = 2,  // IEEE 754 half precision, saturated
+    VALUE_FLOAT16 = 3,
+};
+
+struct __attribute__((__packed__)) DerivedHeaderData {
+    uint32_t dataSize;
+    uint16_t type;
+    uint8_t numRx;
+    uint8_t numTx;
+    uint64_t timestamp;
+    uint32_t rateNflag;
+    uint32_t numValues;  // values per rx/tx pair
+    uint8_t srcMac[6];
+    uint16_t valueType;
+    uint32_t numSubCarriers;
+    uint32_t numRecords;  // CSI records the values were computed from
+};  // size 40 bytes
+
+/**
+ * Result of a processing stage computed from a single CSI record. It is
+ * written next to the raw CSI output file with its own prefix, or sent to
+ * the UDP peer, in the same way as FTM results.
+ */
+class DerivedRecord {
+   public:
+    DerivedRecord(derivedRecordType type, const Csi& csi);
+
+    void setValues(const std::vector<double>& values, uint32_t numValues);
+    void setValues(const std::vector<std::complex<double>>& values, uint32_t numValues);
+    void setValues(const std::vector<std::complex<float>>& values, uint32_t numValues, bool half);
+    void save();
+    void sendUDP(UdpSocket* udpSocket);
+    void output(UdpSocket* udpSocket);
+
+    static uint16_t toHalf(float value);
+    static std::string prefix(uint16_t type);
+
+    DerivedHeaderData header;
+    std::vector<uint8_t> data;
+    uint32_t clockUncertainty;  // of the CSI timestamp, not part of the record
+
+   private:
+    std::string filePrefix();
+};
+
+#endif
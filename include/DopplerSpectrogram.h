@@ -0,0 +1,83 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DOPPLER_SPECTROGRAM_H
+#define DOPPLER_SPECTROGRAM_H
+
+#include <complex>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "Csi.h"
+#include "DerivedRecord.h"
+#include "Fft.h"
+
+struct DopplerState {
+    uint32_t numStreams = 0;
+    uint32_t numSubCarriers = 0;
+    uint64_t lastTimestamp = 0;  // us
+    uint64_t nextSampleTime = 0;  // us
+    uint32_t count = 0;
+    uint32_t head = 0;
+    uint32_t sinceSpectrum = 0;
+    std::vector<std::complex<double>> last;
+    std::vector<std::complex<double>> ring;  // windowSize samples of numStreams
+};
+
+/**
+ * Short time Fourier transform of the CSI time series of every transmitter.
+ *
+ * Subcarriers of every rx/tx pair (or of the rx1 * conj(rx2) ratio, which
+ * cancels CFO and STO) are averaged in groups, linearly resampled onto a
+ * uniform grid from record timestamps and kept in a ring of windowSize
+ * samples. Every hop samples the Hann windowed ring is transformed, so a
+ * record costs windowSize * log(windowSize) / hop on average. Records older
+ * than the last one of their transmitter are dropped.
+ *
+ * Spectrum values are in dB, DC centered (-rate/2 ... rate/2), laid out as
+ * [stream][group][frequency].
+ */
+class DopplerSpectrogram {
+   public:
+    void configure(double sampleRate,
+                   uint32_t windowSize,
+                   uint32_t hop,
+                   uint32_t groupSize,
+                   bool ratio);
+
+    // Spectra that became due with this record, oldest first
+    std::vector<std::unique_ptr<DerivedRecord>> update(Csi& csi);
+
+   private:
+    double sampleRate = 100;
+    uint32_t windowSize = 128;
+    uint32_t hop = 16;
+    uint32_t groupSize = 0;
+    bool ratio = false;
+    std::shared_ptr<const Fft> plan;
+    std::vector<double> window;
+    std::map<uint64_t, DopplerState> states;
+
+    uint32_t numGroups(uint32_t numSubCarriers) const;
+    void sample(const Csi& csi, uint32_t numStreams, std::vector<std::complex<double>>& out);
+    void push(DopplerState& state, const std::complex<double>* sample);
+    std::unique_ptr<DerivedRecord> spectrum(DopplerState& state, Csi& csi);
+};
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Planned complex FFT of arbitrary size.
+ *
+ * Power-of-two sizes use an iterative radix-2 transform with precomputed
+ * bit-reversal and twiddle tables. Any other size is computed with
+ * Bluestein's chirp-z algorithm on top of a power-of-two plan. Plans are
+ * immutable once built and cached per size, so they can be shared between
+ * threads.
+ */
+class Fft {
+   public:
+    static std::shared_ptr<const Fft> plan(uint32_t size);
+
+    void forward(std::complex<double>* data) const;
+
+    // Scaled by 1/size, so inverse(forward(x)) == x
+    void inverse(std::complex<double>* data) const;
+
+    const uint32_t size;
+
+    explicit Fft(uint32_t size);
+
+   private:
+    inline static std::mutex plansMutex;
+    inline static std::map<uint32_t, std::shared_ptr<const Fft>> plans;
+
+    bool powerOfTwo;
+    std::vector<uint32_t> bitReverse;
+    std::vector<std::complex<double>> twiddles;
+
+    // Bluestein
+    std::vector<std::complex<double>> chirp;
+    std::vector<std::complex<double>> chirpSpectrum;
+    std::shared_ptr<const Fft> convolution;
+
+    void radix2(std::complex<double>* data, bool inverse) const;
+    void bluestein(std::complex<double>* data, bool inverse) const;
+};
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAMPEL_FILTER_H
+#define HAMPEL_FILTER_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include "Csi.h"
+#include "OrderStatisticWindow.h"
+#include "ThreadPool.h"
+
+// Scales median absolute deviation to standard deviation of normal data
+#define HAMPEL_MAD_SCALE 1.4826
+
+struct HampelState {
+    uint32_t numRx = 0;
+    uint32_t numTx = 0;
+    uint32_t numSubCarriers = 0;
+    OrderStatisticWindow window;  // one series per chain and subcarrier
+};
+
+/**
+ * Per transmitter filter of magnitude of every subcarrier over the last N
+ * records, the current one included. The Hampel filter replaces a value by
+ * the window median when it is further than threshold * 1.4826 * MAD from
+ * it, threshold 0 makes it a plain median filter. Magnitude is filtered in
+ * place, the window keeps the unfiltered values. For an even number of
+ * values the MAD is approximate, it is the lower median of the deviations
+ * instead of the mean of the two middle ones, the median itself is exact.
+ * The state has to survive between records, the filter must not be
+ * created again for every record.
+ */
+class HampelFilter {
+   public:
+    void configure(uint32_t windowSize, double threshold, uint32_t numThreads);
+
+    // Returns number of replaced values
+    uint32_t update(Csi& csi);
+    // Forgets the windows of all transmitters
+    void clear();
+
+   private:
+    uint32_t windowSize = 11;
+    double threshold = 3;
+    std::unique_ptr<ThreadPool> pool;
+    std::map<uint64_t, HampelState> states;
+
+    uint32_t filter(HampelState& s, double* magnitude, uint32_t first, uint32_t last);
+};
+
+#endif
@@ -20,6 +20,7 @@
 #define MAIN_CONTROLLER_H
 
 #include <thread>
+#include "Arguments.h"
 #include "Csi.h"
 #include "PacketInjector.h"
 #include "UdpSocket.h"
@@ -36,6 +37,10 @@ class MainController {
 
     Plot* plotPhase;
 
+    Plot* plotCir = nullptr;
+
+    Plot* plotDoppler = nullptr;
+
     static MainController* getInstance();
 
     static gint updatePlots();
@@ -46,6 +51,16 @@ class MainController {
 
     void runNoGui(bool detach = false);
 
+    void startCapture();
+
+    void stopCapture();
+
+    void reconfigure(const Args& previous);
+
+    bool isCapturing() const;
+
+    bool isInterfaceReady() const;
+
     void measureCsi(bool stop = false);
 
     void injectPackets(bool stop = false);
@@ -71,6 +86,9 @@ class MainController {
 
     inline static Csi* csiToPlot = nullptr;
 
+    // Doppler spectra are produced every hop, kept between records for plotting
+    inline static std::vector<double> lastDopplerSpectrum;
+
     guint updatePlotsSourceId = 0;
 
     pthread_t measureCsiThread = 0;
@@ -97,6 +115,10 @@ class MainController {
 
     static void* ftmResponder(void* arg);
 
+    void startThreads(bool detach);
+
+    void syncClock();
+
     bool measuring = false;
 
     bool injecting = false;
@@ -104,6 +126,8 @@ class MainController {
     bool ftmEnabled = false;
 
     bool ftmResponderEnabled = false;
+
+    bool interfaceReady = false;  // monitor interface created, until restoreState
 };
 
 #endif
\ No newline at end of file
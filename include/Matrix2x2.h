@@ -0,0 +1,52 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATRIX_2X2_H
+#define MATRIX_2X2_H
+
+#include <complex>
+#include <cstddef>
+
+/**
+ * Closed form decompositions of many 2x2 matrices at once. Every argument is
+ * an array with one element per matrix, e.g. one per subcarrier, so the loops
+ * vectorize across matrices.
+ */
+namespace matrix2x2 {
+// Hermitian [[a, b], [conj(b), d]], lambda1 >= lambda2, vector is the unit
+// eigenvector of lambda1 as two consecutive values with real first element
+void hermitianEigen(size_t n,
+                    const double* a,
+                    const double* d,
+                    const double* bRe,
+                    const double* bIm,
+                    double* lambda1,
+                    double* lambda2,
+                    std::complex<double>* vector);
+
+// Singular values s1 >= s2 of [[h00, h01], [h10, h11]]
+void singularValues(size_t n,
+                    const std::complex<double>* h00,
+                    const std::complex<double>* h01,
+                    const std::complex<double>* h10,
+                    const std::complex<double>* h11,
+                    double* s1,
+                    double* s2);
+}  // namespace matrix2x2
+
+#endif
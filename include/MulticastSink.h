@@ -0,0 +1,72 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MULTICAST_SINK_H
+#define MULTICAST_SINK_H
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "StreamFramer.h"
+
+struct MulticastStats {
+    uint64_t records = 0;
+    uint64_t datagrams = 0;
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;  // fragments the socket did not accept
+};
+
+/**
+ * Sends every record once to an IPv4 or IPv6 multicast group, the network
+ * delivers it to all listeners so the cost does not grow with their
+ * number. Records are framed by the stream protocol so receivers detect
+ * lost fragments and records, lost data is not resent. All fragments of a
+ * record go out by one sendmmsg call that never blocks. Calls to publish
+ * have to be serialized by the owner.
+ */
+class MulticastSink {
+   public:
+    // group is HOST:PORT or [HOST]:PORT, interface the name of the outgoing one or empty
+    MulticastSink(const std::string& group,
+                  uint32_t ttl,
+                  const std::string& interface,
+                  uint32_t mtu);
+    ~MulticastSink();
+
+    void publish(const struct iovec* iov, int iovcnt);
+    const MulticastStats& getStats() const;
+    void logStats();
+
+   private:
+    int fd;
+    std::string group;
+    struct sockaddr_storage address;
+    socklen_t addressLength;
+    uint32_t mtu;
+    StreamFramer framer;
+    MulticastStats stats;
+    MulticastStats lastStats;
+
+    std::vector<StreamFrameHeader> headers;
+    std::vector<struct iovec> iovs;
+    std::vector<struct mmsghdr> messages;
+};
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUSIC_ESTIMATOR_H
+#define MUSIC_ESTIMATOR_H
+
+#include <complex>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "Csi.h"
+#include "DerivedRecord.h"
+#include "Resampler.h"
+#include "ThreadPool.h"
+
+struct MusicConfig {
+    uint32_t window = 10;          // records estimated in one batch
+    uint32_t subCarriers = 30;     // uniform grid the CSI is resampled to
+    uint32_t smoothing = 15;       // subcarriers of a smoothing subarray
+    uint32_t maxPaths = 3;
+    double antennaSpacing = 0.026;  // m
+    double frequency = 5180e6;      // Hz, channel center
+    double aoaStep = 2;             // degrees of the coarse grid
+    double tofMin = -50;            // ns
+    double tofMax = 150;
+    double tofStep = 2;
+    double signalThreshold = 0.01;  // eigenvalues above this share of the largest span signals
+    uint32_t threads = 0;           // all cores
+};
+
+// CSI of one record on the uniform grid, [rx][tx][subcarrier]
+struct MusicPacket {
+    uint32_t numRx = 0;
+    uint32_t numTx = 0;
+    double spacing = 0;  // Hz between grid subcarriers
+    std::vector<std::complex<double>> csi;
+};
+
+struct MusicPath {
+    double aoa;    // degrees
+    double tof;    // ns, relative after STO removal
+    double power;  // dB of the MUSIC pseudo spectrum
+};
+
+/**
+ * Joint angle of arrival and time of flight estimation (SpotFi). CSI of each
+ * record is resampled onto a uniform subcarrier grid, its STO is removed and
+ * spatially and spectrally smoothed CSI forms the covariance. The noise
+ * subspace projector is computed once per record and the pseudo spectrum is
+ * searched on a coarse grid and refined around its peaks.
+ *
+ * Records are collected per transmitter and a window is estimated in
+ * parallel. Snapshot values per record: maxPaths x (aoa, tof, power), NaN for
+ * paths not found.
+ */
+class MusicEstimator {
+   public:
+    void configure(const MusicConfig& config);
+
+    std::unique_ptr<DerivedRecord> update(const Csi& csi);
+
+    // Thread safe
+    std::vector<MusicPath> estimate(const MusicPacket& packet) const;
+
+    static void hermitianEigen(std::vector<std::complex<double>>& matrix,
+                               uint32_t n,
+                               std::vector<double>& values,
+                               std::vector<std::complex<double>>& vectors);
+
+   private:
+    MusicConfig config;
+    std::unique_ptr<ThreadPool> pool;
+    std::map<std::pair<double, double>, Resampler> resamplers;
+    std::map<uint64_t, std::vector<MusicPacket>> windows;
+
+    MusicPacket prepare(const Csi& csi);
+    void sanitize(MusicPacket& packet) const;
+    std::vector<double> spectrum(const std::vector<std::complex<double>>& projector,
+                                 uint32_t antennas,
+                                 double spacing,
+                                 const std::vector<double>& aoas,
+                                 const std::vector<double>& tofs) const;
+};
+
+#endif
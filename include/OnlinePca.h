@@ -0,0 +1,84 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ONLINE_PCA_H
+#define ONLINE_PCA_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "Csi.h"
+#include "DerivedRecord.h"
+
+struct PcaState {
+    uint32_t numRx = 0;
+    uint32_t numTx = 0;
+    uint32_t numSubCarriers = 0;
+    uint32_t dimension = 0;
+    uint32_t count = 0;
+    uint32_t sinceBasis = 0;
+    std::vector<double> mean;
+    std::vector<double> components;  // numComponents x dimension, norm is the eigenvalue
+};
+
+/**
+ * Per transmitter principal components of magnitude of all rx/tx pairs and
+ * subcarriers, updated with every record by candid covariance-free
+ * incremental PCA (CCIPCA), a learning rate free form of Oja's rule. Cost
+ * is O(k * dimension) per record. Mean and components forget records older
+ * than memory, so the basis follows slow changes of the environment.
+ *
+ * Coefficients record: k projections of the centered record, numRx and
+ * numTx are 1. Basis record, every basisPeriod records when non-zero: mean,
+ * k unit components, each of numRx * numTx * numSubCarriers values, then k
+ * eigenvalues.
+ */
+class OnlinePca {
+   public:
+    void configure(uint32_t numComponents,
+                   uint32_t memory,
+                   uint32_t warmup,
+                   uint32_t basisPeriod,
+                   bool reconstruct);
+
+    // Coefficients once warmed up, with reconstruct the magnitude is replaced
+    // by its projection onto the components
+    std::unique_ptr<DerivedRecord> update(Csi& csi);
+    // Basis of the transmitter of the last updated record when it is due
+    std::unique_ptr<DerivedRecord> basis(const Csi& csi);
+    // Forgets the components of all transmitters
+    void clear();
+
+   private:
+    uint32_t numComponents = 4;
+    uint32_t memory = 1000;
+    uint32_t warmup = 100;
+    uint32_t basisPeriod = 0;
+    bool reconstruct = false;
+    std::map<uint64_t, PcaState> states;
+    PcaState* last = nullptr;
+
+    std::vector<double> residual;
+    std::vector<double> coefficients;
+
+    void orthogonalize(PcaState& s, uint32_t k);
+    void reset(PcaState& s, const Csi& csi);
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ORDER_STATISTIC_WINDOW_H
+#define ORDER_STATISTIC_WINDOW_H
+
+#include <cstdint>
+#include <vector>
+
+#define ORDER_STATISTIC_NIL ((uint16_t)0xffff)
+
+/**
+ * Sliding windows of many series of the same length, e.g. one per subcarrier.
+ * Values of a series are kept in a treap ordered by value, nodes are the ring
+ * slots of the window, so replacing the oldest value, selecting the k-th
+ * smallest and counting values in a range are O(log W).
+ */
+class OrderStatisticWindow {
+   public:
+    void reset(uint32_t numSeries, uint32_t windowSize);
+
+    // Replaces the oldest value of the series, or adds it if not full yet
+    void push(uint32_t series, float value);
+    // Called after every series got its value
+    void advance();
+
+    // Values currently held by the series, including the one just pushed
+    uint32_t size(uint32_t series) const;
+    float select(uint32_t series, uint32_t k) const;
+    float median(uint32_t series) const;
+    // Values in the open interval (low, high)
+    uint32_t countBetween(uint32_t series, float low, float high) const;
+
+   private:
+    struct Tree {
+        float* key;
+        uint16_t* left;
+        uint16_t* right;
+        uint16_t* size;
+        const uint32_t* priority;
+    };
+
+    uint32_t numSeries = 0;
+    uint32_t windowSize = 0;
+    uint32_t head = 0;
+    uint32_t count = 0;
+    std::vector<float> key;
+    std::vector<uint16_t> left;
+    std::vector<uint16_t> right;
+    std::vector<uint16_t> size_;
+    std::vector<uint16_t> root;
+    std::vector<uint32_t> priority;
+
+    Tree tree(uint32_t series);
+    uint32_t countLess(uint32_t series, float value, bool inclusive) const;
+
+    static bool less(const Tree& t, uint16_t a, uint16_t b);
+    static void update(Tree& t, uint16_t node);
+    static uint16_t insert(Tree& t, uint16_t node, uint16_t id);
+    static uint16_t erase(Tree& t, uint16_t node, uint16_t id);
+    static uint16_t merge(Tree& t, uint16_t a, uint16_t b);
+    static void split(Tree& t, uint16_t node, uint16_t id, uint16_t& l, uint16_t& r);
+};
+
+#endif
@@ -0,0 +1,126 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROCESSING_GRAPH_H
+#define PROCESSING_GRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Csi.h"
+#include "DerivedRecord.h"
+#include "UdpSocket.h"
+
+enum stageDomain {
+    DOMAIN_NONE,     // raw record only
+    DOMAIN_POLAR,    // magnitude and phase
+    DOMAIN_COMPLEX,  // complex CSI
+};
+
+class ProcessingStage {
+   public:
+    virtual ~ProcessingStage() = default;
+
+    // Whole record, derived records are written or sent to udpSocket
+    virtual void process(Csi& csi, UdpSocket* udpSocket) = 0;
+
+    // Block of values of an element-wise stage. Adjacent element-wise stages are
+    // fused, every block passes through all of them while it is still in cache
+    virtual void apply(double* magnitude, double* phase, size_t count) {}
+
+    // Forgets the records seen so far, called when records stop arriving in order
+    virtual void reset() {}
+
+    std::string name;
+    std::string config;  // type and parameters
+    stageDomain domain = DOMAIN_POLAR;
+    bool transform = false;  // modifies CSI, also run when processing stored files
+    bool elementWise = false;
+    bool stateful = false;  // result depends on the records before, it is never cached
+};
+
+struct GraphStep {
+    std::string name;
+    std::vector<ProcessingStage*> stages;  // more than one when fused
+    stageDomain domain;
+    uint64_t hash = 0;  // configuration of this and all previous steps
+    uint64_t nanoseconds = 0;
+    uint64_t calls = 0;
+};
+
+/**
+ * Ordered CSI processing pipeline, e.g.
+ *
+ *   # stage [key=value ...]
+ *   interpolate method=cubic
+ *   phaseCalibration
+ *   scale factor=0.01
+ *   statistics window=200 hop=50
+ *   raw
+ *
+ * Stages run on the representation they need, conversions between magnitude
+ * and phase and complex CSI happen only where the domain changes instead of
+ * after every stage. Time spent in every step is accumulated.
+ */
+class ProcessingGraph {
+   public:
+    static std::unique_ptr<ProcessingGraph> fromFile(const std::string& path);
+    static std::unique_ptr<ProcessingGraph> fromArguments();
+    static std::unique_ptr<ProcessingGraph> create();
+
+    void add(const std::string& type, const std::map<std::string, std::string>& params);
+    void compile();
+
+    // Only stages modifying CSI, nothing is emitted. Results of every step up to
+    // the first stateful one are cached in the record, unchanged leading steps
+    // are not computed again. Stateful stages are reset when a record is not
+    // newer than the one transformed before, e.g. when paging back
+    void transform(Csi& csi);
+
+    void run(Csi& csi, UdpSocket* udpSocket);
+
+    void logTimings();
+
+    bool empty() const;
+
+   private:
+    std::vector<std::unique_ptr<ProcessingStage>> stages;
+    std::vector<GraphStep> steps;
+    std::vector<GraphStep> transformSteps;
+    size_t firstStatefulStep = 0;  // of transformSteps, all steps before it are cached
+    uint64_t lastTransformed = 0;  // timestamp of the record transformed last
+    GraphStep toComplex{.name = "toComplex", .domain = DOMAIN_COMPLEX};
+    GraphStep toPolar{.name = "toPolar", .domain = DOMAIN_POLAR};
+
+    uint64_t cacheHits = 0;
+
+    void runStep(GraphStep& step,
+                 Csi& csi,
+                 UdpSocket* udpSocket,
+                 bool& polarValid,
+                 bool& complexValid);
+    void convertBoth(Csi& csi, bool polarValid, bool complexValid);
+    static void timed(GraphStep& step, const std::function<void()>& fn);
+    std::vector<GraphStep> fuse(bool transformOnly);
+};
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "Csi.h"
+
+// Uniform target grid, frequency offsets from the channel center in MHz
+struct ResampleGrid {
+    double first;
+    double last;
+    uint32_t count;
+};
+
+// Row compressed weights, target subcarrier i is the weighted sum of source
+// subcarriers columns[rowStart[i]] .. columns[rowStart[i + 1] - 1]
+struct SparseWeights {
+    std::vector<uint32_t> rowStart;
+    std::vector<uint32_t> columns;
+    std::vector<double> weights;
+};
+
+/**
+ * Maps CSI of any format and channel width onto a common subcarrier grid.
+ * Weights are built once for every source tone plan and the resampling is
+ * then a sparse matrix-vector product per antenna chain.
+ */
+class Resampler {
+   public:
+    Resampler(const ResampleGrid& grid, bool cubic = false);
+
+    void resample(Csi& csi);
+    void resample(const Csi& csi, std::vector<std::complex<double>>& out);
+
+    static ResampleGrid parseGrid(const std::string& grid);
+    static std::vector<double> subcarrierFrequencies(const Csi& csi);
+    static std::vector<double> subcarrierFrequencies(uint32_t format,
+                                                     uint32_t channelWidth,
+                                                     uint32_t numSubCarriers);
+
+   private:
+    ResampleGrid grid;
+    bool cubic;
+    std::map<uint64_t, SparseWeights> weights;
+
+    const SparseWeights& getWeights(const Csi& csi);
+    SparseWeights buildWeights(const std::vector<double>& source) const;
+};
+
+#endif
@@ -0,0 +1,254 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+/*
+ * Shared memory ring of streamed records, header only C reader library.
+ *
+ * FeitCSI started with --shm NAME writes every record it streams into the
+ * POSIX shared memory object NAME (/dev/shm/NAME). The region starts with a
+ * feitcsi_shm_header followed by capacity bytes of ring. Records are 16 byte
+ * aligned, a feitcsi_shm_record followed by size bytes of the same data a
+ * UDP peer gets. A record never wraps, the end of the ring is skipped by a
+ * padding record.
+ *
+ * There is one writer and any number of readers, the writer never waits for
+ * them. head counts the bytes published, tail the bytes the writer is about
+ * to write, so everything before tail - capacity may be overwritten. Readers
+ * keep their own cursor and read the records in place, a record is valid
+ * when tail did not pass cursor + capacity after it was used (seqlock).
+ * Readers sleep on the notify futex, which works on their read only mapping.
+ * Sleeping readers are counted in the separate world writable object
+ * NAME.wait, the writer only wakes them when that count is not zero. Readers
+ * never write to the ring region, so it only has to be readable for them. A
+ * reader that cannot map NAME.wait sleeps until its timeout passes.
+ *
+ *   struct feitcsi_shm_reader reader;
+ *   if (feitcsi_shm_open(&reader, "feitcsi") == 0) {
+ *       const struct feitcsi_shm_record *record;
+ *       for (;;) {
+ *           int r = feitcsi_shm_next(&reader, &record);
+ *           if (r == 0) { feitcsi_shm_wait(&reader, 100); continue; }
+ *           if (r < 0) continue;  // overrun, reader.lost records skipped
+ *           use(feitcsi_shm_data(record), record->size);
+ *           if (!feitcsi_shm_valid(&reader)) discard();  // overwritten meanwhile
+ *       }
+ *   }
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FEITCSI_SHM_MAGIC 0x4d485346 /* "FSHM" */
+#define FEITCSI_SHM_VERSION 2
+#define FEITCSI_SHM_ALIGN 16
+
+enum feitcsi_shm_flag {
+    FEITCSI_SHM_PADDING = 1, /* skip to the start of the ring */
+};
+
+/* Same values as streamFormat in SubscriptionRegistry.h */
+enum feitcsi_shm_format {
+    FEITCSI_SHM_CSI = 0,
+    FEITCSI_SHM_FTM = 1,
+    FEITCSI_SHM_DERIVED = 2,
+};
+
+struct feitcsi_shm_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;    /* bytes of ring, power of two */
+    uint64_t dataOffset;  /* ring start from the region start */
+    uint64_t head;        /* bytes published */
+    uint64_t tail;        /* bytes reserved by the writer, head <= tail */
+    uint64_t records;     /* records published */
+    uint32_t notify;      /* futex, incremented with every publish readers wait for */
+    uint32_t reserved0;   /* sleeping readers are counted in feitcsi_shm_waiters */
+    uint32_t closed;      /* the writer is gone, reopen to follow a new one */
+    uint32_t reserved[5];
+}; /* size 80 bytes */
+
+/* The object NAME.wait, the only one readers write to */
+struct feitcsi_shm_waiters {
+    uint32_t count; /* readers in feitcsi_shm_wait */
+    uint32_t reserved[15];
+}; /* size 64 bytes */
+
+struct feitcsi_shm_record {
+    uint32_t size;  /* bytes of data following the record header */
+    uint16_t flags;
+    uint8_t format; /* feitcsi_shm_format */
+    uint8_t reserved;
+    uint16_t derivedType; /* derivedRecordType of FEITCSI_SHM_DERIVED */
+    uint16_t reserved2;
+    uint32_t sequence;
+}; /* size 16 bytes */
+
+/* Bytes of the ring taken by a record with size bytes of data */
+#define FEITCSI_SHM_RECORD_SPACE(size)                                  \
+    ((sizeof(struct feitcsi_shm_record) + (size) + FEITCSI_SHM_ALIGN - 1) & \
+     ~(uint64_t)(FEITCSI_SHM_ALIGN - 1))
+
+struct feitcsi_shm_reader {
+    const struct feitcsi_shm_header *header;
+    struct feitcsi_shm_waiters *waiters; /* NULL when NAME.wait cannot be mapped */
+    const uint8_t *ring;
+    size_t length;
+    uint64_t cursor; /* next record */
+    uint64_t start;  /* record returned by the last feitcsi_shm_next */
+    uint64_t lost;   /* bytes skipped by overruns */
+};
+
+static inline const uint8_t *feitcsi_shm_data(const struct feitcsi_shm_record *record) {
+    return (const uint8_t *)record + sizeof(struct feitcsi_shm_record);
+}
+
+/* Maps the region read only, reading starts at the newest record. 0 or -errno */
+static inline int feitcsi_shm_open(struct feitcsi_shm_reader *reader, const char *name) {
+    char path[256] = "/";
+    struct stat st;
+    int fd;
+    void *region;
+
+    memset(reader, 0, sizeof(*reader));
+    strncat(path, name, sizeof(path) - 2);
+    fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0)
+        return -errno;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct feitcsi_shm_header)) {
+        close(fd);
+        return -EINVAL;
+    }
+    region = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED)
+        return -errno;
+
+    reader->header = (const struct feitcsi_shm_header *)region;
+    reader->length = st.st_size;
+    if (reader->header->magic != FEITCSI_SHM_MAGIC ||
+        reader->header->version != FEITCSI_SHM_VERSION ||
+        reader->header->dataOffset + reader->header->capacity > reader->length) {
+        munmap(region, reader->length);
+        reader->header = NULL;
+        return -EPROTO;
+    }
+    reader->ring = (const uint8_t *)region + reader->header->dataOffset;
+
+    fd = -1;
+    if (strlen(path) + sizeof(".wait") <= sizeof(path)) {
+        strcat(path, ".wait");
+        fd = shm_open(path, O_RDWR, 0);
+    }
+    if (fd >= 0) {
+        region = mmap(NULL, sizeof(struct feitcsi_shm_waiters), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+        close(fd);
+        if (region != MAP_FAILED)
+            reader->waiters = (struct feitcsi_shm_waiters *)region;
+    }
+    reader->cursor = __atomic_load_n(&reader->header->head, __ATOMIC_ACQUIRE);
+    reader->start = reader->cursor;
+    return 0;
+}
+
+static inline void feitcsi_shm_close(struct feitcsi_shm_reader *reader) {
+    if (reader->header)
+        munmap((void *)reader->header, reader->length);
+    if (reader->waiters)
+        munmap(reader->waiters, sizeof(struct feitcsi_shm_waiters));
+    reader->header = NULL;
+    reader->waiters = NULL;
+}
+
+/* True when the record returned last was not overwritten while it was used */
+static inline int feitcsi_shm_valid(const struct feitcsi_shm_reader *reader) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&reader->header->tail, __ATOMIC_RELAXED) <=
+           reader->start + reader->header->capacity;
+}
+
+/*
+ * Next record without copying it, 1 when there is one, 0 when the reader
+ * caught up, -1 when the writer lapped the reader, which then continues with
+ * the newest record.
+ */
+static inline int feitcsi_shm_next(struct feitcsi_shm_reader *reader,
+                                   const struct feitcsi_shm_record **record) {
+    const uint64_t capacity = reader->header->capacity;
+    for (;;) {
+        const uint64_t head = __atomic_load_n(&reader->header->head, __ATOMIC_ACQUIRE);
+        const struct feitcsi_shm_record *r;
+        uint32_t size;
+        uint16_t flags;
+
+        if (reader->cursor == head)
+            return 0;
+        r = (const struct feitcsi_shm_record *)(reader->ring +
+                                                (reader->cursor & (capacity - 1)));
+        size = r->size;
+        flags = r->flags;
+        reader->start = reader->cursor;
+        if (!feitcsi_shm_valid(reader)) {
+            reader->lost += head - reader->cursor;
+            reader->cursor = head;
+            reader->start = head;
+            return -1;
+        }
+        reader->cursor += FEITCSI_SHM_RECORD_SPACE(size);
+        if (flags & FEITCSI_SHM_PADDING)
+            continue;
+        *record = r;
+        return 1;
+    }
+}
+
+/* Sleeps until the writer publishes or timeoutMs passes, negative waits forever */
+static inline void feitcsi_shm_wait(struct feitcsi_shm_reader *reader, int timeoutMs) {
+    const struct feitcsi_shm_header *header = reader->header;
+    struct timespec timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+    uint32_t notify;
+
+    /*
+     * Counted before head is checked, a writer that still saw no waiter has
+     * published before that check, so the reader does not sleep then
+     */
+    if (reader->waiters)
+        __atomic_add_fetch(&reader->waiters->count, 1, __ATOMIC_SEQ_CST);
+    notify = __atomic_load_n(&header->notify, __ATOMIC_SEQ_CST);
+
+    /* A publish after notify was read changes it, the futex does not sleep then */
+    if (__atomic_load_n(&header->head, __ATOMIC_SEQ_CST) == reader->cursor &&
+        !__atomic_load_n(&header->closed, __ATOMIC_RELAXED))
+        syscall(SYS_futex, &header->notify, FUTEX_WAIT, notify, timeoutMs < 0 ? NULL : &timeout,
+                NULL, 0);
+    if (reader->waiters)
+        __atomic_sub_fetch(&reader->waiters->count, 1, __ATOMIC_SEQ_CST);
+}
+
+#endif
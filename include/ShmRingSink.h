@@ -0,0 +1,62 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHM_RING_SINK_H
+#define SHM_RING_SINK_H
+
+#include <sys/uio.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "ShmRing.h"
+#include "SubscriptionRegistry.h"
+
+#define SHM_RING_MIN_SIZE (1 << 20)
+
+/**
+ * Writer of the shared memory ring described in ShmRing.h. Creates the
+ * POSIX shared memory objects and removes them again when destroyed. Records
+ * are copied once into the ring, the writer never waits for readers.
+ * Calls to publish have to be serialized by the owner.
+ */
+class ShmRingSink {
+   public:
+    ShmRingSink(const std::string& name, size_t size);
+    ~ShmRingSink();
+
+    void publish(const struct iovec* iov, int iovcnt, const StreamRecordInfo& info);
+    const std::string& getName() const;
+    uint64_t getDropped() const;
+
+   private:
+    std::string name;
+    struct feitcsi_shm_header* header;
+    struct feitcsi_shm_waiters* waiters;  // NAME.wait, written by the readers
+    uint8_t* ring;
+    size_t length;
+    uint64_t position = 0;  // tail as written by this writer
+    uint32_t sequence = 0;
+    uint64_t dropped = 0;  // records larger than half of the ring
+
+    void writeRecord(uint64_t position,
+                     uint32_t size,
+                     uint16_t flags,
+                     const StreamRecordInfo* info);
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPATIAL_COVARIANCE_H
+#define SPATIAL_COVARIANCE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "Csi.h"
+#include "DerivedRecord.h"
+
+#define COVARIANCE_VALUES 11
+
+// Per subcarrier group sums, structure of arrays for the batched kernels
+struct CovarianceSums {
+    std::vector<double> a;  // rx0 power
+    std::vector<double> d;  // rx1 power
+    std::vector<double> bRe;  // rx0 * conj(rx1)
+    std::vector<double> bIm;
+    std::vector<double> s1;  // singular values of the rx x tx channel
+    std::vector<double> s2;
+
+    void assign(uint32_t numGroups);
+    void add(const CovarianceSums& other, double sign);
+};
+
+struct CovarianceWindow {
+    uint32_t numRx = 0;
+    uint32_t numTx = 0;
+    uint32_t numSubCarriers = 0;
+    uint32_t numGroups = 0;
+    uint32_t count = 0;
+    uint32_t head = 0;
+    uint32_t sinceSnapshot = 0;
+    std::vector<CovarianceSums> ring;  // contribution of every record in the window
+    CovarianceSums sums;
+};
+
+/**
+ * Per transmitter rx x rx spatial covariance of every subcarrier group,
+ * accumulated incrementally over a window of records. Links with up to two
+ * rx and tx chains are decomposed in closed form, missing chains are zero.
+ * The sums are recomputed from the window every time a sliding window wraps,
+ * so rounding errors of removed records do not accumulate.
+ *
+ * Window of N records with hop H emits a snapshot every H records once the
+ * window is full, as CsiStatistics does.
+ *
+ * Snapshot values per subcarrier group:
+ * lambda1, lambda2, lambda1 / lambda2, rank, dominant eigenvector (re, im,
+ * re, im), mean s1, mean s2 of the channel matrix and s1 / s2
+ */
+class SpatialCovariance {
+   public:
+    void configure(uint32_t windowSize, uint32_t hop, uint32_t groupSize, double rankThreshold);
+
+    std::unique_ptr<DerivedRecord> update(const Csi& csi);
+
+   private:
+    uint32_t windowSize = 100;
+    uint32_t hop = 100;
+    uint32_t groupSize = 1;
+    double rankThreshold = 0.01;
+    std::map<uint64_t, CovarianceWindow> windows;
+
+    // Per record scratch, one value per subcarrier
+    std::vector<std::complex<double>> zeros;
+    std::vector<double> s1;
+    std::vector<double> s2;
+
+    void reset(CovarianceWindow& w, const Csi& csi);
+    void recompute(CovarianceWindow& w);
+    void accumulate(const Csi& csi, uint32_t numGroups, CovarianceSums& sums);
+    std::unique_ptr<DerivedRecord> snapshot(CovarianceWindow& w, const Csi& csi);
+};
+
+#endif
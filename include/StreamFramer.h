@@ -0,0 +1,68 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAM_FRAMER_H
+#define STREAM_FRAMER_H
+
+#include <sys/uio.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "StreamProtocol.h"
+
+typedef std::shared_ptr<const std::vector<char>> StreamRecordData;
+
+// Framed record kept for resending its fragments
+struct StreamHistoryRecord {
+    uint32_t sequence;
+    uint16_t fragmentCount;
+    uint32_t payloadSize;  // per fragment
+    StreamRecordData data;
+};
+
+/**
+ * Sender side of the stream protocol for one destination. Numbers the
+ * records, keeps the last STREAM_HISTORY_RECORDS of them and builds the
+ * fragments, the payload points into the record so nothing is copied. Not
+ * thread safe, the owner serializes the calls.
+ */
+class StreamFramer {
+   public:
+    StreamFramer();
+
+    // Registers the record, nullptr when it needs more than 65535 fragments
+    const StreamHistoryRecord* add(StreamRecordData data, uint32_t mtu);
+    void fragment(const StreamHistoryRecord& record,
+                  uint16_t index,
+                  uint8_t flags,
+                  StreamFrameHeader& header,
+                  struct iovec& payload) const;
+    // Calls send for every fragment requested by the NACK, false when buf is no NACK
+    bool resend(const char* buf,
+                size_t size,
+                const std::function<void(const StreamHistoryRecord&, uint16_t)>& send) const;
+
+   private:
+    uint32_t sessionId;
+    uint32_t nextSequence = 0;
+    std::deque<StreamHistoryRecord> history;
+};
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAM_PROTOCOL_H
+#define STREAM_PROTOCOL_H
+
+#include <cstdint>
+
+/**
+ * FeitCSI stream protocol, records sent over UDP split into datagrams that
+ * fit the path MTU, so a lost datagram costs one fragment instead of the
+ * whole IP fragmented record. All fields are little endian.
+ *
+ * Every datagram is a StreamFrameHeader followed by bytes fragmentOffset to
+ * fragmentOffset + payload of the record. Records of a session are numbered
+ * by sequence, the session id changes when the sender restarts. A receiver
+ * asks for missing fragments by sending a StreamNackHeader followed by count
+ * uint16 fragment indices back to the sender, which resends them while the
+ * record is still in its history.
+ */
+
+#define STREAM_MAGIC 0x49534346       // "FCSI"
+#define STREAM_NACK_MAGIC 0x4b414e46  // "FNAK"
+#define STREAM_VERSION 1
+#define STREAM_DEFAULT_MTU 1472  // 1500 byte Ethernet MTU without IPv4 and UDP headers
+#define STREAM_MIN_MTU 128
+#define STREAM_MAX_MTU 65507  // largest UDP payload over IPv4
+#define STREAM_MAX_RECORD_SIZE (16 << 20)  // receivers reject bigger records
+#define STREAM_HISTORY_RECORDS 64   // records the sender can resend fragments of
+#define STREAM_MAX_NACK_FRAGMENTS 500
+
+enum streamFlag : uint8_t {
+    STREAM_FLAG_RETRANSMIT = 1,
+};
+
+struct __attribute__((__packed__)) StreamFrameHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint16_t headerSize;  // payload starts here, later versions may add fields
+    uint32_t sessionId;
+    uint32_t sequence;
+    uint16_t fragmentIndex;
+    uint16_t fragmentCount;
+    uint32_t recordSize;
+    uint32_t fragmentOffset;
+};  // size 28 bytes
+
+struct __attribute__((__packed__)) StreamNackHeader {
+    uint32_t magic;
+    uint32_t sessionId;
+    uint32_t sequence;
+    uint16_t count;
+    uint16_t reserved;
+};  // size 16 bytes
+
+#endif
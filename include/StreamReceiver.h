@@ -0,0 +1,119 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAM_RECEIVER_H
+#define STREAM_RECEIVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "StreamProtocol.h"
+
+enum streamLossType {
+    STREAM_LOSS_GAP,         // no fragment of the records arrived
+    STREAM_LOSS_INCOMPLETE,  // some fragments of the record are missing
+};
+
+struct StreamLoss {
+    streamLossType type;
+    uint32_t sessionId;
+    uint32_t firstSequence;
+    uint32_t lastSequence;
+    std::vector<uint16_t> missing;  // fragment indices of an incomplete record
+};
+
+struct StreamReceiverStats {
+    uint64_t datagrams = 0;
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    uint64_t duplicates = 0;  // fragments received twice or after their record was given up
+    uint64_t invalid = 0;
+    uint64_t lostRecords = 0;
+    uint64_t incompleteRecords = 0;
+    uint64_t nacks = 0;
+    uint64_t sessions = 0;
+};
+
+/**
+ * Reference receiver of the FeitCSI stream protocol, depends on nothing but
+ * StreamProtocol.h. Datagrams are fed in arrival order, records are passed
+ * to onRecord as soon as all their fragments arrived, in any order. A
+ * record is given up once it is window records older than the newest one,
+ * its loss is reported to onLoss, records that never showed up as gaps.
+ *
+ *   StreamReceiver receiver;
+ *   receiver.onRecord = [](uint32_t sequence, const std::vector<uint8_t>& r) { ... };
+ *   while ((n = recvfrom(fd, buf, sizeof(buf), 0, &from, &len)) > 0) {
+ *       receiver.receive(buf, n);
+ *       for (auto& nack : receiver.nacks()) sendto(fd, nack.data(), nack.size(), 0, &from, len);
+ *   }
+ *
+ * Multicast streams (--multicast) are read from the socket returned by
+ * joinMulticast, the sender does not resend so no NACKs are sent:
+ *
+ *   int fd = StreamReceiver::joinMulticast("239.255.0.1:9100", "eth0");
+ *   StreamReceiver receiver(64, 0);
+ */
+class StreamReceiver {
+   public:
+    explicit StreamReceiver(uint32_t window = 64, uint32_t maxNacks = 2);
+
+    void receive(const uint8_t* datagram, size_t size);
+    // Requests for fragments of records a newer record was already seen for
+    std::vector<std::vector<uint8_t>> nacks();
+    // Gives up all pending records, e.g. at the end of the stream
+    void finish();
+
+    const StreamReceiverStats& getStats() const;
+
+    // UDP socket bound to the port of group HOST:PORT and joined to it on
+    // interface, any with an empty name. Returns -1 and sets errno on failure.
+    static int joinMulticast(const std::string& group, const std::string& interface = "");
+
+    std::function<void(uint32_t sequence, const std::vector<uint8_t>& record)> onRecord;
+    std::function<void(const StreamLoss& loss)> onLoss;
+
+   private:
+    struct PendingRecord {
+        uint16_t fragmentCount = 0;
+        uint16_t received = 0;
+        uint32_t nacks = 0;
+        uint64_t nackedAt = 0;  // newest sequence when the last request was made
+        bool complete = false;
+        std::vector<uint8_t> data;
+        std::vector<bool> have;
+    };
+
+    uint32_t window;
+    uint32_t maxNacks;
+    bool started = false;
+    uint32_t sessionId = 0;
+    // Sequences extended to 64 bits, so they never wrap around
+    uint64_t floor = 0;    // records before are given up or delivered
+    uint64_t highest = 0;  // newest sequence seen
+    std::map<uint64_t, PendingRecord> pending;
+    StreamReceiverStats stats;
+
+    void expire(uint64_t until);
+    void reportGap(uint64_t first, uint64_t last);
+};
+
+#endif
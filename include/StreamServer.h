@@ -0,0 +1,126 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAM_SERVER_H
+#define STREAM_SERVER_H
+
+#include <sys/uio.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "StreamFramer.h"
+
+// Buffers gathered by one writev to a client
+#define STREAM_SERVER_IOV 64
+
+enum streamBackpressure {
+    BACKPRESSURE_BLOCK,       // capture waits until the client drained to the low watermark
+    BACKPRESSURE_DROP,        // oldest queued records are dropped
+    BACKPRESSURE_DISCONNECT,  // the client is disconnected
+};
+
+struct StreamClientStats {
+    std::string name;
+    uint64_t records = 0;  // sent completely
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;
+    size_t lagRecords = 0;  // queued
+    size_t lagBytes = 0;
+    double lagSeconds = 0;  // age of the oldest queued record
+};
+
+struct StreamQueuedRecord {
+    StreamRecordData data;
+    std::chrono::steady_clock::time_point queued;
+};
+
+struct StreamClient {
+    int fd;
+    std::string name;
+    std::mutex mutex;
+    std::condition_variable drained;
+    std::deque<StreamQueuedRecord> queue;
+    size_t frontOffset = 0;  // bytes of the front record already written
+    size_t queuedBytes = 0;
+    bool waiting = false;  // queue was empty, the server thread has to be woken
+    bool closed = false;
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;
+};
+
+/**
+ * Lossless stream of framed records over TCP and Unix domain sockets. Each
+ * record is a single fragment StreamFrameHeader followed by the record. One
+ * epoll thread accepts clients and writes their queues, publish only
+ * appends a shared reference of the record to every queue. A queue above
+ * the high watermark is handled by the backpressure policy, blocking
+ * resumes once it drained to the low watermark.
+ *
+ * Listen addresses are tcp:PORT, tcp:HOST:PORT or unix:PATH, separated by
+ * commas.
+ */
+class StreamServer {
+   public:
+    StreamServer(const std::string& listen,
+                 size_t highWatermark,
+                 streamBackpressure backpressure);
+    ~StreamServer();
+
+    void publish(const struct iovec* iov, int iovcnt);
+    std::vector<StreamClientStats> getStats();
+    void logStats();
+    const std::string& getListen() const;
+
+    static streamBackpressure parseBackpressure(const std::string& name);
+
+   private:
+    std::string listen;
+    size_t highWatermark;
+    size_t lowWatermark;
+    streamBackpressure backpressure;
+
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::vector<int> listeners;
+    std::vector<std::string> unixPaths;
+    std::thread thread;
+    std::atomic<bool> stopping = false;
+
+    std::mutex clientsMutex;
+    std::vector<std::shared_ptr<StreamClient>> clients;
+
+    uint32_t sessionId;
+    std::atomic<uint32_t> sequence = 0;
+
+    void openListener(const std::string& address);
+    void run();
+    void accept(int listener);
+    void flush(StreamClient& client);
+    void close(const std::shared_ptr<StreamClient>& client);
+    std::shared_ptr<StreamClient> find(int fd);
+};
+
+#endif
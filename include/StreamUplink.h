@@ -0,0 +1,96 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STREAM_UPLINK_H
+#define STREAM_UPLINK_H
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "StreamFramer.h"
+#include "SubscriptionRegistry.h"
+
+// Records queued for a TCP aggregator, the oldest are dropped above
+#define UPLINK_QUEUE_BYTES (16 << 20)
+#define UPLINK_RECONNECT_MS 1000
+// A connect or a blocked write gives up after this long and looks at stopping
+#define UPLINK_TIMEOUT_MS 1000
+
+struct StreamUplinkStats {
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;  // not accepted by the socket or the queue was full
+    uint64_t retransmitted = 0;
+    uint64_t connects = 0;
+};
+
+/**
+ * Pushes records to an aggregator (Aggregator.h), every record prefixed by
+ * AggregateRecordHeader. Over udp:HOST:PORT records are split into stream
+ * protocol fragments sent right away without blocking, NACKs of the
+ * aggregator are answered from the history before the next record. Over
+ * tcp:HOST:PORT a thread writes single fragment frames and reconnects when
+ * the connection breaks, records wait in a queue meanwhile. Calls to
+ * publish have to be serialized by the owner.
+ */
+class StreamUplink {
+   public:
+    StreamUplink(const std::string& address, uint32_t mtu);
+    ~StreamUplink();
+
+    // Stops the writer and destroys the uplink on a thread of its own, the
+    // capture thread calling it does not wait for a connect or a write
+    static void release(std::unique_ptr<StreamUplink> uplink);
+
+    void publish(const struct iovec* iov, int iovcnt, const StreamRecordInfo& info);
+    StreamUplinkStats getStats();
+    void logStats();
+
+   private:
+    std::string address;
+    bool tcp;
+    struct sockaddr_storage peer;
+    socklen_t peerLength;
+    int fd = -1;
+    uint32_t mtu;
+    StreamFramer framer;
+
+    std::mutex mutex;  // of the TCP queue and the stats
+    std::condition_variable wake;
+    std::deque<StreamRecordData> queue;
+    size_t queuedBytes = 0;
+    std::atomic<bool> stopping = false;
+    std::thread writer;
+    uint32_t sessionId;
+    uint32_t sequence = 0;
+    StreamUplinkStats stats;
+    StreamUplinkStats lastStats;
+
+    void sendFragment(const StreamHistoryRecord& record, uint16_t index, uint8_t flags);
+    void answerNacks();
+    int connectPeer();
+    void writeLoop();
+};
+
+#endif
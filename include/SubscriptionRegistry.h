@@ -0,0 +1,179 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SUBSCRIPTION_REGISTRY_H
+#define SUBSCRIPTION_REGISTRY_H
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "StreamFramer.h"
+
+// Records waiting for one subscriber before the oldest are dropped
+#define SUBSCRIPTION_QUEUE_LIMIT 1024
+// Subscriptions not renewed for this long are removed
+#define SUBSCRIPTION_TIMEOUT_S 60
+#define SUBSCRIPTION_LIMIT 64
+
+enum streamFormat : uint8_t {
+    STREAM_FORMAT_CSI,
+    STREAM_FORMAT_FTM,
+    STREAM_FORMAT_DERIVED,
+};
+
+// What a record sent to the peers is, for filtering
+struct StreamRecordInfo {
+    streamFormat format;
+    uint16_t derivedType;   // derivedRecordType of STREAM_FORMAT_DERIVED
+    const uint8_t* srcMac;  // nullptr when the record has none
+    uint64_t timestamp = 0;         // us since epoch, corrected by ClockSync
+    uint32_t clockUncertainty = 0;  // us, 0 when not synchronized
+};
+
+/**
+ * Part of every CSI record a subscriber wants, sent as a DERIVED_PROJECTION
+ * record of float16 values [rx, tx, subcarrier(, re, im)] instead of the
+ * raw record. Other records are sent unchanged.
+ */
+struct SubscriptionProjection {
+    uint32_t rx = 0;  // bit mask of the receive chains kept, all when 0
+    uint32_t tx = 0;
+    uint32_t stride = 1;     // every Nth subcarrier is kept
+    bool amplitude = false;  // magnitude only instead of complex values
+
+    bool identity() const;
+    bool operator==(const SubscriptionProjection&) const = default;
+    // Of a CSI record, nullptr when no chain is left or the record is malformed
+    StreamRecordData apply(const std::vector<char>& record) const;
+};
+
+struct SubscriptionFilter {
+    std::vector<std::array<uint8_t, 6>> macs;  // any MAC when empty
+    uint64_t formats = UINT64_MAX;             // formatBit of accepted records
+    uint32_t decimation = 1;                   // every Nth accepted record is sent
+    double rate = 0;                           // records per second of one MAC at most
+    SubscriptionProjection projection;
+
+    // Tokens mac=MAC[,MAC...] format=NAME[,NAME...] decimation=N rate=HZ,
+    // NAME is csi, ftm or a derived record prefix such as cir or pca, and the
+    // projection rx=N[,N...] tx=N[,N...] stride=N values=amplitude|complex
+    static SubscriptionFilter parse(const std::vector<std::string>& tokens);
+    static uint64_t formatBit(streamFormat format, uint16_t derivedType);
+    bool matches(const StreamRecordInfo& info) const;
+};
+
+struct SubscriberStats {
+    uint64_t sent = 0;  // records
+    uint64_t dropped = 0;
+    uint64_t bytes = 0;
+    size_t queued = 0;
+};
+
+/**
+ * One consumer of the stream with its own queue and sending thread. The
+ * capture thread only appends a shared reference of the record, when the
+ * subscriber falls behind its oldest records are dropped. Datagrams go out
+ * of the control socket, so they come from the port subscribers talk to.
+ */
+class Subscriber {
+   public:
+    Subscriber(int sfd, const struct sockaddr_storage& address, socklen_t addressLength);
+    ~Subscriber();
+
+    bool sameAddress(const struct sockaddr_storage& address, socklen_t addressLength) const;
+    // Counts the record against the rate and decimation, true when it is to be sent
+    bool accept(const StreamRecordInfo& info);
+    void enqueue(const StreamRecordData& data);
+    bool resend(const char* buf, size_t size);
+    SubscriberStats getStats();
+    std::string name() const;
+
+    SubscriptionFilter filter;  // guarded by the registry
+    std::chrono::steady_clock::time_point renewed;
+
+   private:
+    int sfd;
+    struct sockaddr_storage address;
+    socklen_t addressLength;
+    std::atomic<uint64_t> counter = 0;
+    std::mutex rateMutex;
+    std::unordered_map<uint64_t, uint64_t> nextTime;  // by MAC, us
+
+    bool admit(const StreamRecordInfo& info);
+
+    std::mutex queueMutex;
+    std::condition_variable wake;
+    std::deque<StreamRecordData> queue;
+    bool stopping = false;
+    std::thread sender;
+
+    std::mutex framerMutex;
+    StreamFramer framer;
+
+    std::atomic<uint64_t> sent = 0;
+    std::atomic<uint64_t> dropped = 0;
+    std::atomic<uint64_t> bytes = 0;
+
+    void sendLoop();
+    void sendBatch(const std::vector<StreamRecordData>& batch);
+    void sendMessages(struct mmsghdr* messages, size_t count);
+};
+
+/**
+ * Peers subscribed to the stream with text commands on the control socket:
+ *   subscribe [mac=MAC,...] [format=NAME,...] [decimation=N] [rate=HZ]
+ *             [rx=N,...] [tx=N,...] [stride=N] [values=amplitude|complex]
+ *   unsubscribe
+ * Subscribing again replaces the filter and renews the subscription. A
+ * projection is computed once per record for all subscribers asking for
+ * the same one.
+ */
+class SubscriptionRegistry {
+   public:
+    // Subscription command or NACK of a subscriber, false when buf is neither
+    bool handle(int sfd,
+                const char* buf,
+                size_t size,
+                const struct sockaddr_storage& from,
+                socklen_t fromLength);
+    bool contains(const struct sockaddr_storage& address, socklen_t addressLength);
+    void publish(const struct iovec* iov, int iovcnt, const StreamRecordInfo& info);
+    void expire();
+    void logStats();
+
+   private:
+    std::shared_mutex mutex;
+    std::vector<std::unique_ptr<Subscriber>> subscribers;
+    std::atomic<bool> empty = true;
+
+    Subscriber* find(const struct sockaddr_storage& address, socklen_t addressLength);
+};
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads running parallel loops. The calling thread
+ * takes part in the loop and returns when all iterations are done. Loop
+ * bodies must not throw.
+ */
+class ThreadPool {
+   public:
+    explicit ThreadPool(size_t numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+    size_t size() const;
+
+   private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable done;
+    const std::function<void(size_t)>* job = nullptr;
+    size_t count = 0;
+    size_t next = 0;
+    size_t finished = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    void work();
+    void runIterations(std::unique_lock<std::mutex>& lock);
+};
+
+#endif
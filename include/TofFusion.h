@@ -0,0 +1,96 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOF_FUSION_H
+#define TOF_FUSION_H
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Csi.h"
+#include "DerivedRecord.h"
+
+#define TOF_FUSION_VALUES 5
+#define FTM_QUEUE_SIZE 1024
+#define TOF_JITTER_WEIGHT 0.05
+
+struct Ftm;
+
+// One way time of flight, timestamps in us since epoch
+struct FtmSample {
+    uint64_t timestamp;
+    double tof;       // ns
+    double variance;  // ns^2
+};
+
+struct CsiTof {
+    uint64_t timestamp;
+    double tof;  // ns
+};
+
+/**
+ * Distance from the phase slope of CSI calibrated by FTM. Time of flight of
+ * every record is the slope of its unwrapped phase over subcarrier frequency,
+ * which also contains STO and hardware delays. Every FTM measurement is
+ * paired with the CSI time of flight around its timestamp and the median
+ * difference of the last pairs is the offset added to the CSI estimates.
+ *
+ * FTM results are reported from the FTM thread by addFtm(), or read from a
+ * FTM_ file when processing recorded CSI.
+ *
+ * Values per record: distance (m), its standard deviation (m), confidence
+ * (0-1], CSI time of flight (ns), calibration offset (ns)
+ */
+class TofFusion {
+   public:
+    void configure(uint64_t alignWindow, uint32_t calibrationSize, const std::string& ftmFile);
+
+    std::unique_ptr<DerivedRecord> update(const Csi& csi);
+
+    static void addFtm(const Ftm& ftm);
+
+    // ToF of the first tx chain over all rx chains from raw CSI, ns
+    double phaseSlopeTof(const Csi& csi, double& variance);
+
+   private:
+    inline static std::mutex ftmMutex;
+    inline static std::deque<FtmSample> ftmQueue;
+    inline static std::atomic<bool> enabled = false;
+
+    uint64_t alignWindow = 50000;  // us
+    uint32_t calibrationSize = 16;
+    std::deque<FtmSample> pending;
+    std::deque<CsiTof> history;
+    std::deque<double> offsets;
+    double offset = 0;
+    double offsetVariance = 0;
+    // Exponentially weighted mean and variance of CSI time of flight, packet jitter
+    double tofMean = NAN;
+    double tofVariance = 0;
+    std::vector<double> phase;
+
+    static FtmSample toSample(const Ftm& ftm);
+    void calibrate(uint64_t now);
+};
+
+#endif
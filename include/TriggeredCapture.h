@@ -0,0 +1,94 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRIGGERED_CAPTURE_H
+#define TRIGGERED_CAPTURE_H
+
+#include <complex>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "Csi.h"
+#include "UdpSocket.h"
+
+// Upper bound of buffered records whatever the pre-trigger time is
+#define TRIGGER_RING_LIMIT 100000
+
+enum triggerDetector {
+    TRIGGER_VARIANCE,  // amplitude variance over subcarriers
+    TRIGGER_RATIO,     // energy of changes of rx0 / rx1 CSI ratio, needs two rx chains
+};
+
+struct RawRecord {
+    RawHeaderData header;
+    uint32_t clockUncertainty;
+    std::vector<uint8_t> data;
+};
+
+struct DetectorState {
+    uint32_t numValues = 0;
+    uint32_t count = 0;
+    std::vector<double> mean;
+    std::vector<double> variance;
+    std::vector<std::complex<double>> ratioMean;
+};
+
+/**
+ * Event triggered raw output. Raw records of the last pre seconds are kept
+ * in memory while a cheap per transmitter detector runs on every record.
+ * When the detector of any transmitter fires, the buffered records are
+ * written or sent, followed by every record until hold seconds pass without
+ * another detection.
+ *
+ * Detector value is the mean over subcarriers of exponentially weighted
+ * variance normalized by squared mean, of magnitude or of the rx0 / rx1
+ * ratio, which is free of CFO and timing offsets.
+ */
+class TriggeredCapture {
+   public:
+    void configure(triggerDetector detector,
+                   double threshold,
+                   double preSeconds,
+                   double holdSeconds,
+                   double alpha);
+
+    void update(const Csi& csi, UdpSocket* udpSocket);
+
+    static triggerDetector parseDetector(const std::string& name);
+
+   private:
+    triggerDetector detector = TRIGGER_VARIANCE;
+    double threshold = 0.01;
+    uint64_t pre = 2000000;  // us
+    uint64_t hold = 5000000;
+    double alpha = 0.1;
+    std::map<uint64_t, DetectorState> states;
+    std::deque<RawRecord> ring;
+    bool recording = false;
+    uint64_t recordUntil = 0;
+
+    double evaluate(const Csi& csi);
+    static void output(const RawHeaderData& header,
+                       const uint8_t* data,
+                       uint32_t clockUncertainty,
+                       UdpSocket* udpSocket);
+};
+
+#endif
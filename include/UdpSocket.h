@@ -20,13 +20,69 @@
 #define UDP_SOCKET_H
 
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Arguments.h"
+#include "MulticastSink.h"
+#include "ShmRingSink.h"
+#include "StreamFramer.h"
+#include "StreamServer.h"
+#include "StreamUplink.h"
+#include "SubscriptionRegistry.h"
 
+// Datagrams sent by one sendmmsg call
+#define UDP_BATCH_SIZE 32
+// Queued datagrams wait at most this long for the batch to fill
+#define UDP_FLUSH_INTERVAL_US 1000
+
+struct UdpStats
+{
+    uint64_t sent = 0;
+    uint64_t dropped = 0;  // socket buffer full or datagram too big
+    uint64_t batches = 0;
+    uint64_t bytes = 0;
+    uint64_t retransmitted = 0;  // fragments resent on request of the receiver
+};
+
+/**
+ * Answers control commands and streams records to the last peer that sent a
+ * command and to the subscribers (SubscriptionRegistry.h). Datagrams
+ * are queued and sent by sendmmsg when the batch is full or the flush
+ * interval passes. A queued datagram points into its shared record buffer,
+ * which the batch keeps alive, so a record is gathered once however it is
+ * fragmented. Sending never blocks, datagrams the kernel does not accept are
+ * counted as dropped. Batch size 1 sends every datagram right away straight
+ * from the caller's buffers.
+ *
+ * With framing enabled records are split into MTU sized fragments of the
+ * stream protocol (StreamProtocol.h) and the last records are kept so the
+ * receiver can ask for lost fragments. With a shared memory ring name set
+ * the records are also written to the ring for local readers, with listen
+ * addresses set they are streamed to TCP and Unix socket clients, with
+ * a multicast group set they are sent once to the group and with an
+ * aggregator set they are pushed to it.
+ */
 class UdpSocket
 {
 
 public:
+    ~UdpSocket();
     void init();
-    void send(char *buf, int size);
+    // Streams to address without waiting for a command, e.g. in tools
+    void setPeer(const struct sockaddr *address, socklen_t length);
+    void send(char *buf, int size, const StreamRecordInfo &info);
+    void send(const struct iovec *iov, int iovcnt, const StreamRecordInfo &info);
+    void flush();
+    UdpStats getStats() const;
+    void logStats();
 
 private:
 
@@ -34,6 +90,73 @@ private:
     bool running = false;
     struct sockaddr_storage peer_addr;
     socklen_t peer_addr_len;
+    std::atomic<bool> hasPeer = false;  // a command arrived and the peer is no subscriber
+    SubscriptionRegistry subscriptions;
+
+    // Datagram of the batch, a stream protocol header and a part of a record
+    struct QueuedDatagram
+    {
+        StreamFrameHeader header;
+        bool framed;
+        const char *payload;
+        size_t payloadSize;
+    };
+
+    std::mutex batchMutex;
+    std::vector<QueuedDatagram> queued;
+    std::vector<StreamRecordData> records;  // payloads of the queued datagrams point into
+    std::vector<struct iovec> iovs;
+    std::vector<struct mmsghdr> messages;
+    std::chrono::steady_clock::time_point oldest;
+    std::thread flusher;
+    std::condition_variable flusherWake;
+    bool stopping = false;
+
+    std::atomic<uint64_t> sent = 0;
+    std::atomic<uint64_t> dropped = 0;
+    std::atomic<uint64_t> batches = 0;
+    std::atomic<uint64_t> bytes = 0;
+    std::atomic<uint64_t> retransmitted = 0;
+
+    std::mutex framerMutex;
+    StreamFramer framer;
+
+    std::mutex shmMutex;
+    std::unique_ptr<ShmRingSink> shm;
+    std::string shmFailed;  // name the ring could not be created with
+
+    std::mutex streamMutex;
+    std::shared_ptr<StreamServer> stream;
+    std::string streamConfig;  // stream was created with, or failed to
+
+    std::mutex multicastMutex;
+    std::unique_ptr<MulticastSink> multicast;
+    std::string multicastConfig;  // multicast was created with, or failed to
+
+    std::mutex uplinkMutex;
+    std::unique_ptr<StreamUplink> uplink;
+    std::string uplinkConfig;  // uplink was created with, or failed to
+
+    UdpStats lastStats;
+    std::chrono::steady_clock::time_point lastStatsTime;
+    double lastCpuTime = 0;
+
+    // The sinks read args, one snapshot of the arguments for the whole record
+    void publishShm(const struct iovec *iov, int iovcnt, const StreamRecordInfo &recordInfo,
+                    const Args &args);
+    void publishStream(const struct iovec *iov, int iovcnt, const Args &args);
+    void publishMulticast(const struct iovec *iov, int iovcnt, const Args &args);
+    void publishUplink(const struct iovec *iov, int iovcnt, const StreamRecordInfo &recordInfo,
+                       const Args &args);
+    static StreamRecordData gatherRecord(const struct iovec *iov, int iovcnt);
+    void sendDatagram(const struct iovec *iov, int iovcnt);
+    void queueDatagram(const StreamRecordData &record, const StreamFrameHeader *header,
+                       const char *payload, size_t payloadSize, const Args &args);
+    void sendFramed(const struct iovec *iov, int iovcnt, const Args &args);
+    void sendFragment(const StreamHistoryRecord &record, uint16_t index, uint8_t flags,
+                      const Args &args);
+    void flushLocked();
+    void flushLoop();
 };
 
 #endif
\ No newline at end of file
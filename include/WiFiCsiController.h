@@ -21,6 +21,8 @@
 
 #include "Netlink.h"
 #include "Csi.h"
+#include "ProcessingGraph.h"
+#include <memory>
 #include <mutex>
 #include <queue>
 
@@ -38,6 +40,7 @@ public:
     inline static std::mutex csiQueueMutex;
     inline static std::queue<Csi*> csiQueue;
     int64_t stopTime = 0;
+    std::unique_ptr<ProcessingGraph> graph;
 
     ~WiFiCsiController();
 
@@ -45,6 +48,8 @@ private:
     static int listenToCsiHandler(nl80211_state *state, nl_msg *msg, void *arg);
     static int processListenToCsiHandler(nl_msg *msg, void *arg);
     static void printDetail(Csi *c);
+    void output(Csi *c);
+    uint64_t processedCount = 0;
 };
 
 #endif
\ No newline at end of file
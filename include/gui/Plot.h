@@ -31,7 +31,7 @@ class Plot : public Gtk::DrawingArea
 public:
     void init();
     void init(Glib::RefPtr<Gtk::Box> box);
-    void updateData(Csi *csi, std::vector<double> *data);
+    void updateData(Csi *csi, std::vector<double> *data, uint32_t numPoints = 0);
     double yTicksMax = 200;
     double yTicksMin = 0;
     std::string yLabel = "";
@@ -47,6 +47,7 @@ private:
     };
     Csi *csi;
     std::vector<double> *data;
+    uint32_t numPoints = 0; // values per rx/tx pair, subcarrier count when 0
     std::mutex updateDataMutex;
     double yTicks;
     
@@ -28,6 +28,18 @@ enum processor
     interpolateCubic,
     interpolateCosine,
     phaseCalibrationLinearTransform,
+    channelImpulseResponse,
+    statistics,
+    dopplerSpectrogram,
+    resample,
+    csiRatio,
+    spatialCovariance,
+    music,
+    tofFusion,
+    hampel,
+    medianFilter,
+    pca,
+    trigger,
 };
 
 #endif
\ No newline at end of file
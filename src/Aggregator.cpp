@@ -0,0 +1,645 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Aggregator.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include "AggregateProtocol.h"
+#include "Arguments.h"
+#include "ClockSync.h"
+#include "DerivedRecord.h"
+#include "Logger.h"
+#include "StreamReceiver.h"
+
+// Datagrams taken by one recvmmsg call
+#define AGGREGATE_BATCH 32
+#define AGGREGATE_DATAGRAM_SIZE 65536
+// Frames on TCP connections larger than this are garbage, the connection is closed
+#define AGGREGATE_MAX_RECORD (64 << 20)
+
+namespace {
+
+struct BufferedRecord {
+    uint64_t timestamp;
+    uint64_t order;  // arrival at its thread, keeps records of equal timestamps in order
+    StreamRecordData data;
+};
+
+struct LaterRecord {
+    bool operator()(const BufferedRecord& a, const BufferedRecord& b) const {
+        return a.timestamp > b.timestamp || (a.timestamp == b.timestamp && a.order > b.order);
+    }
+};
+
+struct DatagramSource {
+    StreamReceiver receiver;
+    uint8_t node[16];
+    std::chrono::steady_clock::time_point seen;
+};
+
+struct Connection {
+    std::vector<uint8_t> buffer;
+    size_t used = 0;
+    uint8_t node[16];
+    bool started = false;
+    uint32_t sessionId = 0;
+    uint32_t nextSequence = 0;
+};
+
+// IPv6 address of a peer, IPv4 ones mapped
+void nodeAddress(const struct sockaddr_storage& address, uint8_t* node) {
+    if (address.ss_family == AF_INET) {
+        static const uint8_t mapped[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+        memcpy(node, mapped, sizeof(mapped));
+        memcpy(node + 12, &((const struct sockaddr_in*)&address)->sin_addr, 4);
+    } else {
+        memcpy(node, &((const struct sockaddr_in6*)&address)->sin6_addr, 16);
+    }
+}
+
+std::string nodeName(const uint8_t* node) {
+    char name[INET6_ADDRSTRLEN];
+    struct in6_addr address;
+    memcpy(&address, node, sizeof(address));
+    if (IN6_IS_ADDR_V4MAPPED(&address)) {
+        inet_ntop(AF_INET, node + 12, name, sizeof(name));
+    } else {
+        inet_ntop(AF_INET6, node, name, sizeof(name));
+    }
+    return name;
+}
+
+std::string formatPrefix(uint8_t format, uint16_t derivedType) {
+    switch (format) {
+        case STREAM_FORMAT_CSI:
+            return "CSI_";
+        case STREAM_FORMAT_FTM:
+            return "FTM_";
+    }
+    return DerivedRecord::prefix(derivedType);
+}
+
+}  // namespace
+
+struct Aggregator::Worker {
+    int epollFd = -1;
+    std::vector<int> udpFds;
+    std::vector<int> listenFds;
+    std::unordered_map<int, Connection> connections;
+    std::unordered_map<std::string, DatagramSource> sources;  // by sockaddr
+    std::thread thread;
+
+    std::mutex mutex;  // of the heap
+    std::priority_queue<BufferedRecord, std::vector<BufferedRecord>, LaterRecord> heap;
+    uint64_t order = 0;
+
+    std::atomic<uint64_t> datagrams = 0;
+    std::atomic<uint64_t> records = 0;
+    std::atomic<uint64_t> lost = 0;
+    std::atomic<uint64_t> invalid = 0;
+    std::atomic<uint64_t> nacks = 0;
+
+    std::vector<uint8_t> buffers;
+    struct mmsghdr messages[AGGREGATE_BATCH];
+    struct iovec iovs[AGGREGATE_BATCH];
+    struct sockaddr_storage addresses[AGGREGATE_BATCH];
+
+    ~Worker() {
+        for (int fd : this->udpFds) {
+            ::close(fd);
+        }
+        for (int fd : this->listenFds) {
+            ::close(fd);
+        }
+        for (auto& [fd, connection] : this->connections) {
+            ::close(fd);
+        }
+        if (this->epollFd >= 0) {
+            ::close(this->epollFd);
+        }
+    }
+};
+
+struct Aggregator::Shard {
+    std::filesystem::path directory;
+    std::string prefix;
+    uint32_t number = 0;
+    uint64_t size = 0;
+    std::ofstream data;
+    std::ofstream index;
+
+    void open() {
+        std::filesystem::path path;
+        char name[16];
+        do {
+            snprintf(name, sizeof(name), "%06u", this->number++);
+            path = this->directory / (this->prefix + name + ".dat");
+        } while (std::filesystem::exists(path));
+        this->data.open(path, std::ios::binary);
+        this->index.open(this->directory / (this->prefix + name + ".idx"), std::ios::binary);
+        this->size = 0;
+        if (this->data.fail() || this->index.fail()) {
+            throw std::ios_base::failure("Open shard " + path.string() +
+                                         " failed: " + std::strerror(errno));
+        }
+    }
+};
+
+Aggregator::Aggregator(const AggregateConfig& config) : config(config) {
+    const uint32_t threads =
+        config.threads ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t i = 0; i < threads; i++) {
+        this->workers.push_back(std::make_unique<Worker>());
+        this->openSockets(*this->workers.back());
+    }
+
+    if (!config.directory.empty()) {
+        std::filesystem::create_directories(config.directory);
+    }
+    const std::shared_ptr<const Args> snapshot = Arguments::snapshot();
+    const Args& args = *snapshot;
+    if (!args.streamListen.empty()) {
+        this->stream = std::make_unique<StreamServer>(
+            args.streamListen, (size_t)args.streamBuffer << 20,
+            StreamServer::parseBackpressure(args.streamBackpressure));
+    }
+    if (!args.multicastGroup.empty()) {
+        this->multicast = std::make_unique<MulticastSink>(
+            args.multicastGroup, args.multicastTtl, args.multicastInterface,
+            args.udpFrame ? args.udpFrame : STREAM_DEFAULT_MTU);
+    }
+    if (!args.shmName.empty()) {
+        this->shm = std::make_unique<ShmRingSink>(args.shmName, (size_t)args.shmSize << 20);
+    }
+    Logger::log(info) << "Aggregating records on " << config.listen << " with " << threads
+                      << " threads\n";
+}
+
+Aggregator::~Aggregator() = default;
+
+/**
+ * Every thread binds its own sockets to all the addresses, SO_REUSEPORT
+ * lets the kernel spread the nodes over them.
+ */
+void Aggregator::openSockets(Worker& worker) {
+    worker.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    worker.buffers.resize((size_t)AGGREGATE_BATCH * AGGREGATE_DATAGRAM_SIZE);
+
+    std::istringstream iss(this->config.listen);
+    std::string address;
+    while (std::getline(iss, address, ',')) {
+        const bool tcp = address.rfind("tcp:", 0) == 0;
+        if (!tcp && address.rfind("udp:", 0) != 0) {
+            throw std::invalid_argument("Aggregate address " + address +
+                                        " is not udp:[HOST:]PORT or tcp:[HOST:]PORT");
+        }
+        std::string host = address.substr(4);
+        std::string port = host;
+        const size_t separator = host.rfind(':');
+        if (separator == std::string::npos) {
+            host.clear();
+        } else {
+            port = host.substr(separator + 1);
+            host = host.substr(0, separator);
+            if (host.size() > 1 && host.front() == '[' && host.back() == ']') {
+                host = host.substr(1, host.size() - 2);
+            }
+        }
+
+        struct addrinfo hints = {};
+        struct addrinfo* result;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = tcp ? SOCK_STREAM : SOCK_DGRAM;
+        hints.ai_flags = AI_PASSIVE;
+        int s = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result);
+        if (s != 0) {
+            throw std::invalid_argument("Aggregate address " + address + ": " + gai_strerror(s));
+        }
+        int fd = -1;
+        for (struct addrinfo* rp = result; rp; rp = rp->ai_next) {
+            fd = socket(rp->ai_family, rp->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                        rp->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            int on = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+            if (!tcp) {
+                int size = 8 << 20;
+                setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+            }
+            if (bind(fd, rp->ai_addr, rp->ai_addrlen) == 0 &&
+                (!tcp || ::listen(fd, SOMAXCONN) == 0)) {
+                break;
+            }
+            ::close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(result);
+        if (fd < 0) {
+            throw std::ios_base::failure("Bind " + address + " failed");
+        }
+
+        (tcp ? worker.listenFds : worker.udpFds).push_back(fd);
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(worker.epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+void Aggregator::run() {
+    // Blocked by the caller before any thread was started, only waited for here
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+
+    for (auto& worker : this->workers) {
+        worker->thread = std::thread(&Aggregator::receive, this, std::ref(*worker));
+    }
+
+    auto lastLog = std::chrono::steady_clock::now();
+    AggregateStats lastStats;
+    const struct timespec tick = {0, AGGREGATE_TICK_MS * 1000000};
+    while (!this->stopping) {
+        if (sigtimedwait(&signals, nullptr, &tick) > 0) {
+            this->stopping = true;
+        }
+        this->release(false);
+
+        const auto now = std::chrono::steady_clock::now();
+        if (Arguments::snapshot()->verbose && now - lastLog >= std::chrono::seconds(1)) {
+            const AggregateStats stats = this->getStats();
+            const double seconds = std::chrono::duration<double>(now - lastLog).count();
+            Logger::log(info) << "Aggregator " << (stats.records - lastStats.records) / seconds
+                              << " records/s, " << stats.buffered << " buffered, "
+                              << stats.late << " late, " << stats.lost << " lost, "
+                              << stats.invalid << " invalid, " << stats.nacks << " NACKs\n";
+            lastStats = stats;
+            lastLog = now;
+        }
+    }
+
+    for (auto& worker : this->workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    this->release(true);
+    for (auto& [key, shard] : this->shards) {
+        shard->data.flush();
+        shard->index.flush();
+    }
+}
+
+void Aggregator::stop() {
+    this->stopping = true;
+}
+
+AggregateStats Aggregator::getStats() {
+    AggregateStats stats;
+    for (auto& worker : this->workers) {
+        stats.datagrams += worker->datagrams;
+        stats.records += worker->records;
+        stats.lost += worker->lost;
+        stats.invalid += worker->invalid;
+        stats.nacks += worker->nacks;
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        stats.buffered += worker->heap.size();
+    }
+    stats.released = this->released;
+    stats.late = this->late;
+    return stats;
+}
+
+void Aggregator::receive(Worker& worker) {
+    struct epoll_event events[64];
+    auto lastExpire = std::chrono::steady_clock::now();
+    while (!this->stopping) {
+        const int n = epoll_wait(worker.epollFd, events, 64, 100);
+        for (int i = 0; i < n; i++) {
+            const int fd = events[i].data.fd;
+            if (std::find(worker.udpFds.begin(), worker.udpFds.end(), fd) !=
+                worker.udpFds.end()) {
+                this->receiveDatagrams(worker, fd);
+            } else if (std::find(worker.listenFds.begin(), worker.listenFds.end(), fd) !=
+                       worker.listenFds.end()) {
+                struct sockaddr_storage address;
+                socklen_t length = sizeof(address);
+                int client;
+                while ((client = accept4(fd, (struct sockaddr*)&address, &length,
+                                         SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    Connection& connection = worker.connections[client];
+                    nodeAddress(address, connection.node);
+                    struct epoll_event event = {};
+                    event.events = EPOLLIN;
+                    event.data.fd = client;
+                    epoll_ctl(worker.epollFd, EPOLL_CTL_ADD, client, &event);
+                    Logger::log(info) << "Node " << nodeName(connection.node) << " connected\n";
+                    length = sizeof(address);
+                }
+            } else {
+                this->receiveConnection(worker, fd);
+            }
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now - lastExpire >= std::chrono::seconds(1)) {
+            lastExpire = now;
+            for (auto it = worker.sources.begin(); it != worker.sources.end();) {
+                if (now - it->second.seen > std::chrono::seconds(AGGREGATE_SOURCE_TIMEOUT_S)) {
+                    it->second.receiver.finish();
+                    it = worker.sources.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+}
+
+void Aggregator::receiveDatagrams(Worker& worker, int fd) {
+    for (int i = 0; i < AGGREGATE_BATCH; i++) {
+        worker.iovs[i] = {&worker.buffers[(size_t)i * AGGREGATE_DATAGRAM_SIZE],
+                          AGGREGATE_DATAGRAM_SIZE};
+        worker.messages[i].msg_hdr = {};
+        worker.messages[i].msg_hdr.msg_iov = &worker.iovs[i];
+        worker.messages[i].msg_hdr.msg_iovlen = 1;
+        worker.messages[i].msg_hdr.msg_name = &worker.addresses[i];
+    }
+
+    // Sources that got datagrams with their address, asked for lost fragments once per call
+    std::vector<std::pair<DatagramSource*, const std::string*>> touched;
+    int n;
+    // A few batches at a time, epoll comes back for the rest and other sockets get their turn
+    for (int batch = 0; batch < 16; batch++) {
+        for (int i = 0; i < AGGREGATE_BATCH; i++) {
+            worker.messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        }
+        n = recvmmsg(fd, worker.messages, AGGREGATE_BATCH, MSG_DONTWAIT, nullptr);
+        if (n <= 0) {
+            break;
+        }
+        const int64_t received = ClockSync::localTime();
+        const auto now = std::chrono::steady_clock::now();
+        worker.datagrams += n;
+        for (int i = 0; i < n; i++) {
+            const uint8_t* datagram = (const uint8_t*)worker.iovs[i].iov_base;
+            const size_t size = worker.messages[i].msg_len;
+            const struct sockaddr* from = (const struct sockaddr*)&worker.addresses[i];
+            const socklen_t fromLen = worker.messages[i].msg_hdr.msg_namelen;
+            if (ClockSync::answer(fd, (const char*)datagram, size, received, from, fromLen)) {
+                continue;
+            }
+
+            const std::string key((const char*)from, fromLen);
+            auto it = worker.sources.find(key);
+            if (it == worker.sources.end()) {
+                it = worker.sources.try_emplace(key).first;
+                DatagramSource& source = it->second;
+                nodeAddress(worker.addresses[i], source.node);
+                source.receiver.onRecord = [this, &worker, &source](
+                                               uint32_t, const std::vector<uint8_t>& record) {
+                    this->addRecord(worker, source.node, record.data(), record.size());
+                };
+                source.receiver.onLoss = [&worker](const StreamLoss& loss) {
+                    worker.lost += loss.type == STREAM_LOSS_GAP
+                                       ? loss.lastSequence - loss.firstSequence + 1
+                                       : 1;
+                };
+                Logger::log(info) << "Node " << nodeName(source.node) << " sending\n";
+            }
+            DatagramSource& source = it->second;
+            source.seen = now;
+            const uint64_t invalid = source.receiver.getStats().invalid;
+            source.receiver.receive(datagram, size);
+            worker.invalid += source.receiver.getStats().invalid - invalid;
+            if (std::find_if(touched.begin(), touched.end(), [&source](const auto& t) {
+                    return t.first == &source;
+                }) == touched.end()) {
+                touched.emplace_back(&source, &it->first);
+            }
+        }
+        if (n < AGGREGATE_BATCH) {
+            break;
+        }
+    }
+
+    for (const auto& [source, address] : touched) {
+        for (const std::vector<uint8_t>& nack : source->receiver.nacks()) {
+            sendto(fd, nack.data(), nack.size(), MSG_DONTWAIT,
+                   (const struct sockaddr*)address->data(), address->size());
+            worker.nacks++;
+        }
+    }
+}
+
+void Aggregator::receiveConnection(Worker& worker, int fd) {
+    Connection& c = worker.connections[fd];
+    bool closed = false;
+    for (;;) {
+        if (c.buffer.size() - c.used < AGGREGATE_DATAGRAM_SIZE) {
+            c.buffer.resize(c.used + AGGREGATE_DATAGRAM_SIZE);
+        }
+        const ssize_t n = recv(fd, c.buffer.data() + c.used, c.buffer.size() - c.used, 0);
+        if (n > 0) {
+            c.used += n;
+            continue;
+        }
+        closed = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+        break;
+    }
+
+    size_t offset = 0;
+    while (!closed && c.used - offset >= sizeof(StreamFrameHeader)) {
+        StreamFrameHeader h;
+        memcpy(&h, c.buffer.data() + offset, sizeof(h));
+        if (h.magic != STREAM_MAGIC || h.version != STREAM_VERSION ||
+            h.headerSize < sizeof(h) || h.fragmentCount != 1 ||
+            h.recordSize > AGGREGATE_MAX_RECORD) {
+            worker.invalid++;
+            closed = true;
+            break;
+        }
+        const size_t size = (size_t)h.headerSize + h.recordSize;
+        if (c.used - offset < size) {
+            break;
+        }
+        // Records the node dropped while it could not send show up as a gap.
+        // A sequence behind the expected one is not a loss, the stream is
+        // resynchronised to it
+        const int32_t gap = (int32_t)(h.sequence - c.nextSequence);
+        if (c.started && h.sessionId == c.sessionId && gap > 0) {
+            worker.lost += gap;
+        }
+        c.started = true;
+        c.sessionId = h.sessionId;
+        c.nextSequence = h.sequence + 1;
+        this->addRecord(worker, c.node, c.buffer.data() + offset + h.headerSize, h.recordSize);
+        offset += size;
+    }
+
+    if (closed) {
+        Logger::log(info) << "Node " << nodeName(c.node) << " disconnected\n";
+        epoll_ctl(worker.epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        worker.connections.erase(fd);
+        return;
+    }
+    memmove(c.buffer.data(), c.buffer.data() + offset, c.used - offset);
+    c.used -= offset;
+}
+
+void Aggregator::addRecord(Worker& worker,
+                           const uint8_t* node,
+                           const uint8_t* record,
+                           size_t size) {
+    AggregateRecordHeader envelope;
+    if (size < sizeof(envelope)) {
+        worker.invalid++;
+        return;
+    }
+    memcpy(&envelope, record, sizeof(envelope));
+    if (envelope.headerSize < sizeof(envelope) || envelope.headerSize > size) {
+        worker.invalid++;
+        return;
+    }
+    auto data =
+        std::make_shared<std::vector<char>>((const char*)record, (const char*)record + size);
+    memcpy(data->data() + offsetof(AggregateRecordHeader, node), node, sizeof(envelope.node));
+    // Nodes without a clock stamp are put at arrival
+    const uint64_t timestamp = envelope.timestamp ? envelope.timestamp
+                                                  : ClockSync::getInstance().now();
+
+    worker.records++;
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.heap.push({timestamp, worker.order++, std::move(data)});
+}
+
+/**
+ * Takes the records older than the corrected clock minus the jitter from
+ * all the threads and outputs them in timestamp order.
+ */
+void Aggregator::release(bool all) {
+    const uint64_t watermark =
+        ClockSync::getInstance().now() - (uint64_t)this->config.jitter * 1000;
+    std::vector<BufferedRecord> batch;
+    for (auto& worker : this->workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        while (!worker->heap.empty() &&
+               (all || worker->heap.top().timestamp <= watermark ||
+                worker->heap.size() > AGGREGATE_BUFFER_RECORDS)) {
+            batch.push_back(worker->heap.top());
+            worker->heap.pop();
+        }
+    }
+    std::sort(batch.begin(), batch.end(), [](const BufferedRecord& a, const BufferedRecord& b) {
+        return a.timestamp < b.timestamp;
+    });
+
+    for (const BufferedRecord& record : batch) {
+        if (record.timestamp < this->lastReleased) {
+            this->late++;
+        } else {
+            this->lastReleased = record.timestamp;
+        }
+        this->output(record.data);
+        this->released++;
+    }
+}
+
+void Aggregator::output(const StreamRecordData& data) {
+    if (!this->config.directory.empty()) {
+        this->write(data);
+    }
+    struct iovec iov = {const_cast<char*>(data->data()), data->size()};
+    if (this->stream) {
+        this->stream->publish(&iov, 1);
+    }
+    if (this->multicast) {
+        this->multicast->publish(&iov, 1);
+    }
+    if (this->shm) {
+        AggregateRecordHeader envelope;
+        memcpy(&envelope, data->data(), sizeof(envelope));
+        this->shm->publish(&iov, 1,
+                           {(streamFormat)envelope.format, envelope.derivedType,
+                            envelope.srcMac, envelope.timestamp, envelope.clockUncertainty});
+    }
+}
+
+void Aggregator::write(const StreamRecordData& data) {
+    AggregateRecordHeader envelope;
+    memcpy(&envelope, data->data(), sizeof(envelope));
+    std::string key((const char*)envelope.node, sizeof(envelope.node));
+    key.append((const char*)envelope.srcMac, sizeof(envelope.srcMac));
+    key.append((const char*)&envelope.format, sizeof(envelope.format));
+    key.append((const char*)&envelope.derivedType, sizeof(envelope.derivedType));
+
+    std::unique_ptr<Shard>& shard = this->shards[key];
+    try {
+        if (!shard) {
+            char mac[18];
+            snprintf(mac, sizeof(mac), "%02x-%02x-%02x-%02x-%02x-%02x", envelope.srcMac[0],
+                     envelope.srcMac[1], envelope.srcMac[2], envelope.srcMac[3],
+                     envelope.srcMac[4], envelope.srcMac[5]);
+            auto created = std::make_unique<Shard>();
+            created->directory =
+                std::filesystem::path(this->config.directory) / nodeName(envelope.node) / mac;
+            created->prefix = formatPrefix(envelope.format, envelope.derivedType);
+            std::filesystem::create_directories(created->directory);
+            created->open();
+            shard = std::move(created);
+        } else if (shard->size >= (uint64_t)this->config.shardSize << 20) {
+            shard->data.close();
+            shard->index.close();
+            shard->open();
+        }
+    } catch (const std::exception& e) {
+        Logger::log(error) << e.what() << "\n";
+        shard.reset();
+        return;
+    }
+
+    const size_t size = data->size() - envelope.headerSize;
+    const AggregateIndexEntry entry = {envelope.timestamp, shard->size, (uint32_t)size,
+                                       envelope.clockUncertainty};
+    shard->data.write(data->data() + envelope.headerSize, size);
+    shard->index.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    shard->size += size;
+}
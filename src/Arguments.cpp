@@ -19,6 +19,14 @@
 #include "Arguments.h"
 #include "WiFIController.h"
 #include "rs.h"
+#include "Resampler.h"
+#include "CsiRatio.h"
+#include "Logger.h"
+#include "StreamProtocol.h"
+#include "StreamServer.h"
+#include "TriggeredCapture.h"
+
+#include <sstream>
 
 const std::string VERSION = (std::string("FeitCSI ") + FEITCSI_VERSION);
 const char *argp_program_version = VERSION.c_str();
@@ -58,13 +66,75 @@ void Arguments::init()
         .ftmBurstDuration = 0,
         .mac = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55}
     };
+    Arguments::publish();
 }
 
 void Arguments::parse(int argc, char *argv[])
+{
+    Arguments::parse(argc, argv, arguments);
+    Arguments::publish();
+}
+
+void Arguments::parse(int argc, char *argv[], Args &args)
 {
     static struct argp argp = {options, parse_opt, args_doc, doc};
 
-    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+    argp_parse(&argp, argc, argv, 0, 0, &args);
+}
+
+/**
+ * The capture thread reads the arguments on every record while the control
+ * thread may change them, so it reads an immutable copy that is replaced as
+ * a whole and stays valid as long as the reader holds it.
+ */
+std::shared_ptr<const Args> Arguments::snapshot()
+{
+    return published.load();
+}
+
+void Arguments::publish()
+{
+    Arguments::publish(arguments);
+}
+
+void Arguments::publish(const Args &args)
+{
+    published.store(std::make_shared<const Args>(args));
+}
+
+/**
+ * Applies options given by their keys to args, e.g. {'f', "5180"}, without
+ * exiting on errors. Keys are the short option characters and longOption
+ * values. False when a key is unknown or a value is not correct.
+ */
+bool Arguments::parse(const std::vector<std::pair<int, std::string>> &values, Args &args)
+{
+    static struct argp argp = {options, parse_opt, args_doc, doc};
+
+    std::vector<std::string> strings = {"feitcsi"};
+    for (const auto &[key, value] : values)
+    {
+        const struct argp_option *option = options;
+        while (option->name && option->key != key)
+        {
+            option++;
+        }
+        if (!option->name)
+        {
+            Logger::log(error) << "Unknown option key " << key << "\n";
+            return false;
+        }
+        strings.push_back(std::string("--") + option->name + (value.empty() ? "" : "=" + value));
+    }
+
+    std::vector<char *> argv;
+    for (std::string &s : strings)
+    {
+        argv.push_back(s.data());
+    }
+    argv.push_back(nullptr);
+    return argp_parse(&argp, argv.size() - 1, argv.data(), ARGP_NO_EXIT | ARGP_NO_HELP, 0,
+                      &args) == 0;
 }
 
 error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
@@ -131,7 +201,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         else
         {
             argp_failure(state, 1, 0, "Bad mode. Possible values [measure|inject|measureinject|ftm]");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         break;
     }
@@ -141,7 +211,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (mcs < 0 || mcs > 11)
         {
             argp_failure(state, 1, 0, "Bad MCS index. Possible values [0-11]");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         args->mcs = (uint8_t)mcs;
         break;
@@ -155,7 +225,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         else
         {
             argp_failure(state, 1, 0, "Bad format. Possible values [NOHT|HT|VHT|HESU]");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         break;
     }
@@ -168,7 +238,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         else
         {
             argp_failure(state, 1, 0, "Bad coding. Possible values [LDPC|BCC]");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         break;
     }
@@ -181,7 +251,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         else
         {
             argp_failure(state, 1, 0, "Bad LTF. Possible values [2xLTF+0.8|2xLTF+1.6|4xLTF+3.2|4xLTF+0.8]");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         break;
     }
@@ -191,7 +261,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (modeDelay <= 0)
         {
             argp_failure(state, 1, 0, "Mode delay is not correct number");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         args->modeDelay = (uint32_t)modeDelay;
         break;
@@ -206,7 +276,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         else
         {
             argp_failure(state, 1, 0, "Bad guard interval. Possible values [400|800]");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         break;
     }
@@ -216,7 +286,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (injd <= 0)
         {
             argp_failure(state, 1, 0, "Inject delay is not correct number");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         args->injectDelay = (uint32_t)injd;
         break;
@@ -227,7 +297,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (injr <= 0)
         {
             argp_failure(state, 1, 0, "Inject repeat is not correct number");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         args->injectRepeat = (uint32_t)injr;
         break;
@@ -238,7 +308,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (ss < 1 || ss > 2)
         {
             argp_failure(state, 1, 0, "Bad spatial stream. Possible values [1|2]");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         args->spatialStreams = (uint8_t)ss;
         break;
@@ -249,7 +319,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (tx < 1 || tx > 22)
         {
             argp_failure(state, 1, 0, "Bad tx power. Possible values [1-22]");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         args->txPower = (uint8_t)tx;
         break;
@@ -272,7 +342,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         else
         {
             argp_failure(state, 1, 0, "Bad transmitting antenna value. Possible values 1, 2 or 12 for both");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         break;
     }
@@ -282,7 +352,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (f <= 0)
         {
             argp_failure(state, 1, 0, "Frequency is not correct");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         args->frequency = (uint16_t)f;
         break;
@@ -293,7 +363,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (chMode.width == 0)
         {
             argp_failure(state, 1, 0, "Bad bandwidth. Possible values of bandwidth are [20|40|HT40-|80|160]");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         args->bandwidth = arg;
         args->channelWidth = WiFIController::chanModeToWidth(chMode);
@@ -311,7 +381,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (f <= 0)
         {
             argp_failure(state, 1, 0, "FTM burst exponent is not correct");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         args->ftmBurstExp = (uint8_t)f;
         break;
@@ -322,7 +392,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (f <= 0)
         {
             argp_failure(state, 1, 0, "FTM per burst is not correct");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         args->ftmPerBurst = (uint8_t)f;
         break;
@@ -333,7 +403,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (f <= 0)
         {
             argp_failure(state, 1, 0, "FTM burst period is not correct");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         args->ftmBurstPeriod = (uint16_t)f;
         break;
@@ -344,7 +414,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (f <= 0)
         {
             argp_failure(state, 1, 0, "FTM burst duration is not correct");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         args->ftmBurstDuration = (uint8_t)f;
         break;
@@ -355,7 +425,7 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (res != ETH_ALEN)
         {
             argp_failure(state, 1, 0, "Bad mac address");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         break;
     }
@@ -366,17 +436,570 @@ error_t Arguments::parse_opt(int key, char *arg, struct argp_state *state)
         if (res != ETH_ALEN)
         {
             argp_failure(state, 1, 0, "FTM target mac address is not correct");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
         }
         break;
     }
+    case OPTION_CIR:
+        args->processors[processor::channelImpulseResponse] = true;
+        break;
+    case OPTION_CIR_OVERSAMPLE:
+    {
+        int f = std::atoi(arg);
+        if (f < 1 || f > 16)
+        {
+            argp_failure(state, 1, 0, "Bad CIR oversample factor. Possible values [1-16]");
+            return EINVAL;
+        }
+        args->cirOversample = (uint32_t)f;
+        break;
+    }
+    case OPTION_NO_RAW:
+        args->rawOutput = false;
+        break;
+    case OPTION_STATS:
+        args->processors[processor::statistics] = true;
+        break;
+    case OPTION_STATS_WINDOW:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Statistics window is not correct number");
+            return EINVAL;
+        }
+        args->statsWindow = (uint32_t)f;
+        break;
+    }
+    case OPTION_STATS_HOP:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Statistics hop is not correct number");
+            return EINVAL;
+        }
+        args->statsHop = (uint32_t)f;
+        break;
+    }
+    case OPTION_STATS_PERCENTILES:
+    {
+        args->statsPercentiles.clear();
+        std::istringstream iss(arg);
+        std::string token;
+        while (std::getline(iss, token, ','))
+        {
+            char *end;
+            double p = std::strtod(token.c_str(), &end);
+            if (token.empty() || *end != '\0' || p < 0 || p > 100)
+            {
+                argp_failure(state, 1, 0, "Bad percentile. Possible values [0-100]");
+                return EINVAL;
+            }
+            args->statsPercentiles.push_back(p);
+        }
+        break;
+    }
+    case OPTION_DOPPLER:
+        args->processors[processor::dopplerSpectrogram] = true;
+        break;
+    case OPTION_DOPPLER_RATE:
+    {
+        double f = std::atof(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Doppler sample rate is not correct number");
+            return EINVAL;
+        }
+        args->dopplerRate = f;
+        break;
+    }
+    case OPTION_DOPPLER_WINDOW:
+    {
+        int f = std::atoi(arg);
+        if (f < 2)
+        {
+            argp_failure(state, 1, 0, "Doppler window is not correct number");
+            return EINVAL;
+        }
+        args->dopplerWindow = (uint32_t)f;
+        break;
+    }
+    case OPTION_DOPPLER_HOP:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Doppler hop is not correct number");
+            return EINVAL;
+        }
+        args->dopplerHop = (uint32_t)f;
+        break;
+    }
+    case OPTION_DOPPLER_GROUP:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Doppler subcarrier group is not correct number");
+            return EINVAL;
+        }
+        args->dopplerGroup = (uint32_t)f;
+        break;
+    }
+    case OPTION_DOPPLER_RATIO:
+        args->dopplerRatio = true;
+        break;
+    case OPTION_PIPELINE:
+        args->pipelineFile = arg;
+        break;
+    case OPTION_RESAMPLE:
+        try
+        {
+            Resampler::parseGrid(arg);
+        }
+        catch (const std::invalid_argument &e)
+        {
+            argp_failure(state, 1, 0, "%s", e.what());
+            return EINVAL;
+        }
+        args->resampleGrid = arg;
+        args->processors[processor::resample] = true;
+        break;
+    case OPTION_RESAMPLE_CUBIC:
+        args->resampleCubic = true;
+        break;
+    case OPTION_CSI_RATIO:
+        if (arg)
+        {
+            try
+            {
+                CsiRatio::parsePairs(arg);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                argp_failure(state, 1, 0, "%s", e.what());
+                return EINVAL;
+            }
+            args->ratioPairs = arg;
+        }
+        args->processors[processor::csiRatio] = true;
+        break;
+    case OPTION_CSI_RATIO_PRODUCT:
+        args->ratioProduct = true;
+        break;
+    case OPTION_CSI_RATIO_FLOAT:
+        args->ratioFloat = true;
+        break;
+    case OPTION_COVARIANCE:
+        args->processors[processor::spatialCovariance] = true;
+        break;
+    case OPTION_COVARIANCE_WINDOW:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Covariance window is not correct number");
+            return EINVAL;
+        }
+        args->covarianceWindow = (uint32_t)f;
+        break;
+    }
+    case OPTION_COVARIANCE_HOP:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Covariance hop is not correct number");
+            return EINVAL;
+        }
+        args->covarianceHop = (uint32_t)f;
+        break;
+    }
+    case OPTION_COVARIANCE_GROUP:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Covariance subcarrier group is not correct number");
+            return EINVAL;
+        }
+        args->covarianceGroup = (uint32_t)f;
+        break;
+    }
+    case OPTION_MUSIC:
+        args->processors[processor::music] = true;
+        break;
+    case OPTION_MUSIC_WINDOW:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "MUSIC window is not correct number");
+            return EINVAL;
+        }
+        args->musicWindow = (uint32_t)f;
+        break;
+    }
+    case OPTION_ANTENNA_SPACING:
+    {
+        double f = std::atof(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Antenna spacing is not correct number");
+            return EINVAL;
+        }
+        args->antennaSpacing = f;
+        break;
+    }
+    case OPTION_INPUT_FILE:
+        args->inputFile = arg;
+        args->rawOutput = false;
+        break;
+    case OPTION_TOF_FUSION:
+        args->processors[processor::tofFusion] = true;
+        break;
+    case OPTION_TOF_ALIGN:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "ToF align window is not correct number");
+            return EINVAL;
+        }
+        args->tofAlign = (uint32_t)f;
+        break;
+    }
+    case OPTION_FTM_FILE:
+        args->ftmFile = arg;
+        break;
+    case OPTION_HAMPEL:
+        args->processors[processor::hampel] = true;
+        break;
+    case OPTION_HAMPEL_WINDOW:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Hampel window is not correct number");
+            return EINVAL;
+        }
+        args->hampelWindow = (uint32_t)f;
+        break;
+    }
+    case OPTION_HAMPEL_THRESHOLD:
+    {
+        double f = std::atof(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Hampel threshold is not correct number");
+            return EINVAL;
+        }
+        args->hampelThreshold = f;
+        break;
+    }
+    case OPTION_MEDIAN_FILTER:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Median filter window is not correct number");
+            return EINVAL;
+        }
+        args->processors[processor::medianFilter] = true;
+        args->medianWindow = (uint32_t)f;
+        break;
+    }
+    case OPTION_PCA:
+        args->processors[processor::pca] = true;
+        break;
+    case OPTION_PCA_COMPONENTS:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "PCA components is not correct number");
+            return EINVAL;
+        }
+        args->pcaComponents = (uint32_t)f;
+        break;
+    }
+    case OPTION_PCA_MEMORY:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "PCA memory is not correct number");
+            return EINVAL;
+        }
+        args->pcaMemory = (uint32_t)f;
+        break;
+    }
+    case OPTION_PCA_BASIS:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "PCA basis period is not correct number");
+            return EINVAL;
+        }
+        args->pcaBasis = (uint32_t)f;
+        break;
+    }
+    case OPTION_EXPORT:
+        args->exportDirectory = arg;
+        args->rawOutput = false;
+        break;
+    case OPTION_EXPORT_INPUTS:
+        args->exportInputs = arg;
+        break;
+    case OPTION_EXPORT_WINDOW:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Export window is not correct number");
+            return EINVAL;
+        }
+        args->exportWindow = (uint32_t)f;
+        break;
+    }
+    case OPTION_EXPORT_HOP:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Export hop is not correct number");
+            return EINVAL;
+        }
+        args->exportHop = (uint32_t)f;
+        break;
+    }
+    case OPTION_EXPORT_SHARD:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Export shard size is not correct number");
+            return EINVAL;
+        }
+        args->exportShard = (uint32_t)f;
+        break;
+    }
+    case OPTION_EXPORT_INT8:
+        args->exportInt8 = true;
+        break;
+    case OPTION_EXPORT_COMPLEX:
+        args->exportComplex = true;
+        break;
+    case OPTION_EXPORT_SEED:
+        args->exportSeed = std::strtoull(arg, nullptr, 10);
+        break;
+    case OPTION_TRIGGER:
+        args->processors[processor::trigger] = true;
+        if (arg)
+        {
+            try
+            {
+                TriggeredCapture::parseDetector(arg);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                argp_failure(state, 1, 0, "%s", e.what());
+                return EINVAL;
+            }
+            args->triggerDetector = arg;
+        }
+        break;
+    case OPTION_TRIGGER_THRESHOLD:
+    {
+        double f = std::atof(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Trigger threshold is not correct number");
+            return EINVAL;
+        }
+        args->triggerThreshold = f;
+        break;
+    }
+    case OPTION_TRIGGER_PRE:
+    {
+        double f = std::atof(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Trigger pre time is not correct number");
+            return EINVAL;
+        }
+        args->triggerPre = f;
+        break;
+    }
+    case OPTION_TRIGGER_HOLD:
+    {
+        double f = std::atof(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Trigger hold time is not correct number");
+            return EINVAL;
+        }
+        args->triggerHold = f;
+        break;
+    }
+    case OPTION_UDP_BATCH:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "UDP batch is not correct number");
+            return EINVAL;
+        }
+        args->udpBatch = (uint32_t)f;
+        break;
+    }
+    case OPTION_UDP_FRAME:
+    {
+        int f = arg ? std::atoi(arg) : STREAM_DEFAULT_MTU;
+        if (f < STREAM_MIN_MTU || f > STREAM_MAX_MTU)
+        {
+            argp_failure(state, 1, 0, "UDP frame MTU is not correct number");
+            return EINVAL;
+        }
+        args->udpFrame = (uint32_t)f;
+        break;
+    }
+    case OPTION_SHM:
+        args->shmName = arg;
+        break;
+    case OPTION_SHM_SIZE:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Shared memory size is not correct number");
+            return EINVAL;
+        }
+        args->shmSize = (uint32_t)f;
+        break;
+    }
+    case OPTION_STREAM:
+        args->streamListen = arg;
+        break;
+    case OPTION_STREAM_BUFFER:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Stream buffer is not correct number");
+            return EINVAL;
+        }
+        args->streamBuffer = (uint32_t)f;
+        break;
+    }
+    case OPTION_STREAM_BACKPRESSURE:
+        try
+        {
+            StreamServer::parseBackpressure(arg);
+        }
+        catch (const std::invalid_argument &e)
+        {
+            argp_failure(state, 1, 0, "%s", e.what());
+            return EINVAL;
+        }
+        args->streamBackpressure = arg;
+        break;
+    case OPTION_MULTICAST:
+        args->multicastGroup = arg;
+        break;
+    case OPTION_MULTICAST_TTL:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0 || f > 255)
+        {
+            argp_failure(state, 1, 0, "Multicast TTL is not correct number 1-255");
+            return EINVAL;
+        }
+        args->multicastTtl = (uint32_t)f;
+        break;
+    }
+    case OPTION_MULTICAST_INTERFACE:
+        args->multicastInterface = arg;
+        break;
+    case OPTION_CLOCK_SYNC:
+        args->clockSync = arg;
+        break;
+    case OPTION_CLOCK_INTERVAL:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Clock interval is not correct number");
+            return EINVAL;
+        }
+        args->clockInterval = (uint32_t)f;
+        break;
+    }
+    case OPTION_AGGREGATOR:
+        args->aggregator = arg;
+        break;
+    case OPTION_AGGREGATE:
+        args->aggregateListen = arg;
+        break;
+    case OPTION_AGGREGATE_OUTPUT:
+        args->aggregateOutput = arg;
+        break;
+    case OPTION_AGGREGATE_JITTER:
+    {
+        int f = std::atoi(arg);
+        if (f < 0 || (f == 0 && arg[0] != '0'))
+        {
+            argp_failure(state, 1, 0, "Aggregate jitter is not correct number");
+            return EINVAL;
+        }
+        args->aggregateJitter = (uint32_t)f;
+        break;
+    }
+    case OPTION_AGGREGATE_THREADS:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Aggregate threads is not correct number");
+            return EINVAL;
+        }
+        args->aggregateThreads = (uint32_t)f;
+        break;
+    }
+    case OPTION_AGGREGATE_SHARD:
+    {
+        int f = std::atoi(arg);
+        if (f <= 0)
+        {
+            argp_failure(state, 1, 0, "Aggregate shard size is not correct number");
+            return EINVAL;
+        }
+        args->aggregateShard = (uint32_t)f;
+        break;
+    }
     case ARGP_KEY_ARG:
     case ARGP_KEY_END:
-        if (args->frequency == 0 ||
-            args->bandwidth.empty())
+        /* The aggregator only receives, it has no interface to tune */
+        if (args->aggregateListen.empty() &&
+            (args->frequency == 0 || args->bandwidth.empty()))
         {
             argp_failure(state, 1, 0, "Fill required arguments -f -b . See --help for more information");
-            exit(ARGP_ERR_UNKNOWN);
+            return EINVAL;
+        }
+        /* Only the UDP socket mode and the aggregator publish to these sinks */
+        if ((!args->udpSocket || args->gui) && args->aggregateListen.empty() &&
+            (!args->shmName.empty() || !args->streamListen.empty() ||
+             !args->multicastGroup.empty()))
+        {
+            argp_failure(state, 1, 0, "--shm, --stream and --multicast need -u or --aggregate-listen");
+            return EINVAL;
+        }
+        if ((!args->udpSocket || args->gui) && !args->aggregator.empty())
+        {
+            argp_failure(state, 1, 0, "--aggregator needs -u");
+            return EINVAL;
         }
         return 0;
     default:
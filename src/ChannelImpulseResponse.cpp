@@ -0,0 +1,136 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ChannelImpulseResponse.h"
+#include <algorithm>
+#include <cmath>
+#include "Fft.h"
+#include "rs.h"
+
+void ChannelImpulseResponse::compute(Csi& csi, uint32_t oversample) {
+    const ToneMap& toneMap = ChannelImpulseResponse::getToneMap(csi);
+    const uint32_t length = toneMap.fftSize * std::max(oversample, 1u);
+    std::shared_ptr<const Fft> plan = Fft::plan(length);
+
+    const uint32_t numChains = csi.numRx * csi.numTx;
+    csi.cirLength = length;
+    csi.cir.assign(numChains * length, 0);
+    csi.powerDelayProfile.resize(numChains * length);
+
+    for (uint32_t chain = 0; chain < numChains; chain++) {
+        const std::complex<double>* in = &csi.csi[chain * csi.numSubCarriers];
+        std::complex<double>* out = &csi.cir[chain * length];
+
+        for (uint32_t n = 0; n < csi.numSubCarriers; n++) {
+            int32_t tone = toneMap.tones[n];
+            out[tone >= 0 ? tone : length + tone] = in[n];
+        }
+
+        plan->inverse(out);
+
+        double* pdp = &csi.powerDelayProfile[chain * length];
+        for (uint32_t i = 0; i < length; i++) {
+            pdp[i] = 10 * log10(std::norm(out[i]) + 1e-12);
+        }
+    }
+}
+
+const ToneMap& ChannelImpulseResponse::getToneMap(const Csi& csi) {
+    return getToneMap(csi.format, csi.numSubCarriers);
+}
+
+const ToneMap& ChannelImpulseResponse::getToneMap(uint32_t format, uint32_t numSubCarriers) {
+    // VHT 160 and HE 40 both report 484 subcarriers with different tone plans
+    format = format == RATE_MCS_HE_MSK ? RATE_MCS_HE_MSK : 0;
+    uint64_t key = ((uint64_t)format << 32) | numSubCarriers;
+
+    std::lock_guard<std::mutex> lock(ChannelImpulseResponse::toneMapsMutex);
+    auto it = ChannelImpulseResponse::toneMaps.find(key);
+    if (it == ChannelImpulseResponse::toneMaps.end()) {
+        it = ChannelImpulseResponse::toneMaps
+                 .emplace(key, buildToneMap(format, numSubCarriers))
+                 .first;
+    }
+    return it->second;
+}
+
+ToneMap ChannelImpulseResponse::buildToneMap(uint32_t format, uint32_t numSubCarriers) {
+    ToneMap map;
+    switch (numSubCarriers) {
+        case 52:  // NOHT 20
+            map.fftSize = 64;
+            addTones(map, 1, 26);
+            break;
+        case 56:  // HT/VHT 20
+            map.fftSize = 64;
+            addTones(map, 1, 28);
+            break;
+        case 114:  // HT/VHT 40
+            map.fftSize = 128;
+            addTones(map, 2, 58);
+            break;
+        case 242:  // VHT 80, HE 20
+            map.fftSize = 256;
+            addTones(map, 2, 122);
+            break;
+        case 484:
+            map.fftSize = 512;
+            if (format == RATE_MCS_HE_MSK) {  // HE 40
+                addTones(map, 3, 244);
+            } else {  // VHT 160, two 80 MHz segments
+                addTones(map, 6, 126);
+                addTones(map, 130, 250);
+            }
+            break;
+        case 996:  // HE 80
+            map.fftSize = 1024;
+            addTones(map, 3, 500);
+            break;
+        case 1992:  // HE 160, two 80 MHz segments
+            map.fftSize = 2048;
+            addTones(map, 12, 509);
+            addTones(map, 515, 1012);
+            break;
+        default: {
+            // Unknown plan, assume contiguous tones around DC
+            map.fftSize = 1;
+            while (map.fftSize < numSubCarriers + 1) {
+                map.fftSize <<= 1;
+            }
+            addTones(map, 1, numSubCarriers - numSubCarriers / 2);
+            if (numSubCarriers % 2) {
+                map.tones.erase(map.tones.begin());
+            }
+            return map;
+        }
+    }
+    return map;
+}
+
+// Adds the tone range [first, last] and its negative mirror, keeping the map sorted
+void ChannelImpulseResponse::addTones(ToneMap& map, int32_t first, int32_t last) {
+    std::vector<int32_t> negative;
+    for (int32_t t = -last; t <= -first; t++) {
+        negative.push_back(t);
+    }
+    map.tones.insert(map.tones.end(), negative.begin(), negative.end());
+    for (int32_t t = first; t <= last; t++) {
+        map.tones.push_back(t);
+    }
+    std::sort(map.tones.begin(), map.tones.end());
+}
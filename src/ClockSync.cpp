@@ -0,0 +1,301 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ClockSync.h"
+
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <ios>
+#include <stdexcept>
+#include "Arguments.h"
+#include "Logger.h"
+
+#define CLOCK_DEFAULT_PORT "8008"
+// Exchanges right after start are this far apart to fill the samples quickly
+#define CLOCK_FAST_INTERVAL_MS 100
+#define CLOCK_TIMEOUT_MS 1000
+
+ClockSync& ClockSync::getInstance() {
+    static ClockSync instance;
+    return instance;
+}
+
+ClockSync::~ClockSync() {
+    this->stop();
+}
+
+void ClockSync::start(const std::string& coordinator, uint32_t intervalMs) {
+    this->stop();
+
+    std::string host = coordinator;
+    std::string port = CLOCK_DEFAULT_PORT;
+    const size_t separator = coordinator.rfind(':');
+    const size_t bracket = coordinator.rfind(']');
+    // A bare IPv6 address has colons but no port
+    if (separator != std::string::npos && (bracket != std::string::npos ? separator > bracket
+                                           : coordinator.find(':') == separator)) {
+        host = coordinator.substr(0, separator);
+        port = coordinator.substr(separator + 1);
+    }
+    if (host.size() > 1 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    struct addrinfo hints = {};
+    struct addrinfo* result;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    int s = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (s != 0) {
+        throw std::invalid_argument("Clock coordinator " + coordinator + ": " + gai_strerror(s));
+    }
+    this->fd = socket(result->ai_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (this->fd < 0 || connect(this->fd, result->ai_addr, result->ai_addrlen) < 0) {
+        const int err = errno;
+        freeaddrinfo(result);
+        if (this->fd >= 0) {
+            ::close(this->fd);
+            this->fd = -1;
+        }
+        throw std::ios_base::failure("Clock coordinator " + coordinator +
+                                     " failed: " + std::strerror(err));
+    }
+    freeaddrinfo(result);
+
+    {
+        // Exchanges with another coordinator tell nothing about this one
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->samples.clear();
+    }
+    this->coordinator = coordinator;
+    this->interval = std::max<uint32_t>(intervalMs, 1);
+    this->running = true;
+    this->worker = std::thread(&ClockSync::run, this);
+    Logger::log(info) << "Synchronizing clock to " << coordinator << "\n";
+}
+
+void ClockSync::stop() {
+    {
+        std::lock_guard<std::mutex> lock(this->wakeMutex);
+        this->running = false;
+    }
+    this->wake.notify_all();
+    if (this->worker.joinable()) {
+        this->worker.join();
+    }
+    if (this->fd >= 0) {
+        ::close(this->fd);
+        this->fd = -1;
+    }
+    this->coordinator.clear();
+}
+
+const std::string& ClockSync::getCoordinator() const {
+    return this->coordinator;
+}
+
+uint32_t ClockSync::getInterval() const {
+    return this->interval;
+}
+
+int64_t ClockSync::localTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t ClockSync::now(uint32_t* uncertainty) {
+    uint64_t u;
+    const int64_t time = this->correct(localTime(), &u);
+    if (uncertainty) {
+        *uncertainty = u ? (uint32_t)std::min<uint64_t>((u + 999) / 1000, UINT32_MAX) : 0;
+    }
+    return time / 1000;
+}
+
+int64_t ClockSync::correct(int64_t local, uint64_t* uncertainty) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    const int64_t offset = this->appliedOffset(local);
+    if (uncertainty) {
+        if (!this->synchronized) {
+            *uncertainty = 0;
+        } else {
+            const int64_t age = std::max<int64_t>(local - this->best.time, 0);
+            *uncertainty = std::max<uint64_t>(
+                1, this->best.delay / 2 + this->best.remoteUncertainty +
+                       age * CLOCK_DRIFT_PPM / 1000000 + std::abs(this->target - offset));
+        }
+    }
+    return local + offset;
+}
+
+ClockSyncStats ClockSync::getStats() {
+    const int64_t local = localTime();
+    uint64_t uncertainty;
+    const int64_t time = this->correct(local, &uncertainty);
+    std::lock_guard<std::mutex> lock(this->mutex);
+    ClockSyncStats stats = this->stats;
+    stats.synchronized = this->synchronized;
+    stats.offset = time - local;
+    stats.target = this->target;
+    stats.delay = this->best.delay;
+    stats.uncertainty = uncertainty;
+    return stats;
+}
+
+int64_t ClockSync::appliedOffset(int64_t local) const {
+    if (!this->synchronized) {
+        return 0;
+    }
+    const int64_t change = this->target - this->base;
+    const int64_t limit = std::max<int64_t>(local - this->baseTime, 0) * CLOCK_SLEW_PPM / 1000000;
+    if (std::abs(change) <= limit) {
+        return this->target;
+    }
+    return this->base + (change > 0 ? limit : -limit);
+}
+
+void ClockSync::run() {
+    uint32_t sequence = 0;
+    uint64_t exchanges = 0;
+    while (this->running) {
+        if (this->exchange(++sequence)) {
+            exchanges++;
+        }
+        const uint32_t wait = exchanges < CLOCK_SAMPLES
+                                  ? std::min<uint32_t>(this->interval, CLOCK_FAST_INTERVAL_MS)
+                                  : this->interval;
+        std::unique_lock<std::mutex> lock(this->wakeMutex);
+        this->wake.wait_for(lock, std::chrono::milliseconds(wait),
+                            [this] { return !this->running; });
+    }
+}
+
+bool ClockSync::exchange(uint32_t sequence) {
+    ClockPacket request = {};
+    request.magic = CLOCK_MAGIC;
+    request.version = CLOCK_VERSION;
+    request.type = CLOCK_REQUEST;
+    request.sequence = sequence;
+    request.t1 = localTime();
+    if (send(this->fd, &request, sizeof(request), 0) != sizeof(request)) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stats.timeouts++;
+        return false;
+    }
+
+    const int64_t deadline =
+        request.t1 + (int64_t)std::min<uint32_t>(this->interval, CLOCK_TIMEOUT_MS) * 1000000;
+    struct pollfd p = {this->fd, POLLIN, 0};
+    int64_t left;
+    while ((left = deadline - localTime()) > 0 && this->running) {
+        if (poll(&p, 1, (int)(left / 1000000) + 1) <= 0) {
+            continue;
+        }
+        ClockPacket response;
+        const ssize_t n = recv(this->fd, &response, sizeof(response), MSG_DONTWAIT);
+        const int64_t t4 = localTime();
+        // Late answers to earlier requests and strangers are skipped
+        if (n != sizeof(response) || response.magic != CLOCK_MAGIC ||
+            response.version != CLOCK_VERSION || response.type != CLOCK_RESPONSE ||
+            response.sequence != sequence || response.t1 != request.t1) {
+            continue;
+        }
+        Sample sample;
+        sample.offset = ((response.t2 - response.t1) + (response.t3 - t4)) / 2;
+        sample.delay = std::max<int64_t>((t4 - response.t1) - (response.t3 - response.t2), 0);
+        sample.time = t4;
+        sample.remoteUncertainty = response.uncertainty;
+        this->addSample(sample);
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats.timeouts++;
+    return false;
+}
+
+void ClockSync::addSample(const Sample& sample) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats.exchanges++;
+    this->samples.push_back(sample);
+    if (this->samples.size() > CLOCK_SAMPLES) {
+        this->samples.pop_front();
+    }
+
+    // Smallest error bound now, a short round trip long ago may be worse than a recent one
+    auto bound = [&sample](const Sample& s) {
+        return s.delay / 2 + (int64_t)s.remoteUncertainty +
+               (sample.time - s.time) * CLOCK_DRIFT_PPM / 1000000;
+    };
+    this->best = *std::min_element(
+        this->samples.begin(), this->samples.end(),
+        [&bound](const Sample& a, const Sample& b) { return bound(a) < bound(b); });
+
+    const int64_t offset = this->appliedOffset(sample.time);
+    this->base = offset;
+    this->baseTime = sample.time;
+    this->target = this->best.offset;
+    if (!this->synchronized || std::abs(this->target - offset) > CLOCK_STEP_NS) {
+        if (this->synchronized) {
+            this->stats.steps++;
+        }
+        this->synchronized = true;
+        this->base = this->target;
+        Logger::log(info) << "Clock offset " << this->target / 1e6 << " ms, error bound "
+                          << bound(this->best) / 1e3 << " us\n";
+    } else if (Arguments::snapshot()->verbose) {
+        Logger::log(info) << "Clock offset " << this->target / 1e6 << " ms, round trip "
+                          << sample.delay / 1e3 << " us, error bound "
+                          << bound(this->best) / 1e3 << " us\n";
+    }
+}
+
+bool ClockSync::answer(int fd,
+                       const char* buf,
+                       size_t size,
+                       int64_t received,
+                       const struct sockaddr* from,
+                       socklen_t fromLen) {
+    ClockPacket packet;
+    if (size != sizeof(packet)) {
+        return false;
+    }
+    memcpy(&packet, buf, sizeof(packet));
+    if (packet.magic != CLOCK_MAGIC || packet.type != CLOCK_REQUEST) {
+        return false;
+    }
+    // Other versions are not answered, the node times out instead of misreading
+    if (packet.version != CLOCK_VERSION) {
+        return true;
+    }
+
+    ClockSync& clock = getInstance();
+    uint64_t uncertainty;
+    packet.type = CLOCK_RESPONSE;
+    packet.t2 = clock.correct(received, &uncertainty);
+    packet.uncertainty = (uint32_t)std::min<uint64_t>(uncertainty, UINT32_MAX);
+    packet.t3 = clock.correct(localTime());
+    sendto(fd, &packet, sizeof(packet), MSG_DONTWAIT, from, fromLen);
+    return true;
+}
@@ -0,0 +1,169 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ControlHandler.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <utility>
+#include "Arguments.h"
+#include "Logger.h"
+#include "MainController.h"
+
+bool ControlHandler::handle(const char* buf,
+                            size_t size,
+                            UdpSocket* udpSocket,
+                            std::vector<char>& reply,
+                            bool& started) {
+    ControlHeader header;
+    started = false;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, buf, sizeof(header));
+    if (header.magic != CONTROL_MAGIC || (header.command & CONTROL_REPLY)) {
+        return false;
+    }
+
+    if (header.version != CONTROL_VERSION) {
+        buildReply(header, CONTROL_BAD_VERSION, udpSocket, reply);
+        return true;
+    }
+    if (header.payloadSize != size - sizeof(header)) {
+        buildReply(header, CONTROL_BAD_PAYLOAD, udpSocket, reply);
+        return true;
+    }
+
+    // Lost reply, the request is answered again instead of applied twice
+    const bool changes = header.command == CONTROL_START || header.command == CONTROL_STOP ||
+                         header.command == CONTROL_RECONFIGURE;
+    if (changes && header.correlationId == lastCorrelationId && !lastReply.empty()) {
+        reply = lastReply;
+        return true;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const controlResult result = apply(header, buf + sizeof(header));
+    if (changes) {
+        applyMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+        if (Arguments::snapshot()->verbose) {
+            Logger::log(info) << "Control command " << header.command << " applied in "
+                              << applyMicroseconds << " us\n";
+        }
+    }
+
+    buildReply(header, result, udpSocket, reply);
+    if (changes) {
+        lastCorrelationId = header.correlationId;
+        lastReply = reply;
+    }
+    started = header.command == CONTROL_START && result == CONTROL_OK;
+    return true;
+}
+
+controlResult ControlHandler::apply(const ControlHeader& header, const char* payload) {
+    MainController* mainController = MainController::getInstance();
+    switch (header.command) {
+        case CONTROL_START:
+        case CONTROL_RECONFIGURE: {
+            std::vector<std::pair<int, std::string>> values;
+            size_t offset = 0;
+            while (offset < header.payloadSize) {
+                ControlOption option;
+                if (header.payloadSize - offset < sizeof(option)) {
+                    return CONTROL_BAD_PAYLOAD;
+                }
+                memcpy(&option, payload + offset, sizeof(option));
+                offset += sizeof(option);
+                if (header.payloadSize - offset < option.size) {
+                    return CONTROL_BAD_PAYLOAD;
+                }
+                values.emplace_back((int)option.key, std::string(payload + offset, option.size));
+                offset += option.size;
+            }
+
+            // Parsed into a copy, nothing changes when an option is not correct.
+            // Capture threads keep reading their snapshot until it is replaced
+            const std::shared_ptr<const Args> previous = Arguments::snapshot();
+            Args next = *previous;
+            if (!Arguments::parse(values, next)) {
+                return CONTROL_BAD_OPTIONS;
+            }
+            Arguments::publish(next);
+            if (header.command == CONTROL_START && !mainController->isCapturing()) {
+                mainController->startCapture();
+            } else {
+                mainController->reconfigure(*previous);
+            }
+            return CONTROL_OK;
+        }
+        case CONTROL_STOP:
+            mainController->stopCapture();
+            return CONTROL_OK;
+        case CONTROL_STATUS:
+        case CONTROL_STATS:
+            return CONTROL_OK;
+    }
+    return CONTROL_BAD_COMMAND;
+}
+
+void ControlHandler::buildReply(const ControlHeader& request,
+                                controlResult result,
+                                UdpSocket* udpSocket,
+                                std::vector<char>& reply) {
+    ControlHeader header = request;
+    header.version = CONTROL_VERSION;
+    header.command = request.command | CONTROL_REPLY;
+    header.result = result;
+    header.reserved = 0;
+    header.payloadSize = 0;
+
+    std::vector<char> payload;
+    if (result == CONTROL_OK && request.command == CONTROL_STATS) {
+        const UdpStats udpStats = udpSocket->getStats();
+        ControlStatsData stats = {};
+        stats.sent = udpStats.sent;
+        stats.dropped = udpStats.dropped;
+        stats.batches = udpStats.batches;
+        stats.bytes = udpStats.bytes;
+        stats.retransmitted = udpStats.retransmitted;
+        payload.assign((char*)&stats, (char*)&stats + sizeof(stats));
+    } else if (result == CONTROL_OK) {
+        const MainController* mainController = MainController::getInstance();
+        const std::shared_ptr<const Args> snapshot = Arguments::snapshot();
+        const Args& args = *snapshot;
+        ControlStatusData status = {};
+        status.capturing = mainController->isCapturing();
+        status.interfaceReady = mainController->isInterfaceReady();
+        status.measure = args.measure;
+        status.inject = args.inject;
+        status.ftm = args.ftm;
+        status.ftmResponder = args.ftmResponder;
+        status.frequency = args.frequency;
+        strncpy(status.bandwidth, args.bandwidth.c_str(), sizeof(status.bandwidth) - 1);
+        status.applyMicroseconds = applyMicroseconds;
+        payload.assign((char*)&status, (char*)&status + sizeof(status));
+    }
+
+    header.payloadSize = payload.size();
+    reply.assign((char*)&header, (char*)&header + sizeof(header));
+    reply.insert(reply.end(), payload.begin(), payload.end());
+}
@@ -23,6 +23,7 @@
 #include <string>
 #include <vector>
 #include "Arguments.h"
+#include "ClockSync.h"
 #include "Logger.h"
 #include "rs.h"
 
@@ -30,7 +31,7 @@ Csi::Csi() {}
 
 Csi::~Csi() {
     if (this->rawCsiData) {
-        delete rawCsiData;
+        delete[] rawCsiData;
     }
 }
 
@@ -50,9 +51,7 @@ void Csi::loadFromMemory(uint8_t* pHeader, uint8_t* pRawCsiData) {
     memcpy(&this->rawHeaderData, pHeader, CSI_HEADER_LENGTH);
     this->rawCsiData = new uint8_t[this->rawHeaderData.csiDataSize];
     memcpy(this->rawCsiData, pRawCsiData, this->rawHeaderData.csiDataSize);
-    this->rawHeaderData.timestamp = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
-                                        std::chrono::system_clock::now().time_since_epoch())
-                                        .count();
+    this->rawHeaderData.timestamp = ClockSync::getInstance().now(&this->clockUncertainty);
 
     this->processRawCsi();
 }
@@ -65,97 +64,92 @@ void Csi::loadFromMemory(uint8_t* rawData) {
 }
 
 void Csi::save() {
+    save(this->rawHeaderData, this->rawCsiData);
+}
+
+void Csi::save(const RawHeaderData& header, const uint8_t* rawCsiData) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     std::ofstream outfile;
-    outfile.open(Arguments::arguments.outputFile, std::ios_base::app | std::ios::binary);
+    outfile.open(args->outputFile, std::ios_base::app | std::ios::binary);
     if (outfile.fail()) {
         throw std::ios_base::failure("Open file failed: " + std::string(std::strerror(errno)));
     }
-    outfile.write(reinterpret_cast<char*>(&this->rawHeaderData), sizeof(RawHeaderData));
-    outfile.write(reinterpret_cast<char*>(this->rawCsiData), this->rawHeaderData.csiDataSize);
+    outfile.write(reinterpret_cast<const char*>(&header), sizeof(RawHeaderData));
+    outfile.write(reinterpret_cast<const char*>(rawCsiData), header.csiDataSize);
     outfile.close();
     std::filesystem::permissions(
-        Arguments::arguments.outputFile,
+        args->outputFile,
         std::filesystem::perms::all &
             ~(std::filesystem::perms::owner_exec | std::filesystem::perms::group_exec |
               std::filesystem::perms::others_exec),
         std::filesystem::perm_options::add);
 
-    std::cout.write(reinterpret_cast<const char*>(&this->rawHeaderData), sizeof(RawHeaderData));
-    std::cout.write(reinterpret_cast<const char*>(this->rawCsiData),
-                    this->rawHeaderData.csiDataSize);
+    std::cout.write(reinterpret_cast<const char*>(&header), sizeof(RawHeaderData));
+    std::cout.write(reinterpret_cast<const char*>(rawCsiData), header.csiDataSize);
     std::cout.flush();
 }
 
 void Csi::sendUDP(UdpSocket* udpSocket) {
-    int size = CSI_HEADER_LENGTH + this->rawHeaderData.csiDataSize;
-    char data[size];
-    memcpy(data, &this->rawHeaderData, CSI_HEADER_LENGTH);
-    memcpy(&data[CSI_HEADER_LENGTH], this->rawCsiData, this->rawHeaderData.csiDataSize);
-    udpSocket->send(data, size);
+    sendUDP(udpSocket, this->rawHeaderData, this->rawCsiData, this->clockUncertainty);
 }
 
+void Csi::sendUDP(UdpSocket* udpSocket,
+                  const RawHeaderData& header,
+                  const uint8_t* rawCsiData,
+                  uint32_t clockUncertainty) {
+    struct iovec iov[2] = {
+        {const_cast<RawHeaderData*>(&header), CSI_HEADER_LENGTH},
+        {const_cast<uint8_t*>(rawCsiData), header.csiDataSize},
+    };
+    udpSocket->send(iov, 2,
+                    {STREAM_FORMAT_CSI, 0, header.srcMac, header.timestamp, clockUncertainty});
+}
+
+/**
+ * Firmware reports bogus subcarriers between the two 80 MHz segments of
+ * 160 MHz VHT and HE CSI. They are removed in place, every rx/tx chain is
+ * moved down by the gaps in front of it with at most two memmove calls,
+ * one for the subcarriers before the gap and one for those after it.
+ * tools/csi_fix_check compares the result with the previous copy loop.
+ */
 void Csi::fixCsiBug() {
     if (this->channelWidth != RATE_MCS_CHAN_WIDTH_160) {
         return;
     }
 
-    if (this->format != RATE_MCS_VHT_MSK && this->format != RATE_MCS_HE_MSK) {
-        return;
+    const CsiGap* gap = nullptr;
+    for (const CsiGap& g : CSI_160_GAPS) {
+        if (g.format == this->format) {
+            gap = &g;
+        }
     }
 
-    uint16_t newSubcarrierSize = 0;
-    if (this->format == RATE_MCS_VHT_MSK && this->rawHeaderData.numSubCarriers == 484) {
+    if (!gap || this->numSubCarriers != gap->numSubCarriers + gap->count) {
         return;
-    } else if (this->format == RATE_MCS_VHT_MSK) {
-        newSubcarrierSize = 484;
     }
 
-    if (this->format == RATE_MCS_HE_MSK && this->rawHeaderData.numSubCarriers == 1992) {
-        return;
-    } else if (this->format == RATE_MCS_HE_MSK) {
-        newSubcarrierSize = 1992;
-    }
+    const uint32_t oldChainSize = this->numSubCarriers * 4;
+    const uint32_t newChainSize = gap->numSubCarriers * 4;
+    const uint32_t headSize = gap->start * 4;
+    const uint32_t tailSize = newChainSize - headSize;
+    const uint32_t numChains = this->numRx * this->numTx;
 
-    for (uint32_t i = 0; i < this->rawHeaderData.csiDataSize; i = i + 4) {
-        if (format == RATE_MCS_VHT_MSK) {
-            if (i > (241 * 4) && i < (256 * 4))  // Fix the firmware bug
-                continue;
-        }
+    if (numChains * oldChainSize > this->rawHeaderData.csiDataSize) {
+        return;
     }
 
-    uint32_t newTotalSize = newSubcarrierSize * 4 * this->numRx * this->numTx;
-    uint8_t fixedCsiData[newTotalSize];
-
-    uint32_t newIndex = 0;
-    uint32_t oldIndex = 0;
-    for (uint32_t rx = 0; rx < this->numRx; rx++) {
-        for (uint32_t tx = 0; tx < this->numTx; tx++) {
-            for (uint32_t n = 0; n < this->numSubCarriers; n++) {
-                if (this->format == RATE_MCS_VHT_MSK) {
-                    if (n > 241 && n < 256) {
-                        oldIndex += 4;
-                        continue;
-                    }
-                }
-                if (this->format == RATE_MCS_HE_MSK) {
-                    if (n > 995 && n < 1024) {
-                        oldIndex += 4;
-                        continue;
-                    }
-                }
-                memcpy(&fixedCsiData[newIndex], &this->rawCsiData[oldIndex], 4);
-                oldIndex += 4;
-                newIndex += 4;
-            }
+    for (uint32_t chain = 0; chain < numChains; chain++) {
+        uint8_t* src = &this->rawCsiData[chain * oldChainSize];
+        uint8_t* dst = &this->rawCsiData[chain * newChainSize];
+        if (chain) {
+            memmove(dst, src, headSize);
         }
+        memmove(dst + headSize, src + headSize + gap->count * 4, tailSize);
     }
 
-    this->numSubCarriers = newSubcarrierSize;
+    this->numSubCarriers = gap->numSubCarriers;
     this->rawHeaderData.numSubCarriers = this->numSubCarriers;
-    this->rawHeaderData.csiDataSize = newTotalSize;
-    delete this->rawCsiData;
-    this->rawCsiData = new uint8_t[newTotalSize];
-    memcpy(this->rawCsiData, fixedCsiData, newTotalSize);
+    this->rawHeaderData.csiDataSize = numChains * newChainSize;
 }
 
 void Csi::processRawCsi() {
@@ -183,17 +177,91 @@ void Csi::processRawCsi() {
         this->magnitude.push_back(std::abs(c));
         this->phase.push_back(std::arg(c));
     }
+    this->rawNumSubCarriers = this->numSubCarriers;
+    this->rawNumValues = this->rawHeaderData.csiDataSize / 4;
+}
+
+const uint8_t* Csi::getRawCsiData() const {
+    return this->rawCsiData;
+}
+
+/**
+ * Decoded from the raw values again instead of taken from the working
+ * values, which stages run on the record before may have changed already.
+ * Records not loaded from raw data start from their working values.
+ */
+const std::shared_ptr<const CsiLayer>& Csi::baseLayer() {
+    if (!this->base && !this->rawCsiData) {
+        this->base = this->snapshot(true, true);
+    }
+    if (!this->base) {
+        auto csi = std::make_shared<std::vector<std::complex<double>>>();
+        csi->reserve(this->rawNumValues);
+        for (uint32_t i = 0; i < this->rawNumValues; i++) {
+            const uint8_t* value = &this->rawCsiData[i * 4];
+            csi->emplace_back((int16_t)(value[0] | value[1] << 8),
+                              (int16_t)(value[2] | value[3] << 8));
+        }
+        auto layer = std::make_shared<CsiLayer>();
+        layer->csi = std::move(csi);
+        layer->numSubCarriers = this->rawNumSubCarriers;
+        layer->polarValid = false;
+        this->base = std::move(layer);
+    }
+    return this->base;
+}
+
+std::shared_ptr<const CsiLayer> Csi::cachedLayer(uint64_t key) {
+    auto it = this->layers.find(key);
+    return it == this->layers.end() ? nullptr : it->second;
+}
+
+void Csi::cacheLayer(uint64_t key, std::shared_ptr<const CsiLayer> layer) {
+    if (this->layers.count(key)) {
+        return;
+    }
+    if (this->layerOrder.size() >= CSI_LAYER_CACHE_SIZE) {
+        this->layers.erase(this->layerOrder.front());
+        this->layerOrder.pop_front();
+    }
+    this->layers.emplace(key, std::move(layer));
+    this->layerOrder.push_back(key);
 }
 
-void Csi::backup() {
-    if (this->csiBackup.empty()) {
-        this->csiBackup = this->csi;
+// Only valid representations are copied, stale ones are computed again when needed
+std::shared_ptr<const CsiLayer> Csi::snapshot(bool polarValid, bool complexValid) {
+    auto layer = std::make_shared<CsiLayer>();
+    if (complexValid) {
+        layer->csi = std::make_shared<const std::vector<std::complex<double>>>(this->csi);
     }
+    if (polarValid) {
+        layer->magnitude = std::make_shared<const std::vector<double>>(this->magnitude);
+        layer->phase = std::make_shared<const std::vector<double>>(this->phase);
+    }
+    layer->numSubCarriers = this->numSubCarriers;
+    layer->polarValid = polarValid;
+    layer->complexValid = complexValid;
+    return layer;
 }
 
-void Csi::restore() {
-    this->csi = this->csiBackup;
-    this->recalcMagnitudePhase();
+/**
+ * Working values are the only copy, the layer itself is never modified. The
+ * representation the layer does not hold is converted before it is read,
+ * only its size is set.
+ */
+void Csi::view(const CsiLayer& layer) {
+    if (layer.complexValid) {
+        this->csi = *layer.csi;
+    }
+    if (layer.polarValid) {
+        this->magnitude = *layer.magnitude;
+        this->phase = *layer.phase;
+    }
+    const size_t size = layer.complexValid ? layer.csi->size() : layer.magnitude->size();
+    this->csi.resize(size);
+    this->magnitude.resize(size);
+    this->phase.resize(size);
+    this->numSubCarriers = layer.numSubCarriers;
 }
 
 void Csi::magnitudePhaseToComplex() {
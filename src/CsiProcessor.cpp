@@ -19,7 +19,6 @@
 #include "CsiProcessor.h"
 #include "main.h"
 #include "Logger.h"
-#include "interpolation.h"
 #include "Arguments.h"
 
 #include <fstream>
@@ -30,7 +29,7 @@
 bool CsiProcessor::loadCsi()
 {
     this->clearState();
-    std::ifstream ifs(Arguments::arguments.inputFile, std::ios::binary);
+    std::ifstream ifs(Arguments::snapshot()->inputFile, std::ios::binary);
 
     ifs.seekg (0, ifs.end);
     int length = ifs.tellg();
@@ -59,8 +58,9 @@ bool CsiProcessor::loadCsi()
 
 void CsiProcessor::saveCsi()
 {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     std::ofstream outfile;
-    outfile.open(Arguments::arguments.outputFile, std::ios_base::app | std::ios::binary);
+    outfile.open(args->outputFile, std::ios_base::app | std::ios::binary);
     if (outfile.fail())
     {
         throw std::ios_base::failure("Open file failed: " + std::string(std::strerror(errno)));
@@ -74,7 +74,7 @@ void CsiProcessor::saveCsi()
         outfile.write(reinterpret_cast<char *>(c->csi.data()), c->rawHeaderData.csiDataSize);
     }
     outfile.close();
-    std::filesystem::permissions(Arguments::arguments.outputFile, std::filesystem::perms::all & ~(std::filesystem::perms::owner_exec | std::filesystem::perms::group_exec | std::filesystem::perms::others_exec), std::filesystem::perm_options::add);
+    std::filesystem::permissions(args->outputFile, std::filesystem::perms::all & ~(std::filesystem::perms::owner_exec | std::filesystem::perms::group_exec | std::filesystem::perms::others_exec), std::filesystem::perm_options::add);
 }
 
 CsiProcessor::~CsiProcessor()
@@ -92,114 +92,34 @@ void CsiProcessor::clearState()
     for (Csi *c : this->csiData) {
         delete c;
     }
-}
-
-void CsiProcessor::interpolate(Csi &csi, processor type)
-{
-    const std::vector<uint32_t> pilotIndices = csi.getPilotIndices();
-    uint32_t offset = 0;
-    for (uint32_t rx = 0; rx < csi.numRx; rx++)
-    {
-        for (uint32_t tx = 0; tx < csi.numTx; tx++)
-        {
-            for (uint32_t pilotIndice : pilotIndices) {
-                uint32_t index = pilotIndice + offset;
-                if (type == processor::interpolateLinear)
-                {
-                    csi.magnitude[index] = interpolation::linearInterpolate(csi.magnitude[index - 1], csi.magnitude[index + 1], 0.5);
-                    csi.phase[index] = interpolation::linearInterpolate(csi.phase[index - 1], csi.phase[index + 1], 0.5);
-                }
-                else if(type == processor::interpolateCubic)
-                {
-                    csi.magnitude[index] = interpolation::cubicInterpolate(csi.magnitude[index - 2], csi.magnitude[index - 1], csi.magnitude[index + 1], csi.magnitude[index + 2], 0.5);
-                    csi.phase[index] = interpolation::cubicInterpolate(csi.phase[index - 2], csi.phase[index - 1], csi.phase[index + 1], csi.phase[index + 2], 0.5);
-                }
-                else if(type == processor::interpolateCosine)
-                {
-                    csi.magnitude[index] = interpolation::cosineInterpolate(csi.magnitude[index - 1], csi.magnitude[index + 1], 0.5);
-                    csi.phase[index] = interpolation::cosineInterpolate(csi.phase[index - 1], csi.phase[index + 1], 0.5);
-                }
-            }
-            offset += csi.numSubCarriers;
-        }
-    }
-
-    csi.magnitudePhaseToComplex();
+    this->csiData.clear();
 }
 
 void CsiProcessor::process(Csi &csi)
 {
-    csi.backup();
-    csi.restore();
-
-    if (Arguments::arguments.processors[processor::interpolateLinear])
-    {
-        this->interpolate(csi, processor::interpolateLinear);
-    } 
-    else if (Arguments::arguments.processors[processor::interpolateCubic])
-    {
-        this->interpolate(csi, processor::interpolateCubic);
-    }
-    else if (Arguments::arguments.processors[processor::interpolateCosine])
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
+    // Stages keep state between records, the graph is created again only when
+    // processors are toggled from GUI or other arguments change between calls
+    if (!this->graph || !(this->graphArguments == *args))
     {
-        this->interpolate(csi, processor::interpolateCosine);
+        this->graph = ProcessingGraph::create();
+        this->graphArguments = *args;
     }
-
-    if (Arguments::arguments.processors[processor::phaseCalibrationLinearTransform])
-    {
-        this->phaseCalibLinearTransform(csi);
-    } 
+    this->graph->transform(csi);
 }
 
-//WiFi-Based Real-Time Calibration-Free Passive Human Motion Detection
-void CsiProcessor::phaseCalibLinearTransform(Csi &csi)
+// Runs all stages over the loaded records as in live capture
+void CsiProcessor::run()
 {
-    /* double a = (csi.phase.back() - csi.phase[0]) / (csi.phase.size());
-    double b = std::reduce(csi.phase.begin(), csi.phase.end()) / csi.phase.size();
-    
-    for (uint32_t i = 0; i < csi.phase.size(); i++) {
-        csi.phase[i] = csi.phase[i] - (a*(i + 1) + b);
-    } */
-
-    uint32_t offset = 0;
-    //double sk[] = {-26, -25, -24, -23, -22, -21, -20, -19, -18, -17, -16, -15, -14, -13, -12, -11, -10, -9, -8, -7, -6, -5, -4, -3, -2, -1, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26};
-
-    std::vector<int> sk;
-    for (int i = (csi.numSubCarriers / 2); i >= 0 ; i--)
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
+    this->graph = ProcessingGraph::create();
+    this->graphArguments = *args;
+    for (Csi *c : this->csiData)
     {
-        sk.push_back(-i);
+        this->graph->run(*c, nullptr);
     }
-    for (uint32_t i = 1; i <= (csi.numSubCarriers / 2) ; i++)
-    {
-        sk.push_back(i);
-    }
-    
-    
-    csi.unwrapPhase();
-
-    for (uint32_t rx = 0; rx < csi.numRx; rx++)
+    if (args->verbose)
     {
-        for (uint32_t tx = 0; tx < csi.numTx; tx++)
-        {
-            uint32_t firstIndex = offset;
-            uint32_t lastIndex = offset + (csi.numSubCarriers - 1);
-            
-            double sum = 0;
-            for (uint32_t i = firstIndex; i <= lastIndex; i++) {
-                sum += csi.phase[i];
-            }
-
-            double a = (csi.phase[lastIndex] - csi.phase[firstIndex]) / (sk.back() - sk[0]);
-            double b = sum / csi.numSubCarriers;
-
-            uint32_t k = 0;
-            for (uint32_t i = firstIndex; i <= lastIndex; i++) {
-                csi.phase[i] = csi.phase[i] - a*sk[k]  - b;
-                k++;
-            }
-
-            offset += csi.numSubCarriers;
-        }
+        this->graph->logTimings();
     }
-    csi.magnitudePhaseToComplex();
-}
\ No newline at end of file
+}
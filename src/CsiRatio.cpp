@@ -0,0 +1,106 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CsiRatio.h"
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+void CsiRatio::configure(const std::vector<AntennaPair>& pairs, bool product, bool half) {
+    this->pairs = pairs;
+    this->product = product;
+    this->half = half;
+}
+
+std::unique_ptr<DerivedRecord> CsiRatio::compute(const Csi& csi) {
+    const uint8_t* raw = csi.getRawCsiData();
+    const RawHeaderData& h = csi.rawHeaderData;
+    const uint32_t numSubCarriers = h.numSubCarriers;
+    if (!raw || h.csiDataSize < (uint32_t)h.numRx * h.numTx * numSubCarriers * 4) {
+        return nullptr;
+    }
+
+    this->values.clear();
+    uint32_t numPairs = 0;
+    for (const AntennaPair& pair : this->pairs) {
+        if (pair.rx >= h.numRx || pair.reference >= h.numRx) {
+            continue;
+        }
+        numPairs++;
+
+        for (uint32_t tx = 0; tx < h.numTx; tx++) {
+            const uint8_t* a = raw + (pair.rx * h.numTx + tx) * numSubCarriers * 4;
+            const uint8_t* b = raw + (pair.reference * h.numTx + tx) * numSubCarriers * 4;
+            const size_t offset = this->values.size();
+            this->values.resize(offset + numSubCarriers);
+            std::complex<float>* out = &this->values[offset];
+
+            for (uint32_t n = 0; n < numSubCarriers; n++) {
+                int16_t va[2];
+                int16_t vb[2];
+                memcpy(va, a + n * 4, sizeof(va));
+                memcpy(vb, b + n * 4, sizeof(vb));
+                const float ar = va[0], ai = va[1];
+                const float br = vb[0], bi = vb[1];
+
+                // a * conj(b)
+                float re = ar * br + ai * bi;
+                float im = ai * br - ar * bi;
+                if (!this->product) {
+                    const float power = br * br + bi * bi;
+                    const float scale = power > 0 ? 1 / power : 0;
+                    re *= scale;
+                    im *= scale;
+                }
+                out[n] = {re, im};
+            }
+        }
+    }
+
+    if (!numPairs) {
+        return nullptr;
+    }
+
+    std::unique_ptr<DerivedRecord> record = std::make_unique<DerivedRecord>(DERIVED_RATIO, csi);
+    record->header.numRx = numPairs;
+    record->header.numTx = h.numTx;
+    record->header.numSubCarriers = numSubCarriers;
+    record->setValues(this->values, numSubCarriers, this->half);
+    return record;
+}
+
+// Comma separated RX:REFERENCE chain pairs, e.g. 0:1,0:2
+std::vector<AntennaPair> CsiRatio::parsePairs(const std::string& pairs) {
+    std::vector<AntennaPair> result;
+    std::istringstream iss(pairs);
+    std::string token;
+    while (std::getline(iss, token, ',')) {
+        std::istringstream pair(token);
+        int rx, reference;
+        char c;
+        if (!(pair >> rx >> c >> reference) || c != ':' || !pair.eof() || rx < 0 ||
+            reference < 0 || rx == reference) {
+            throw std::invalid_argument("Bad antenna pair " + token + ", expected RX:REFERENCE");
+        }
+        result.push_back({(uint32_t)rx, (uint32_t)reference});
+    }
+    if (result.empty()) {
+        throw std::invalid_argument("No antenna pair given");
+    }
+    return result;
+}
@@ -0,0 +1,179 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CsiStatistics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void CsiStatistics::configure(uint32_t windowSize,
+                              uint32_t hop,
+                              const std::vector<double>& percentiles) {
+    this->windowSize = std::max(windowSize, 1u);
+    this->hop = hop ? std::min(hop, this->windowSize) : this->windowSize;
+    this->percentiles = percentiles;
+    this->windows.clear();
+}
+
+uint32_t CsiStatistics::valuesPerMetric() const {
+    return 4 + this->percentiles.size();
+}
+
+std::unique_ptr<DerivedRecord> CsiStatistics::update(const Csi& csi) {
+    uint64_t key = 0;
+    memcpy(&key, csi.rawHeaderData.srcMac, sizeof(csi.rawHeaderData.srcMac));
+    StatisticsWindow& w = this->windows[key];
+
+    if (w.numRx != csi.numRx || w.numTx != csi.numTx || w.numSubCarriers != csi.numSubCarriers) {
+        this->reset(w, csi);
+    }
+
+    const uint32_t half = w.numValues / 2;
+    double* slot = &w.ring[(size_t)w.head * w.numValues];
+    const bool full = w.count == this->windowSize;
+
+    for (uint32_t i = 0; i < half; i++) {
+        const double x = csi.magnitude[i];
+        if (full) {
+            // Remove the oldest value, it is overwritten by the new one
+            const double old = slot[i];
+            const double mean = w.mean[i] + (x - old) / w.count;
+            w.m2[i] += (x - old) * (x - mean + old - w.mean[i]);
+            w.mean[i] = mean;
+        } else {
+            const double delta = x - w.mean[i];
+            w.mean[i] += delta / (w.count + 1);
+            w.m2[i] += delta * (x - w.mean[i]);
+        }
+        slot[i] = x;
+    }
+    for (uint32_t i = 0; i < half; i++) {
+        const double x = csi.phase[i];
+        if (full) {
+            w.sinSum[i] -= std::sin(slot[half + i]);
+            w.cosSum[i] -= std::cos(slot[half + i]);
+        }
+        w.sinSum[i] += std::sin(x);
+        w.cosSum[i] += std::cos(x);
+        slot[half + i] = x;
+    }
+
+    if (!full) {
+        w.count++;
+    }
+    w.head = (w.head + 1) % this->windowSize;
+    w.sinceSnapshot++;
+    if (full && w.head == 0) {
+        this->recompute(w);
+    }
+
+    if (w.count < this->windowSize || w.sinceSnapshot < this->hop) {
+        return nullptr;
+    }
+
+    w.sinceSnapshot = 0;
+    std::unique_ptr<DerivedRecord> record = this->snapshot(w, csi);
+
+    if (this->hop == this->windowSize) {
+        this->reset(w, csi);
+    }
+    return record;
+}
+
+void CsiStatistics::reset(StatisticsWindow& w, const Csi& csi) {
+    w.numRx = csi.numRx;
+    w.numTx = csi.numTx;
+    w.numSubCarriers = csi.numSubCarriers;
+    w.numValues = 2 * csi.numRx * csi.numTx * csi.numSubCarriers;
+    w.count = 0;
+    w.head = 0;
+    w.sinceSnapshot = 0;
+    w.ring.assign((size_t)this->windowSize * w.numValues, 0);
+    w.mean.assign(w.numValues / 2, 0);
+    w.m2.assign(w.numValues / 2, 0);
+    w.sinSum.assign(w.numValues / 2, 0);
+    w.cosSum.assign(w.numValues / 2, 0);
+}
+
+void CsiStatistics::recompute(StatisticsWindow& w) {
+    const uint32_t half = w.numValues / 2;
+    std::fill(w.mean.begin(), w.mean.end(), 0);
+    std::fill(w.m2.begin(), w.m2.end(), 0);
+    std::fill(w.sinSum.begin(), w.sinSum.end(), 0);
+    std::fill(w.cosSum.begin(), w.cosSum.end(), 0);
+
+    for (uint32_t n = 0; n < w.count; n++) {
+        const double* record = &w.ring[(size_t)n * w.numValues];
+        for (uint32_t i = 0; i < half; i++) {
+            w.mean[i] += record[i];
+            w.sinSum[i] += std::sin(record[half + i]);
+            w.cosSum[i] += std::cos(record[half + i]);
+        }
+    }
+    for (uint32_t i = 0; i < half; i++) {
+        w.mean[i] /= w.count;
+    }
+    for (uint32_t n = 0; n < w.count; n++) {
+        const double* record = &w.ring[(size_t)n * w.numValues];
+        for (uint32_t i = 0; i < half; i++) {
+            const double d = record[i] - w.mean[i];
+            w.m2[i] += d * d;
+        }
+    }
+}
+
+std::unique_ptr<DerivedRecord> CsiStatistics::snapshot(StatisticsWindow& w, const Csi& csi) {
+    const uint32_t perMetric = this->valuesPerMetric();
+    const uint32_t numChains = w.numRx * w.numTx;
+    const uint32_t half = w.numValues / 2;
+    std::vector<double> values(numChains * w.numSubCarriers * 2 * perMetric);
+    std::vector<double> window(w.count);
+
+    for (uint32_t i = 0; i < w.numValues; i++) {
+        for (uint32_t n = 0; n < w.count; n++) {
+            window[n] = w.ring[(size_t)n * w.numValues + i];
+        }
+
+        // i indexes [metric][chain][subcarrier], output is [chain][subcarrier][metric]
+        const uint32_t metric = i < half ? 0 : 1;
+        const uint32_t chainValue = i % half;
+        double* out = &values[(chainValue * 2 + metric) * perMetric];
+
+        if (metric == 0) {
+            out[0] = w.mean[i];
+            out[1] = w.count > 1 ? std::max(w.m2[i], 0.0) / (w.count - 1) : 0;
+        } else {
+            out[0] = std::atan2(w.sinSum[chainValue], w.cosSum[chainValue]);
+            const double r = std::hypot(w.sinSum[chainValue], w.cosSum[chainValue]) / w.count;
+            out[1] = std::max(1 - r, 0.0);
+        }
+        auto [min, max] = std::minmax_element(window.begin(), window.end());
+        out[2] = *min;
+        out[3] = *max;
+        for (size_t p = 0; p < this->percentiles.size(); p++) {
+            size_t rank = std::lround(this->percentiles[p] / 100 * (w.count - 1));
+            std::nth_element(window.begin(), window.begin() + rank, window.end());
+            out[4 + p] = window[rank];
+        }
+    }
+
+    std::unique_ptr<DerivedRecord> record = std::make_unique<DerivedRecord>(DERIVED_STATISTICS, csi);
+    record->setValues(values, w.numSubCarriers * 2 * perMetric);
+    record->header.numRecords = w.count;
+    return record;
+}
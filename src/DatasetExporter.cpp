@@ -0,0 +1,449 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatasetExporter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <tuple>
+#include "Csi.h"
+#include "DerivedRecord.h"
+#include "Logger.h"
+#include "ProcessingGraph.h"
+#include "ThreadPool.h"
+
+namespace {
+
+struct PendingWindow {
+    uint32_t numRx = 0;
+    uint32_t numTx = 0;
+    uint32_t numSubCarriers = 0;
+    std::deque<std::vector<float>> records;
+    std::deque<uint64_t> timestamps;
+};
+
+// Same sequence on every platform, unlike std::shuffle
+uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+std::string csvField(const std::string& value) {
+    std::string out = "\"";
+    for (char c : value) {
+        out += c == '"' ? std::string("\"\"") : std::string(1, c);
+    }
+    return out + "\"";
+}
+
+std::ofstream openOutput(const std::filesystem::path& path) {
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (ofs.fail()) {
+        throw std::ios_base::failure("Open file failed: " + path.string() + " " +
+                                     std::string(std::strerror(errno)));
+    }
+    return ofs;
+}
+
+// Removes the spools however the export ends
+struct SpoolFiles {
+    std::vector<std::string> paths;
+
+    ~SpoolFiles() {
+        for (const std::string& path : this->paths) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    }
+};
+
+}  // namespace
+
+DatasetExporter::DatasetExporter(const ExportConfig& config) : config(config) {
+    this->config.window = std::max(this->config.window, 1u);
+    this->config.hop =
+        this->config.hop ? std::min(this->config.hop, this->config.window) : this->config.window;
+    this->config.shardSize = std::max(this->config.shardSize, 1u);
+}
+
+std::vector<ExportInput> DatasetExporter::readInputs(const std::string& path) {
+    std::ifstream ifs(path);
+    if (ifs.fail()) {
+        throw std::ios_base::failure("Open file failed: " + path);
+    }
+
+    std::vector<ExportInput> inputs;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        std::istringstream iss(line);
+        std::string file;
+        if (!(iss >> file) || file[0] == '#') {
+            continue;
+        }
+        ExportInput in = input(file);
+        std::string label;
+        std::getline(iss >> std::ws, label);
+        if (!label.empty()) {
+            in.label = label;
+        }
+        inputs.push_back(in);
+    }
+    return inputs;
+}
+
+ExportInput DatasetExporter::input(const std::string& file) {
+    return {file, std::filesystem::path(file).stem().string()};
+}
+
+void DatasetExporter::run(const std::vector<ExportInput>& inputs) {
+    std::filesystem::create_directories(this->config.directory);
+    ThreadPool pool(this->config.threads);
+    SpoolFiles spools;
+    for (uint32_t i = 0; i < inputs.size(); i++) {
+        spools.paths.push_back(this->spoolPath(i));
+    }
+
+    // Loop bodies must not throw, the first error is raised afterwards
+    std::vector<std::vector<WindowIndex>> windows(inputs.size());
+    std::vector<std::exception_ptr> errors(inputs.size());
+    pool.parallelFor(inputs.size(), [&](size_t i) {
+        try {
+            windows[i] = this->extract(inputs[i], i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    });
+    for (const std::exception_ptr& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+
+    // Windows of one shape in input and capture order, so the result does
+    // not depend on which thread finished first
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t>, std::vector<const WindowIndex*>> groups;
+    for (const std::vector<WindowIndex>& input : windows) {
+        for (const WindowIndex& w : input) {
+            groups[{w.numRx, w.numTx, w.numSubCarriers}].push_back(&w);
+        }
+    }
+
+    std::vector<std::string> names;
+    std::vector<std::vector<const WindowIndex*>> shards;
+    uint64_t state = this->config.seed;
+    for (auto& [shape, group] : groups) {
+        if (this->config.seed) {
+            for (size_t i = group.size(); i > 1; i--) {
+                std::swap(group[i - 1], group[splitMix64(state) % i]);
+            }
+        }
+        for (size_t first = 0; first < group.size(); first += this->config.shardSize) {
+            const size_t last = std::min(group.size(), first + this->config.shardSize);
+            char name[32];
+            snprintf(name, sizeof(name), "shard-%05zu", shards.size());
+            names.push_back(name);
+            shards.emplace_back(group.begin() + first, group.begin() + last);
+        }
+    }
+
+    errors.assign(shards.size(), nullptr);
+    pool.parallelFor(shards.size(), [&](size_t i) {
+        try {
+            this->writeShard(names[i], shards[i], inputs);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    });
+    for (const std::exception_ptr& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+    this->writeManifest(names, shards);
+
+    size_t total = 0;
+    for (const std::vector<const WindowIndex*>& shard : shards) {
+        total += shard.size();
+    }
+    Logger::log(info) << "Exported " << total << " windows in " << shards.size() << " shards to "
+                      << this->config.directory << "\n";
+}
+
+std::vector<WindowIndex> DatasetExporter::extract(const ExportInput& input, uint32_t index) {
+    std::ifstream ifs(input.file, std::ios::binary);
+    if (ifs.fail()) {
+        throw std::ios_base::failure("Open file failed: " + input.file);
+    }
+    std::ofstream spool = openOutput(this->spoolPath(index));
+
+    std::unique_ptr<ProcessingGraph> graph = ProcessingGraph::create();
+    std::map<uint64_t, PendingWindow> pending;
+    std::vector<WindowIndex> windows;
+    TensorWindow w;
+    uint64_t offset = 0;
+    std::vector<uint8_t> buffer;
+    std::vector<float> values;
+
+    uint32_t csiDataSize;
+    while (ifs.read(reinterpret_cast<char*>(&csiDataSize), sizeof(csiDataSize))) {
+        buffer.resize(CSI_HEADER_LENGTH + csiDataSize);
+        memcpy(buffer.data(), &csiDataSize, sizeof(csiDataSize));
+        if (!ifs.read(reinterpret_cast<char*>(buffer.data()) + sizeof(csiDataSize),
+                      buffer.size() - sizeof(csiDataSize))) {
+            break;  // truncated last record of an interrupted capture
+        }
+
+        Csi csi;
+        csi.loadFromMemory(buffer.data());
+        graph->transform(csi);
+
+        uint64_t key = 0;
+        memcpy(&key, csi.rawHeaderData.srcMac, sizeof(csi.rawHeaderData.srcMac));
+        PendingWindow& p = pending[key];
+        if (p.numRx != csi.numRx || p.numTx != csi.numTx ||
+            p.numSubCarriers != csi.numSubCarriers) {
+            p.numRx = csi.numRx;
+            p.numTx = csi.numTx;
+            p.numSubCarriers = csi.numSubCarriers;
+            p.records.clear();
+            p.timestamps.clear();
+        }
+
+        std::vector<float> record;
+        if (this->config.complex) {
+            record.reserve(2 * csi.csi.size());
+            for (const std::complex<double>& c : csi.csi) {
+                record.push_back(c.real());
+                record.push_back(c.imag());
+            }
+        } else {
+            record.assign(csi.magnitude.begin(), csi.magnitude.end());
+        }
+        p.records.push_back(std::move(record));
+        p.timestamps.push_back(csi.rawHeaderData.timestamp);
+
+        if (p.records.size() < this->config.window) {
+            continue;
+        }
+
+        w.input = index;
+        memcpy(w.srcMac, csi.rawHeaderData.srcMac, sizeof(w.srcMac));
+        w.numRx = p.numRx;
+        w.numTx = p.numTx;
+        w.numSubCarriers = p.numSubCarriers;
+        w.timestamps.assign(p.timestamps.begin(), p.timestamps.end());
+        const uint32_t valuesPerRecord = p.records.front().size();
+        values.clear();
+        for (const std::vector<float>& r : p.records) {
+            values.insert(values.end(), r.begin(), r.end());
+        }
+        this->quantize(values, valuesPerRecord, w);
+
+        spool.write(reinterpret_cast<const char*>(w.values.data()), w.values.size());
+        spool.write(reinterpret_cast<const char*>(w.timestamps.data()),
+                    w.timestamps.size() * sizeof(uint64_t));
+        if (this->config.int8) {
+            spool.write(reinterpret_cast<const char*>(w.scales.data()),
+                        w.scales.size() * sizeof(float));
+        }
+
+        WindowIndex i;
+        i.input = index;
+        i.offset = offset;
+        memcpy(i.srcMac, w.srcMac, sizeof(i.srcMac));
+        i.numRx = w.numRx;
+        i.numTx = w.numTx;
+        i.numSubCarriers = w.numSubCarriers;
+        i.firstTimestamp = w.timestamps.front();
+        i.lastTimestamp = w.timestamps.back();
+        offset += this->valuesSize(i) + w.timestamps.size() * sizeof(uint64_t) +
+                  this->scalesSize(i);
+        windows.push_back(i);
+
+        for (uint32_t i = 0; i < this->config.hop; i++) {
+            p.records.pop_front();
+            p.timestamps.pop_front();
+        }
+    }
+
+    spool.flush();
+    if (spool.fail()) {
+        throw std::ios_base::failure("Write of spool failed: " + this->spoolPath(index));
+    }
+    return windows;
+}
+
+void DatasetExporter::quantize(const std::vector<float>& values,
+                               uint32_t valuesPerRecord,
+                               TensorWindow& w) {
+    if (!this->config.int8) {
+        w.values.resize(values.size() * sizeof(uint16_t));
+        uint16_t* out = reinterpret_cast<uint16_t*>(w.values.data());
+        for (size_t i = 0; i < values.size(); i++) {
+            out[i] = DerivedRecord::toHalf(values[i]);
+        }
+        return;
+    }
+
+    // Symmetric scale of every rx/tx/subcarrier channel over the window, real
+    // and imaginary part share it
+    const uint32_t components = this->config.complex ? 2 : 1;
+    const uint32_t numChannels = valuesPerRecord / components;
+    const size_t numRecords = values.size() / valuesPerRecord;
+    w.scales.assign(numChannels, 0);
+    for (size_t r = 0; r < numRecords; r++) {
+        const float* record = &values[r * valuesPerRecord];
+        for (uint32_t i = 0; i < valuesPerRecord; i++) {
+            float& scale = w.scales[i / components];
+            scale = std::max(scale, std::fabs(record[i]));
+        }
+    }
+    for (float& scale : w.scales) {
+        scale /= 127;
+    }
+
+    w.values.resize(values.size());
+    int8_t* out = reinterpret_cast<int8_t*>(w.values.data());
+    for (size_t r = 0; r < numRecords; r++) {
+        const size_t offset = r * valuesPerRecord;
+        for (uint32_t i = 0; i < valuesPerRecord; i++) {
+            const float scale = w.scales[i / components];
+            const float q = scale > 0 ? std::nearbyint(values[offset + i] / scale) : 0;
+            out[offset + i] = (int8_t)std::clamp(q, -127.0f, 127.0f);
+        }
+    }
+}
+
+void DatasetExporter::writeShard(const std::string& name,
+                                 const std::vector<const WindowIndex*>& windows,
+                                 const std::vector<ExportInput>& inputs) {
+    const std::filesystem::path dir(this->config.directory);
+
+    std::ofstream tensor = openOutput(dir / (name + ".bin"));
+    std::ofstream timestamps = openOutput(dir / (name + ".timestamps.bin"));
+    std::ofstream scales;
+    if (this->config.int8) {
+        scales = openOutput(dir / (name + ".scales.bin"));
+    }
+
+    std::map<uint32_t, std::ifstream> spools;
+    std::vector<char> buffer;
+    const size_t timestampsSize = this->config.window * sizeof(uint64_t);
+    for (const WindowIndex* w : windows) {
+        auto spool = spools.find(w->input);
+        if (spool == spools.end()) {
+            std::ifstream ifs(this->spoolPath(w->input), std::ios::binary);
+            spool = spools.emplace(w->input, std::move(ifs)).first;
+        }
+        const size_t valuesSize = this->valuesSize(*w);
+        buffer.resize(valuesSize + timestampsSize + this->scalesSize(*w));
+        spool->second.seekg(w->offset);
+        if (!spool->second.read(buffer.data(), buffer.size())) {
+            throw std::ios_base::failure("Read of spool failed: " + this->spoolPath(w->input));
+        }
+        tensor.write(buffer.data(), valuesSize);
+        timestamps.write(buffer.data() + valuesSize, timestampsSize);
+        if (this->config.int8) {
+            scales.write(buffer.data() + valuesSize + timestampsSize,
+                         buffer.size() - valuesSize - timestampsSize);
+        }
+    }
+
+    std::ofstream labels = openOutput(dir / (name + ".labels.csv"));
+    labels << "window,label,source,mac,first_timestamp,last_timestamp\n";
+    for (size_t i = 0; i < windows.size(); i++) {
+        const WindowIndex* w = windows[i];
+        char mac[18];
+        snprintf(mac, sizeof(mac), "%02x:%02x:%02x:%02x:%02x:%02x", w->srcMac[0], w->srcMac[1],
+                 w->srcMac[2], w->srcMac[3], w->srcMac[4], w->srcMac[5]);
+        labels << i << "," << csvField(inputs[w->input].label) << ","
+               << csvField(inputs[w->input].file) << "," << mac << "," << w->firstTimestamp
+               << "," << w->lastTimestamp << "\n";
+    }
+
+    if (tensor.fail() || timestamps.fail() || scales.fail() || labels.fail()) {
+        throw std::ios_base::failure("Write of " + name + " failed");
+    }
+}
+
+void DatasetExporter::writeManifest(const std::vector<std::string>& names,
+                                    const std::vector<std::vector<const WindowIndex*>>& shards) {
+    std::ofstream ofs = openOutput(std::filesystem::path(this->config.directory) / "manifest.json");
+    ofs << "{\n"
+        << "  \"dtype\": \"" << (this->config.int8 ? "int8" : "float16") << "\",\n"
+        << "  \"values\": \"" << (this->config.complex ? "complex" : "magnitude") << "\",\n"
+        << "  \"layout\": [\"window\", \"time\", \"rx\", \"tx\", \"subcarrier\""
+        << (this->config.complex ? ", \"re_im\"" : "") << "],\n"
+        << "  \"window\": " << this->config.window << ",\n"
+        << "  \"hop\": " << this->config.hop << ",\n"
+        << "  \"seed\": " << this->config.seed << ",\n"
+        << "  \"shards\": [";
+
+    for (size_t i = 0; i < shards.size(); i++) {
+        const std::string& n = names[i];
+        ofs << (i ? "," : "") << "\n    {\"name\": \"" << n
+            << "\", \"windows\": " << shards[i].size() << ", \"shape\": [";
+        std::vector<uint32_t> s = this->shape(*shards[i].front(), shards[i].size());
+        for (size_t d = 0; d < s.size(); d++) {
+            ofs << (d ? ", " : "") << s[d];
+        }
+        ofs << "], \"tensor\": \"" << n << ".bin\", \"timestamps\": \"" << n
+            << ".timestamps.bin\", \"labels\": \"" << n << ".labels.csv\"";
+        if (this->config.int8) {
+            ofs << ", \"scales\": \"" << n << ".scales.bin\"";
+        }
+        ofs << "}";
+    }
+    ofs << "\n  ]\n}\n";
+
+    if (ofs.fail()) {
+        throw std::ios_base::failure("Write of manifest failed");
+    }
+}
+
+std::vector<uint32_t> DatasetExporter::shape(const WindowIndex& w, size_t numWindows) {
+    std::vector<uint32_t> s = {(uint32_t)numWindows, this->config.window, w.numRx, w.numTx,
+                               w.numSubCarriers};
+    if (this->config.complex) {
+        s.push_back(2);
+    }
+    return s;
+}
+
+size_t DatasetExporter::valuesSize(const WindowIndex& w) {
+    return (size_t)this->config.window * w.numRx * w.numTx * w.numSubCarriers *
+           (this->config.complex ? 2 : 1) * (this->config.int8 ? 1 : sizeof(uint16_t));
+}
+
+size_t DatasetExporter::scalesSize(const WindowIndex& w) {
+    return this->config.int8 ? (size_t)w.numRx * w.numTx * w.numSubCarriers * sizeof(float) : 0;
+}
+
+std::string DatasetExporter::spoolPath(uint32_t input) {
+    char name[32];
+    snprintf(name, sizeof(name), ".spool-%05u", input);
+    return (std::filesystem::path(this->config.directory) / name).string();
+}
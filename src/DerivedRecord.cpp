@@ -0,0 +1,187 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DerivedRecord.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "Arguments.h"
+
+DerivedRecord::DerivedRecord(derivedRecordType type, const Csi& csi) {
+    memset(&this->header, 0, DERIVED_HEADER_LENGTH);
+    this->header.type = type;
+    this->header.numRx = csi.numRx;
+    this->header.numTx = csi.numTx;
+    this->header.timestamp = csi.rawHeaderData.timestamp;
+    this->clockUncertainty = csi.clockUncertainty;
+    this->header.rateNflag = csi.rawHeaderData.rateNflag;
+    this->header.numSubCarriers = csi.numSubCarriers;
+    this->header.numRecords = 1;
+    memcpy(this->header.srcMac, csi.rawHeaderData.srcMac, sizeof(this->header.srcMac));
+}
+
+void DerivedRecord::setValues(const std::vector<double>& values, uint32_t numValues) {
+    this->data.resize(values.size() * sizeof(float));
+    float* out = reinterpret_cast<float*>(this->data.data());
+    for (size_t i = 0; i < values.size(); i++) {
+        out[i] = values[i];
+    }
+    this->header.numValues = numValues;
+    this->header.valueType = VALUE_FLOAT32;
+    this->header.dataSize = this->data.size();
+}
+
+void DerivedRecord::setValues(const std::vector<std::complex<double>>& values, uint32_t numValues) {
+    this->data.resize(values.size() * 2 * sizeof(float));
+    float* out = reinterpret_cast<float*>(this->data.data());
+    for (size_t i = 0; i < values.size(); i++) {
+        out[2 * i] = values[i].real();
+        out[2 * i + 1] = values[i].imag();
+    }
+    this->header.numValues = numValues;
+    this->header.valueType = VALUE_COMPLEX_FLOAT32;
+    this->header.dataSize = this->data.size();
+}
+
+void DerivedRecord::setValues(const std::vector<std::complex<float>>& values,
+                              uint32_t numValues,
+                              bool half) {
+    if (half) {
+        this->data.resize(values.size() * 2 * sizeof(uint16_t));
+        uint16_t* out = reinterpret_cast<uint16_t*>(this->data.data());
+        for (size_t i = 0; i < values.size(); i++) {
+            out[2 * i] = toHalf(values[i].real());
+            out[2 * i + 1] = toHalf(values[i].imag());
+        }
+        this->header.valueType = VALUE_COMPLEX_FLOAT16;
+    } else {
+        this->data.resize(values.size() * sizeof(std::complex<float>));
+        memcpy(this->data.data(), values.data(), this->data.size());
+        this->header.valueType = VALUE_COMPLEX_FLOAT32;
+    }
+    this->header.numValues = numValues;
+    this->header.dataSize = this->data.size();
+}
+
+// Round to nearest even, values out of range saturate to the largest finite half
+uint16_t DerivedRecord::toHalf(float value) {
+    uint32_t x;
+    memcpy(&x, &value, sizeof(x));
+    const uint16_t sign = (x >> 16) & 0x8000;
+    const int32_t biased = (x >> 23) & 0xff;
+    uint32_t mantissa = x & 0x7fffff;
+
+    if (biased == 0xff) {
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    }
+    const int32_t exponent = biased - 127 + 15;
+    if (exponent >= 31) {
+        return sign | 0x7bff;
+    }
+
+    uint32_t shift = 13;
+    uint32_t half;
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        shift = 14 - exponent;
+        half = mantissa >> shift;
+    } else {
+        half = (exponent << 10) | (mantissa >> shift);
+    }
+
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+        half++;
+    }
+    if (half >= 0x7c00) {
+        half = 0x7bff;
+    }
+    return sign | half;
+}
+
+void DerivedRecord::save() {
+    std::string filename = this->filePrefix() + Arguments::snapshot()->outputFile;
+    std::ofstream outfile;
+    outfile.open(filename, std::ios_base::app | std::ios::binary);
+    if (outfile.fail()) {
+        throw std::ios_base::failure("Open file failed: " + std::string(std::strerror(errno)));
+    }
+    outfile.write(reinterpret_cast<char*>(&this->header), DERIVED_HEADER_LENGTH);
+    outfile.write(reinterpret_cast<char*>(this->data.data()), this->header.dataSize);
+    outfile.close();
+    std::filesystem::permissions(
+        filename,
+        std::filesystem::perms::all &
+            ~(std::filesystem::perms::owner_exec | std::filesystem::perms::group_exec |
+              std::filesystem::perms::others_exec),
+        std::filesystem::perm_options::add);
+}
+
+void DerivedRecord::sendUDP(UdpSocket* udpSocket) {
+    struct iovec iov[2] = {
+        {&this->header, DERIVED_HEADER_LENGTH},
+        {this->data.data(), this->header.dataSize},
+    };
+    udpSocket->send(iov, 2,
+                    {STREAM_FORMAT_DERIVED, this->header.type, this->header.srcMac,
+                     this->header.timestamp, this->clockUncertainty});
+}
+
+void DerivedRecord::output(UdpSocket* udpSocket) {
+    if (udpSocket) {
+        this->sendUDP(udpSocket);
+    } else {
+        this->save();
+    }
+}
+
+std::string DerivedRecord::filePrefix() {
+    return prefix(this->header.type);
+}
+
+std::string DerivedRecord::prefix(uint16_t type) {
+    switch (type) {
+        case DERIVED_CIR:
+            return "CIR_";
+        case DERIVED_STATISTICS:
+            return "STATS_";
+        case DERIVED_DOPPLER:
+            return "DOPPLER_";
+        case DERIVED_PROCESSED:
+            return "PROCESSED_";
+        case DERIVED_RATIO:
+            return "RATIO_";
+        case DERIVED_COVARIANCE:
+            return "COVARIANCE_";
+        case DERIVED_AOA_TOF:
+            return "AOA_";
+        case DERIVED_DISTANCE:
+            return "DISTANCE_";
+        case DERIVED_PCA:
+            return "PCA_";
+        case DERIVED_PCA_BASIS:
+            return "PCABASIS_";
+        case DERIVED_PROJECTION:
+            return "PROJECTION_";
+    }
+    return "DERIVED_";
+}
@@ -0,0 +1,196 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DopplerSpectrogram.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+void DopplerSpectrogram::configure(double sampleRate,
+                                   uint32_t windowSize,
+                                   uint32_t hop,
+                                   uint32_t groupSize,
+                                   bool ratio) {
+    if (!(sampleRate > 0 && sampleRate <= 1e6)) {
+        throw std::invalid_argument("Bad Doppler sample rate " + std::to_string(sampleRate) +
+                                    ", it must be above 0 and at most 1000000");
+    }
+    this->sampleRate = sampleRate;
+    this->windowSize = std::max(windowSize, 2u);
+    this->hop = hop ? std::min(hop, this->windowSize) : this->windowSize;
+    this->groupSize = groupSize;
+    this->ratio = ratio;
+    this->plan = Fft::plan(this->windowSize);
+    this->window.resize(this->windowSize);
+    for (uint32_t i = 0; i < this->windowSize; i++) {
+        this->window[i] = 0.5 - 0.5 * cos(2 * M_PI * i / this->windowSize);
+    }
+    this->states.clear();
+}
+
+uint32_t DopplerSpectrogram::numGroups(uint32_t numSubCarriers) const {
+    if (!this->groupSize || this->groupSize >= numSubCarriers) {
+        return 1;
+    }
+    return (numSubCarriers + this->groupSize - 1) / this->groupSize;
+}
+
+std::vector<std::unique_ptr<DerivedRecord>> DopplerSpectrogram::update(Csi& csi) {
+    std::vector<std::unique_ptr<DerivedRecord>> records;
+    if (this->ratio && csi.numRx < 2) {
+        return records;
+    }
+    if (!this->plan) {
+        this->configure(this->sampleRate, this->windowSize, this->hop, this->groupSize,
+                        this->ratio);
+    }
+
+    uint64_t key = 0;
+    memcpy(&key, csi.rawHeaderData.srcMac, sizeof(csi.rawHeaderData.srcMac));
+    DopplerState& state = this->states[key];
+
+    const uint32_t numChains = this->ratio ? csi.numTx : csi.numRx * csi.numTx;
+    const uint32_t numStreams = numChains * this->numGroups(csi.numSubCarriers);
+    const uint64_t period = std::max<uint64_t>(1e6 / this->sampleRate, 1);
+    const uint64_t timestamp = csi.rawHeaderData.timestamp;
+
+    const uint64_t span = period * this->windowSize;
+    const bool sameLayout =
+        state.numStreams == numStreams && state.numSubCarriers == csi.numSubCarriers;
+
+    // A late or repeated record is dropped, the series it would go before is kept
+    if (sameLayout && timestamp <= state.lastTimestamp &&
+        state.lastTimestamp - timestamp <= span) {
+        return records;
+    }
+
+    std::vector<std::complex<double>> current;
+    this->sample(csi, numStreams, current);
+
+    // Layout change, a gap longer than the window or a clock step back restarts the series
+    if (!sameLayout || timestamp <= state.lastTimestamp ||
+        timestamp - state.lastTimestamp > span) {
+        state.numStreams = numStreams;
+        state.numSubCarriers = csi.numSubCarriers;
+        state.count = 0;
+        state.head = 0;
+        state.sinceSpectrum = 0;
+        state.ring.assign((size_t)this->windowSize * numStreams, 0);
+        state.last = current;
+        state.lastTimestamp = timestamp;
+        state.nextSampleTime = timestamp + period;
+        this->push(state, current.data());
+        return records;
+    }
+
+    // A gap may make several spectra due, each one is emitted at its own sample time
+    std::vector<std::complex<double>> interpolated(numStreams);
+    while (state.nextSampleTime <= timestamp) {
+        const double mu = (double)(state.nextSampleTime - state.lastTimestamp) /
+                          (timestamp - state.lastTimestamp);
+        for (uint32_t s = 0; s < numStreams; s++) {
+            interpolated[s] = state.last[s] + mu * (current[s] - state.last[s]);
+        }
+        this->push(state, interpolated.data());
+
+        if (state.count == this->windowSize && state.sinceSpectrum >= this->hop) {
+            records.push_back(this->spectrum(state, csi));
+            records.back()->header.timestamp = state.nextSampleTime;
+        }
+        state.nextSampleTime += period;
+    }
+
+    state.last = std::move(current);
+    state.lastTimestamp = timestamp;
+    return records;
+}
+
+void DopplerSpectrogram::sample(const Csi& csi,
+                                uint32_t numStreams,
+                                std::vector<std::complex<double>>& out) {
+    const uint32_t groups = this->numGroups(csi.numSubCarriers);
+    const uint32_t numChains = numStreams / groups;
+    out.assign(numStreams, 0);
+
+    for (uint32_t chain = 0; chain < numChains; chain++) {
+        // Ratio streams are indexed by tx, rx1 * conj(rx2) of the same tx
+        const std::complex<double>* a = &csi.csi[chain * csi.numSubCarriers];
+        const std::complex<double>* b = &csi.csi[(csi.numTx + chain) * csi.numSubCarriers];
+        for (uint32_t n = 0; n < csi.numSubCarriers; n++) {
+            std::complex<double> v = this->ratio ? a[n] * std::conj(b[n]) : a[n];
+            out[chain * groups + n * groups / csi.numSubCarriers] += v;
+        }
+    }
+}
+
+void DopplerSpectrogram::push(DopplerState& state, const std::complex<double>* sample) {
+    std::copy(sample, sample + state.numStreams, &state.ring[(size_t)state.head * state.numStreams]);
+    state.head = (state.head + 1) % this->windowSize;
+    state.count = std::min(state.count + 1, this->windowSize);
+    state.sinceSpectrum++;
+}
+
+std::unique_ptr<DerivedRecord> DopplerSpectrogram::spectrum(DopplerState& state, Csi& csi) {
+    const uint32_t n = this->windowSize;
+    std::vector<double> values((size_t)state.numStreams * n);
+    std::vector<std::complex<double>> buf(n);
+
+    for (uint32_t s = 0; s < state.numStreams; s++) {
+        // Oldest sample is at head, the static (DC) part is removed before windowing
+        std::complex<double> mean = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            buf[i] = state.ring[(size_t)((state.head + i) % n) * state.numStreams + s];
+            mean += buf[i];
+        }
+        mean /= (double)n;
+        for (uint32_t i = 0; i < n; i++) {
+            buf[i] = (buf[i] - mean) * this->window[i];
+        }
+
+        this->plan->forward(buf.data());
+
+        double* out = &values[(size_t)s * n];
+        for (uint32_t k = 0; k < n; k++) {
+            out[(k + n / 2) % n] = 10 * log10(std::norm(buf[k]) + 1e-12);
+        }
+    }
+    state.sinceSpectrum = 0;
+
+    const uint32_t groups = this->numGroups(csi.numSubCarriers);
+    const uint32_t numChains = state.numStreams / groups;
+
+    // Group average per chain for plotting
+    csi.dopplerLength = n;
+    csi.dopplerSpectrum.assign((size_t)numChains * n, 0);
+    for (uint32_t s = 0; s < state.numStreams; s++) {
+        for (uint32_t k = 0; k < n; k++) {
+            csi.dopplerSpectrum[(s / groups) * n + k] += values[(size_t)s * n + k] / groups;
+        }
+    }
+
+    std::unique_ptr<DerivedRecord> record = std::make_unique<DerivedRecord>(DERIVED_DOPPLER, csi);
+    if (this->ratio) {
+        record->header.numRx = 1;
+    }
+    record->setValues(values, groups * n);
+    record->header.numSubCarriers = groups;
+    record->header.numRecords = n;
+    return record;
+}
@@ -0,0 +1,170 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Fft.h"
+#include <cmath>
+#include <stdexcept>
+
+std::shared_ptr<const Fft> Fft::plan(uint32_t size) {
+    {
+        std::lock_guard<std::mutex> lock(Fft::plansMutex);
+        auto it = Fft::plans.find(size);
+        if (it != Fft::plans.end()) {
+            return it->second;
+        }
+    }
+
+    // Built outside the lock, Bluestein plans request their own convolution plan
+    auto p = std::make_shared<const Fft>(size);
+
+    std::lock_guard<std::mutex> lock(Fft::plansMutex);
+    return Fft::plans.try_emplace(size, p).first->second;
+}
+
+Fft::Fft(uint32_t size) : size(size) {
+    if (size == 0) {
+        throw std::invalid_argument("FFT size must be greater than zero");
+    }
+
+    this->powerOfTwo = (size & (size - 1)) == 0;
+
+    if (this->powerOfTwo) {
+        uint32_t bits = 0;
+        while ((1u << bits) < size) {
+            bits++;
+        }
+        this->bitReverse.resize(size);
+        for (uint32_t i = 0; i < size; i++) {
+            uint32_t r = 0;
+            for (uint32_t b = 0; b < bits; b++) {
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            this->bitReverse[i] = r;
+        }
+
+        this->twiddles.resize(size / 2);
+        for (uint32_t k = 0; k < size / 2; k++) {
+            this->twiddles[k] = std::polar(1.0, -2.0 * M_PI * k / size);
+        }
+        return;
+    }
+
+    // Bluestein: X[k] = w[k] * sum(x[n] * w[n] * conj(w[k - n])), w[n] = exp(-i*pi*n^2/N)
+    uint32_t convSize = 1;
+    while (convSize < 2 * size - 1) {
+        convSize <<= 1;
+    }
+    this->convolution = Fft::plan(convSize);
+
+    this->chirp.resize(size);
+    for (uint64_t n = 0; n < size; n++) {
+        // n^2 mod 2N keeps the argument small for large n
+        uint64_t n2 = (n * n) % (2 * (uint64_t)size);
+        this->chirp[n] = std::polar(1.0, -M_PI * n2 / size);
+    }
+
+    this->chirpSpectrum.assign(convSize, 0);
+    this->chirpSpectrum[0] = std::conj(this->chirp[0]);
+    for (uint32_t n = 1; n < size; n++) {
+        this->chirpSpectrum[n] = std::conj(this->chirp[n]);
+        this->chirpSpectrum[convSize - n] = std::conj(this->chirp[n]);
+    }
+    this->convolution->forward(this->chirpSpectrum.data());
+}
+
+void Fft::forward(std::complex<double>* data) const {
+    if (this->powerOfTwo) {
+        this->radix2(data, false);
+    } else {
+        this->bluestein(data, false);
+    }
+}
+
+void Fft::inverse(std::complex<double>* data) const {
+    if (this->powerOfTwo) {
+        this->radix2(data, true);
+    } else {
+        this->bluestein(data, true);
+    }
+    const double scale = 1.0 / this->size;
+    for (uint32_t i = 0; i < this->size; i++) {
+        data[i] *= scale;
+    }
+}
+
+void Fft::radix2(std::complex<double>* data, bool inverse) const {
+    const uint32_t n = this->size;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t r = this->bitReverse[i];
+        if (i < r) {
+            std::swap(data[i], data[r]);
+        }
+    }
+
+    // Split real/imag arithmetic keeps the inner loop free of the
+    // NaN/Inf checks of std::complex multiplication so it vectorizes
+    double* d = reinterpret_cast<double*>(data);
+    const double* w = reinterpret_cast<const double*>(this->twiddles.data());
+    const double sign = inverse ? -1.0 : 1.0;
+
+    for (uint32_t len = 2; len <= n; len <<= 1) {
+        const uint32_t half = len >> 1;
+        const uint32_t stride = n / len;
+        for (uint32_t start = 0; start < n; start += len) {
+            double* a = d + 2 * start;
+            double* b = d + 2 * (start + half);
+            for (uint32_t j = 0; j < half; j++) {
+                const double wr = w[2 * j * stride];
+                const double wi = sign * w[2 * j * stride + 1];
+                const double br = b[2 * j] * wr - b[2 * j + 1] * wi;
+                const double bi = b[2 * j] * wi + b[2 * j + 1] * wr;
+                const double ar = a[2 * j];
+                const double ai = a[2 * j + 1];
+                a[2 * j] = ar + br;
+                a[2 * j + 1] = ai + bi;
+                b[2 * j] = ar - br;
+                b[2 * j + 1] = ai - bi;
+            }
+        }
+    }
+}
+
+void Fft::bluestein(std::complex<double>* data, bool inverse) const {
+    const uint32_t n = this->size;
+    const uint32_t m = this->convolution->size;
+
+    thread_local std::vector<std::complex<double>> work;
+    work.assign(m, 0);
+
+    // The inverse transform is the forward one applied to the conjugated input
+    for (uint32_t i = 0; i < n; i++) {
+        std::complex<double> x = inverse ? std::conj(data[i]) : data[i];
+        work[i] = x * this->chirp[i];
+    }
+
+    this->convolution->forward(work.data());
+    for (uint32_t i = 0; i < m; i++) {
+        work[i] *= this->chirpSpectrum[i];
+    }
+    this->convolution->inverse(work.data());
+
+    for (uint32_t k = 0; k < n; k++) {
+        std::complex<double> x = work[k] * this->chirp[k];
+        data[k] = inverse ? std::conj(x) : x;
+    }
+}
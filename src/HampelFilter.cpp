@@ -0,0 +1,91 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "HampelFilter.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+// Series filtered by one pool task
+#define HAMPEL_BLOCK 512
+
+void HampelFilter::configure(uint32_t windowSize, double threshold, uint32_t numThreads) {
+    this->windowSize = std::max(windowSize, 1u);
+    this->threshold = std::max(threshold, 0.0);
+    this->pool = std::make_unique<ThreadPool>(numThreads);
+    this->states.clear();
+}
+
+void HampelFilter::clear() {
+    this->states.clear();
+}
+
+uint32_t HampelFilter::update(Csi& csi) {
+    uint64_t key = 0;
+    memcpy(&key, csi.rawHeaderData.srcMac, sizeof(csi.rawHeaderData.srcMac));
+    HampelState& s = this->states[key];
+
+    if (s.numRx != csi.numRx || s.numTx != csi.numTx || s.numSubCarriers != csi.numSubCarriers) {
+        s.numRx = csi.numRx;
+        s.numTx = csi.numTx;
+        s.numSubCarriers = csi.numSubCarriers;
+        s.window.reset(csi.numRx * csi.numTx * csi.numSubCarriers, this->windowSize);
+    }
+
+    const uint32_t numSeries = s.numRx * s.numTx * s.numSubCarriers;
+    const uint32_t numBlocks = (numSeries + HAMPEL_BLOCK - 1) / HAMPEL_BLOCK;
+    std::atomic<uint32_t> replaced = 0;
+    if (numBlocks > 1 && this->pool) {
+        this->pool->parallelFor(numBlocks, [&](size_t b) {
+            const uint32_t first = b * HAMPEL_BLOCK;
+            const uint32_t last = std::min(first + HAMPEL_BLOCK, numSeries);
+            replaced += this->filter(s, csi.magnitude.data(), first, last);
+        });
+    } else {
+        replaced = this->filter(s, csi.magnitude.data(), 0, numSeries);
+    }
+    s.window.advance();
+    return replaced;
+}
+
+uint32_t HampelFilter::filter(HampelState& s, double* magnitude, uint32_t first, uint32_t last) {
+    uint32_t replaced = 0;
+    for (uint32_t i = first; i < last; i++) {
+        s.window.push(i, magnitude[i]);
+        const float median = s.window.median(i);
+        if (this->threshold == 0) {
+            magnitude[i] = median;
+            continue;
+        }
+
+        // Outlier when MAD < bound, i.e. at least (n + 1) / 2 values of the
+        // window deviate from the median less than bound, two rank queries
+        // instead of a selection over the deviations. With an even window
+        // n / 2 values suffice, which compares the lower median of the
+        // deviations. Needs a few records to judge
+        const float bound = std::fabs(magnitude[i] - median) / (this->threshold * HAMPEL_MAD_SCALE);
+        const uint32_t n = s.window.size(i);
+        if (n >= 3 && bound > 0 &&
+            s.window.countBetween(i, median - bound, median + bound) > (n - 1) / 2) {
+            magnitude[i] = median;
+            replaced++;
+        }
+    }
+    return replaced;
+}
@@ -18,6 +18,7 @@
 
 #include "MainController.h"
 #include "Arguments.h"
+#include "ClockSync.h"
 #include "Logger.h"
 #include "WiFiFtmController.h"
 #include "gui/MainWindow.h"
@@ -57,7 +58,7 @@ void MainController::deleteInstance() {
     if (mainController->injecting) {
         MainController::instance->injectPackets(true);
     }
-    if (Arguments::arguments.plot) {
+    if (Arguments::snapshot()->plot) {
         MainController::instance->app->quit();
     }
 
@@ -65,6 +66,7 @@ void MainController::deleteInstance() {
 }
 
 void MainController::initPlots() {
+    std::map<processor, bool> processors = Arguments::snapshot()->processors;
     Glib::RefPtr<Gtk::Box> plotBox =
         Glib::RefPtr<Gtk::Box>::cast_dynamic(this->mainWindow->builder->get_object("plotBox"));
     MainController* mainController = MainController::getInstance();
@@ -76,6 +78,24 @@ void MainController::initPlots() {
     mainController->plotPhase->yTicksMin = -4;
     mainController->plotPhase->yTicksMax = 4;
     mainController->plotPhase->init(plotBox);
+    if (processors[processor::channelImpulseResponse]) {
+        mainController->plotCir = new Plot();
+        mainController->plotCir->yLabel = "Power (dB)";
+        mainController->plotCir->xLabel = "Delay sample";
+        mainController->plotCir->title = "Power delay profile";
+        mainController->plotCir->yTicksMin = -40;
+        mainController->plotCir->yTicksMax = 80;
+        mainController->plotCir->init(plotBox);
+    }
+    if (processors[processor::dopplerSpectrogram]) {
+        mainController->plotDoppler = new Plot();
+        mainController->plotDoppler->yLabel = "Power (dB)";
+        mainController->plotDoppler->xLabel = "Doppler bin";
+        mainController->plotDoppler->title = "Doppler spectrum";
+        mainController->plotDoppler->yTicksMin = -40;
+        mainController->plotDoppler->yTicksMax = 80;
+        mainController->plotDoppler->init(plotBox);
+    }
     this->updatePlotsSourceId =
         gdk_threads_add_idle((GSourceFunc)MainController::updatePlots, nullptr);
 }
@@ -108,6 +128,22 @@ int MainController::updatePlots() {
 
     mainController->plotAmplitude->updateData(csiToPlot, &csiToPlot->magnitude);
     mainController->plotPhase->updateData(csiToPlot, &csiToPlot->phase);
+    if (mainController->plotCir && csiToPlot->cirLength) {
+        mainController->plotCir->updateData(csiToPlot, &csiToPlot->powerDelayProfile,
+                                            csiToPlot->cirLength);
+    }
+    if (mainController->plotDoppler) {
+        if (csiToPlot->dopplerLength) {
+            lastDopplerSpectrum = csiToPlot->dopplerSpectrum;
+        } else if (!lastDopplerSpectrum.empty()) {
+            csiToPlot->dopplerSpectrum = lastDopplerSpectrum;
+            csiToPlot->dopplerLength = Arguments::snapshot()->dopplerWindow;
+        }
+        if (csiToPlot->dopplerLength) {
+            mainController->plotDoppler->updateData(csiToPlot, &csiToPlot->dopplerSpectrum,
+                                                    csiToPlot->dopplerLength);
+        }
+    }
 
     return (TRUE);
 }
@@ -120,14 +156,15 @@ int MainController::updatePlots() {
  *          thread or not
  */
 void MainController::measureCsi(bool stop) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     if (stop) {
         this->measuring = false;
         pthread_cancel(this->measureCsiThread);
     } else {
         this->measuring = true;
         if (this->wifiController.setInterfaceFrequency(
-                MONITOR_INTERFACE_NAME, Arguments::arguments.frequency,
-                Arguments::arguments.bandwidth.c_str()) < 0) {
+                MONITOR_INTERFACE_NAME, args->frequency,
+                args->bandwidth.c_str()) < 0) {
             Logger::log(error) << "Failed to set frequency\n";
         };
         pthread_create(&this->measureCsiThread, NULL, &MainController::measureCsi, NULL);
@@ -143,14 +180,15 @@ void MainController::measureCsi(bool stop) {
  *          thread or not
  */
 void MainController::injectPackets(bool stop) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     if (stop) {
         this->injecting = false;
         pthread_cancel(this->injectPacketThread);
     } else {
         this->injecting = true;
         if (this->wifiController.setInterfaceFrequency(
-                MONITOR_INTERFACE_NAME, Arguments::arguments.frequency,
-                Arguments::arguments.bandwidth.c_str()) < 0) {
+                MONITOR_INTERFACE_NAME, args->frequency,
+                args->bandwidth.c_str()) < 0) {
             Logger::log(error) << "Failed to set frequency\n";
         };
         pthread_create(&this->injectPacketThread, NULL, &MainController::injectPackets, NULL);
@@ -164,6 +202,7 @@ void MainController::runGui() {
     Arguments::arguments.verbose = true;
     Arguments::arguments.measure = false;
     Arguments::arguments.inject = false;
+    Arguments::publish();
     gtk_init(NULL, NULL);
     Glib::init();
     this->plotAmplitude = new Plot();
@@ -180,8 +219,10 @@ void MainController::runGui() {
 }
 
 void MainController::runNoGui(bool detach) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     this->initInterface();
-    if (Arguments::arguments.plot) {
+    this->interfaceReady = true;
+    if (args->plot) {
         gtk_init(NULL, NULL);
         Glib::init();
         this->plotAmplitude = new Plot();
@@ -192,54 +233,79 @@ void MainController::runNoGui(bool detach) {
         auto builder = Gtk::Builder::create_from_string(layout);
         builder->get_widget_derived("MainWindow", this->mainWindow);
         this->initPlots();
-        if (Arguments::arguments.measure && !Arguments::arguments.ftm) {
+        if (args->measure && !args->ftm) {
             this->measureCsi();
         }
-        if (Arguments::arguments.inject && !Arguments::arguments.ftmResponder) {
+        if (args->inject && !args->ftmResponder) {
             this->injectPackets();
         }
         this->app->run(*this->mainWindow);
         return;
     }
 
-    if (Arguments::arguments.measure && !Arguments::arguments.ftm) {
+    this->startThreads(detach);
+}
+
+// Follows the clock coordinator of the arguments, every start command may change it
+void MainController::syncClock() {
+    const std::shared_ptr<const Args> snapshot = Arguments::snapshot();
+    const Args& args = *snapshot;
+    ClockSync& clock = ClockSync::getInstance();
+    if (args.clockSync == clock.getCoordinator() && args.clockInterval == clock.getInterval()) {
+        return;
+    }
+    if (args.clockSync.empty()) {
+        clock.stop();
+        return;
+    }
+    try {
+        clock.start(args.clockSync, args.clockInterval);
+    } catch (const std::exception& e) {
+        Logger::log(error) << e.what() << "\n";
+    }
+}
+
+void MainController::startThreads(bool detach) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
+    this->syncClock();
+    if (args->measure && !args->ftm) {
         this->measuring = true;
         pthread_create(&this->measureCsiThread, NULL, &MainController::measureCsi, NULL);
     }
-    if (Arguments::arguments.inject && !Arguments::arguments.ftmResponder) {
+    if (args->inject && !args->ftmResponder) {
         this->injecting = true;
         pthread_create(&this->injectPacketThread, NULL, &MainController::injectPackets, NULL);
     }
-    if (Arguments::arguments.ftm) {
+    if (args->ftm) {
         this->ftmEnabled = true;
         pthread_create(&this->ftmThread, NULL, &MainController::ftm, NULL);
     }
-    if (Arguments::arguments.ftmResponder) {
+    if (args->ftmResponder) {
         this->ftmResponderEnabled = true;
         pthread_create(&this->ftmResponderThread, NULL, &MainController::ftmResponder, NULL);
     }
-    if (Arguments::arguments.measure && !Arguments::arguments.ftm) {
+    if (args->measure && !args->ftm) {
         if (detach) {
             pthread_detach(this->measureCsiThread);
         } else {
             pthread_join(this->measureCsiThread, NULL);
         }
     }
-    if (Arguments::arguments.inject && !Arguments::arguments.ftmResponder) {
+    if (args->inject && !args->ftmResponder) {
         if (detach) {
             pthread_detach(this->injectPacketThread);
         } else {
             pthread_join(this->injectPacketThread, NULL);
         }
     }
-    if (Arguments::arguments.ftm) {
+    if (args->ftm) {
         if (detach) {
             pthread_detach(this->ftmThread);
         } else {
             pthread_join(this->ftmThread, NULL);
         }
     }
-    if (Arguments::arguments.ftmResponder) {
+    if (args->ftmResponder) {
         if (detach) {
             pthread_detach(this->ftmResponderThread);
         } else {
@@ -248,12 +314,129 @@ void MainController::runNoGui(bool detach) {
     }
 }
 
+/**
+ * Starts capture in the background, the monitor interface is created only
+ * when it does not exist yet, otherwise it is just tuned to the frequency.
+ */
+void MainController::startCapture() {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
+    if (args->plot) {
+        this->runNoGui(true);
+        return;
+    }
+    if (!this->interfaceReady) {
+        this->initInterface();
+        this->interfaceReady = true;
+    } else if (this->wifiController.setInterfaceFrequency(
+                   MONITOR_INTERFACE_NAME, args->frequency,
+                   args->bandwidth.c_str()) < 0) {
+        Logger::log(error) << "Failed to set frequency\n";
+    }
+    this->startThreads(true);
+}
+
+// Stops the capture threads, the monitor interface is kept for the next start
+void MainController::stopCapture() {
+    if (this->measuring) {
+        this->measureCsi(true);
+        try {
+            WiFiCsiController::enableCsi(false);
+        } catch (const std::exception& e) {
+            Logger::log(error) << e.what() << '\n';
+        }
+    }
+    if (this->injecting) {
+        this->injectPackets(true);
+    }
+    if (this->ftmEnabled) {
+        this->ftmEnabled = false;
+        pthread_cancel(this->ftmThread);
+    }
+    if (this->ftmResponderEnabled) {
+        this->ftmResponderEnabled = false;
+        pthread_cancel(this->ftmResponderThread);
+    }
+}
+
+// Settings of the monitor interface, changing them needs a new interface
+static bool interfaceChanged(const Args& a, const Args& b) {
+    return a.txPower != b.txPower || a.phy != b.phy || memcmp(a.mac, b.mac, sizeof(a.mac)) != 0;
+}
+
+// Arguments the capture thread reads from every new Arguments::snapshot, no restart needed
+static void copyLiveArguments(const Args& from, Args& to) {
+    to.verbose = from.verbose;
+    to.frequency = from.frequency;
+    to.bandwidth = from.bandwidth;
+    to.udpBatch = from.udpBatch;
+    to.udpFrame = from.udpFrame;
+    to.shmName = from.shmName;
+    to.shmSize = from.shmSize;
+    to.streamListen = from.streamListen;
+    to.streamBuffer = from.streamBuffer;
+    to.streamBackpressure = from.streamBackpressure;
+    to.multicastGroup = from.multicastGroup;
+    to.multicastTtl = from.multicastTtl;
+    to.multicastInterface = from.multicastInterface;
+    to.clockSync = from.clockSync;
+    to.clockInterval = from.clockInterval;
+    to.aggregator = from.aggregator;
+}
+
+/**
+ * Applies the arguments that changed since previous to a running capture
+ * with as little as possible: a new frequency only retunes the monitor
+ * interface, other capture settings restart the threads and only a changed
+ * interface setting recreates the interface.
+ */
+void MainController::reconfigure(const Args& previous) {
+    const std::shared_ptr<const Args> snapshot = Arguments::snapshot();
+    const Args& next = *snapshot;
+    this->syncClock();
+    if (this->interfaceReady && interfaceChanged(previous, next)) {
+        const bool capturing = this->isCapturing();
+        this->stopCapture();
+        this->restoreState();
+        if (capturing) {
+            this->startCapture();
+        }
+        return;
+    }
+    if (!this->isCapturing()) {
+        return;
+    }
+
+    Args unchanged = next;
+    copyLiveArguments(previous, unchanged);
+    if (!(unchanged == previous)) {
+        this->stopCapture();
+        this->startCapture();
+        return;
+    }
+
+    if (previous.frequency != next.frequency || previous.bandwidth != next.bandwidth) {
+        if (this->wifiController.setInterfaceFrequency(MONITOR_INTERFACE_NAME, next.frequency,
+                                                       next.bandwidth.c_str()) < 0) {
+            Logger::log(error) << "Failed to set frequency\n";
+        }
+    }
+}
+
+bool MainController::isCapturing() const {
+    return this->measuring || this->injecting || this->ftmEnabled || this->ftmResponderEnabled;
+}
+
+bool MainController::isInterfaceReady() const {
+    return this->interfaceReady;
+}
+
 void MainController::runUdpSocket() {
     this->udpSocket = new UdpSocket();
     udpSocket->init();
 }
 
 void MainController::initInterface() {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     try {
         // this->wifiController.killNetworkProcesses();
         Logger::log(info) << "Initializing the WiFi Controller\n";
@@ -274,9 +457,9 @@ void MainController::initInterface() {
 
         Logger::log(info) << "Using phy " << intel_phy << "\n";
 
-        this->wifiController.createMonitorInterface(intel_phy, Arguments::arguments.frequency,
-                                                    Arguments::arguments.txPower,
-                                                    Arguments::arguments.mac);
+        this->wifiController.createMonitorInterface(intel_phy, args->frequency,
+                                                    args->txPower,
+                                                    args->mac);
 
         Logger::log(info) << "Monitor interface created\n";
         std::this_thread::sleep_for(std::chrono::milliseconds(500));
@@ -322,6 +505,7 @@ void* MainController::measureCsi(void* arg) {
 }
 
 void* MainController::ftm(void* arg) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     bool firstRun = true;
     try {
         // if (MainController::getInstance()->wifiController.setInterfaceStatus(AP_INTERFACE_NAME,
@@ -331,11 +515,11 @@ void* MainController::ftm(void* arg) {
 
         WiFiFtmController wft;
         wft.init();
-        if (Arguments::arguments.measure) {
+        if (args->measure) {
             uint64_t startFtmTime = 0;
             while (1) {
                 std::this_thread::sleep_for(
-                    std::chrono::microseconds(Arguments::arguments.injectDelay));
+                    std::chrono::microseconds(args->injectDelay));
                 try {
                     wft.startInitiator();
                 } catch (const std::exception& e) {
@@ -352,14 +536,14 @@ void* MainController::ftm(void* arg) {
                 uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
                                    std::chrono::system_clock::now().time_since_epoch())
                                    .count();
-                if ((startFtmTime + (Arguments::arguments.modeDelay / 2)) > now) {
+                if ((startFtmTime + (args->modeDelay / 2)) > now) {
                     continue;
                 }
 
                 if (!wft.lastRttIsSuccess && !firstRun) {
                     MainController::getInstance()->measureCsi(false);
                     std::this_thread::sleep_for(
-                        std::chrono::milliseconds(Arguments::arguments.modeDelay));
+                        std::chrono::milliseconds(args->modeDelay));
                     MainController::getInstance()->measureCsi(true);
                     WiFiCsiController::enableCsi(false);
                     firstRun = true;
@@ -374,17 +558,17 @@ void* MainController::ftm(void* arg) {
                 }
             }
         } else {
-            if (Arguments::arguments.injectRepeat) {
-                for (uint32_t i = 0; i < Arguments::arguments.injectRepeat; i++) {
+            if (args->injectRepeat) {
+                for (uint32_t i = 0; i < args->injectRepeat; i++) {
                     wft.startInitiator();
                     std::this_thread::sleep_for(
-                        std::chrono::microseconds(Arguments::arguments.injectDelay));
+                        std::chrono::microseconds(args->injectDelay));
                 }
             } else {
                 while (true) {
                     wft.startInitiator();
                     std::this_thread::sleep_for(
-                        std::chrono::microseconds(Arguments::arguments.injectDelay));
+                        std::chrono::microseconds(args->injectDelay));
                 }
             }
         }
@@ -400,14 +584,15 @@ void* MainController::ftm(void* arg) {
 }
 
 void* MainController::ftmResponder(void* arg) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     WiFiFtmController wft;
     wft.init();
     try {
-        if (Arguments::arguments.inject) {
+        if (args->inject) {
             while (true) {
                 MainController::getInstance()->injectPackets(false);
                 std::this_thread::sleep_for(
-                    std::chrono::milliseconds(Arguments::arguments.modeDelay));
+                    std::chrono::milliseconds(args->modeDelay));
                 MainController::getInstance()->injectPackets(true);
 
                 if (MainController::getInstance()->wifiController.setInterfaceStatus(
@@ -421,10 +606,10 @@ void* MainController::ftmResponder(void* arg) {
                 };
 
                 std::this_thread::sleep_for(
-                    std::chrono::milliseconds(Arguments::arguments.modeDelay));
+                    std::chrono::milliseconds(args->modeDelay));
             }
         } else {
-            if (Arguments::arguments.verbose) {
+            if (args->verbose) {
                 Logger::log(info) << "FTM responder was started\n";
             }
         }
@@ -443,6 +628,7 @@ void* MainController::ftmResponder(void* arg) {
 }
 
 void* MainController::injectPackets(void* arg) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     try {
         // if (MainController::getInstance()->wifiController.setInterfaceStatus(AP_INTERFACE_NAME,
         //                                                                      false) < 0) {
@@ -454,17 +640,17 @@ void* MainController::injectPackets(void* arg) {
         };
 
         PacketInjector pi;
-        if (Arguments::arguments.injectRepeat) {
-            for (uint32_t i = 0; i < Arguments::arguments.injectRepeat; i++) {
+        if (args->injectRepeat) {
+            for (uint32_t i = 0; i < args->injectRepeat; i++) {
                 pi.inject();
                 std::this_thread::sleep_for(
-                    std::chrono::microseconds(Arguments::arguments.injectDelay));
+                    std::chrono::microseconds(args->injectDelay));
             }
         } else {
             while (true) {
                 pi.inject();
                 std::this_thread::sleep_for(
-                    std::chrono::microseconds(Arguments::arguments.injectDelay));
+                    std::chrono::microseconds(args->injectDelay));
             }
         }
     } catch (const std::exception& e) {
@@ -479,6 +665,7 @@ void* MainController::injectPackets(void* arg) {
 }
 
 void MainController::restoreState() {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     MainController* mainController = MainController::getInstance();
 
     if (mainController->measureCsiThread) {
@@ -487,11 +674,14 @@ void MainController::restoreState() {
     if (mainController->injectPacketThread) {
         pthread_cancel(mainController->injectPacketThread);
     }
+    mainController->measuring = false;
+    mainController->injecting = false;
+    mainController->interfaceReady = false;
 
     mainController->wifiController.deleteInterface(MONITOR_INTERFACE_NAME);
     // mainController->wifiController.deleteInterface(AP_INTERFACE_NAME);
     for (InterfaceInfo interface : mainController->interfacesToRestore) {
-        if (Arguments::arguments.verbose) {
+        if (args->verbose) {
             Logger::log(info) << "Recovering interface " << interface.ifName << "\n";
         }
         unsigned char mac[ETH_ALEN];
@@ -508,7 +698,7 @@ void MainController::restoreState() {
     mainController->interfacesToRestore.clear();
     mainController->wifiController.interfaces.clear();
 
-    if (Arguments::arguments.verbose) {
+    if (args->verbose) {
         Logger::log(info) << "Exiting recovery state...\n";
     }
 }
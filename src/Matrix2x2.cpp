@@ -0,0 +1,88 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Matrix2x2.h"
+#include <cmath>
+
+namespace matrix2x2 {
+void hermitianEigen(size_t n,
+                    const double* a,
+                    const double* d,
+                    const double* bRe,
+                    const double* bIm,
+                    double* lambda1,
+                    double* lambda2,
+                    std::complex<double>* vector) {
+    for (size_t i = 0; i < n; i++) {
+        const double mean = (a[i] + d[i]) / 2;
+        const double diff = (a[i] - d[i]) / 2;
+        const double b2 = bRe[i] * bRe[i] + bIm[i] * bIm[i];
+        const double r = std::sqrt(diff * diff + b2);
+        lambda1[i] = mean + r;
+        // Smaller eigenvalue from the determinant, no cancellation for
+        // badly conditioned matrices
+        lambda2[i] = lambda1[i] != 0 ? (a[i] * d[i] - b2) / lambda1[i] : 0;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        // (b, lambda1 - a) or (lambda1 - d, conj(b)), the better conditioned one
+        const double ea = lambda1[i] - a[i];
+        const double ed = lambda1[i] - d[i];
+        double v0Re, v0Im, v1Re, v1Im;
+        if (ed >= ea) {
+            // Rotated so that the first element is real
+            v0Re = ed;
+            v0Im = 0;
+            v1Re = bRe[i];
+            v1Im = -bIm[i];
+        } else {
+            const double b = std::sqrt(bRe[i] * bRe[i] + bIm[i] * bIm[i]);
+            const double scale = b != 0 ? ea / b : 0;
+            v0Re = b;
+            v0Im = 0;
+            v1Re = b != 0 ? scale * bRe[i] : 1;
+            v1Im = -scale * bIm[i];
+        }
+        double norm = std::sqrt(v0Re * v0Re + v1Re * v1Re + v1Im * v1Im);
+        if (norm == 0) {
+            v0Re = norm = 1;
+        }
+        vector[2 * i] = {v0Re / norm, v0Im};
+        vector[2 * i + 1] = {v1Re / norm, v1Im / norm};
+    }
+}
+
+void singularValues(size_t n,
+                    const std::complex<double>* h00,
+                    const std::complex<double>* h01,
+                    const std::complex<double>* h10,
+                    const std::complex<double>* h11,
+                    double* s1,
+                    double* s2) {
+    for (size_t i = 0; i < n; i++) {
+        // Eigenvalues of H^H H, s2 from |det H| = s1 * s2
+        const double a = std::norm(h00[i]) + std::norm(h10[i]);
+        const double d = std::norm(h01[i]) + std::norm(h11[i]);
+        const std::complex<double> b = std::conj(h00[i]) * h01[i] + std::conj(h10[i]) * h11[i];
+        const double diff = (a - d) / 2;
+        const double lambda = (a + d) / 2 + std::sqrt(diff * diff + std::norm(b));
+        s1[i] = std::sqrt(lambda);
+        s2[i] = s1[i] != 0 ? std::abs(h00[i] * h11[i] - h01[i] * h10[i]) / s1[i] : 0;
+    }
+}
+}  // namespace matrix2x2
@@ -0,0 +1,170 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MulticastSink.h"
+
+#include <net/if.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <ios>
+#include <stdexcept>
+#include "Logger.h"
+
+MulticastSink::MulticastSink(const std::string& group,
+                             uint32_t ttl,
+                             const std::string& interface,
+                             uint32_t mtu)
+    : group(group), mtu(mtu) {
+    const size_t separator = group.rfind(':');
+    if (separator == std::string::npos) {
+        throw std::invalid_argument("Multicast group " + group + " is not HOST:PORT");
+    }
+    std::string host = group.substr(0, separator);
+    const std::string port = group.substr(separator + 1);
+    if (host.size() > 1 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    struct addrinfo hints = {};
+    struct addrinfo* result;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    int s = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (s != 0) {
+        throw std::invalid_argument("Multicast group " + group + ": " + gai_strerror(s));
+    }
+    memcpy(&this->address, result->ai_addr, result->ai_addrlen);
+    this->addressLength = result->ai_addrlen;
+    const int family = result->ai_family;
+    freeaddrinfo(result);
+
+    const bool multicast =
+        family == AF_INET
+            ? IN_MULTICAST(ntohl(((struct sockaddr_in*)&this->address)->sin_addr.s_addr))
+            : IN6_IS_ADDR_MULTICAST(&((struct sockaddr_in6*)&this->address)->sin6_addr);
+    if (!multicast) {
+        throw std::invalid_argument("Address " + group + " is not a multicast group");
+    }
+
+    unsigned int index = 0;
+    if (!interface.empty()) {
+        index = if_nametoindex(interface.c_str());
+        if (!index) {
+            throw std::invalid_argument("Multicast interface " + interface + " does not exist");
+        }
+    }
+
+    this->fd = socket(family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (this->fd < 0) {
+        throw std::ios_base::failure(std::string("Multicast socket failed: ") +
+                                     std::strerror(errno));
+    }
+    int hops = ttl;
+    int loop = 1;
+    int ok;
+    if (family == AF_INET) {
+        struct ip_mreqn request = {};
+        request.imr_ifindex = index;
+        ok = setsockopt(this->fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops)) == 0 &&
+             setsockopt(this->fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) == 0 &&
+             (!index ||
+              setsockopt(this->fd, IPPROTO_IP, IP_MULTICAST_IF, &request, sizeof(request)) == 0);
+    } else {
+        ok = setsockopt(this->fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &hops, sizeof(hops)) == 0 &&
+             setsockopt(this->fd, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, &loop, sizeof(loop)) == 0 &&
+             (!index ||
+              setsockopt(this->fd, IPPROTO_IPV6, IPV6_MULTICAST_IF, &index, sizeof(index)) == 0);
+    }
+    if (!ok) {
+        const int err = errno;
+        ::close(this->fd);
+        throw std::ios_base::failure("Multicast options for " + group +
+                                     " failed: " + std::strerror(err));
+    }
+    Logger::log(info) << "Multicasting records to " << group << "\n";
+}
+
+MulticastSink::~MulticastSink() {
+    ::close(this->fd);
+}
+
+void MulticastSink::publish(const struct iovec* iov, int iovcnt) {
+    size_t size = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        size += iov[i].iov_len;
+    }
+    auto data = std::make_shared<std::vector<char>>();
+    data->reserve(size);
+    for (int i = 0; i < iovcnt; i++) {
+        const char* base = static_cast<const char*>(iov[i].iov_base);
+        data->insert(data->end(), base, base + iov[i].iov_len);
+    }
+
+    const StreamHistoryRecord* record = this->framer.add(std::move(data), this->mtu);
+    if (!record) {
+        this->stats.dropped++;
+        return;
+    }
+    const uint16_t count = record->fragmentCount;
+    this->headers.resize(count);
+    this->iovs.resize(2 * (size_t)count);
+    this->messages.resize(count);
+    for (uint16_t i = 0; i < count; i++) {
+        struct iovec* fragment = &this->iovs[2 * (size_t)i];
+        fragment[0] = {&this->headers[i], sizeof(StreamFrameHeader)};
+        this->framer.fragment(*record, i, 0, this->headers[i], fragment[1]);
+        struct msghdr& msg = this->messages[i].msg_hdr;
+        msg = {};
+        msg.msg_name = &this->address;
+        msg.msg_namelen = this->addressLength;
+        msg.msg_iov = fragment;
+        msg.msg_iovlen = 2;
+    }
+
+    this->stats.records++;
+    unsigned int done = 0;
+    while (done < count) {
+        int n = sendmmsg(this->fd, &this->messages[done], count - done, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // The rest of the record is lost either way, receivers report it
+            this->stats.dropped += count - done;
+            return;
+        }
+        for (int i = 0; i < n; i++) {
+            this->stats.bytes += this->messages[done + i].msg_len;
+        }
+        this->stats.datagrams += n;
+        done += n;
+    }
+}
+
+const MulticastStats& MulticastSink::getStats() const {
+    return this->stats;
+}
+
+void MulticastSink::logStats() {
+    Logger::log(info) << "Multicast " << this->group << " "
+                      << this->stats.records - this->lastStats.records << " records, "
+                      << this->stats.datagrams - this->lastStats.datagrams << " datagrams, "
+                      << this->stats.dropped << " dropped\n";
+    this->lastStats = this->stats;
+}
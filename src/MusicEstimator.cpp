@@ -0,0 +1,373 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MusicEstimator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#define SPEED_OF_LIGHT 299792458.0
+#define MUSIC_REFINE_POINTS 11
+#define JACOBI_MAX_SWEEPS 50
+
+typedef std::complex<double> cx;
+
+void MusicEstimator::configure(const MusicConfig& config) {
+    this->config = config;
+    this->config.window = std::max(config.window, 1u);
+    this->config.subCarriers = std::max(config.subCarriers, 4u);
+    this->config.smoothing = std::clamp(config.smoothing, 2u, this->config.subCarriers - 1);
+    this->config.maxPaths = std::max(config.maxPaths, 1u);
+    this->pool = std::make_unique<ThreadPool>(config.threads);
+    this->resamplers.clear();
+    this->windows.clear();
+}
+
+std::unique_ptr<DerivedRecord> MusicEstimator::update(const Csi& csi) {
+    // Angle is not observable with a single antenna
+    if (csi.numRx < 2) {
+        return nullptr;
+    }
+
+    uint64_t key = 0;
+    memcpy(&key, csi.rawHeaderData.srcMac, sizeof(csi.rawHeaderData.srcMac));
+    std::vector<MusicPacket>& window = this->windows[key];
+    window.push_back(this->prepare(csi));
+    if (window.size() < this->config.window) {
+        return nullptr;
+    }
+
+    if (!this->pool) {
+        this->pool = std::make_unique<ThreadPool>(this->config.threads);
+    }
+
+    const uint32_t maxPaths = this->config.maxPaths;
+    std::vector<double> values(window.size() * maxPaths * 3, NAN);
+    this->pool->parallelFor(window.size(), [&](size_t i) {
+        std::vector<MusicPath> paths = this->estimate(window[i]);
+        for (size_t p = 0; p < paths.size() && p < maxPaths; p++) {
+            double* out = &values[(i * maxPaths + p) * 3];
+            out[0] = paths[p].aoa;
+            out[1] = paths[p].tof;
+            out[2] = paths[p].power;
+        }
+    });
+
+    std::unique_ptr<DerivedRecord> record = std::make_unique<DerivedRecord>(DERIVED_AOA_TOF, csi);
+    record->header.numRx = 1;
+    record->header.numTx = 1;
+    record->header.numSubCarriers = this->config.subCarriers;
+    record->header.numRecords = window.size();
+    record->setValues(values, values.size());
+    window.clear();
+    return record;
+}
+
+MusicPacket MusicEstimator::prepare(const Csi& csi) {
+    const std::vector<double> frequencies = Resampler::subcarrierFrequencies(csi);
+    const std::pair<double, double> span(frequencies.front(), frequencies.back());
+    auto it = this->resamplers.find(span);
+    if (it == this->resamplers.end()) {
+        ResampleGrid grid = {span.first, span.second, this->config.subCarriers};
+        it = this->resamplers.emplace(span, Resampler(grid)).first;
+    }
+
+    MusicPacket packet;
+    packet.numRx = csi.numRx;
+    packet.numTx = csi.numTx;
+    packet.spacing = (span.second - span.first) / (this->config.subCarriers - 1) * 1e6;
+    it->second.resample(csi, packet.csi);
+    this->sanitize(packet);
+    return packet;
+}
+
+// Removes the phase slope common to all rx chains of a tx chain (SpotFi algorithm 1)
+void MusicEstimator::sanitize(MusicPacket& packet) const {
+    const uint32_t k = this->config.subCarriers;
+    const double center = (k - 1) / 2.0;
+    double den = 0;
+    for (uint32_t n = 0; n < k; n++) {
+        den += (n - center) * (n - center);
+    }
+    den *= packet.numRx;
+
+    for (uint32_t tx = 0; tx < packet.numTx; tx++) {
+        double num = 0;
+        for (uint32_t rx = 0; rx < packet.numRx; rx++) {
+            const cx* h = &packet.csi[(rx * packet.numTx + tx) * k];
+            double phase = std::arg(h[0]);
+            num += -center * phase;
+            for (uint32_t n = 1; n < k; n++) {
+                phase += std::remainder(std::arg(h[n]) - std::arg(h[n - 1]), 2 * M_PI);
+                num += (n - center) * phase;
+            }
+        }
+
+        const double slope = num / den;
+        for (uint32_t rx = 0; rx < packet.numRx; rx++) {
+            cx* h = &packet.csi[(rx * packet.numTx + tx) * k];
+            for (uint32_t n = 0; n < k; n++) {
+                h[n] *= std::polar(1.0, -slope * n);
+            }
+        }
+    }
+}
+
+std::vector<MusicPath> MusicEstimator::estimate(const MusicPacket& packet) const {
+    const uint32_t k = this->config.subCarriers;
+    const uint32_t ms = this->config.smoothing;
+    const uint32_t ma = std::min(packet.numRx, 2u);
+    const uint32_t l = ma * ms;
+
+    // Smoothed covariance, every antenna and subcarrier shift of the subarray
+    std::vector<cx> covariance(l * l, 0);
+    std::vector<cx> x(l);
+    for (uint32_t tx = 0; tx < packet.numTx; tx++) {
+        for (uint32_t p = 0; p + ma <= packet.numRx; p++) {
+            for (uint32_t q = 0; q + ms <= k; q++) {
+                for (uint32_t a = 0; a < ma; a++) {
+                    const cx* h = &packet.csi[((p + a) * packet.numTx + tx) * k + q];
+                    std::copy(h, h + ms, &x[a * ms]);
+                }
+                for (uint32_t i = 0; i < l; i++) {
+                    for (uint32_t j = 0; j < l; j++) {
+                        covariance[i * l + j] += x[i] * std::conj(x[j]);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<double> eigenvalues;
+    std::vector<cx> eigenvectors;
+    hermitianEigen(covariance, l, eigenvalues, eigenvectors);
+    if (eigenvalues[0] <= 0) {
+        return {};
+    }
+
+    uint32_t signals = 0;
+    while (signals < l - 1 &&
+           eigenvalues[signals] > this->config.signalThreshold * eigenvalues[0]) {
+        signals++;
+    }
+    signals = std::max(signals, 1u);
+
+    // Noise subspace projector, reused by every point of the search
+    std::vector<cx> projector(l * l, 0);
+    for (uint32_t e = signals; e < l; e++) {
+        for (uint32_t i = 0; i < l; i++) {
+            const cx vi = eigenvectors[i * l + e];
+            for (uint32_t j = 0; j < l; j++) {
+                projector[i * l + j] += vi * std::conj(eigenvectors[j * l + e]);
+            }
+        }
+    }
+
+    std::vector<double> aoas, tofs;
+    for (double aoa = -90; aoa <= 90; aoa += this->config.aoaStep) {
+        aoas.push_back(aoa);
+    }
+    for (double tof = this->config.tofMin; tof <= this->config.tofMax; tof += this->config.tofStep) {
+        tofs.push_back(tof);
+    }
+    const std::vector<double> coarse = this->spectrum(projector, ma, packet.spacing, aoas, tofs);
+
+    // Local maxima of the coarse grid
+    const int na = aoas.size();
+    const int nt = tofs.size();
+    std::vector<uint32_t> peaks;
+    for (int t = 0; t < nt; t++) {
+        for (int a = 0; a < na; a++) {
+            const double v = coarse[t * na + a];
+            bool peak = true;
+            for (int dt = -1; dt <= 1 && peak; dt++) {
+                for (int da = -1; da <= 1 && peak; da++) {
+                    const int tt = t + dt;
+                    const int aa = a + da;
+                    if ((dt || da) && tt >= 0 && tt < nt && aa >= 0 && aa < na &&
+                        coarse[tt * na + aa] > v) {
+                        peak = false;
+                    }
+                }
+            }
+            if (peak) {
+                peaks.push_back(t * na + a);
+            }
+        }
+    }
+    std::sort(peaks.begin(), peaks.end(),
+              [&](uint32_t i, uint32_t j) { return coarse[i] > coarse[j]; });
+    peaks.resize(std::min<size_t>(peaks.size(), std::min(signals, this->config.maxPaths)));
+
+    std::vector<MusicPath> paths;
+    for (uint32_t peak : peaks) {
+        const double aoa = aoas[peak % na];
+        const double tof = tofs[peak / na];
+        std::vector<double> fineAoas, fineTofs;
+        for (int i = 0; i < MUSIC_REFINE_POINTS; i++) {
+            const double f = 2.0 * i / (MUSIC_REFINE_POINTS - 1) - 1;
+            fineAoas.push_back(std::clamp(aoa + f * this->config.aoaStep, -90.0, 90.0));
+            fineTofs.push_back(tof + f * this->config.tofStep);
+        }
+        const std::vector<double> fine =
+            this->spectrum(projector, ma, packet.spacing, fineAoas, fineTofs);
+        const size_t best = std::max_element(fine.begin(), fine.end()) - fine.begin();
+        paths.push_back({fineAoas[best % MUSIC_REFINE_POINTS],
+                         fineTofs[best / MUSIC_REFINE_POINTS], 10 * log10(fine[best])});
+    }
+    return paths;
+}
+
+/**
+ * Pseudo spectrum 1 / (a^H P a) over tofs x aoas. The steering vector is the
+ * Kronecker product of the antenna and subcarrier parts, so the subcarrier
+ * part is applied once per ToF, leaving an antennas x antennas form per angle.
+ */
+std::vector<double> MusicEstimator::spectrum(const std::vector<cx>& projector,
+                                             uint32_t antennas,
+                                             double spacing,
+                                             const std::vector<double>& aoas,
+                                             const std::vector<double>& tofs) const {
+    const uint32_t ms = this->config.smoothing;
+    const uint32_t l = antennas * ms;
+    const size_t na = aoas.size();
+
+    std::vector<cx> phi(na * antennas);
+    for (size_t i = 0; i < na; i++) {
+        const double shift = 2 * M_PI * this->config.antennaSpacing *
+                             sin(aoas[i] * M_PI / 180) * this->config.frequency / SPEED_OF_LIGHT;
+        for (uint32_t a = 0; a < antennas; a++) {
+            phi[i * antennas + a] = std::polar(1.0, -shift * a);
+        }
+    }
+
+    std::vector<double> result(tofs.size() * na);
+    std::vector<cx> omega(ms), v(l), q(antennas * antennas);
+    for (size_t t = 0; t < tofs.size(); t++) {
+        for (uint32_t s = 0; s < ms; s++) {
+            omega[s] = std::polar(1.0, -2 * M_PI * s * spacing * tofs[t] * 1e-9);
+        }
+        for (uint32_t a2 = 0; a2 < antennas; a2++) {
+            for (uint32_t i = 0; i < l; i++) {
+                const cx* row = &projector[i * l + a2 * ms];
+                cx sum = 0;
+                for (uint32_t s = 0; s < ms; s++) {
+                    sum += row[s] * omega[s];
+                }
+                v[i] = sum;
+            }
+            for (uint32_t a1 = 0; a1 < antennas; a1++) {
+                cx sum = 0;
+                for (uint32_t s = 0; s < ms; s++) {
+                    sum += std::conj(omega[s]) * v[a1 * ms + s];
+                }
+                q[a1 * antennas + a2] = sum;
+            }
+        }
+
+        for (size_t i = 0; i < na; i++) {
+            const cx* p = &phi[i * antennas];
+            double den = 0;
+            for (uint32_t a1 = 0; a1 < antennas; a1++) {
+                for (uint32_t a2 = 0; a2 < antennas; a2++) {
+                    den += (std::conj(p[a1]) * q[a1 * antennas + a2] * p[a2]).real();
+                }
+            }
+            result[t * na + i] = 1 / std::max(den, 1e-12);
+        }
+    }
+    return result;
+}
+
+/**
+ * Cyclic Jacobi eigen decomposition of a Hermitian n x n matrix (row major,
+ * destroyed). Eigenvalues are sorted descending, vectors[i * n + k] is the
+ * i-th element of the k-th eigenvector.
+ */
+void MusicEstimator::hermitianEigen(std::vector<cx>& a,
+                                    uint32_t n,
+                                    std::vector<double>& values,
+                                    std::vector<cx>& vectors) {
+    std::vector<cx> v(n * n, 0);
+    for (uint32_t i = 0; i < n; i++) {
+        v[i * n + i] = 1;
+    }
+
+    for (int sweep = 0; sweep < JACOBI_MAX_SWEEPS; sweep++) {
+        double off = 0;
+        double total = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            for (uint32_t j = 0; j < n; j++) {
+                total += std::norm(a[i * n + j]);
+                off += i != j ? std::norm(a[i * n + j]) : 0;
+            }
+        }
+        if (off <= 1e-26 * total) {
+            break;
+        }
+
+        for (uint32_t p = 0; p + 1 < n; p++) {
+            for (uint32_t q = p + 1; q < n; q++) {
+                const cx apq = a[p * n + q];
+                const double absApq = std::abs(apq);
+                if (absApq < 1e-300) {
+                    continue;
+                }
+                const double tau = (a[q * n + q].real() - a[p * n + p].real()) / (2 * absApq);
+                const double t = (tau >= 0 ? 1 : -1) / (std::abs(tau) + std::sqrt(1 + tau * tau));
+                const double c = 1 / std::sqrt(1 + t * t);
+                const double s = t * c;
+                const cx e = apq / absApq;
+
+                // A = G^H A G, G = [[c, s e], [-s conj(e), c]] in rows/columns p, q
+                for (uint32_t k = 0; k < n; k++) {
+                    const cx akp = a[k * n + p];
+                    const cx akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * std::conj(e) * akq;
+                    a[k * n + q] = s * e * akp + c * akq;
+
+                    const cx vkp = v[k * n + p];
+                    const cx vkq = v[k * n + q];
+                    v[k * n + p] = c * vkp - s * std::conj(e) * vkq;
+                    v[k * n + q] = s * e * vkp + c * vkq;
+                }
+                for (uint32_t k = 0; k < n; k++) {
+                    const cx apk = a[p * n + k];
+                    const cx aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * e * aqk;
+                    a[q * n + k] = s * std::conj(e) * apk + c * aqk;
+                }
+            }
+        }
+    }
+
+    std::vector<uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&](uint32_t i, uint32_t j) { return a[i * n + i].real() > a[j * n + j].real(); });
+
+    values.resize(n);
+    vectors.resize(n * n);
+    for (uint32_t k = 0; k < n; k++) {
+        values[k] = a[order[k] * n + order[k]].real();
+        for (uint32_t i = 0; i < n; i++) {
+            vectors[i * n + k] = v[i * n + order[k]];
+        }
+    }
+}
@@ -0,0 +1,226 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "OnlinePca.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void OnlinePca::configure(uint32_t numComponents,
+                          uint32_t memory,
+                          uint32_t warmup,
+                          uint32_t basisPeriod,
+                          bool reconstruct) {
+    this->numComponents = std::max(numComponents, 1u);
+    this->memory = std::max(memory, 2u);
+    this->warmup = warmup;
+    this->basisPeriod = basisPeriod;
+    this->reconstruct = reconstruct;
+    this->states.clear();
+    this->last = nullptr;
+}
+
+std::unique_ptr<DerivedRecord> OnlinePca::update(Csi& csi) {
+    uint64_t key = 0;
+    memcpy(&key, csi.rawHeaderData.srcMac, sizeof(csi.rawHeaderData.srcMac));
+    PcaState& s = this->states[key];
+    this->last = &s;
+
+    if (s.numRx != csi.numRx || s.numTx != csi.numTx || s.numSubCarriers != csi.numSubCarriers) {
+        this->reset(s, csi);
+    }
+
+    const uint32_t d = s.dimension;
+    const uint32_t k = std::min(this->numComponents, d);
+    s.count++;
+    s.sinceBasis++;
+    const double n = std::min(s.count, this->memory);
+
+    double* u = this->residual.data();
+    for (uint32_t j = 0; j < d; j++) {
+        s.mean[j] += (csi.magnitude[j] - s.mean[j]) / n;
+        u[j] = csi.magnitude[j] - s.mean[j];
+    }
+
+    // CCIPCA: v_i += (u (u . v_i / |v_i|) - v_i) / n, then u loses its
+    // projection onto v_i before it updates the next component. A component
+    // starts from the first residual that is not zero
+    for (uint32_t i = 0; i < k; i++) {
+        double* v = &s.components[(size_t)i * d];
+        double norm = 0;
+        double dot = 0;
+        for (uint32_t j = 0; j < d; j++) {
+            norm += v[j] * v[j];
+            dot += u[j] * v[j];
+        }
+        if (norm == 0) {
+            std::copy(u, u + d, v);
+        } else {
+            const double w = dot / std::sqrt(norm);
+            for (uint32_t j = 0; j < d; j++) {
+                v[j] += (u[j] * w - v[j]) / n;
+            }
+        }
+
+        norm = 0;
+        dot = 0;
+        for (uint32_t j = 0; j < d; j++) {
+            norm += v[j] * v[j];
+            dot += u[j] * v[j];
+        }
+        if (norm > 0) {
+            const double p = dot / norm;
+            for (uint32_t j = 0; j < d; j++) {
+                u[j] -= p * v[j];
+            }
+        }
+    }
+    this->orthogonalize(s, k);
+
+    if (s.count < std::max(this->warmup, k)) {
+        return nullptr;
+    }
+
+    // Projections of the centered record onto the unit components
+    this->coefficients.assign(k, 0);
+    for (uint32_t i = 0; i < k; i++) {
+        const double* v = &s.components[(size_t)i * d];
+        double norm = 0;
+        double dot = 0;
+        for (uint32_t j = 0; j < d; j++) {
+            norm += v[j] * v[j];
+            dot += (csi.magnitude[j] - s.mean[j]) * v[j];
+        }
+        this->coefficients[i] = norm > 0 ? dot / std::sqrt(norm) : 0;
+    }
+
+    // The stage is marked transform, the graph computes complex CSI again
+    if (this->reconstruct) {
+        std::copy(s.mean.begin(), s.mean.end(), csi.magnitude.begin());
+        for (uint32_t i = 0; i < k; i++) {
+            const double* v = &s.components[(size_t)i * d];
+            double norm = 0;
+            for (uint32_t j = 0; j < d; j++) {
+                norm += v[j] * v[j];
+            }
+            if (norm == 0) {
+                continue;
+            }
+            const double c = this->coefficients[i] / std::sqrt(norm);
+            for (uint32_t j = 0; j < d; j++) {
+                csi.magnitude[j] += c * v[j];
+            }
+        }
+    }
+
+    std::unique_ptr<DerivedRecord> record = std::make_unique<DerivedRecord>(DERIVED_PCA, csi);
+    record->header.numRx = 1;
+    record->header.numTx = 1;
+    record->header.numSubCarriers = k;
+    record->setValues(this->coefficients, k);
+    return record;
+}
+
+void OnlinePca::clear() {
+    this->states.clear();
+    this->last = nullptr;
+}
+
+std::unique_ptr<DerivedRecord> OnlinePca::basis(const Csi& csi) {
+    PcaState* s = this->last;
+    if (!s || !this->basisPeriod || s->sinceBasis < this->basisPeriod ||
+        s->count < std::max(this->warmup, this->numComponents)) {
+        return nullptr;
+    }
+    s->sinceBasis = 0;
+
+    const uint32_t d = s->dimension;
+    const uint32_t k = std::min(this->numComponents, d);
+    std::vector<double> values(s->mean);
+    values.reserve((size_t)(k + 1) * d + k);
+    std::vector<double> eigenvalues(k);
+    for (uint32_t i = 0; i < k; i++) {
+        const double* v = &s->components[(size_t)i * d];
+        double norm = 0;
+        for (uint32_t j = 0; j < d; j++) {
+            norm += v[j] * v[j];
+        }
+        norm = std::sqrt(norm);
+        eigenvalues[i] = norm;
+        for (uint32_t j = 0; j < d; j++) {
+            values.push_back(norm > 0 ? v[j] / norm : 0);
+        }
+    }
+    values.insert(values.end(), eigenvalues.begin(), eigenvalues.end());
+
+    std::unique_ptr<DerivedRecord> record = std::make_unique<DerivedRecord>(DERIVED_PCA_BASIS, csi);
+    record->header.numRecords = std::min(s->count, this->memory);
+    record->setValues(values, d);
+    return record;
+}
+
+// Deflation leaves a bit of the strong components in the weak ones, Gram-Schmidt
+// keeps them orthogonal, norms (eigenvalues) are kept
+void OnlinePca::orthogonalize(PcaState& s, uint32_t k) {
+    const uint32_t d = s.dimension;
+    for (uint32_t i = 1; i < k; i++) {
+        double* v = &s.components[(size_t)i * d];
+        double before = 0;
+        for (uint32_t j = 0; j < d; j++) {
+            before += v[j] * v[j];
+        }
+        if (before == 0) {
+            continue;
+        }
+        for (uint32_t p = 0; p < i; p++) {
+            const double* q = &s.components[(size_t)p * d];
+            double norm = 0;
+            double dot = 0;
+            for (uint32_t j = 0; j < d; j++) {
+                norm += q[j] * q[j];
+                dot += v[j] * q[j];
+            }
+            if (norm == 0) {
+                continue;
+            }
+            for (uint32_t j = 0; j < d; j++) {
+                v[j] -= dot / norm * q[j];
+            }
+        }
+        double after = 0;
+        for (uint32_t j = 0; j < d; j++) {
+            after += v[j] * v[j];
+        }
+        const double scale = after > 0 ? std::sqrt(before / after) : 0;
+        for (uint32_t j = 0; j < d; j++) {
+            v[j] *= scale;
+        }
+    }
+}
+
+void OnlinePca::reset(PcaState& s, const Csi& csi) {
+    s.numRx = csi.numRx;
+    s.numTx = csi.numTx;
+    s.numSubCarriers = csi.numSubCarriers;
+    s.dimension = csi.numRx * csi.numTx * csi.numSubCarriers;
+    s.count = 0;
+    s.sinceBasis = 0;
+    s.mean.assign(s.dimension, 0);
+    s.components.assign((size_t)this->numComponents * s.dimension, 0);
+    this->residual.resize(std::max<size_t>(this->residual.size(), s.dimension));
+}
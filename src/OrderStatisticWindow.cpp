@@ -0,0 +1,195 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "OrderStatisticWindow.h"
+#include <algorithm>
+#include <random>
+
+void OrderStatisticWindow::reset(uint32_t numSeries, uint32_t windowSize) {
+    this->numSeries = numSeries;
+    this->windowSize = std::clamp(windowSize, 1u, (uint32_t)ORDER_STATISTIC_NIL - 1);
+    this->head = 0;
+    this->count = 0;
+
+    const size_t n = (size_t)numSeries * this->windowSize;
+    this->key.assign(n, 0);
+    this->left.assign(n, ORDER_STATISTIC_NIL);
+    this->right.assign(n, ORDER_STATISTIC_NIL);
+    this->size_.assign(n, 0);
+    this->root.assign(numSeries, ORDER_STATISTIC_NIL);
+
+    // Same heap priorities for every series, trees differ by their values
+    std::mt19937 generator(this->windowSize);
+    this->priority.resize(this->windowSize);
+    for (uint32_t& p : this->priority) {
+        p = generator();
+    }
+}
+
+void OrderStatisticWindow::push(uint32_t series, float value) {
+    Tree t = this->tree(series);
+    uint16_t& root = this->root[series];
+    const uint16_t slot = this->head;
+    if (this->count == this->windowSize) {
+        root = erase(t, root, slot);
+    }
+    t.key[slot] = value;
+    t.left[slot] = ORDER_STATISTIC_NIL;
+    t.right[slot] = ORDER_STATISTIC_NIL;
+    t.size[slot] = 1;
+    root = insert(t, root, slot);
+}
+
+void OrderStatisticWindow::advance() {
+    this->head = (this->head + 1) % this->windowSize;
+    this->count = std::min(this->count + 1, this->windowSize);
+}
+
+uint32_t OrderStatisticWindow::size(uint32_t series) const {
+    const uint16_t node = this->root[series];
+    return node == ORDER_STATISTIC_NIL ? 0 : this->size_[(size_t)series * this->windowSize + node];
+}
+
+float OrderStatisticWindow::select(uint32_t series, uint32_t k) const {
+    const size_t base = (size_t)series * this->windowSize;
+    uint16_t node = this->root[series];
+    while (true) {
+        const uint16_t l = this->left[base + node];
+        const uint32_t leftSize = l == ORDER_STATISTIC_NIL ? 0 : this->size_[base + l];
+        if (k < leftSize) {
+            node = l;
+        } else if (k == leftSize) {
+            return this->key[base + node];
+        } else {
+            k -= leftSize + 1;
+            node = this->right[base + node];
+        }
+    }
+}
+
+float OrderStatisticWindow::median(uint32_t series) const {
+    const uint32_t n = this->size(series);
+    if (n % 2) {
+        return this->select(series, n / 2);
+    }
+    return (this->select(series, n / 2 - 1) + this->select(series, n / 2)) / 2;
+}
+
+uint32_t OrderStatisticWindow::countBetween(uint32_t series, float low, float high) const {
+    if (!(low < high)) {
+        return 0;
+    }
+    return this->countLess(series, high, false) - this->countLess(series, low, true);
+}
+
+uint32_t OrderStatisticWindow::countLess(uint32_t series, float value, bool inclusive) const {
+    const size_t base = (size_t)series * this->windowSize;
+    uint32_t result = 0;
+    uint16_t node = this->root[series];
+    while (node != ORDER_STATISTIC_NIL) {
+        const float k = this->key[base + node];
+        if (k < value || (inclusive && k == value)) {
+            const uint16_t l = this->left[base + node];
+            result += 1 + (l == ORDER_STATISTIC_NIL ? 0 : this->size_[base + l]);
+            node = this->right[base + node];
+        } else {
+            node = this->left[base + node];
+        }
+    }
+    return result;
+}
+
+OrderStatisticWindow::Tree OrderStatisticWindow::tree(uint32_t series) {
+    const size_t base = (size_t)series * this->windowSize;
+    return {&this->key[base], &this->left[base], &this->right[base], &this->size_[base],
+            this->priority.data()};
+}
+
+// Ordered by value, ties by slot, so every node has a unique position
+bool OrderStatisticWindow::less(const Tree& t, uint16_t a, uint16_t b) {
+    return t.key[a] < t.key[b] || (t.key[a] == t.key[b] && a < b);
+}
+
+void OrderStatisticWindow::update(Tree& t, uint16_t node) {
+    t.size[node] = 1 + (t.left[node] == ORDER_STATISTIC_NIL ? 0 : t.size[t.left[node]]) +
+                   (t.right[node] == ORDER_STATISTIC_NIL ? 0 : t.size[t.right[node]]);
+}
+
+uint16_t OrderStatisticWindow::insert(Tree& t, uint16_t node, uint16_t id) {
+    if (node == ORDER_STATISTIC_NIL) {
+        return id;
+    }
+    if (t.priority[id] > t.priority[node]) {
+        split(t, node, id, t.left[id], t.right[id]);
+        update(t, id);
+        return id;
+    }
+    if (less(t, id, node)) {
+        t.left[node] = insert(t, t.left[node], id);
+    } else {
+        t.right[node] = insert(t, t.right[node], id);
+    }
+    t.size[node]++;
+    return node;
+}
+
+uint16_t OrderStatisticWindow::erase(Tree& t, uint16_t node, uint16_t id) {
+    if (node == id) {
+        return merge(t, t.left[node], t.right[node]);
+    }
+    if (less(t, id, node)) {
+        t.left[node] = erase(t, t.left[node], id);
+    } else {
+        t.right[node] = erase(t, t.right[node], id);
+    }
+    t.size[node]--;
+    return node;
+}
+
+uint16_t OrderStatisticWindow::merge(Tree& t, uint16_t a, uint16_t b) {
+    if (a == ORDER_STATISTIC_NIL) {
+        return b;
+    }
+    if (b == ORDER_STATISTIC_NIL) {
+        return a;
+    }
+    if (t.priority[a] > t.priority[b]) {
+        t.right[a] = merge(t, t.right[a], b);
+        update(t, a);
+        return a;
+    }
+    t.left[b] = merge(t, a, t.left[b]);
+    update(t, b);
+    return b;
+}
+
+// l gets the nodes ordered before id, r the rest
+void OrderStatisticWindow::split(Tree& t, uint16_t node, uint16_t id, uint16_t& l, uint16_t& r) {
+    if (node == ORDER_STATISTIC_NIL) {
+        l = r = ORDER_STATISTIC_NIL;
+        return;
+    }
+    if (less(t, node, id)) {
+        split(t, t.right[node], id, t.right[node], r);
+        l = node;
+    } else {
+        split(t, t.left[node], id, l, t.left[node]);
+        r = node;
+    }
+    update(t, node);
+}
@@ -31,86 +31,91 @@ uint8_t ieee80211Header[] = {0xe0, 0x80, 0x00, 0x00, 0x00, 0x16, 0xea, 0x12, 0x3
 uint8_t ieee80211Body[] = {};
 
 void PacketInjector::inject() {
-    if (Arguments::arguments.verbose) {
-        Logger::log(info) << "Injecting " << Arguments::arguments.format << "\n";
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
+    if (args->verbose) {
+        Logger::log(info) << "Injecting " << args->format << "\n";
     }
 
-    if (Arguments::arguments.format == "NOHT") {
+    if (args->format == "NOHT") {
         this->injectNoHT();
-    } else if (Arguments::arguments.format == "HT") {
+    } else if (args->format == "HT") {
         this->injectHT();
-    } else if (Arguments::arguments.format == "VHT") {
+    } else if (args->format == "VHT") {
         this->injectVHT();
-    } else if (Arguments::arguments.format == "HESU") {
+    } else if (args->format == "HESU") {
         this->injectHE();
     }
 }
 
 void PacketInjector::injectNoHT() {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     uint8_t mcs = 0;
-    if (RATE_LEGACY_RATE_MSK >= Arguments::arguments.mcs) {
-        mcs = RATE_LEGACY_RATE_MSK & Arguments::arguments.mcs;
+    if (RATE_LEGACY_RATE_MSK >= args->mcs) {
+        mcs = RATE_LEGACY_RATE_MSK & args->mcs;
     }
-    uint32_t rateNFlags = RATE_MCS_LEGACY_OFDM_MSK | mcs | Arguments::arguments.antenna;
+    uint32_t rateNFlags = RATE_MCS_LEGACY_OFDM_MSK | mcs | args->antenna;
 
     this->send(rateNFlags);
 }
 
 void PacketInjector::injectHT() {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     uint8_t mcs = 0;
-    if (RATE_HT_MCS_CODE_MSK >= Arguments::arguments.mcs) {
-        mcs = RATE_HT_MCS_CODE_MSK & Arguments::arguments.mcs;
+    if (RATE_HT_MCS_CODE_MSK >= args->mcs) {
+        mcs = RATE_HT_MCS_CODE_MSK & args->mcs;
     }
-    uint32_t rateNFlags = RATE_MCS_HT_MSK | mcs | Arguments::arguments.antenna |
-                          (Arguments::arguments.channelWidth == 40 ? RATE_MCS_CHAN_WIDTH_40 : 0) |
-                          (Arguments::arguments.spatialStreams == 2 ? SPATIAL_STREAM : 0) |
-                          (Arguments::arguments.spatialStreams == 2 ? RATE_MCS_ANT_AB_MSK : 0) |
-                          (Arguments::arguments.guardInterval == 400 ? RATE_MCS_SGI_MSK : 0) |
-                          (Arguments::arguments.coding == "LDPC" ? RATE_MCS_LDPC_MSK : 0);
+    uint32_t rateNFlags = RATE_MCS_HT_MSK | mcs | args->antenna |
+                          (args->channelWidth == 40 ? RATE_MCS_CHAN_WIDTH_40 : 0) |
+                          (args->spatialStreams == 2 ? SPATIAL_STREAM : 0) |
+                          (args->spatialStreams == 2 ? RATE_MCS_ANT_AB_MSK : 0) |
+                          (args->guardInterval == 400 ? RATE_MCS_SGI_MSK : 0) |
+                          (args->coding == "LDPC" ? RATE_MCS_LDPC_MSK : 0);
     this->send(rateNFlags);
 }
 
 void PacketInjector::injectVHT() {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     uint8_t mcs = 0;
-    if (RATE_MCS_CODE_MSK >= Arguments::arguments.mcs) {
-        mcs = RATE_MCS_CODE_MSK & Arguments::arguments.mcs;
+    if (RATE_MCS_CODE_MSK >= args->mcs) {
+        mcs = RATE_MCS_CODE_MSK & args->mcs;
     }
-    uint32_t rateNFlags = RATE_MCS_VHT_MSK | mcs | Arguments::arguments.antenna |
-                          (Arguments::arguments.channelWidth == 40 ? RATE_MCS_CHAN_WIDTH_40 : 0) |
-                          (Arguments::arguments.channelWidth == 80 ? RATE_MCS_CHAN_WIDTH_80 : 0) |
-                          (Arguments::arguments.channelWidth == 160 ? RATE_MCS_CHAN_WIDTH_160 : 0) |
-                          (Arguments::arguments.spatialStreams == 2 ? SPATIAL_STREAM : 0) |
-                          (Arguments::arguments.spatialStreams == 2 ? RATE_MCS_ANT_AB_MSK : 0) |
-                          (Arguments::arguments.guardInterval == 400 ? RATE_MCS_SGI_MSK : 0) |
-                          (Arguments::arguments.coding == "LDPC" ? RATE_MCS_LDPC_MSK : 0);
+    uint32_t rateNFlags = RATE_MCS_VHT_MSK | mcs | args->antenna |
+                          (args->channelWidth == 40 ? RATE_MCS_CHAN_WIDTH_40 : 0) |
+                          (args->channelWidth == 80 ? RATE_MCS_CHAN_WIDTH_80 : 0) |
+                          (args->channelWidth == 160 ? RATE_MCS_CHAN_WIDTH_160 : 0) |
+                          (args->spatialStreams == 2 ? SPATIAL_STREAM : 0) |
+                          (args->spatialStreams == 2 ? RATE_MCS_ANT_AB_MSK : 0) |
+                          (args->guardInterval == 400 ? RATE_MCS_SGI_MSK : 0) |
+                          (args->coding == "LDPC" ? RATE_MCS_LDPC_MSK : 0);
     this->send(rateNFlags);
 }
 
 void PacketInjector::injectHE() {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     uint8_t mcs = 0;
-    if (RATE_MCS_CODE_MSK >= Arguments::arguments.mcs) {
-        mcs = RATE_MCS_CODE_MSK & Arguments::arguments.mcs;
+    if (RATE_MCS_CODE_MSK >= args->mcs) {
+        mcs = RATE_MCS_CODE_MSK & args->mcs;
     }
 
     uint32_t ltf = 1;
-    if (Arguments::arguments.ltf == "2xLTF+0.8") {
+    if (args->ltf == "2xLTF+0.8") {
         ltf = 1;
-    } else if (Arguments::arguments.ltf == "2xLTF+1.6") {
+    } else if (args->ltf == "2xLTF+1.6") {
         ltf = 2;
-    } else if (Arguments::arguments.ltf == "4xLTF+3.2") {
+    } else if (args->ltf == "4xLTF+3.2") {
         ltf = 3;
-    } else if (Arguments::arguments.ltf == "4xLTF+0.8") {
+    } else if (args->ltf == "4xLTF+0.8") {
         ltf = 4;
     }
     ltf = (ltf << RATE_MCS_HE_GI_LTF_POS) & RATE_MCS_HE_GI_LTF_MSK;
 
-    uint32_t rateNFlags = RATE_MCS_HE_MSK | RATE_MCS_LDPC_MSK | mcs | Arguments::arguments.antenna |
+    uint32_t rateNFlags = RATE_MCS_HE_MSK | RATE_MCS_LDPC_MSK | mcs | args->antenna |
                           ltf |
-                          (Arguments::arguments.channelWidth == 40 ? RATE_MCS_CHAN_WIDTH_40 : 0) |
-                          (Arguments::arguments.channelWidth == 80 ? RATE_MCS_CHAN_WIDTH_80 : 0) |
-                          (Arguments::arguments.channelWidth == 160 ? RATE_MCS_CHAN_WIDTH_160 : 0) |
-                          (Arguments::arguments.spatialStreams == 2 ? SPATIAL_STREAM : 0) |
-                          (Arguments::arguments.spatialStreams == 2 ? RATE_MCS_ANT_AB_MSK : 0);
+                          (args->channelWidth == 40 ? RATE_MCS_CHAN_WIDTH_40 : 0) |
+                          (args->channelWidth == 80 ? RATE_MCS_CHAN_WIDTH_80 : 0) |
+                          (args->channelWidth == 160 ? RATE_MCS_CHAN_WIDTH_160 : 0) |
+                          (args->spatialStreams == 2 ? SPATIAL_STREAM : 0) |
+                          (args->spatialStreams == 2 ? RATE_MCS_ANT_AB_MSK : 0);
     this->send(rateNFlags);
 }
 
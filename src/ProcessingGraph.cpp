@@ -0,0 +1,831 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ProcessingGraph.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include "Arguments.h"
+#include "ChannelImpulseResponse.h"
+#include "CsiRatio.h"
+#include "CsiStatistics.h"
+#include "DopplerSpectrogram.h"
+#include "HampelFilter.h"
+#include "Logger.h"
+#include "MusicEstimator.h"
+#include "OnlinePca.h"
+#include "Resampler.h"
+#include "SpatialCovariance.h"
+#include "TofFusion.h"
+#include "TriggeredCapture.h"
+#include "interpolation.h"
+
+#define FUSED_BLOCK_SIZE ((size_t)256)
+
+typedef std::map<std::string, std::string> StageParams;
+
+static double paramDouble(const StageParams& params, const std::string& key, double fallback) {
+    auto it = params.find(key);
+    if (it == params.end()) {
+        return fallback;
+    }
+    size_t end;
+    double value = std::stod(it->second, &end);
+    if (end != it->second.size()) {
+        throw std::invalid_argument("Bad value of " + key + ": " + it->second);
+    }
+    return value;
+}
+
+// Counts and sizes, a negative value would wrap around when converted
+static uint32_t paramUnsigned(const StageParams& params,
+                              const std::string& key,
+                              uint32_t fallback) {
+    const double value = paramDouble(params, key, fallback);
+    if (value < 0 || value > UINT32_MAX || value != std::floor(value)) {
+        throw std::invalid_argument("Bad value of " + key + ": " + params.at(key) +
+                                    ", it must be a non-negative integer");
+    }
+    return value;
+}
+
+class InterpolateStage : public ProcessingStage {
+   public:
+    processor method;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override {
+        const std::vector<uint32_t> pilotIndices = csi.getPilotIndices();
+        uint32_t offset = 0;
+        for (uint32_t rx = 0; rx < csi.numRx; rx++) {
+            for (uint32_t tx = 0; tx < csi.numTx; tx++) {
+                for (uint32_t pilotIndice : pilotIndices) {
+                    uint32_t i = pilotIndice + offset;
+                    if (this->method == processor::interpolateLinear) {
+                        csi.magnitude[i] = interpolation::linearInterpolate(
+                            csi.magnitude[i - 1], csi.magnitude[i + 1], 0.5);
+                        csi.phase[i] =
+                            interpolation::linearInterpolate(csi.phase[i - 1], csi.phase[i + 1], 0.5);
+                    } else if (this->method == processor::interpolateCubic) {
+                        csi.magnitude[i] = interpolation::cubicInterpolate(
+                            csi.magnitude[i - 2], csi.magnitude[i - 1], csi.magnitude[i + 1],
+                            csi.magnitude[i + 2], 0.5);
+                        csi.phase[i] = interpolation::cubicInterpolate(
+                            csi.phase[i - 2], csi.phase[i - 1], csi.phase[i + 1], csi.phase[i + 2],
+                            0.5);
+                    } else if (this->method == processor::interpolateCosine) {
+                        csi.magnitude[i] = interpolation::cosineInterpolate(
+                            csi.magnitude[i - 1], csi.magnitude[i + 1], 0.5);
+                        csi.phase[i] =
+                            interpolation::cosineInterpolate(csi.phase[i - 1], csi.phase[i + 1], 0.5);
+                    }
+                }
+                offset += csi.numSubCarriers;
+            }
+        }
+    }
+};
+
+// WiFi-Based Real-Time Calibration-Free Passive Human Motion Detection
+class PhaseCalibrationStage : public ProcessingStage {
+   public:
+    void process(Csi& csi, UdpSocket* udpSocket) override {
+        std::vector<int> sk;
+        for (int i = (csi.numSubCarriers / 2); i >= 0; i--) {
+            sk.push_back(-i);
+        }
+        for (uint32_t i = 1; i <= (csi.numSubCarriers / 2); i++) {
+            sk.push_back(i);
+        }
+
+        csi.unwrapPhase();
+
+        uint32_t offset = 0;
+        for (uint32_t rx = 0; rx < csi.numRx; rx++) {
+            for (uint32_t tx = 0; tx < csi.numTx; tx++) {
+                uint32_t firstIndex = offset;
+                uint32_t lastIndex = offset + (csi.numSubCarriers - 1);
+
+                double sum = 0;
+                for (uint32_t i = firstIndex; i <= lastIndex; i++) {
+                    sum += csi.phase[i];
+                }
+
+                double a = (csi.phase[lastIndex] - csi.phase[firstIndex]) / (sk.back() - sk[0]);
+                double b = sum / csi.numSubCarriers;
+
+                uint32_t k = 0;
+                for (uint32_t i = firstIndex; i <= lastIndex; i++) {
+                    csi.phase[i] = csi.phase[i] - a * sk[k] - b;
+                    k++;
+                }
+
+                offset += csi.numSubCarriers;
+            }
+        }
+    }
+};
+
+class ResampleStage : public ProcessingStage {
+   public:
+    std::unique_ptr<Resampler> resampler;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override { this->resampler->resample(csi); }
+};
+
+class HampelStage : public ProcessingStage {
+   public:
+    HampelFilter filter;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override { this->filter.update(csi); }
+    void reset() override { this->filter.clear(); }
+};
+
+class UnwrapStage : public ProcessingStage {
+   public:
+    void process(Csi& csi, UdpSocket* udpSocket) override { csi.unwrapPhase(); }
+};
+
+class ScaleStage : public ProcessingStage {
+   public:
+    double factor = 1;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override {}
+    void apply(double* magnitude, double* phase, size_t count) override {
+        for (size_t i = 0; i < count; i++) {
+            magnitude[i] *= this->factor;
+        }
+    }
+};
+
+class DbStage : public ProcessingStage {
+   public:
+    void process(Csi& csi, UdpSocket* udpSocket) override {}
+    void apply(double* magnitude, double* phase, size_t count) override {
+        for (size_t i = 0; i < count; i++) {
+            magnitude[i] = 20 * log10(magnitude[i] + 1e-12);
+        }
+    }
+};
+
+class WrapPhaseStage : public ProcessingStage {
+   public:
+    void process(Csi& csi, UdpSocket* udpSocket) override {}
+    void apply(double* magnitude, double* phase, size_t count) override {
+        for (size_t i = 0; i < count; i++) {
+            phase[i] = remainder(phase[i], 2 * M_PI);
+        }
+    }
+};
+
+class CirStage : public ProcessingStage {
+   public:
+    uint32_t oversample = 1;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override {
+        ChannelImpulseResponse::compute(csi, this->oversample);
+        DerivedRecord record(DERIVED_CIR, csi);
+        record.setValues(csi.cir, csi.cirLength);
+        record.output(udpSocket);
+    }
+};
+
+class StatisticsStage : public ProcessingStage {
+   public:
+    CsiStatistics statistics;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override {
+        std::unique_ptr<DerivedRecord> snapshot = this->statistics.update(csi);
+        if (snapshot) {
+            snapshot->output(udpSocket);
+        }
+    }
+};
+
+class DopplerStage : public ProcessingStage {
+   public:
+    DopplerSpectrogram doppler;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override {
+        for (std::unique_ptr<DerivedRecord>& spectrum : this->doppler.update(csi)) {
+            spectrum->output(udpSocket);
+        }
+    }
+};
+
+class CovarianceStage : public ProcessingStage {
+   public:
+    SpatialCovariance covariance;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override {
+        std::unique_ptr<DerivedRecord> snapshot = this->covariance.update(csi);
+        if (snapshot) {
+            snapshot->output(udpSocket);
+        }
+    }
+};
+
+class MusicStage : public ProcessingStage {
+   public:
+    MusicEstimator music;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override {
+        std::unique_ptr<DerivedRecord> record = this->music.update(csi);
+        if (record) {
+            record->output(udpSocket);
+        }
+    }
+};
+
+class PcaStage : public ProcessingStage {
+   public:
+    OnlinePca pca;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override {
+        std::unique_ptr<DerivedRecord> record = this->pca.update(csi);
+        if (record) {
+            record->output(udpSocket);
+        }
+        std::unique_ptr<DerivedRecord> basis = this->pca.basis(csi);
+        if (basis) {
+            basis->output(udpSocket);
+        }
+    }
+    void reset() override { this->pca.clear(); }
+};
+
+class TofFusionStage : public ProcessingStage {
+   public:
+    TofFusion fusion;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override {
+        std::unique_ptr<DerivedRecord> record = this->fusion.update(csi);
+        if (record) {
+            record->output(udpSocket);
+        }
+    }
+};
+
+class RatioStage : public ProcessingStage {
+   public:
+    CsiRatio ratio;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override {
+        std::unique_ptr<DerivedRecord> record = this->ratio.compute(csi);
+        if (record) {
+            record->output(udpSocket);
+        }
+    }
+};
+
+class RawStage : public ProcessingStage {
+   public:
+    void process(Csi& csi, UdpSocket* udpSocket) override {
+        if (udpSocket) {
+            csi.sendUDP(udpSocket);
+        } else {
+            csi.save();
+        }
+    }
+};
+
+class TriggerStage : public ProcessingStage {
+   public:
+    TriggeredCapture capture;
+
+    void process(Csi& csi, UdpSocket* udpSocket) override { this->capture.update(csi, udpSocket); }
+};
+
+class ProcessedStage : public ProcessingStage {
+   public:
+    void process(Csi& csi, UdpSocket* udpSocket) override {
+        DerivedRecord record(DERIVED_PROCESSED, csi);
+        record.setValues(csi.csi, csi.numSubCarriers);
+        record.output(udpSocket);
+    }
+};
+
+std::unique_ptr<ProcessingGraph> ProcessingGraph::create() {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
+    if (!args->pipelineFile.empty()) {
+        return ProcessingGraph::fromFile(args->pipelineFile);
+    }
+    return ProcessingGraph::fromArguments();
+}
+
+std::unique_ptr<ProcessingGraph> ProcessingGraph::fromFile(const std::string& path) {
+    std::ifstream ifs(path);
+    if (ifs.fail()) {
+        throw std::ios_base::failure("Open pipeline file " + path +
+                                     " failed: " + std::string(std::strerror(errno)));
+    }
+
+    std::unique_ptr<ProcessingGraph> graph = std::make_unique<ProcessingGraph>();
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(ifs, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream iss(line);
+        std::string type;
+        if (!(iss >> type)) {
+            continue;
+        }
+
+        StageParams params;
+        std::string token;
+        while (iss >> token) {
+            size_t eq = token.find('=');
+            if (eq == std::string::npos) {
+                throw std::invalid_argument(path + ":" + std::to_string(lineNumber) +
+                                            " expected key=value, got " + token);
+            }
+            params[token.substr(0, eq)] = token.substr(eq + 1);
+        }
+
+        try {
+            graph->add(type, params);
+        } catch (const std::exception& e) {
+            throw std::invalid_argument(path + ":" + std::to_string(lineNumber) + " " + e.what());
+        }
+    }
+
+    graph->compile();
+    return graph;
+}
+
+std::unique_ptr<ProcessingGraph> ProcessingGraph::fromArguments() {
+    std::unique_ptr<ProcessingGraph> graph = std::make_unique<ProcessingGraph>();
+    const std::shared_ptr<const Args> snapshot = Arguments::snapshot();
+    const Args& args = *snapshot;
+    std::map<processor, bool> processors = args.processors;
+
+    if (processors[processor::interpolateLinear]) {
+        graph->add("interpolate", {{"method", "linear"}});
+    } else if (processors[processor::interpolateCubic]) {
+        graph->add("interpolate", {{"method", "cubic"}});
+    } else if (processors[processor::interpolateCosine]) {
+        graph->add("interpolate", {{"method", "cosine"}});
+    }
+    if (processors[processor::phaseCalibrationLinearTransform]) {
+        graph->add("phaseCalibration", {});
+    }
+    if (processors[processor::resample]) {
+        graph->add("resample", {{"grid", args.resampleGrid},
+                                {"method", args.resampleCubic ? "cubic" : "linear"}});
+    }
+    if (processors[processor::hampel]) {
+        graph->add("hampel", {});
+    }
+    if (processors[processor::medianFilter]) {
+        graph->add("median", {});
+    }
+    if (args.rawOutput) {
+        if (processors[processor::trigger]) {
+            graph->add("trigger", {{"detector", args.triggerDetector}});
+        } else {
+            graph->add("raw", {});
+        }
+    }
+    if (processors[processor::csiRatio]) {
+        StageParams params = {{"pairs", args.ratioPairs},
+                              {"mode", args.ratioProduct ? "product" : "ratio"}};
+        if (args.ratioFloat) {
+            params["precision"] = "float";
+        }
+        graph->add("ratio", params);
+    }
+    if (processors[processor::channelImpulseResponse]) {
+        graph->add("cir", {});
+    }
+    if (processors[processor::statistics]) {
+        graph->add("statistics", {});
+    }
+    if (processors[processor::dopplerSpectrogram]) {
+        graph->add("doppler", {});
+    }
+    if (processors[processor::spatialCovariance]) {
+        graph->add("covariance", {});
+    }
+    if (processors[processor::music]) {
+        graph->add("music", {});
+    }
+    if (processors[processor::tofFusion]) {
+        graph->add("tofFusion", {});
+    }
+    if (processors[processor::pca]) {
+        graph->add("pca", {});
+    }
+
+    graph->compile();
+    return graph;
+}
+
+void ProcessingGraph::add(const std::string& type, const StageParams& params) {
+    std::unique_ptr<ProcessingStage> stage;
+    const std::shared_ptr<const Args> snapshot = Arguments::snapshot();
+    const Args& args = *snapshot;
+
+    if (type == "interpolate") {
+        auto s = std::make_unique<InterpolateStage>();
+        auto method = params.find("method");
+        std::string m = method == params.end() ? "linear" : method->second;
+        if (m == "linear") {
+            s->method = processor::interpolateLinear;
+        } else if (m == "cubic") {
+            s->method = processor::interpolateCubic;
+        } else if (m == "cosine") {
+            s->method = processor::interpolateCosine;
+        } else {
+            throw std::invalid_argument("Bad interpolation method " + m +
+                                        ". Possible values [linear|cubic|cosine]");
+        }
+        s->transform = true;
+        stage = std::move(s);
+    } else if (type == "phaseCalibration") {
+        stage = std::make_unique<PhaseCalibrationStage>();
+        stage->transform = true;
+    } else if (type == "resample") {
+        auto s = std::make_unique<ResampleStage>();
+        auto grid = params.find("grid");
+        if (grid == params.end()) {
+            throw std::invalid_argument("Resampling needs grid=FIRST:LAST:COUNT");
+        }
+        auto method = params.find("method");
+        std::string m = method == params.end() ? "linear" : method->second;
+        if (m != "linear" && m != "cubic") {
+            throw std::invalid_argument("Bad resampling method " + m +
+                                        ". Possible values [linear|cubic]");
+        }
+        s->resampler = std::make_unique<Resampler>(Resampler::parseGrid(grid->second), m == "cubic");
+        s->domain = DOMAIN_COMPLEX;
+        s->transform = true;
+        stage = std::move(s);
+    } else if (type == "hampel" || type == "median") {
+        auto s = std::make_unique<HampelStage>();
+        if (type == "hampel") {
+            s->filter.configure(paramUnsigned(params, "window", args.hampelWindow),
+                                paramDouble(params, "threshold", args.hampelThreshold),
+                                paramUnsigned(params, "threads", 0));
+        } else {
+            s->filter.configure(paramUnsigned(params, "window", args.medianWindow), 0,
+                                paramUnsigned(params, "threads", 0));
+        }
+        s->transform = true;
+        s->stateful = true;
+        stage = std::move(s);
+    } else if (type == "unwrap") {
+        stage = std::make_unique<UnwrapStage>();
+        stage->transform = true;
+    } else if (type == "scale") {
+        auto s = std::make_unique<ScaleStage>();
+        s->factor = paramDouble(params, "factor", 1);
+        s->transform = true;
+        s->elementWise = true;
+        stage = std::move(s);
+    } else if (type == "db") {
+        stage = std::make_unique<DbStage>();
+        stage->transform = true;
+        stage->elementWise = true;
+    } else if (type == "wrapPhase") {
+        stage = std::make_unique<WrapPhaseStage>();
+        stage->transform = true;
+        stage->elementWise = true;
+    } else if (type == "cir") {
+        auto s = std::make_unique<CirStage>();
+        s->oversample = paramUnsigned(params, "oversample", args.cirOversample);
+        if (s->oversample < 1 || s->oversample > 16) {
+            throw std::invalid_argument("Bad CIR oversample factor " + std::to_string(s->oversample) +
+                                        ". Possible values [1-16]");
+        }
+        s->domain = DOMAIN_COMPLEX;
+        stage = std::move(s);
+    } else if (type == "statistics") {
+        auto s = std::make_unique<StatisticsStage>();
+        std::vector<double> percentiles = args.statsPercentiles;
+        auto p = params.find("percentiles");
+        if (p != params.end()) {
+            percentiles.clear();
+            std::istringstream iss(p->second);
+            std::string token;
+            while (std::getline(iss, token, ',')) {
+                size_t end;
+                const double percentile = std::stod(token, &end);
+                if (end != token.size() || !(percentile >= 0 && percentile <= 100)) {
+                    throw std::invalid_argument("Bad percentile " + token +
+                                                ", it must be between 0 and 100");
+                }
+                percentiles.push_back(percentile);
+            }
+        }
+        s->statistics.configure(paramUnsigned(params, "window", args.statsWindow),
+                                paramUnsigned(params, "hop", args.statsHop), percentiles);
+        stage = std::move(s);
+    } else if (type == "doppler") {
+        auto s = std::make_unique<DopplerStage>();
+        s->doppler.configure(paramDouble(params, "rate", args.dopplerRate),
+                             paramUnsigned(params, "window", args.dopplerWindow),
+                             paramUnsigned(params, "hop", args.dopplerHop),
+                             paramUnsigned(params, "group", args.dopplerGroup),
+                             paramDouble(params, "ratio", args.dopplerRatio) != 0);
+        s->domain = DOMAIN_COMPLEX;
+        stage = std::move(s);
+    } else if (type == "covariance") {
+        auto s = std::make_unique<CovarianceStage>();
+        s->covariance.configure(paramUnsigned(params, "window", args.covarianceWindow),
+                                paramUnsigned(params, "hop", args.covarianceHop),
+                                paramUnsigned(params, "group", args.covarianceGroup),
+                                paramDouble(params, "rank", 0.01));
+        s->domain = DOMAIN_COMPLEX;
+        stage = std::move(s);
+    } else if (type == "music") {
+        auto s = std::make_unique<MusicStage>();
+        MusicConfig c;
+        c.window = paramUnsigned(params, "window", args.musicWindow);
+        c.subCarriers = paramUnsigned(params, "subcarriers", c.subCarriers);
+        c.smoothing = paramUnsigned(params, "smoothing", c.subCarriers / 2);
+        c.maxPaths = paramUnsigned(params, "paths", c.maxPaths);
+        c.antennaSpacing = paramDouble(params, "spacing", args.antennaSpacing);
+        c.frequency = paramDouble(params, "frequency", args.frequency) * 1e6;
+        c.aoaStep = paramDouble(params, "aoaStep", c.aoaStep);
+        c.tofMin = paramDouble(params, "tofMin", c.tofMin);
+        c.tofMax = paramDouble(params, "tofMax", c.tofMax);
+        c.tofStep = paramDouble(params, "tofStep", c.tofStep);
+        c.signalThreshold = paramDouble(params, "threshold", c.signalThreshold);
+        c.threads = paramUnsigned(params, "threads", c.threads);
+        if (c.aoaStep <= 0 || c.tofStep <= 0 || c.tofMax < c.tofMin) {
+            throw std::invalid_argument("Bad MUSIC search grid");
+        }
+        s->music.configure(c);
+        s->domain = DOMAIN_COMPLEX;
+        stage = std::move(s);
+    } else if (type == "tofFusion") {
+        auto s = std::make_unique<TofFusionStage>();
+        std::string ftmFile = args.ftmFile;
+        auto file = params.find("ftm");
+        if (file != params.end()) {
+            ftmFile = file->second;
+        } else if (ftmFile.empty() && !args.inputFile.empty()) {
+            // Recorded next to the CSI file
+            std::filesystem::path input(args.inputFile);
+            std::filesystem::path ftm = input.parent_path() / ("FTM_" + input.filename().string());
+            if (std::filesystem::exists(ftm)) {
+                ftmFile = ftm.string();
+            }
+        }
+        s->fusion.configure((uint64_t)paramUnsigned(params, "align", args.tofAlign) * 1000,
+                            paramUnsigned(params, "calibration", 16), ftmFile);
+        s->domain = DOMAIN_NONE;
+        stage = std::move(s);
+    } else if (type == "pca") {
+        auto s = std::make_unique<PcaStage>();
+        const bool reconstruct = paramDouble(params, "reconstruct", 0) != 0;
+        s->pca.configure(paramUnsigned(params, "components", args.pcaComponents),
+                         paramUnsigned(params, "memory", args.pcaMemory),
+                         paramUnsigned(params, "warmup", 100),
+                         paramUnsigned(params, "basis", args.pcaBasis), reconstruct);
+        // Replaces magnitude, complex CSI is computed again for later stages. The
+        // basis is learned from every record, so the result depends on the ones before
+        s->transform = reconstruct;
+        s->stateful = reconstruct;
+        stage = std::move(s);
+    } else if (type == "ratio") {
+        auto s = std::make_unique<RatioStage>();
+        auto pairs = params.find("pairs");
+        auto mode = params.find("mode");
+        std::string m = mode == params.end() ? "ratio" : mode->second;
+        if (m != "ratio" && m != "product") {
+            throw std::invalid_argument("Bad CSI ratio mode " + m +
+                                        ". Possible values [ratio|product]");
+        }
+        // Conjugate products of strong signals exceed the half precision range
+        auto precision = params.find("precision");
+        std::string p = precision == params.end() ? (m == "ratio" ? "half" : "float")
+                                                  : precision->second;
+        if (p != "half" && p != "float") {
+            throw std::invalid_argument("Bad CSI ratio precision " + p +
+                                        ". Possible values [half|float]");
+        }
+        s->ratio.configure(CsiRatio::parsePairs(pairs == params.end() ? "0:1" : pairs->second),
+                           m == "product", p == "half");
+        s->domain = DOMAIN_NONE;
+        stage = std::move(s);
+    } else if (type == "raw") {
+        stage = std::make_unique<RawStage>();
+        stage->domain = DOMAIN_NONE;
+    } else if (type == "trigger") {
+        auto s = std::make_unique<TriggerStage>();
+        auto detector = params.find("detector");
+        triggerDetector d = TriggeredCapture::parseDetector(
+            detector == params.end() ? args.triggerDetector : detector->second);
+        s->capture.configure(d, paramDouble(params, "threshold", args.triggerThreshold),
+                             paramDouble(params, "pre", args.triggerPre),
+                             paramDouble(params, "hold", args.triggerHold),
+                             paramDouble(params, "alpha", 0.1));
+        s->domain = d == TRIGGER_RATIO ? DOMAIN_COMPLEX : DOMAIN_POLAR;
+        stage = std::move(s);
+    } else if (type == "processed") {
+        stage = std::make_unique<ProcessedStage>();
+        stage->domain = DOMAIN_COMPLEX;
+    } else {
+        throw std::invalid_argument("Unknown processing stage " + type);
+    }
+
+    stage->name = type;
+    stage->config = type;
+    for (const auto& [key, value] : params) {
+        stage->config += " " + key + "=" + value;
+    }
+    this->stages.push_back(std::move(stage));
+}
+
+void ProcessingGraph::compile() {
+    this->steps = this->fuse(false);
+    this->transformSteps = this->fuse(true);
+    this->firstStatefulStep = 0;
+    while (this->firstStatefulStep < this->transformSteps.size() &&
+           !this->transformSteps[this->firstStatefulStep].stages.front()->stateful) {
+        this->firstStatefulStep++;
+    }
+}
+
+// FNV-1a
+static uint64_t hashCombine(uint64_t hash, const std::string& value) {
+    for (unsigned char c : value) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+std::vector<GraphStep> ProcessingGraph::fuse(bool transformOnly) {
+    std::vector<GraphStep> plan;
+    // Hash of a step covers its configuration and of all steps before it
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (std::unique_ptr<ProcessingStage>& stage : this->stages) {
+        if (transformOnly && !stage->transform) {
+            continue;
+        }
+        hash = hashCombine(hash, stage->config + "\n");
+        if (stage->elementWise && !plan.empty() && !plan.back().stages.empty() &&
+            plan.back().stages.back()->elementWise) {
+            plan.back().name += "+" + stage->name;
+            plan.back().stages.push_back(stage.get());
+            plan.back().hash = hash;
+            continue;
+        }
+        plan.push_back(GraphStep{.name = stage->name,
+                                 .stages = {stage.get()},
+                                 .domain = stage->domain,
+                                 .hash = hash});
+    }
+    return plan;
+}
+
+bool ProcessingGraph::empty() const {
+    return this->stages.empty();
+}
+
+void ProcessingGraph::transform(Csi& csi) {
+    const size_t cacheable = this->firstStatefulStep;
+    if (cacheable < this->transformSteps.size()) {
+        const uint64_t timestamp = csi.rawHeaderData.timestamp;
+        if (timestamp <= this->lastTransformed) {
+            for (GraphStep& step : this->transformSteps) {
+                if (step.stages.front()->stateful) {
+                    step.stages.front()->reset();
+                }
+            }
+        }
+        this->lastTransformed = timestamp;
+    }
+
+    // Longest already processed prefix of the plan is the starting point
+    size_t first = cacheable;
+    std::shared_ptr<const CsiLayer> layer;
+    while (first > 0 && !(layer = csi.cachedLayer(this->transformSteps[first - 1].hash))) {
+        first--;
+    }
+    if (!layer) {
+        layer = csi.baseLayer();
+    }
+    this->cacheHits += first == this->transformSteps.size();
+
+    csi.view(*layer);
+    bool polarValid = layer->polarValid;
+    bool complexValid = layer->complexValid;
+
+    for (size_t i = first; i < this->transformSteps.size(); i++) {
+        GraphStep& step = this->transformSteps[i];
+        this->runStep(step, csi, nullptr, polarValid, complexValid);
+        if (i + 1 < this->transformSteps.size() && i < cacheable) {
+            csi.cacheLayer(step.hash, csi.snapshot(polarValid, complexValid));
+        }
+    }
+
+    this->convertBoth(csi, polarValid, complexValid);
+    if (first < this->transformSteps.size() && cacheable == this->transformSteps.size()) {
+        csi.cacheLayer(this->transformSteps.back().hash, csi.snapshot(true, true));
+    }
+}
+
+void ProcessingGraph::run(Csi& csi, UdpSocket* udpSocket) {
+    // Both representations are consistent after loading
+    bool polarValid = true;
+    bool complexValid = true;
+    for (GraphStep& step : this->steps) {
+        this->runStep(step, csi, udpSocket, polarValid, complexValid);
+    }
+    this->convertBoth(csi, polarValid, complexValid);
+}
+
+void ProcessingGraph::timed(GraphStep& step, const std::function<void()>& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    step.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+    step.calls++;
+}
+
+void ProcessingGraph::runStep(GraphStep& step,
+                              Csi& csi,
+                              UdpSocket* udpSocket,
+                              bool& polarValid,
+                              bool& complexValid) {
+    if (step.domain == DOMAIN_COMPLEX && !complexValid) {
+        timed(this->toComplex, [&] { csi.magnitudePhaseToComplex(); });
+        complexValid = true;
+    } else if (step.domain == DOMAIN_POLAR && !polarValid) {
+        timed(this->toPolar, [&] { csi.recalcMagnitudePhase(); });
+        polarValid = true;
+    }
+
+    timed(step, [&] {
+        if (step.stages.front()->elementWise) {
+            const size_t size = csi.magnitude.size();
+            for (size_t i = 0; i < size; i += FUSED_BLOCK_SIZE) {
+                const size_t count = std::min(FUSED_BLOCK_SIZE, size - i);
+                for (ProcessingStage* stage : step.stages) {
+                    stage->apply(&csi.magnitude[i], &csi.phase[i], count);
+                }
+            }
+        } else {
+            step.stages.front()->process(csi, udpSocket);
+        }
+    });
+
+    if (step.stages.front()->transform) {
+        complexValid = step.domain == DOMAIN_COMPLEX;
+        polarValid = step.domain == DOMAIN_POLAR;
+    }
+}
+
+void ProcessingGraph::convertBoth(Csi& csi, bool polarValid, bool complexValid) {
+    if (!complexValid) {
+        timed(this->toComplex, [&] { csi.magnitudePhaseToComplex(); });
+    } else if (!polarValid) {
+        timed(this->toPolar, [&] { csi.recalcMagnitudePhase(); });
+    }
+}
+
+void ProcessingGraph::logTimings() {
+    auto log = [](const GraphStep& step) {
+        if (!step.calls) {
+            return;
+        }
+        Logger::log(info) << "Stage " << step.name << ": " << step.calls << " calls, "
+                          << (step.nanoseconds / step.calls) << " ns/call\n";
+    };
+    log(this->toPolar);
+    log(this->toComplex);
+    if (this->cacheHits) {
+        Logger::log(info) << "Processed CSI cache hits: " << this->cacheHits << "\n";
+    }
+    for (const GraphStep& step : this->steps) {
+        log(step);
+    }
+    for (const GraphStep& step : this->transformSteps) {
+        log(step);
+    }
+}
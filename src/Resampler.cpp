@@ -0,0 +1,155 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Resampler.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include "ChannelImpulseResponse.h"
+#include "rs.h"
+
+Resampler::Resampler(const ResampleGrid& grid, bool cubic) : grid(grid), cubic(cubic) {}
+
+void Resampler::resample(Csi& csi) {
+    std::vector<std::complex<double>> out;
+    this->resample(csi, out);
+    csi.csi = std::move(out);
+    csi.numSubCarriers = this->grid.count;
+}
+
+void Resampler::resample(const Csi& csi, std::vector<std::complex<double>>& out) {
+    const SparseWeights& w = this->getWeights(csi);
+    const uint32_t numChains = csi.numRx * csi.numTx;
+    const uint32_t count = this->grid.count;
+
+    out.resize(numChains * count);
+    for (uint32_t chain = 0; chain < numChains; chain++) {
+        const std::complex<double>* in = &csi.csi[chain * csi.numSubCarriers];
+        std::complex<double>* o = &out[chain * count];
+        for (uint32_t i = 0; i < count; i++) {
+            double re = 0;
+            double im = 0;
+            for (uint32_t k = w.rowStart[i]; k < w.rowStart[i + 1]; k++) {
+                re += w.weights[k] * in[w.columns[k]].real();
+                im += w.weights[k] * in[w.columns[k]].imag();
+            }
+            o[i] = {re, im};
+        }
+    }
+}
+
+ResampleGrid Resampler::parseGrid(const std::string& grid) {
+    std::istringstream iss(grid);
+    ResampleGrid g;
+    char c1, c2;
+    if (!(iss >> g.first >> c1 >> g.last >> c2 >> g.count) || c1 != ':' || c2 != ':' ||
+        !iss.eof()) {
+        throw std::invalid_argument("Bad resampling grid " + grid +
+                                    ", expected FIRST:LAST:COUNT in MHz");
+    }
+    if (g.count < 2 || g.last <= g.first) {
+        throw std::invalid_argument("Resampling grid needs at least 2 increasing frequencies");
+    }
+    return g;
+}
+
+std::vector<double> Resampler::subcarrierFrequencies(const Csi& csi) {
+    return subcarrierFrequencies(csi.format, csi.channelWidth, csi.numSubCarriers);
+}
+
+std::vector<double> Resampler::subcarrierFrequencies(uint32_t format,
+                                                     uint32_t channelWidth,
+                                                     uint32_t numSubCarriers) {
+    const ToneMap& toneMap = ChannelImpulseResponse::getToneMap(format, numSubCarriers);
+    const uint32_t widthMhz = 20 << (channelWidth >> RATE_MCS_CHAN_WIDTH_POS);
+    const double spacing = (double)widthMhz / toneMap.fftSize;
+
+    std::vector<double> frequencies;
+    frequencies.reserve(toneMap.tones.size());
+    for (int32_t tone : toneMap.tones) {
+        frequencies.push_back(tone * spacing);
+    }
+    return frequencies;
+}
+
+const SparseWeights& Resampler::getWeights(const Csi& csi) {
+    uint32_t format = csi.format == RATE_MCS_HE_MSK ? RATE_MCS_HE_MSK : 0;
+    uint64_t key = ((uint64_t)(format | csi.channelWidth) << 32) | csi.numSubCarriers;
+
+    auto it = this->weights.find(key);
+    if (it == this->weights.end()) {
+        it = this->weights.emplace(key, this->buildWeights(subcarrierFrequencies(csi))).first;
+    }
+    return it->second;
+}
+
+// Linear or cubic interpolation between neighbouring source subcarriers, the
+// edge values are held outside of the source band
+SparseWeights Resampler::buildWeights(const std::vector<double>& source) const {
+    SparseWeights w;
+    const uint32_t last = source.size() - 1;
+    const double step = (this->grid.last - this->grid.first) / (this->grid.count - 1);
+
+    w.rowStart.push_back(0);
+    for (uint32_t i = 0; i < this->grid.count; i++) {
+        const double f = this->grid.first + i * step;
+        std::map<uint32_t, double> row;
+
+        if (f <= source.front()) {
+            row[0] = 1;
+        } else if (f >= source.back()) {
+            row[last] = 1;
+        } else {
+            uint32_t j = std::upper_bound(source.begin(), source.end(), f) - source.begin() - 1;
+            const double mu = (f - source[j]) / (source[j + 1] - source[j]);
+            if (this->cubic) {
+                // Cubic Hermite with tangents from the actual subcarrier
+                // frequencies, exact for linear slopes also across null tones
+                const double mu2 = mu * mu;
+                const double mu3 = mu2 * mu;
+                const double d = source[j + 1] - source[j];
+                const double h00 = 2 * mu3 - 3 * mu2 + 1;
+                const double h10 = mu3 - 2 * mu2 + mu;
+                const double h01 = -2 * mu3 + 3 * mu2;
+                const double h11 = mu3 - mu2;
+                const uint32_t j0 = j == 0 ? 0 : j - 1;
+                const uint32_t j3 = std::min(j + 2, last);
+                const double t0 = h10 * d / (source[j + 1] - source[j0]);
+                const double t1 = h11 * d / (source[j3] - source[j]);
+                row[j] += h00;
+                row[j + 1] += h01;
+                row[j + 1] += t0;
+                row[j0] -= t0;
+                row[j3] += t1;
+                row[j] -= t1;
+            } else {
+                row[j] = 1 - mu;
+                row[j + 1] = mu;
+            }
+        }
+
+        for (const auto& [column, weight] : row) {
+            if (weight != 0) {
+                w.columns.push_back(column);
+                w.weights.push_back(weight);
+            }
+        }
+        w.rowStart.push_back(w.columns.size());
+    }
+    return w;
+}
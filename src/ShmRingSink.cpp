@@ -0,0 +1,166 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ShmRingSink.h"
+
+#include <climits>
+#include <cstring>
+#include <ios>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+ShmRingSink::ShmRingSink(const std::string& name, size_t size) : name(name) {
+    size_t capacity = SHM_RING_MIN_SIZE;
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    const size_t dataOffset = 4096;  // ring starts page aligned
+    this->length = dataOffset + capacity;
+
+    // A stale region of a writer that did not exit cleanly is replaced
+    const std::string path = "/" + name;
+    shm_unlink(path.c_str());
+    int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::ios_base::failure("Create shared memory " + name +
+                                     " failed: " + std::string(std::strerror(errno)));
+    }
+    if (ftruncate(fd, this->length) < 0) {
+        const int err = errno;
+        close(fd);
+        shm_unlink(path.c_str());
+        throw std::ios_base::failure("Resize shared memory " + name +
+                                     " failed: " + std::string(std::strerror(err)));
+    }
+    void* region = mmap(nullptr, this->length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) {
+        shm_unlink(path.c_str());
+        throw std::ios_base::failure("Map shared memory " + name +
+                                     " failed: " + std::string(std::strerror(errno)));
+    }
+
+    // Readers announce they sleep here, the ring itself stays read only for them
+    const std::string waitPath = path + ".wait";
+    shm_unlink(waitPath.c_str());
+    fd = shm_open(waitPath.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+    void* waitRegion = MAP_FAILED;
+    if (fd >= 0) {
+        // umask would take the write permission of other users again
+        if (fchmod(fd, 0666) == 0 && ftruncate(fd, sizeof(feitcsi_shm_waiters)) == 0) {
+            waitRegion = mmap(nullptr, sizeof(feitcsi_shm_waiters), PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, 0);
+        }
+        close(fd);
+    }
+    if (waitRegion == MAP_FAILED) {
+        const int err = errno;
+        munmap(region, this->length);
+        shm_unlink(path.c_str());
+        shm_unlink(waitPath.c_str());
+        throw std::ios_base::failure("Create shared memory " + name +
+                                     ".wait failed: " + std::string(std::strerror(err)));
+    }
+    this->waiters = static_cast<feitcsi_shm_waiters*>(waitRegion);
+
+    this->header = static_cast<feitcsi_shm_header*>(region);
+    this->ring = static_cast<uint8_t*>(region) + dataOffset;
+    this->header->version = FEITCSI_SHM_VERSION;
+    this->header->capacity = capacity;
+    this->header->dataOffset = dataOffset;
+    // Readers check magic, it is set once the rest is in place
+    __atomic_store_n(&this->header->magic, FEITCSI_SHM_MAGIC, __ATOMIC_RELEASE);
+}
+
+ShmRingSink::~ShmRingSink() {
+    __atomic_store_n(&this->header->closed, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&this->header->notify, 1, __ATOMIC_SEQ_CST);
+    syscall(SYS_futex, &this->header->notify, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    munmap(this->header, this->length);
+    munmap(this->waiters, sizeof(feitcsi_shm_waiters));
+    shm_unlink(("/" + this->name).c_str());
+    shm_unlink(("/" + this->name + ".wait").c_str());
+}
+
+void ShmRingSink::publish(const struct iovec* iov, int iovcnt, const StreamRecordInfo& info) {
+    size_t size = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        size += iov[i].iov_len;
+    }
+    const uint64_t capacity = this->header->capacity;
+    const uint64_t space = FEITCSI_SHM_RECORD_SPACE(size);
+    if (space > capacity / 2) {
+        this->dropped++;
+        return;
+    }
+
+    const uint64_t offset = this->position & (capacity - 1);
+    const uint64_t padding = offset + space > capacity ? capacity - offset : 0;
+    const uint64_t tail = this->position + padding + space;
+
+    // Readers see the bytes are taken before any of them changes
+    __atomic_store_n(&this->header->tail, tail, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (padding) {
+        this->writeRecord(this->position, padding - sizeof(feitcsi_shm_record),
+                          FEITCSI_SHM_PADDING, nullptr);
+        this->position += padding;
+    }
+    this->writeRecord(this->position, size, 0, &info);
+    uint8_t* data = this->ring + (this->position & (capacity - 1)) + sizeof(feitcsi_shm_record);
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(data, iov[i].iov_base, iov[i].iov_len);
+        data += iov[i].iov_len;
+    }
+    this->position = tail;
+
+    __atomic_store_n(&this->header->head, tail, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&this->header->records, this->sequence, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&this->header->notify, 1, __ATOMIC_SEQ_CST);
+    // A reader counted after this load sees the new head and does not sleep
+    if (__atomic_load_n(&this->waiters->count, __ATOMIC_SEQ_CST)) {
+        syscall(SYS_futex, &this->header->notify, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+}
+
+void ShmRingSink::writeRecord(uint64_t position,
+                              uint32_t size,
+                              uint16_t flags,
+                              const StreamRecordInfo* info) {
+    feitcsi_shm_record record = {};
+    record.size = size;
+    record.flags = flags;
+    if (info) {
+        record.format = info->format;
+        record.derivedType = info->derivedType;
+        record.sequence = this->sequence++;
+    }
+    memcpy(this->ring + (position & (this->header->capacity - 1)), &record, sizeof(record));
+}
+
+const std::string& ShmRingSink::getName() const {
+    return this->name;
+}
+
+uint64_t ShmRingSink::getDropped() const {
+    return this->dropped;
+}
@@ -0,0 +1,201 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SpatialCovariance.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "Matrix2x2.h"
+
+void CovarianceSums::assign(uint32_t numGroups) {
+    for (std::vector<double>* v : {&a, &d, &bRe, &bIm, &s1, &s2}) {
+        v->assign(numGroups, 0);
+    }
+}
+
+void CovarianceSums::add(const CovarianceSums& other, double sign) {
+    const size_t n = this->a.size();
+    for (size_t i = 0; i < n; i++) {
+        this->a[i] += sign * other.a[i];
+        this->d[i] += sign * other.d[i];
+        this->bRe[i] += sign * other.bRe[i];
+        this->bIm[i] += sign * other.bIm[i];
+        this->s1[i] += sign * other.s1[i];
+        this->s2[i] += sign * other.s2[i];
+    }
+}
+
+void SpatialCovariance::configure(uint32_t windowSize,
+                                  uint32_t hop,
+                                  uint32_t groupSize,
+                                  double rankThreshold) {
+    this->windowSize = std::max(windowSize, 1u);
+    this->hop = hop ? std::min(hop, this->windowSize) : this->windowSize;
+    this->groupSize = std::max(groupSize, 1u);
+    this->rankThreshold = rankThreshold;
+    this->windows.clear();
+}
+
+std::unique_ptr<DerivedRecord> SpatialCovariance::update(const Csi& csi) {
+    if (csi.numRx > 2 || csi.numTx > 2) {
+        return nullptr;
+    }
+
+    uint64_t key = 0;
+    memcpy(&key, csi.rawHeaderData.srcMac, sizeof(csi.rawHeaderData.srcMac));
+    CovarianceWindow& w = this->windows[key];
+
+    if (w.numRx != csi.numRx || w.numTx != csi.numTx || w.numSubCarriers != csi.numSubCarriers) {
+        this->reset(w, csi);
+    }
+
+    CovarianceSums& slot = w.ring[w.head];
+    const bool full = w.count == this->windowSize;
+    if (full) {
+        // Remove the oldest record, it is overwritten by the new one
+        w.sums.add(slot, -1);
+    } else {
+        w.count++;
+    }
+    this->accumulate(csi, w.numGroups, slot);
+    w.sums.add(slot, 1);
+
+    w.head = (w.head + 1) % this->windowSize;
+    w.sinceSnapshot++;
+    if (full && w.head == 0) {
+        this->recompute(w);
+    }
+
+    if (w.count < this->windowSize || w.sinceSnapshot < this->hop) {
+        return nullptr;
+    }
+
+    w.sinceSnapshot = 0;
+    std::unique_ptr<DerivedRecord> record = this->snapshot(w, csi);
+
+    if (this->hop == this->windowSize) {
+        this->reset(w, csi);
+    }
+    return record;
+}
+
+void SpatialCovariance::reset(CovarianceWindow& w, const Csi& csi) {
+    w.numRx = csi.numRx;
+    w.numTx = csi.numTx;
+    w.numSubCarriers = csi.numSubCarriers;
+    w.numGroups = (csi.numSubCarriers + this->groupSize - 1) / this->groupSize;
+    w.count = 0;
+    w.head = 0;
+    w.sinceSnapshot = 0;
+    w.ring.resize(this->windowSize);
+    for (CovarianceSums& sums : w.ring) {
+        sums.assign(w.numGroups);
+    }
+    w.sums.assign(w.numGroups);
+}
+
+void SpatialCovariance::recompute(CovarianceWindow& w) {
+    w.sums.assign(w.numGroups);
+    for (uint32_t n = 0; n < w.count; n++) {
+        w.sums.add(w.ring[n], 1);
+    }
+}
+
+void SpatialCovariance::accumulate(const Csi& csi, uint32_t numGroups, CovarianceSums& sums) {
+    const uint32_t n = csi.numSubCarriers;
+    this->zeros.assign(n, 0);
+    this->s1.resize(n);
+    this->s2.resize(n);
+    sums.assign(numGroups);
+
+    // Chain (rx, tx) as one value per subcarrier, zero for missing chains
+    auto chain = [&](uint32_t rx, uint32_t tx) -> const std::complex<double>* {
+        if (rx >= csi.numRx || tx >= csi.numTx) {
+            return this->zeros.data();
+        }
+        return &csi.csi[(rx * csi.numTx + tx) * n];
+    };
+
+    matrix2x2::singularValues(n, chain(0, 0), chain(0, 1), chain(1, 0), chain(1, 1),
+                              this->s1.data(), this->s2.data());
+
+    for (uint32_t tx = 0; tx < csi.numTx; tx++) {
+        const std::complex<double>* h0 = chain(0, tx);
+        const std::complex<double>* h1 = chain(1, tx);
+        for (uint32_t i = 0; i < n; i++) {
+            const uint32_t g = i / this->groupSize;
+            const std::complex<double> b = h0[i] * std::conj(h1[i]);
+            sums.a[g] += std::norm(h0[i]);
+            sums.d[g] += std::norm(h1[i]);
+            sums.bRe[g] += b.real();
+            sums.bIm[g] += b.imag();
+        }
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        const uint32_t g = i / this->groupSize;
+        sums.s1[g] += this->s1[i];
+        sums.s2[g] += this->s2[i];
+    }
+}
+
+std::unique_ptr<DerivedRecord> SpatialCovariance::snapshot(CovarianceWindow& w, const Csi& csi) {
+    const uint32_t numGroups = w.numGroups;
+    std::vector<double> a(numGroups), d(numGroups), bRe(numGroups), bIm(numGroups);
+    for (uint32_t g = 0; g < numGroups; g++) {
+        const uint32_t groupLength = std::min(this->groupSize, w.numSubCarriers - g * this->groupSize);
+        const double scale = 1.0 / ((double)w.count * groupLength * w.numTx);
+        a[g] = w.sums.a[g] * scale;
+        d[g] = w.sums.d[g] * scale;
+        bRe[g] = w.sums.bRe[g] * scale;
+        bIm[g] = w.sums.bIm[g] * scale;
+    }
+
+    std::vector<double> lambda1(numGroups), lambda2(numGroups);
+    std::vector<std::complex<double>> vector(2 * numGroups);
+    matrix2x2::hermitianEigen(numGroups, a.data(), d.data(), bRe.data(), bIm.data(),
+                              lambda1.data(), lambda2.data(), vector.data());
+
+    std::vector<double> values(numGroups * COVARIANCE_VALUES);
+    for (uint32_t g = 0; g < numGroups; g++) {
+        const uint32_t groupLength = std::min(this->groupSize, w.numSubCarriers - g * this->groupSize);
+        const double l2 = std::max(lambda2[g], 0.0);
+        const double s1 = w.sums.s1[g] / ((double)w.count * groupLength);
+        const double s2 = std::max(w.sums.s2[g], 0.0) / ((double)w.count * groupLength);
+
+        double* out = &values[g * COVARIANCE_VALUES];
+        out[0] = lambda1[g];
+        out[1] = l2;
+        out[2] = l2 > 0 ? lambda1[g] / l2 : INFINITY;
+        out[3] = (lambda1[g] > 0) + (lambda1[g] > 0 && l2 > this->rankThreshold * lambda1[g]);
+        out[4] = vector[2 * g].real();
+        out[5] = vector[2 * g].imag();
+        out[6] = vector[2 * g + 1].real();
+        out[7] = vector[2 * g + 1].imag();
+        out[8] = s1;
+        out[9] = s2;
+        out[10] = s2 > 0 ? s1 / s2 : INFINITY;
+    }
+
+    std::unique_ptr<DerivedRecord> record = std::make_unique<DerivedRecord>(DERIVED_COVARIANCE, csi);
+    record->header.numRx = 1;
+    record->header.numTx = 1;
+    record->header.numSubCarriers = numGroups;
+    record->header.numRecords = w.count;
+    record->setValues(values, numGroups * COVARIANCE_VALUES);
+    return record;
+}
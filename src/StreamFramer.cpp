@@ -0,0 +1,103 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StreamFramer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+StreamFramer::StreamFramer() {
+    std::random_device random;
+    do {
+        this->sessionId = random();
+    } while (!this->sessionId);
+}
+
+const StreamHistoryRecord* StreamFramer::add(StreamRecordData data, uint32_t mtu) {
+    const uint32_t payloadSize =
+        std::max<uint32_t>(mtu, STREAM_MIN_MTU) - sizeof(StreamFrameHeader);
+    const size_t count = std::max<size_t>(1, (data->size() + payloadSize - 1) / payloadSize);
+    if (count > UINT16_MAX || data->size() > STREAM_MAX_RECORD_SIZE) {
+        return nullptr;
+    }
+
+    if (this->history.size() >= STREAM_HISTORY_RECORDS) {
+        this->history.pop_front();
+    }
+    StreamHistoryRecord& record = this->history.emplace_back();
+    record.sequence = this->nextSequence++;
+    record.fragmentCount = count;
+    record.payloadSize = payloadSize;
+    record.data = std::move(data);
+    return &record;
+}
+
+void StreamFramer::fragment(const StreamHistoryRecord& record,
+                            uint16_t index,
+                            uint8_t flags,
+                            StreamFrameHeader& header,
+                            struct iovec& payload) const {
+    header.magic = STREAM_MAGIC;
+    header.version = STREAM_VERSION;
+    header.flags = flags;
+    header.headerSize = sizeof(StreamFrameHeader);
+    header.sessionId = this->sessionId;
+    header.sequence = record.sequence;
+    header.fragmentIndex = index;
+    header.fragmentCount = record.fragmentCount;
+    header.recordSize = record.data->size();
+    header.fragmentOffset = (size_t)index * record.payloadSize;
+
+    payload.iov_base = const_cast<char*>(record.data->data()) + header.fragmentOffset;
+    payload.iov_len =
+        std::min<size_t>(record.payloadSize, header.recordSize - header.fragmentOffset);
+}
+
+bool StreamFramer::resend(
+    const char* buf,
+    size_t size,
+    const std::function<void(const StreamHistoryRecord&, uint16_t)>& send) const {
+    StreamNackHeader h;
+    if (size < sizeof(h)) {
+        return false;
+    }
+    memcpy(&h, buf, sizeof(h));
+    if (h.magic != STREAM_NACK_MAGIC) {
+        return false;
+    }
+    if (h.sessionId != this->sessionId) {
+        return true;
+    }
+
+    const size_t count = std::min<size_t>(h.count, (size - sizeof(h)) / sizeof(uint16_t));
+    for (const StreamHistoryRecord& record : this->history) {
+        if (record.sequence != h.sequence) {
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            uint16_t index;
+            memcpy(&index, buf + sizeof(h) + i * sizeof(uint16_t), sizeof(index));
+            if (index < record.fragmentCount) {
+                send(record, index);
+            }
+        }
+        break;
+    }
+    return true;
+}
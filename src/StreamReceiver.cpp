@@ -0,0 +1,251 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StreamReceiver.h"
+#include <net/if.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+// Records that have to arrive before missing fragments are requested again
+#define STREAM_NACK_SPACING 4
+
+StreamReceiver::StreamReceiver(uint32_t window, uint32_t maxNacks)
+    : window(std::max(window, 1u)), maxNacks(maxNacks) {}
+
+void StreamReceiver::receive(const uint8_t* datagram, size_t size) {
+    StreamFrameHeader h;
+    if (size < sizeof(h)) {
+        this->stats.invalid++;
+        return;
+    }
+    memcpy(&h, datagram, sizeof(h));
+    const size_t payload = size - std::min<size_t>(h.headerSize, size);
+    if (h.magic != STREAM_MAGIC || h.version != STREAM_VERSION || h.headerSize < sizeof(h) ||
+        h.headerSize > size || h.fragmentCount == 0 || h.fragmentIndex >= h.fragmentCount ||
+        (uint64_t)h.fragmentOffset + payload > h.recordSize) {
+        this->stats.invalid++;
+        return;
+    }
+    // The record is allocated at its first fragment, a forged size must not exhaust memory
+    if (h.recordSize > STREAM_MAX_RECORD_SIZE ||
+        h.recordSize > (uint64_t)h.fragmentCount * (STREAM_MAX_MTU - sizeof(h))) {
+        this->stats.invalid++;
+        return;
+    }
+    this->stats.datagrams++;
+
+    if (!this->started || h.sessionId != this->sessionId) {
+        if (this->started) {
+            this->finish();
+        }
+        this->started = true;
+        this->sessionId = h.sessionId;
+        this->floor = h.sequence;
+        this->highest = h.sequence;
+        this->stats.sessions++;
+    }
+
+    const uint64_t sequence = this->highest + (int32_t)(h.sequence - (uint32_t)this->highest);
+    if (sequence < this->floor) {
+        this->stats.duplicates++;
+        return;
+    }
+    this->highest = std::max(this->highest, sequence);
+
+    PendingRecord& p = this->pending[sequence];
+    if (p.fragmentCount == 0) {
+        p.fragmentCount = h.fragmentCount;
+        p.data.resize(h.recordSize);
+        p.have.assign(h.fragmentCount, false);
+    } else if (p.complete || p.fragmentCount != h.fragmentCount ||
+               p.data.size() != h.recordSize) {
+        this->stats.duplicates += p.complete;
+        this->stats.invalid += !p.complete;
+        return;
+    }
+    if (p.have[h.fragmentIndex]) {
+        this->stats.duplicates++;
+        return;
+    }
+
+    memcpy(&p.data[h.fragmentOffset], datagram + h.headerSize, payload);
+    p.have[h.fragmentIndex] = true;
+    if (++p.received == p.fragmentCount) {
+        p.complete = true;
+        this->stats.records++;
+        this->stats.bytes += p.data.size();
+        if (this->onRecord) {
+            this->onRecord(h.sequence, p.data);
+        }
+        std::vector<uint8_t>().swap(p.data);
+        std::vector<bool>().swap(p.have);
+    }
+
+    if (this->highest >= this->floor + this->window) {
+        this->expire(this->highest - this->window + 1);
+    }
+}
+
+std::vector<std::vector<uint8_t>> StreamReceiver::nacks() {
+    std::vector<std::vector<uint8_t>> out;
+    for (auto& [sequence, p] : this->pending) {
+        if (p.complete || sequence >= this->highest || p.nacks >= this->maxNacks ||
+            (p.nacks && this->highest < p.nackedAt + STREAM_NACK_SPACING)) {
+            continue;
+        }
+
+        StreamNackHeader h = {};
+        h.magic = STREAM_NACK_MAGIC;
+        h.sessionId = this->sessionId;
+        h.sequence = sequence;
+        std::vector<uint16_t> missing;
+        for (uint16_t i = 0; i < p.fragmentCount && missing.size() < STREAM_MAX_NACK_FRAGMENTS;
+             i++) {
+            if (!p.have[i]) {
+                missing.push_back(i);
+            }
+        }
+        h.count = missing.size();
+
+        std::vector<uint8_t> nack(sizeof(h) + missing.size() * sizeof(uint16_t));
+        memcpy(nack.data(), &h, sizeof(h));
+        memcpy(nack.data() + sizeof(h), missing.data(), missing.size() * sizeof(uint16_t));
+        out.push_back(std::move(nack));
+
+        p.nacks++;
+        p.nackedAt = this->highest;
+        this->stats.nacks++;
+    }
+    return out;
+}
+
+void StreamReceiver::finish() {
+    if (this->started) {
+        this->expire(this->highest + 1);
+    }
+}
+
+const StreamReceiverStats& StreamReceiver::getStats() const {
+    return this->stats;
+}
+
+void StreamReceiver::expire(uint64_t until) {
+    uint64_t next = this->floor;
+    auto it = this->pending.begin();
+    while (it != this->pending.end() && it->first < until) {
+        if (it->first > next) {
+            this->reportGap(next, it->first - 1);
+        }
+        const PendingRecord& p = it->second;
+        if (!p.complete) {
+            StreamLoss loss = {STREAM_LOSS_INCOMPLETE, this->sessionId, (uint32_t)it->first,
+                               (uint32_t)it->first, {}};
+            for (uint16_t i = 0; i < p.fragmentCount; i++) {
+                if (!p.have[i]) {
+                    loss.missing.push_back(i);
+                }
+            }
+            this->stats.incompleteRecords++;
+            if (this->onLoss) {
+                this->onLoss(loss);
+            }
+        }
+        next = it->first + 1;
+        it = this->pending.erase(it);
+    }
+    if (next < until) {
+        this->reportGap(next, until - 1);
+    }
+    this->floor = std::max(this->floor, until);
+}
+
+void StreamReceiver::reportGap(uint64_t first, uint64_t last) {
+    this->stats.lostRecords += last - first + 1;
+    if (this->onLoss) {
+        this->onLoss({STREAM_LOSS_GAP, this->sessionId, (uint32_t)first, (uint32_t)last, {}});
+    }
+}
+
+int StreamReceiver::joinMulticast(const std::string& group, const std::string& interface) {
+    const size_t separator = group.rfind(':');
+    if (separator == std::string::npos) {
+        errno = EINVAL;
+        return -1;
+    }
+    std::string host = group.substr(0, separator);
+    const std::string port = group.substr(separator + 1);
+    if (host.size() > 1 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    unsigned int index = 0;
+    if (!interface.empty() && !(index = if_nametoindex(interface.c_str()))) {
+        return -1;
+    }
+
+    struct addrinfo hints = {};
+    struct addrinfo* result;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    const int family = result->ai_family;
+    struct sockaddr_storage address = {};
+    memcpy(&address, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+
+    int fd = socket(family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    // Several receivers on one host share the port, each gets every datagram
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    int ok;
+    if (family == AF_INET) {
+        struct sockaddr_in bound = *(struct sockaddr_in*)&address;
+        struct ip_mreqn request = {};
+        request.imr_multiaddr = bound.sin_addr;
+        request.imr_ifindex = index;
+        bound.sin_addr.s_addr = htonl(INADDR_ANY);
+        ok = bind(fd, (struct sockaddr*)&bound, sizeof(bound)) == 0 &&
+             setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) == 0;
+    } else {
+        struct sockaddr_in6 bound = *(struct sockaddr_in6*)&address;
+        struct ipv6_mreq request = {};
+        request.ipv6mr_multiaddr = bound.sin6_addr;
+        request.ipv6mr_interface = index;
+        bound.sin6_addr = in6addr_any;
+        ok = bind(fd, (struct sockaddr*)&bound, sizeof(bound)) == 0 &&
+             setsockopt(fd, IPPROTO_IPV6, IPV6_JOIN_GROUP, &request, sizeof(request)) == 0;
+    }
+    if (!ok) {
+        const int err = errno;
+        ::close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
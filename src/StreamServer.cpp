@@ -0,0 +1,472 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StreamServer.h"
+
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <ios>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include "Logger.h"
+
+StreamServer::StreamServer(const std::string& listen,
+                           size_t highWatermark,
+                           streamBackpressure backpressure)
+    : listen(listen),
+      highWatermark(highWatermark),
+      lowWatermark(highWatermark / 2),
+      backpressure(backpressure) {
+    std::random_device random;
+    do {
+        this->sessionId = random();
+    } while (!this->sessionId);
+
+    this->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    this->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (this->epollFd < 0 || this->wakeFd < 0) {
+        throw std::ios_base::failure("Create stream server failed: " +
+                                     std::string(std::strerror(errno)));
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = this->wakeFd;
+    epoll_ctl(this->epollFd, EPOLL_CTL_ADD, this->wakeFd, &event);
+
+    try {
+        std::istringstream iss(listen);
+        std::string address;
+        while (std::getline(iss, address, ',')) {
+            this->openListener(address);
+        }
+    } catch (...) {
+        for (int fd : this->listeners) {
+            ::close(fd);
+        }
+        ::close(this->epollFd);
+        ::close(this->wakeFd);
+        throw;
+    }
+    this->thread = std::thread(&StreamServer::run, this);
+}
+
+StreamServer::~StreamServer() {
+    this->stopping = true;
+    uint64_t one = 1;
+    write(this->wakeFd, &one, sizeof(one));
+    this->thread.join();
+
+    for (const std::shared_ptr<StreamClient>& client : this->clients) {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->closed = true;
+        client->drained.notify_all();
+        ::close(client->fd);
+    }
+    for (int fd : this->listeners) {
+        ::close(fd);
+    }
+    for (const std::string& path : this->unixPaths) {
+        unlink(path.c_str());
+    }
+    ::close(this->epollFd);
+    ::close(this->wakeFd);
+}
+
+streamBackpressure StreamServer::parseBackpressure(const std::string& name) {
+    if (name == "block") {
+        return BACKPRESSURE_BLOCK;
+    }
+    if (name == "drop") {
+        return BACKPRESSURE_DROP;
+    }
+    if (name == "disconnect") {
+        return BACKPRESSURE_DISCONNECT;
+    }
+    throw std::invalid_argument("Unknown backpressure " + name +
+                                ", use block, drop or disconnect");
+}
+
+void StreamServer::openListener(const std::string& address) {
+    int fd;
+    if (address.rfind("unix:", 0) == 0) {
+        const std::string path = address.substr(5);
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            throw std::invalid_argument("Unix socket path " + path + " is not correct");
+        }
+        strcpy(addr.sun_path, path.c_str());
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        unlink(path.c_str());
+        if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            const int err = errno;
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            throw std::ios_base::failure("Bind " + address + " failed: " + std::strerror(err));
+        }
+        this->unixPaths.push_back(path);
+    } else if (address.rfind("tcp:", 0) == 0) {
+        std::string host = address.substr(4);
+        std::string port = host;
+        const size_t separator = host.rfind(':');
+        if (separator == std::string::npos) {
+            host.clear();
+        } else {
+            port = host.substr(separator + 1);
+            host = host.substr(0, separator);
+            if (host.size() > 1 && host.front() == '[' && host.back() == ']') {
+                host = host.substr(1, host.size() - 2);
+            }
+        }
+
+        struct addrinfo hints = {};
+        struct addrinfo* result;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        int s = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result);
+        if (s != 0) {
+            throw std::invalid_argument("Stream address " + address + ": " + gai_strerror(s));
+        }
+        fd = -1;
+        for (struct addrinfo* rp = result; rp; rp = rp->ai_next) {
+            fd = socket(rp->ai_family, rp->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                        rp->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            int on = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            if (bind(fd, rp->ai_addr, rp->ai_addrlen) == 0) {
+                break;
+            }
+            ::close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(result);
+        if (fd < 0) {
+            throw std::ios_base::failure("Bind " + address + " failed");
+        }
+    } else {
+        throw std::invalid_argument("Stream address " + address +
+                                    " is not tcp:[HOST:]PORT or unix:PATH");
+    }
+
+    if (::listen(fd, SOMAXCONN) < 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::ios_base::failure("Listen on " + address + " failed: " + std::strerror(err));
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(this->epollFd, EPOLL_CTL_ADD, fd, &event);
+    this->listeners.push_back(fd);
+    Logger::log(info) << "Streaming records on " << address << "\n";
+}
+
+/**
+ * Called from the capture thread. The frame is built once and shared by
+ * all the queues, only BACKPRESSURE_BLOCK ever waits here.
+ */
+void StreamServer::publish(const struct iovec* iov, int iovcnt) {
+    std::vector<std::shared_ptr<StreamClient>> clients;
+    {
+        std::lock_guard<std::mutex> lock(this->clientsMutex);
+        if (this->clients.empty()) {
+            return;
+        }
+        clients = this->clients;
+    }
+
+    size_t size = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        size += iov[i].iov_len;
+    }
+    StreamFrameHeader header = {};
+    header.magic = STREAM_MAGIC;
+    header.version = STREAM_VERSION;
+    header.headerSize = sizeof(StreamFrameHeader);
+    header.sessionId = this->sessionId;
+    header.sequence = this->sequence++;
+    header.fragmentCount = 1;
+    header.recordSize = size;
+
+    auto frame = std::make_shared<std::vector<char>>();
+    frame->reserve(sizeof(header) + size);
+    frame->insert(frame->end(), (char*)&header, (char*)&header + sizeof(header));
+    for (int i = 0; i < iovcnt; i++) {
+        const char* base = static_cast<const char*>(iov[i].iov_base);
+        frame->insert(frame->end(), base, base + iov[i].iov_len);
+    }
+    const StreamQueuedRecord record = {frame, std::chrono::steady_clock::now()};
+
+    bool wake = false;
+    for (const std::shared_ptr<StreamClient>& client : clients) {
+        std::unique_lock<std::mutex> lock(client->mutex);
+        if (client->closed) {
+            continue;
+        }
+        if (!client->queue.empty() && client->queuedBytes + frame->size() > this->highWatermark) {
+            if (this->backpressure == BACKPRESSURE_BLOCK) {
+                client->drained.wait(lock, [&] {
+                    return client->closed || this->stopping ||
+                           client->queuedBytes <= this->lowWatermark;
+                });
+                if (client->closed || this->stopping) {
+                    continue;
+                }
+            } else if (this->backpressure == BACKPRESSURE_DROP) {
+                // The front record may be partially written already
+                const size_t keep = client->frontOffset ? 1 : 0;
+                while (client->queue.size() > keep &&
+                       client->queuedBytes + frame->size() > this->lowWatermark) {
+                    client->queuedBytes -= client->queue[keep].data->size();
+                    client->queue.erase(client->queue.begin() + keep);
+                    client->dropped++;
+                }
+            } else {
+                // The server thread closes it, the fd must not be reused meanwhile
+                client->closed = true;
+                client->waiting = true;
+                wake = true;
+                continue;
+            }
+        }
+        client->queue.push_back(record);
+        client->queuedBytes += frame->size();
+        if (client->queue.size() == 1 && !client->waiting) {
+            client->waiting = true;
+            wake = true;
+        }
+    }
+
+    if (wake) {
+        uint64_t one = 1;
+        write(this->wakeFd, &one, sizeof(one));
+    }
+}
+
+void StreamServer::run() {
+    struct epoll_event events[64];
+    while (!this->stopping) {
+        int n = epoll_wait(this->epollFd, events, 64, 1000);
+        for (int i = 0; i < n; i++) {
+            const int fd = events[i].data.fd;
+            if (fd == this->wakeFd) {
+                uint64_t count;
+                read(this->wakeFd, &count, sizeof(count));
+                std::vector<std::shared_ptr<StreamClient>> clients;
+                {
+                    std::lock_guard<std::mutex> lock(this->clientsMutex);
+                    clients = this->clients;
+                }
+                for (const std::shared_ptr<StreamClient>& client : clients) {
+                    bool closed;
+                    {
+                        std::lock_guard<std::mutex> lock(client->mutex);
+                        if (client->waiting) {
+                            client->waiting = false;
+                            this->flush(*client);
+                        }
+                        closed = client->closed;
+                    }
+                    if (closed) {
+                        this->close(client);
+                    }
+                }
+            } else if (std::find(this->listeners.begin(), this->listeners.end(), fd) !=
+                       this->listeners.end()) {
+                this->accept(fd);
+            } else {
+                std::shared_ptr<StreamClient> client = this->find(fd);
+                if (!client) {
+                    continue;
+                }
+                bool closed = events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP);
+                if (events[i].events & EPOLLIN) {
+                    // Clients send nothing, anything read is discarded
+                    char buf[256];
+                    ssize_t r;
+                    while ((r = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+                    }
+                    closed |= r == 0;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(client->mutex);
+                    if (!closed && (events[i].events & EPOLLOUT)) {
+                        this->flush(*client);
+                    }
+                    closed |= client->closed;
+                }
+                if (closed) {
+                    this->close(client);
+                }
+            }
+        }
+    }
+}
+
+void StreamServer::accept(int listener) {
+    while (true) {
+        struct sockaddr_storage address;
+        socklen_t length = sizeof(address);
+        int fd = accept4(listener, (struct sockaddr*)&address, &length,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        auto client = std::make_shared<StreamClient>();
+        client->fd = fd;
+        char host[NI_MAXHOST], service[NI_MAXSERV];
+        if (address.ss_family != AF_UNIX &&
+            getnameinfo((struct sockaddr*)&address, length, host, NI_MAXHOST, service,
+                        NI_MAXSERV, NI_NUMERICHOST | NI_NUMERICSERV) == 0) {
+            client->name = std::string(host) + ":" + service;
+        } else {
+            client->name = "unix#" + std::to_string(fd);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this->clientsMutex);
+            this->clients.push_back(client);
+        }
+        struct epoll_event event = {};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = fd;
+        epoll_ctl(this->epollFd, EPOLL_CTL_ADD, fd, &event);
+        Logger::log(info) << "Stream client " << client->name << " connected\n";
+    }
+}
+
+// Writes until the queue is empty or the socket is full, client is locked
+void StreamServer::flush(StreamClient& client) {
+    struct iovec iov[STREAM_SERVER_IOV];
+    while (!client.queue.empty() && !client.closed) {
+        int count = 0;
+        for (const StreamQueuedRecord& record : client.queue) {
+            if (count == STREAM_SERVER_IOV) {
+                break;
+            }
+            const size_t offset = count ? 0 : client.frontOffset;
+            iov[count].iov_base = const_cast<char*>(record.data->data()) + offset;
+            iov[count].iov_len = record.data->size() - offset;
+            count++;
+        }
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg(client.fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                client.closed = true;
+            }
+            break;
+        }
+
+        client.bytes += n;
+        size_t written = n + client.frontOffset;
+        while (!client.queue.empty() && written >= client.queue.front().data->size()) {
+            written -= client.queue.front().data->size();
+            client.queuedBytes -= client.queue.front().data->size();
+            client.queue.pop_front();
+            client.records++;
+        }
+        client.frontOffset = written;
+    }
+    if (client.closed || client.queuedBytes <= this->lowWatermark) {
+        client.drained.notify_all();
+    }
+}
+
+void StreamServer::close(const std::shared_ptr<StreamClient>& client) {
+    {
+        std::lock_guard<std::mutex> lock(this->clientsMutex);
+        auto it = std::find(this->clients.begin(), this->clients.end(), client);
+        if (it == this->clients.end()) {
+            return;
+        }
+        this->clients.erase(it);
+    }
+    epoll_ctl(this->epollFd, EPOLL_CTL_DEL, client->fd, nullptr);
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->closed = true;
+        client->drained.notify_all();
+        ::close(client->fd);
+    }
+    Logger::log(info) << "Stream client " << client->name << " disconnected, " << client->records
+                      << " records sent, " << client->dropped << " dropped\n";
+}
+
+std::shared_ptr<StreamClient> StreamServer::find(int fd) {
+    std::lock_guard<std::mutex> lock(this->clientsMutex);
+    for (const std::shared_ptr<StreamClient>& client : this->clients) {
+        if (client->fd == fd) {
+            return client;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<StreamClientStats> StreamServer::getStats() {
+    std::vector<std::shared_ptr<StreamClient>> clients;
+    {
+        std::lock_guard<std::mutex> lock(this->clientsMutex);
+        clients = this->clients;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<StreamClientStats> stats;
+    for (const std::shared_ptr<StreamClient>& client : clients) {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        StreamClientStats& s = stats.emplace_back();
+        s.name = client->name;
+        s.records = client->records;
+        s.bytes = client->bytes;
+        s.dropped = client->dropped;
+        s.lagRecords = client->queue.size();
+        s.lagBytes = client->queuedBytes - client->frontOffset;
+        if (!client->queue.empty()) {
+            s.lagSeconds =
+                std::chrono::duration<double>(now - client->queue.front().queued).count();
+        }
+    }
+    return stats;
+}
+
+void StreamServer::logStats() {
+    for (const StreamClientStats& s : this->getStats()) {
+        Logger::log(info) << "Stream client " << s.name << " " << s.records << " records, "
+                          << s.bytes / 1e6 << " MB, lag " << s.lagRecords << " records "
+                          << s.lagBytes / 1e3 << " kB " << s.lagSeconds * 1e3 << " ms, "
+                          << s.dropped << " dropped\n";
+    }
+}
+
+const std::string& StreamServer::getListen() const {
+    return this->listen;
+}
@@ -0,0 +1,317 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "StreamUplink.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <chrono>
+#include <cstring>
+#include <ios>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "AggregateProtocol.h"
+#include "Logger.h"
+
+StreamUplink::StreamUplink(const std::string& address, uint32_t mtu)
+    : address(address), mtu(mtu) {
+    std::string host;
+    if (address.rfind("udp:", 0) == 0) {
+        this->tcp = false;
+    } else if (address.rfind("tcp:", 0) == 0) {
+        this->tcp = true;
+    } else {
+        throw std::invalid_argument("Aggregator address " + address +
+                                    " is not udp:HOST:PORT or tcp:HOST:PORT");
+    }
+    host = address.substr(4);
+    const size_t separator = host.rfind(':');
+    if (separator == std::string::npos) {
+        throw std::invalid_argument("Aggregator address " + address + " has no port");
+    }
+    const std::string port = host.substr(separator + 1);
+    host = host.substr(0, separator);
+    if (host.size() > 1 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    struct addrinfo hints = {};
+    struct addrinfo* result;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = this->tcp ? SOCK_STREAM : SOCK_DGRAM;
+    int s = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (s != 0) {
+        throw std::invalid_argument("Aggregator address " + address + ": " + gai_strerror(s));
+    }
+    memcpy(&this->peer, result->ai_addr, result->ai_addrlen);
+    this->peerLength = result->ai_addrlen;
+    freeaddrinfo(result);
+
+    if (this->tcp) {
+        std::random_device random;
+        do {
+            this->sessionId = random();
+        } while (!this->sessionId);
+        this->writer = std::thread(&StreamUplink::writeLoop, this);
+    } else {
+        this->fd = socket(this->peer.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (this->fd < 0 ||
+            connect(this->fd, (struct sockaddr*)&this->peer, this->peerLength) < 0) {
+            const int err = errno;
+            if (this->fd >= 0) {
+                ::close(this->fd);
+            }
+            throw std::ios_base::failure("Aggregator " + address +
+                                         " failed: " + std::strerror(err));
+        }
+    }
+    Logger::log(info) << "Sending records to aggregator " << address << "\n";
+}
+
+StreamUplink::~StreamUplink() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    if (this->writer.joinable()) {
+        this->writer.join();
+    }
+    if (this->fd >= 0) {
+        ::close(this->fd);
+    }
+}
+
+void StreamUplink::release(std::unique_ptr<StreamUplink> uplink) {
+    if (!uplink) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(uplink->mutex);
+        uplink->stopping = true;
+    }
+    uplink->wake.notify_all();
+    // The writer notices stopping within UPLINK_TIMEOUT_MS, it is joined there
+    std::thread([uplink = std::move(uplink)]() mutable { uplink.reset(); }).detach();
+}
+
+/**
+ * Called from the capture thread, the record is copied once behind its
+ * envelope and never waits for the aggregator.
+ */
+void StreamUplink::publish(const struct iovec* iov, int iovcnt, const StreamRecordInfo& info) {
+    size_t size = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        size += iov[i].iov_len;
+    }
+    AggregateRecordHeader envelope = {};
+    envelope.timestamp = info.timestamp;
+    envelope.clockUncertainty = info.clockUncertainty;
+    envelope.format = info.format;
+    envelope.derivedType = info.derivedType;
+    if (info.srcMac) {
+        memcpy(envelope.srcMac, info.srcMac, sizeof(envelope.srcMac));
+    }
+    envelope.headerSize = sizeof(envelope);
+
+    // TCP frames carry their header in front, UDP fragments get theirs when sent
+    StreamFrameHeader frame = {};
+    const size_t frameSize = this->tcp ? sizeof(frame) : 0;
+    auto data = std::make_shared<std::vector<char>>();
+    data->reserve(frameSize + sizeof(envelope) + size);
+    data->resize(frameSize);
+    data->insert(data->end(), (char*)&envelope, (char*)&envelope + sizeof(envelope));
+    for (int i = 0; i < iovcnt; i++) {
+        const char* base = static_cast<const char*>(iov[i].iov_base);
+        data->insert(data->end(), base, base + iov[i].iov_len);
+    }
+
+    if (!this->tcp) {
+        this->answerNacks();
+        const StreamHistoryRecord* record = this->framer.add(std::move(data), this->mtu);
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (!record) {
+            this->stats.dropped++;
+            return;
+        }
+        this->stats.records++;
+        for (uint16_t i = 0; i < record->fragmentCount; i++) {
+            this->sendFragment(*record, i, 0);
+        }
+        return;
+    }
+
+    frame.magic = STREAM_MAGIC;
+    frame.version = STREAM_VERSION;
+    frame.headerSize = sizeof(frame);
+    frame.sessionId = this->sessionId;
+    frame.fragmentCount = 1;
+    frame.recordSize = data->size() - sizeof(frame);
+    std::lock_guard<std::mutex> lock(this->mutex);
+    frame.sequence = this->sequence++;
+    memcpy(data->data(), &frame, sizeof(frame));
+    this->queuedBytes += data->size();
+    this->queue.push_back(std::move(data));
+    while (this->queuedBytes > UPLINK_QUEUE_BYTES && this->queue.size() > 1) {
+        this->queuedBytes -= this->queue.front()->size();
+        this->queue.pop_front();
+        this->stats.dropped++;
+    }
+    this->stats.records++;
+    this->wake.notify_one();
+}
+
+// Called with the mutex held
+void StreamUplink::sendFragment(const StreamHistoryRecord& record, uint16_t index, uint8_t flags) {
+    StreamFrameHeader h;
+    struct iovec iov[2] = {{&h, sizeof(h)}, {}};
+    this->framer.fragment(record, index, flags, h, iov[1]);
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    ssize_t n = sendmsg(this->fd, &msg, MSG_DONTWAIT);
+    if (n < 0) {
+        this->stats.dropped++;
+    } else {
+        this->stats.bytes += n;
+    }
+}
+
+void StreamUplink::answerNacks() {
+    char buf[STREAM_DEFAULT_MTU];
+    ssize_t n;
+    while ((n = recv(this->fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->framer.resend(buf, n, [this](const StreamHistoryRecord& record, uint16_t index) {
+            this->sendFragment(record, index, STREAM_FLAG_RETRANSMIT);
+            this->stats.retransmitted++;
+        });
+    }
+}
+
+// Connected socket whose writes time out, or -1 when the aggregator did not answer in time
+int StreamUplink::connectPeer() {
+    int fd = socket(this->peer.ss_family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&this->peer, this->peerLength) < 0) {
+        struct pollfd p = {fd, POLLOUT, 0};
+        int err = errno;
+        socklen_t length = sizeof(err);
+        if (err != EINPROGRESS || poll(&p, 1, UPLINK_TIMEOUT_MS) != 1 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &length) < 0 || err) {
+            ::close(fd);
+            return -1;
+        }
+    }
+    const struct timeval timeout = {UPLINK_TIMEOUT_MS / 1000, (UPLINK_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    return fd;
+}
+
+void StreamUplink::writeLoop() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (!this->stopping) {
+        if (this->fd < 0) {
+            lock.unlock();
+            const int fd = this->connectPeer();
+            lock.lock();
+            if (fd < 0) {
+                this->wake.wait_for(lock, std::chrono::milliseconds(UPLINK_RECONNECT_MS),
+                                    [this] { return this->stopping.load(); });
+                continue;
+            }
+            this->fd = fd;
+            this->stats.connects++;
+            Logger::log(info) << "Connected to aggregator " << this->address << "\n";
+        }
+
+        this->wake.wait(lock, [this] { return this->stopping || !this->queue.empty(); });
+        if (this->stopping) {
+            break;
+        }
+        // Writes a batch without the lock, capture keeps queueing meanwhile
+        std::vector<StreamRecordData> batch(this->queue.begin(), this->queue.end());
+        this->queue.clear();
+        this->queuedBytes = 0;
+        lock.unlock();
+
+        std::vector<struct iovec> iovs;
+        for (const StreamRecordData& data : batch) {
+            iovs.push_back({const_cast<char*>(data->data()), data->size()});
+        }
+        size_t first = 0;
+        bool failed = false;
+        uint64_t written = 0;
+        while (first < iovs.size() && !failed) {
+            const int count = std::min<size_t>(iovs.size() - first, IOV_MAX);
+            struct msghdr msg = {};
+            msg.msg_iov = &iovs[first];
+            msg.msg_iovlen = count;
+            ssize_t n = sendmsg(this->fd, &msg, MSG_NOSIGNAL);
+            if (n < 0) {
+                // A timed out write is tried again until the uplink is released
+                const bool timeout = errno == EAGAIN || errno == EWOULDBLOCK;
+                failed = errno != EINTR && (!timeout || this->stopping);
+                continue;
+            }
+            written += n;
+            while (n > 0) {
+                if ((size_t)n >= iovs[first].iov_len) {
+                    n -= iovs[first].iov_len;
+                    first++;
+                } else {
+                    iovs[first].iov_base = (char*)iovs[first].iov_base + n;
+                    iovs[first].iov_len -= n;
+                    n = 0;
+                }
+            }
+        }
+
+        lock.lock();
+        this->stats.bytes += written;
+        if (failed) {
+            // The record cut short is lost, the aggregator skips to the next connection
+            this->stats.dropped += iovs.size() - first;
+            Logger::log(warning) << "Aggregator " << this->address << " disconnected\n";
+            ::close(this->fd);
+            this->fd = -1;
+        }
+    }
+}
+
+StreamUplinkStats StreamUplink::getStats() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->stats;
+}
+
+void StreamUplink::logStats() {
+    const StreamUplinkStats stats = this->getStats();
+    Logger::log(info) << "Aggregator " << this->address << " "
+                      << stats.records - this->lastStats.records << " records, "
+                      << stats.dropped << " dropped, " << stats.retransmitted
+                      << " retransmitted\n";
+    this->lastStats = stats;
+}
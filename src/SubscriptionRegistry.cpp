@@ -0,0 +1,570 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SubscriptionRegistry.h"
+
+#include <netdb.h>
+#include <poll.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include "Arguments.h"
+#include "Csi.h"
+#include "DerivedRecord.h"
+#include "Logger.h"
+#include "UdpSocket.h"
+
+static std::vector<std::string> split(const std::string& value) {
+    std::vector<std::string> items;
+    std::istringstream iss(value);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        items.push_back(item);
+    }
+    return items;
+}
+
+static uint64_t formatFromName(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+    if (name == "CSI") {
+        return SubscriptionFilter::formatBit(STREAM_FORMAT_CSI, 0);
+    }
+    if (name == "FTM") {
+        return SubscriptionFilter::formatBit(STREAM_FORMAT_FTM, 0);
+    }
+    for (uint16_t type = 1; type < 63; type++) {
+        if (DerivedRecord::prefix(type) == name + "_") {
+            return SubscriptionFilter::formatBit(STREAM_FORMAT_DERIVED, type);
+        }
+    }
+    throw std::invalid_argument("Unknown record format " + name);
+}
+
+static uint32_t chainsFromList(const std::string& value) {
+    uint32_t chains = 0;
+    for (const std::string& item : split(value)) {
+        const int chain = std::atoi(item.c_str());
+        if (chain < 0 || chain > 31 || item.empty() || !std::isdigit(item.front())) {
+            throw std::invalid_argument("Subscription chain " + item + " is not correct");
+        }
+        chains |= 1u << chain;
+    }
+    return chains;
+}
+
+bool SubscriptionProjection::identity() const {
+    return *this == SubscriptionProjection();
+}
+
+/**
+ * Reads the int16 pairs after the raw header in the same [rx, tx, subcarrier]
+ * order as CsiRatio, the result is a derived record the readers of the
+ * derived stream already understand.
+ */
+StreamRecordData SubscriptionProjection::apply(const std::vector<char>& record) const {
+    if (record.size() < CSI_HEADER_LENGTH) {
+        return nullptr;
+    }
+    const RawHeaderData* raw = reinterpret_cast<const RawHeaderData*>(record.data());
+    const uint32_t numRx = raw->numRx;
+    const uint32_t numTx = raw->numTx;
+    const uint32_t numSubCarriers = raw->numSubCarriers;
+    if ((uint64_t)numRx * numTx * numSubCarriers * 4 > record.size() - CSI_HEADER_LENGTH) {
+        return nullptr;
+    }
+
+    std::vector<uint32_t> rxKept, txKept;
+    for (uint32_t rx = 0; rx < numRx; rx++) {
+        if (!this->rx || this->rx & (1u << rx)) {
+            rxKept.push_back(rx);
+        }
+    }
+    for (uint32_t tx = 0; tx < numTx; tx++) {
+        if (!this->tx || this->tx & (1u << tx)) {
+            txKept.push_back(tx);
+        }
+    }
+    if (rxKept.empty() || txKept.empty() || !numSubCarriers) {
+        return nullptr;
+    }
+
+    const uint32_t numValues = (numSubCarriers + this->stride - 1) / this->stride;
+    const uint32_t valueSize = this->amplitude ? 2 : 4;
+    const uint32_t dataSize = rxKept.size() * txKept.size() * numValues * valueSize;
+    auto projected = std::make_shared<std::vector<char>>(sizeof(DerivedHeaderData) + dataSize);
+
+    DerivedHeaderData header = {};
+    header.dataSize = dataSize;
+    header.type = DERIVED_PROJECTION;
+    header.numRx = rxKept.size();
+    header.numTx = txKept.size();
+    header.timestamp = raw->timestamp;
+    header.rateNflag = raw->rateNflag;
+    header.numValues = numValues;
+    memcpy(header.srcMac, raw->srcMac, sizeof(header.srcMac));
+    header.valueType = this->amplitude ? VALUE_FLOAT16 : VALUE_COMPLEX_FLOAT16;
+    header.numSubCarriers = numSubCarriers;
+    header.numRecords = 1;
+    memcpy(projected->data(), &header, sizeof(header));
+
+    const char* csi = record.data() + CSI_HEADER_LENGTH;
+    uint16_t* out = reinterpret_cast<uint16_t*>(projected->data() + sizeof(header));
+    for (uint32_t rx : rxKept) {
+        for (uint32_t tx : txKept) {
+            const char* chain = csi + (rx * numTx + tx) * numSubCarriers * 4;
+            for (uint32_t i = 0; i < numSubCarriers; i += this->stride) {
+                int16_t value[2];
+                memcpy(value, chain + i * 4, sizeof(value));
+                if (this->amplitude) {
+                    *out++ = DerivedRecord::toHalf(std::hypot((float)value[0], (float)value[1]));
+                } else {
+                    *out++ = DerivedRecord::toHalf(value[0]);
+                    *out++ = DerivedRecord::toHalf(value[1]);
+                }
+            }
+        }
+    }
+    return projected;
+}
+
+SubscriptionFilter SubscriptionFilter::parse(const std::vector<std::string>& tokens) {
+    SubscriptionFilter filter;
+    for (const std::string& token : tokens) {
+        const size_t separator = token.find('=');
+        if (separator == std::string::npos) {
+            throw std::invalid_argument("Subscription filter " + token + " is not KEY=VALUE");
+        }
+        const std::string key = token.substr(0, separator);
+        const std::string value = token.substr(separator + 1);
+
+        if (key == "mac") {
+            for (const std::string& item : split(value)) {
+                std::array<uint8_t, 6> mac;
+                if (sscanf(item.c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &mac[0], &mac[1],
+                           &mac[2], &mac[3], &mac[4], &mac[5]) != 6) {
+                    throw std::invalid_argument("Subscription MAC " + item + " is not correct");
+                }
+                filter.macs.push_back(mac);
+            }
+        } else if (key == "format") {
+            filter.formats = 0;
+            for (const std::string& item : split(value)) {
+                filter.formats |= formatFromName(item);
+            }
+        } else if (key == "decimation") {
+            const int decimation = std::atoi(value.c_str());
+            if (decimation <= 0) {
+                throw std::invalid_argument("Subscription decimation is not correct number");
+            }
+            filter.decimation = decimation;
+        } else if (key == "rate") {
+            filter.rate = std::atof(value.c_str());
+            if (!(filter.rate > 0)) {
+                throw std::invalid_argument("Subscription rate is not correct number");
+            }
+        } else if (key == "rx") {
+            filter.projection.rx = chainsFromList(value);
+        } else if (key == "tx") {
+            filter.projection.tx = chainsFromList(value);
+        } else if (key == "stride") {
+            const int stride = std::atoi(value.c_str());
+            if (stride <= 0) {
+                throw std::invalid_argument("Subscription stride is not correct number");
+            }
+            filter.projection.stride = stride;
+        } else if (key == "values") {
+            if (value != "amplitude" && value != "complex") {
+                throw std::invalid_argument("Subscription values are amplitude or complex");
+            }
+            filter.projection.amplitude = value == "amplitude";
+        } else {
+            throw std::invalid_argument("Unknown subscription filter " + key);
+        }
+    }
+    return filter;
+}
+
+uint64_t SubscriptionFilter::formatBit(streamFormat format, uint16_t derivedType) {
+    if (format == STREAM_FORMAT_DERIVED) {
+        return 1ull << std::min<uint16_t>(derivedType + 1, 63);
+    }
+    return 1ull << format;
+}
+
+bool SubscriptionFilter::matches(const StreamRecordInfo& info) const {
+    if (!(this->formats & formatBit(info.format, info.derivedType))) {
+        return false;
+    }
+    if (this->macs.empty()) {
+        return true;
+    }
+    if (!info.srcMac) {
+        return false;
+    }
+    for (const std::array<uint8_t, 6>& mac : this->macs) {
+        if (memcmp(mac.data(), info.srcMac, mac.size()) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Subscriber::Subscriber(int sfd, const struct sockaddr_storage& address, socklen_t addressLength)
+    : sfd(sfd), address(address), addressLength(addressLength) {
+    this->sender = std::thread(&Subscriber::sendLoop, this);
+}
+
+Subscriber::~Subscriber() {
+    {
+        std::lock_guard<std::mutex> lock(this->queueMutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    this->sender.join();
+}
+
+bool Subscriber::sameAddress(const struct sockaddr_storage& address,
+                             socklen_t addressLength) const {
+    return addressLength == this->addressLength &&
+           memcmp(&address, &this->address, addressLength) == 0;
+}
+
+bool Subscriber::accept(const StreamRecordInfo& info) {
+    if (!this->filter.matches(info) || (this->filter.rate > 0 && !this->admit(info))) {
+        return false;
+    }
+    return this->counter++ % this->filter.decimation == 0;
+}
+
+// Spaces the records of every MAC by the rate, by their own timestamps when they have one
+bool Subscriber::admit(const StreamRecordInfo& info) {
+    uint64_t mac = 0;
+    if (info.srcMac) {
+        memcpy(&mac, info.srcMac, 6);
+    }
+    uint64_t now = info.timestamp;
+    if (!now) {
+        now = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now().time_since_epoch())
+                  .count();
+    }
+    const uint64_t period = 1e6 / this->filter.rate;
+
+    std::lock_guard<std::mutex> lock(this->rateMutex);
+    uint64_t& next = this->nextTime[mac];
+    if (now < next) {
+        return false;
+    }
+    // After a pause the schedule starts again instead of letting a burst through
+    next = now - next < period ? next + period : now + period;
+    return true;
+}
+
+void Subscriber::enqueue(const StreamRecordData& data) {
+    {
+        std::lock_guard<std::mutex> lock(this->queueMutex);
+        if (this->queue.size() >= SUBSCRIPTION_QUEUE_LIMIT) {
+            this->queue.pop_front();
+            this->dropped++;
+        }
+        this->queue.push_back(data);
+    }
+    this->wake.notify_one();
+}
+
+void Subscriber::sendLoop() {
+    std::vector<StreamRecordData> batch;
+    std::unique_lock<std::mutex> lock(this->queueMutex);
+    while (true) {
+        this->wake.wait(lock, [this] { return this->stopping || !this->queue.empty(); });
+        if (this->stopping) {
+            return;
+        }
+        while (!this->queue.empty() && batch.size() < UDP_BATCH_SIZE) {
+            batch.push_back(std::move(this->queue.front()));
+            this->queue.pop_front();
+        }
+        lock.unlock();
+        this->sendBatch(batch);
+        batch.clear();
+        lock.lock();
+    }
+}
+
+void Subscriber::sendBatch(const std::vector<StreamRecordData>& batch) {
+    std::vector<StreamFrameHeader> headers;
+    std::vector<struct iovec> payloads;
+    const uint32_t mtu = Arguments::snapshot()->udpFrame;
+    if (mtu) {
+        std::lock_guard<std::mutex> lock(this->framerMutex);
+        for (const StreamRecordData& data : batch) {
+            const StreamHistoryRecord* record = this->framer.add(data, mtu);
+            if (!record) {
+                this->dropped++;
+                continue;
+            }
+            for (uint16_t i = 0; i < record->fragmentCount; i++) {
+                this->framer.fragment(*record, i, 0, headers.emplace_back(),
+                                      payloads.emplace_back());
+            }
+        }
+    } else {
+        for (const StreamRecordData& data : batch) {
+            payloads.push_back({const_cast<char*>(data->data()), data->size()});
+        }
+    }
+
+    const size_t count = payloads.size();
+    std::vector<struct iovec> iovs(2 * count);
+    std::vector<struct mmsghdr> messages(count);
+    for (size_t i = 0; i < count; i++) {
+        struct msghdr& msg = messages[i].msg_hdr;
+        memset(&messages[i], 0, sizeof(struct mmsghdr));
+        msg.msg_name = &this->address;
+        msg.msg_namelen = this->addressLength;
+        msg.msg_iov = &iovs[2 * i];
+        if (mtu) {
+            iovs[2 * i] = {&headers[i], sizeof(StreamFrameHeader)};
+            iovs[2 * i + 1] = payloads[i];
+            msg.msg_iovlen = 2;
+        } else {
+            iovs[2 * i] = payloads[i];
+            msg.msg_iovlen = 1;
+        }
+    }
+    this->sendMessages(messages.data(), count);
+    this->sent += batch.size();
+}
+
+// Waits for room in the socket buffer, only this subscriber's thread blocks
+void Subscriber::sendMessages(struct mmsghdr* messages, size_t count) {
+    size_t first = 0;
+    while (first < count) {
+        int n = sendmmsg(this->sfd, &messages[first], count - first, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                struct pollfd pfd = {this->sfd, POLLOUT, 0};
+                poll(&pfd, 1, 10);
+                continue;
+            }
+            this->dropped++;
+            first++;
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            this->bytes += messages[first + i].msg_len;
+        }
+        first += n;
+    }
+}
+
+bool Subscriber::resend(const char* buf, size_t size) {
+    std::lock_guard<std::mutex> lock(this->framerMutex);
+    return this->framer.resend(buf, size, [this](const StreamHistoryRecord& record,
+                                                 uint16_t index) {
+        StreamFrameHeader header;
+        struct iovec iov[2] = {{&header, sizeof(header)}, {}};
+        this->framer.fragment(record, index, STREAM_FLAG_RETRANSMIT, header, iov[1]);
+        struct msghdr msg = {};
+        msg.msg_name = &this->address;
+        msg.msg_namelen = this->addressLength;
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        sendmsg(this->sfd, &msg, MSG_DONTWAIT);
+    });
+}
+
+SubscriberStats Subscriber::getStats() {
+    SubscriberStats stats;
+    stats.sent = this->sent;
+    stats.dropped = this->dropped;
+    stats.bytes = this->bytes;
+    std::lock_guard<std::mutex> lock(this->queueMutex);
+    stats.queued = this->queue.size();
+    return stats;
+}
+
+std::string Subscriber::name() const {
+    char host[NI_MAXHOST], service[NI_MAXSERV];
+    if (getnameinfo((const struct sockaddr*)&this->address, this->addressLength, host, NI_MAXHOST,
+                    service, NI_MAXSERV, NI_NUMERICHOST | NI_NUMERICSERV) != 0) {
+        return "unknown";
+    }
+    return std::string(host) + ":" + service;
+}
+
+bool SubscriptionRegistry::handle(int sfd,
+                                  const char* buf,
+                                  size_t size,
+                                  const struct sockaddr_storage& from,
+                                  socklen_t fromLength) {
+    const std::string command(buf, strnlen(buf, size));
+    std::vector<std::string> tokens;
+    std::istringstream iss(command);
+    std::string token;
+    while (iss >> token) {
+        tokens.push_back(token);
+    }
+
+    if (!tokens.empty() && tokens.front() == "subscribe") {
+        SubscriptionFilter filter;
+        try {
+            filter = SubscriptionFilter::parse({tokens.begin() + 1, tokens.end()});
+        } catch (const std::invalid_argument& e) {
+            Logger::log(error) << e.what() << "\n";
+            return true;
+        }
+
+        std::unique_lock<std::shared_mutex> lock(this->mutex);
+        Subscriber* subscriber = this->find(from, fromLength);
+        if (!subscriber) {
+            if (this->subscribers.size() >= SUBSCRIPTION_LIMIT) {
+                Logger::log(error) << "Subscriber limit " << SUBSCRIPTION_LIMIT << " reached\n";
+                return true;
+            }
+            subscriber =
+                this->subscribers.emplace_back(new Subscriber(sfd, from, fromLength)).get();
+            Logger::log(info) << "Subscribed " << subscriber->name() << "\n";
+        }
+        subscriber->filter = filter;
+        subscriber->renewed = std::chrono::steady_clock::now();
+        this->empty = false;
+        return true;
+    }
+
+    if (!tokens.empty() && tokens.front() == "unsubscribe") {
+        std::unique_ptr<Subscriber> removed;  // its thread is joined after unlocking
+        std::unique_lock<std::shared_mutex> lock(this->mutex);
+        for (auto it = this->subscribers.begin(); it != this->subscribers.end(); it++) {
+            if ((*it)->sameAddress(from, fromLength)) {
+                Logger::log(info) << "Unsubscribed " << (*it)->name() << "\n";
+                removed = std::move(*it);
+                this->subscribers.erase(it);
+                break;
+            }
+        }
+        this->empty = this->subscribers.empty();
+        lock.unlock();
+        return true;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(this->mutex);
+    Subscriber* subscriber = this->find(from, fromLength);
+    return subscriber && subscriber->resend(buf, size);
+}
+
+bool SubscriptionRegistry::contains(const struct sockaddr_storage& address,
+                                    socklen_t addressLength) {
+    std::shared_lock<std::shared_mutex> lock(this->mutex);
+    return this->find(address, addressLength) != nullptr;
+}
+
+/**
+ * Called from the capture thread, the record is copied once for all the
+ * subscribers and only if one of them takes it. Each distinct projection of
+ * a CSI record is computed once and shared the same way.
+ */
+void SubscriptionRegistry::publish(const struct iovec* iov,
+                                   int iovcnt,
+                                   const StreamRecordInfo& info) {
+    if (this->empty) {
+        return;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(this->mutex);
+    StreamRecordData data;
+    std::vector<std::pair<const SubscriptionProjection*, StreamRecordData>> projections;
+    for (const std::unique_ptr<Subscriber>& subscriber : this->subscribers) {
+        if (!subscriber->accept(info)) {
+            continue;
+        }
+        if (!data) {
+            size_t size = 0;
+            for (int i = 0; i < iovcnt; i++) {
+                size += iov[i].iov_len;
+            }
+            auto record = std::make_shared<std::vector<char>>();
+            record->reserve(size);
+            for (int i = 0; i < iovcnt; i++) {
+                const char* base = static_cast<const char*>(iov[i].iov_base);
+                record->insert(record->end(), base, base + iov[i].iov_len);
+            }
+            data = std::move(record);
+        }
+
+        const SubscriptionProjection& projection = subscriber->filter.projection;
+        if (info.format != STREAM_FORMAT_CSI || projection.identity()) {
+            subscriber->enqueue(data);
+            continue;
+        }
+        auto it = std::find_if(projections.begin(), projections.end(), [&](const auto& entry) {
+            return *entry.first == projection;
+        });
+        if (it == projections.end()) {
+            it = projections.emplace(projections.end(), &projection, projection.apply(*data));
+        }
+        if (it->second) {
+            subscriber->enqueue(it->second);
+        }
+    }
+}
+
+void SubscriptionRegistry::expire() {
+    if (this->empty) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<Subscriber>> removed;
+    std::unique_lock<std::shared_mutex> lock(this->mutex);
+    auto it = this->subscribers.begin();
+    while (it != this->subscribers.end()) {
+        if (now - (*it)->renewed > std::chrono::seconds(SUBSCRIPTION_TIMEOUT_S)) {
+            Logger::log(info) << "Subscription of " << (*it)->name() << " expired\n";
+            removed.push_back(std::move(*it));
+            it = this->subscribers.erase(it);
+        } else {
+            it++;
+        }
+    }
+    this->empty = this->subscribers.empty();
+    lock.unlock();
+}
+
+void SubscriptionRegistry::logStats() {
+    std::shared_lock<std::shared_mutex> lock(this->mutex);
+    for (const std::unique_ptr<Subscriber>& subscriber : this->subscribers) {
+        const SubscriberStats stats = subscriber->getStats();
+        Logger::log(info) << "Subscriber " << subscriber->name() << " " << stats.sent
+                          << " records, " << stats.bytes / 1e6 << " MB, " << stats.queued
+                          << " queued, " << stats.dropped << " dropped\n";
+    }
+}
+
+Subscriber* SubscriptionRegistry::find(const struct sockaddr_storage& address,
+                                       socklen_t addressLength) {
+    for (const std::unique_ptr<Subscriber>& subscriber : this->subscribers) {
+        if (subscriber->sameAddress(address, addressLength)) {
+            return subscriber.get();
+        }
+    }
+    return nullptr;
+}
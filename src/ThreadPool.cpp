@@ -0,0 +1,85 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t numThreads) {
+    if (!numThreads) {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    // The calling thread is one of them
+    for (size_t i = 1; i < numThreads; i++) {
+        this->workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->start.notify_all();
+    for (std::thread& worker : this->workers) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::size() const {
+    return this->workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->job = &fn;
+    this->count = count;
+    this->next = 0;
+    this->finished = 0;
+    this->generation++;
+    this->start.notify_all();
+
+    this->runIterations(lock);
+    this->done.wait(lock, [this] { return this->finished == this->count; });
+    this->job = nullptr;
+}
+
+void ThreadPool::work() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->start.wait(lock, [&] { return this->stopping || this->generation != seen; });
+        if (this->stopping) {
+            return;
+        }
+        seen = this->generation;
+        this->runIterations(lock);
+    }
+}
+
+void ThreadPool::runIterations(std::unique_lock<std::mutex>& lock) {
+    while (this->job && this->next < this->count) {
+        const size_t i = this->next++;
+        const std::function<void(size_t)>& fn = *this->job;
+        lock.unlock();
+        fn(i);
+        lock.lock();
+        if (++this->finished == this->count) {
+            this->done.notify_all();
+        }
+    }
+}
@@ -0,0 +1,257 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TofFusion.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include "Arguments.h"
+#include "Resampler.h"
+#include "WiFiFtmController.h"
+
+#define SPEED_OF_LIGHT 299792458.0
+#define MAD_TO_SIGMA 1.4826
+
+void TofFusion::configure(uint64_t alignWindow,
+                          uint32_t calibrationSize,
+                          const std::string& ftmFile) {
+    this->alignWindow = alignWindow;
+    this->calibrationSize = std::max(calibrationSize, 1u);
+    this->pending.clear();
+    this->history.clear();
+    this->offsets.clear();
+    this->tofMean = NAN;
+    this->tofVariance = 0;
+
+    if (ftmFile.empty()) {
+        TofFusion::enabled = true;
+        return;
+    }
+
+    std::ifstream ifs(ftmFile, std::ios::binary);
+    if (ifs.fail()) {
+        throw std::ios_base::failure("Open FTM file " + ftmFile +
+                                     " failed: " + std::string(std::strerror(errno)));
+    }
+    Ftm ftm;
+    while (ifs.read(reinterpret_cast<char*>(&ftm), FTM_SIZE)) {
+        this->pending.push_back(toSample(ftm));
+    }
+    std::sort(this->pending.begin(), this->pending.end(),
+              [](const FtmSample& a, const FtmSample& b) { return a.timestamp < b.timestamp; });
+}
+
+void TofFusion::addFtm(const Ftm& ftm) {
+    if (!TofFusion::enabled || !ftm.rttAvg) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(TofFusion::ftmMutex);
+    if (TofFusion::ftmQueue.size() == FTM_QUEUE_SIZE) {
+        TofFusion::ftmQueue.pop_front();
+    }
+    TofFusion::ftmQueue.push_back(toSample(ftm));
+}
+
+FtmSample TofFusion::toSample(const Ftm& ftm) {
+    // RTT in ps, half of it is the one way time of flight
+    return {ftm.timestamp, ftm.rttAvg / 2e3, ftm.rttVariance / 4e6};
+}
+
+std::unique_ptr<DerivedRecord> TofFusion::update(const Csi& csi) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
+    const uint8_t* mac = args->ftmTargetMac;
+    static const uint8_t noMac[ETH_ALEN] = {0};
+    if (memcmp(mac, noMac, ETH_ALEN) && memcmp(mac, csi.rawHeaderData.srcMac, ETH_ALEN)) {
+        return nullptr;
+    }
+
+    double variance;
+    const double tof = this->phaseSlopeTof(csi, variance);
+    if (std::isnan(tof)) {
+        return nullptr;
+    }
+
+    if (std::isnan(this->tofMean)) {
+        this->tofMean = tof;
+    } else {
+        const double delta = tof - this->tofMean;
+        this->tofMean += TOF_JITTER_WEIGHT * delta;
+        this->tofVariance =
+            (1 - TOF_JITTER_WEIGHT) * (this->tofVariance + TOF_JITTER_WEIGHT * delta * delta);
+    }
+
+    const uint64_t now = csi.rawHeaderData.timestamp;
+    this->history.push_back({now, tof});
+    {
+        std::lock_guard<std::mutex> lock(TofFusion::ftmMutex);
+        this->pending.insert(this->pending.end(), TofFusion::ftmQueue.begin(),
+                             TofFusion::ftmQueue.end());
+        TofFusion::ftmQueue.clear();
+    }
+    this->calibrate(now);
+
+    if (this->offsets.empty()) {
+        return nullptr;
+    }
+
+    const double sigma = std::sqrt(variance + this->tofVariance + this->offsetVariance) * 1e-9 *
+                         SPEED_OF_LIGHT;
+    std::vector<double> values = {
+        (tof + this->offset) * 1e-9 * SPEED_OF_LIGHT,
+        sigma,
+        1 / (1 + sigma),
+        tof,
+        this->offset,
+    };
+
+    std::unique_ptr<DerivedRecord> record = std::make_unique<DerivedRecord>(DERIVED_DISTANCE, csi);
+    record->header.numRx = 1;
+    record->header.numTx = 1;
+    record->header.numSubCarriers = 0;
+    record->setValues(values, TOF_FUSION_VALUES);
+    return record;
+}
+
+/**
+ * Pairs FTM samples with CSI estimates received within the align window
+ * around them. A sample is used once the window has passed, so CSI arriving
+ * after the FTM result is still taken into account.
+ */
+void TofFusion::calibrate(uint64_t now) {
+    bool changed = false;
+    while (!this->pending.empty() && this->pending.front().timestamp + this->alignWindow <= now) {
+        const FtmSample sample = this->pending.front();
+        this->pending.pop_front();
+
+        std::vector<double> aligned;
+        for (const CsiTof& c : this->history) {
+            if (c.timestamp + this->alignWindow >= sample.timestamp &&
+                c.timestamp <= sample.timestamp + this->alignWindow) {
+                aligned.push_back(c.tof);
+            }
+        }
+        if (aligned.empty()) {
+            continue;
+        }
+        std::nth_element(aligned.begin(), aligned.begin() + aligned.size() / 2, aligned.end());
+        this->offsets.push_back(sample.tof - aligned[aligned.size() / 2]);
+        if (this->offsets.size() > this->calibrationSize) {
+            this->offsets.pop_front();
+        }
+        this->offsetVariance = sample.variance;
+        changed = true;
+    }
+
+    // Older records can not be paired with FTM samples still to come
+    while (!this->history.empty()) {
+        const uint64_t end = this->history.front().timestamp + this->alignWindow;
+        if (end + this->alignWindow >= now ||
+            (!this->pending.empty() && end >= this->pending.front().timestamp)) {
+            break;
+        }
+        this->history.pop_front();
+    }
+
+    if (!changed) {
+        return;
+    }
+
+    std::vector<double> sorted(this->offsets.begin(), this->offsets.end());
+    const size_t n = sorted.size();
+    std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+    this->offset = sorted[n / 2];
+    if (n > 1) {
+        for (double& o : sorted) {
+            o = std::abs(o - this->offset);
+        }
+        std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+        const double spread = MAD_TO_SIGMA * sorted[n / 2];
+        this->offsetVariance = spread * spread / n;
+    }
+}
+
+/**
+ * Least squares slope of the unwrapped phase over subcarrier frequency with
+ * one intercept per rx chain. Variance is from the fit residuals.
+ */
+double TofFusion::phaseSlopeTof(const Csi& csi, double& variance) {
+    const RawHeaderData& h = csi.rawHeaderData;
+    const uint8_t* raw = csi.getRawCsiData();
+    const uint32_t n = h.numSubCarriers;
+    if (!raw || n < 2 || h.csiDataSize < (uint32_t)h.numRx * h.numTx * n * 4) {
+        return NAN;
+    }
+
+    const std::vector<double> frequencies =
+        Resampler::subcarrierFrequencies(csi.format, csi.channelWidth, n);
+    double mean = 0;
+    for (double f : frequencies) {
+        mean += f;
+    }
+    mean /= n;
+    double sxx = 0;
+    for (double f : frequencies) {
+        sxx += (f - mean) * (f - mean);
+    }
+
+    this->phase.resize(h.numRx * n);
+    double sxy = 0;
+    std::vector<double> intercepts(h.numRx);
+    for (uint32_t rx = 0; rx < h.numRx; rx++) {
+        const uint8_t* chain = raw + rx * h.numTx * n * 4;
+        double* p = &this->phase[rx * n];
+        for (uint32_t i = 0; i < n; i++) {
+            int16_t v[2];
+            memcpy(v, chain + i * 4, sizeof(v));
+            p[i] = atan2(v[1], v[0]);
+        }
+        double previous = p[0];
+        double sum = previous;
+        for (uint32_t i = 1; i < n; i++) {
+            const double wrapped = p[i];
+            p[i] = p[i - 1] + std::remainder(wrapped - previous, 2 * M_PI);
+            previous = wrapped;
+            sum += p[i];
+        }
+        intercepts[rx] = sum / n;
+        for (uint32_t i = 0; i < n; i++) {
+            sxy += (frequencies[i] - mean) * p[i];
+        }
+    }
+
+    // rad/MHz
+    const double slope = sxy / (h.numRx * sxx);
+
+    double residual = 0;
+    for (uint32_t rx = 0; rx < h.numRx; rx++) {
+        const double* p = &this->phase[rx * n];
+        for (uint32_t i = 0; i < n; i++) {
+            const double e = p[i] - intercepts[rx] - slope * (frequencies[i] - mean);
+            residual += e * e;
+        }
+    }
+    const uint32_t numValues = h.numRx * n;
+    const uint32_t dof = numValues > h.numRx + 1u ? numValues - h.numRx - 1 : 1;
+    const double slopeVariance = residual / dof / (h.numRx * sxx);
+
+    // phase = -2 pi f tof, f in MHz gives us, scaled to ns
+    const double scale = 1e3 / (2 * M_PI);
+    variance = slopeVariance * scale * scale;
+    return -slope * scale;
+}
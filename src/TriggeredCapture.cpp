@@ -0,0 +1,147 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TriggeredCapture.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "Logger.h"
+
+void TriggeredCapture::configure(triggerDetector detector,
+                                 double threshold,
+                                 double preSeconds,
+                                 double holdSeconds,
+                                 double alpha) {
+    this->detector = detector;
+    this->threshold = threshold;
+    this->pre = std::max(preSeconds, 0.0) * 1e6;
+    this->hold = std::max(holdSeconds, 0.0) * 1e6;
+    this->alpha = std::clamp(alpha, 1e-6, 1.0);
+    this->states.clear();
+    this->ring.clear();
+    this->recording = false;
+    this->recordUntil = 0;
+}
+
+triggerDetector TriggeredCapture::parseDetector(const std::string& name) {
+    if (name == "variance") {
+        return TRIGGER_VARIANCE;
+    }
+    if (name == "ratio") {
+        return TRIGGER_RATIO;
+    }
+    throw std::invalid_argument("Bad trigger detector " + name +
+                                ". Possible values [variance|ratio]");
+}
+
+void TriggeredCapture::update(const Csi& csi, UdpSocket* udpSocket) {
+    const uint64_t now = csi.rawHeaderData.timestamp;
+    const double value = this->evaluate(csi);
+
+    if (value > this->threshold) {
+        if (!this->recording) {
+            Logger::log(info) << "Trigger fired, detector " << value << ", writing "
+                              << this->ring.size() << " buffered records\n";
+            for (const RawRecord& r : this->ring) {
+                output(r.header, r.data.data(), r.clockUncertainty, udpSocket);
+            }
+            this->ring.clear();
+            this->recording = true;
+        }
+        this->recordUntil = now + this->hold;
+    } else if (this->recording && now > this->recordUntil) {
+        Logger::log(info) << "Trigger hold expired\n";
+        this->recording = false;
+    }
+
+    if (this->recording) {
+        output(csi.rawHeaderData, csi.getRawCsiData(), csi.clockUncertainty, udpSocket);
+        return;
+    }
+
+    RawRecord r;
+    r.header = csi.rawHeaderData;
+    r.clockUncertainty = csi.clockUncertainty;
+    r.data.assign(csi.getRawCsiData(), csi.getRawCsiData() + csi.rawHeaderData.csiDataSize);
+    this->ring.push_back(std::move(r));
+    while (!this->ring.empty() && (this->ring.size() > TRIGGER_RING_LIMIT ||
+                                   this->ring.front().header.timestamp + this->pre < now)) {
+        this->ring.pop_front();
+    }
+}
+
+double TriggeredCapture::evaluate(const Csi& csi) {
+    uint64_t key = 0;
+    memcpy(&key, csi.rawHeaderData.srcMac, sizeof(csi.rawHeaderData.srcMac));
+    DetectorState& s = this->states[key];
+
+    const bool ratio = this->detector == TRIGGER_RATIO;
+    if (ratio && csi.numRx < 2) {
+        return 0;
+    }
+    // Ratio of rx0 and rx1 of the first tx chain, or magnitude of all chains
+    const uint32_t numValues = ratio ? csi.numSubCarriers : csi.magnitude.size();
+    if (s.numValues != numValues) {
+        s.numValues = numValues;
+        s.count = 0;
+        s.mean.assign(numValues, 0);
+        s.variance.assign(numValues, 0);
+        s.ratioMean.assign(ratio ? numValues : 0, 0);
+    }
+
+    // Means start at the first record
+    const double a = s.count ? this->alpha : 1;
+    const uint32_t rx1 = csi.numTx * csi.numSubCarriers;
+    double sum = 0;
+    for (uint32_t i = 0; i < numValues; i++) {
+        double delta2;
+        double power;
+        if (ratio) {
+            const std::complex<double> den = csi.csi[rx1 + i];
+            const std::complex<double> r = std::abs(den) > 0 ? csi.csi[i] / den : 0.0;
+            const std::complex<double> delta = r - s.ratioMean[i];
+            s.ratioMean[i] += a * delta;
+            delta2 = std::norm(delta);
+            power = std::norm(s.ratioMean[i]);
+        } else {
+            const double delta = csi.magnitude[i] - s.mean[i];
+            s.mean[i] += a * delta;
+            delta2 = delta * delta;
+            power = s.mean[i] * s.mean[i];
+        }
+        s.variance[i] = s.count ? (1 - a) * (s.variance[i] + a * delta2) : 0;
+        sum += s.variance[i] / (power + 1e-12);
+    }
+
+    // Means need about 1 / alpha records to settle
+    if (++s.count * this->alpha < 1 || numValues == 0) {
+        return 0;
+    }
+    return sum / numValues;
+}
+
+void TriggeredCapture::output(const RawHeaderData& header,
+                              const uint8_t* data,
+                              uint32_t clockUncertainty,
+                              UdpSocket* udpSocket) {
+    if (udpSocket) {
+        Csi::sendUDP(udpSocket, header, data, clockUncertainty);
+    } else {
+        Csi::save(header, data);
+    }
+}
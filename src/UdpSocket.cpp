@@ -19,17 +19,23 @@
 #include "UdpSocket.h"
 
 #include "Arguments.h"
+#include "ClockSync.h"
+#include "ControlHandler.h"
 #include "Logger.h"
 #include "MainController.h"
+#include "StreamProtocol.h"
+#include <algorithm>
+#include <errno.h>
 #include <netdb.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #define PORT "8008"
-#define BUF_SIZE 1024
+#define BUF_SIZE 8192
 
 void UdpSocket::init() {
   MainController *mainController = MainController::getInstance();
@@ -76,15 +82,61 @@ void UdpSocket::init() {
 
   freeaddrinfo(result); /* No longer needed */
 
+  /* Wake up regularly to expire subscriptions */
+  struct timeval timeout = {1, 0};
+  setsockopt(sfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
   /* Read datagrams and echo them back to sender */
 
   while (1) {
     char buf[BUF_SIZE] = {0};
-    peer_addr_len = sizeof(struct sockaddr_storage);
-    nread = recvfrom(sfd, buf, BUF_SIZE, 0, (struct sockaddr *)&peer_addr,
-                     &peer_addr_len);
+    struct sockaddr_storage from;
+    socklen_t from_len = sizeof(struct sockaddr_storage);
+    this->subscriptions.expire();
+    if (this->hasPeer)
+      this->hasPeer = !this->subscriptions.contains(peer_addr, peer_addr_len);
+    nread = recvfrom(sfd, buf, BUF_SIZE - 1, 0, (struct sockaddr *)&from,
+                     &from_len);
+    const int64_t received = ClockSync::localTime();
     if (nread == -1)
-      continue; /* Ignore failed request */
+      continue; /* Ignore failed request or timeout */
+
+    if (ClockSync::answer(sfd, buf, nread, received, (struct sockaddr *)&from,
+                          from_len))
+      continue;
+
+    if (this->subscriptions.handle(sfd, buf, nread, from, from_len))
+      continue;
+
+    {
+      const std::shared_ptr<const Args> args = Arguments::snapshot();
+      std::lock_guard<std::mutex> lock(this->framerMutex);
+      if (this->framer.resend(buf, nread,
+                              [&](const StreamHistoryRecord &record, uint16_t index) {
+                                this->sendFragment(record, index, STREAM_FLAG_RETRANSMIT,
+                                                   *args);
+                                this->retransmitted++;
+                              }))
+        continue;
+    }
+
+    std::vector<char> reply;
+    bool started;
+    if (ControlHandler::handle(buf, nread, this, reply, started)) {
+      sendto(sfd, reply.data(), reply.size(), 0, (struct sockaddr *)&from,
+             from_len);
+      /* The peer that started capture gets the records like with text commands */
+      if (started) {
+        memcpy(&peer_addr, &from, from_len);
+        peer_addr_len = from_len;
+        this->hasPeer = !this->subscriptions.contains(peer_addr, peer_addr_len);
+      }
+      continue;
+    }
+
+    memcpy(&peer_addr, &from, from_len);
+    peer_addr_len = from_len;
+    this->hasPeer = !this->subscriptions.contains(peer_addr, peer_addr_len);
 
     char host[NI_MAXHOST], service[NI_MAXSERV];
 
@@ -92,7 +144,7 @@ void UdpSocket::init() {
                     NI_MAXHOST, service, NI_MAXSERV, NI_NUMERICSERV);
     if (s == 0) {
       if (strncmp(buf, "stop", 4) == 0) {
-        if (this->running) {
+        if (this->running || mainController->isInterfaceReady()) {
           mainController->restoreState();
           this->running = false;
         }
@@ -102,7 +154,7 @@ void UdpSocket::init() {
 
         std::string token;
         int index = 0;
-        while (iss >> token) {
+        while (index < 128 && iss >> token) {
           char *arg = new char[token.size() + 1];
           copy(token.begin(), token.end(), arg);
           arg[token.size()] = '\0';
@@ -110,12 +162,20 @@ void UdpSocket::init() {
           index++;
         }
 
-        Arguments::parse(index, &args[0]);
+        // Parsed into a copy, the capture threads see it once it is published
+        const std::shared_ptr<const Args> previous = Arguments::snapshot();
+        Args next = *previous;
+        Arguments::parse(index, &args[0], next);
+        Arguments::publish(next);
 
-        for (int i = 0; i < index - 1; i++)
+        for (int i = 0; i < index; i++)
           delete[] args[i];
 
-        mainController->runNoGui(true);
+        /* Already capturing, only what changed is applied */
+        if (this->running && mainController->isCapturing())
+          mainController->reconfigure(*previous);
+        else
+          mainController->startCapture();
         this->running = true;
       }
     } else {
@@ -124,9 +184,349 @@ void UdpSocket::init() {
   }
 }
 
-void UdpSocket::send(char *buf, int size) {
-  if (sendto(sfd, buf, size, 0, (struct sockaddr *)&peer_addr, peer_addr_len) !=
-      size) {
-    Logger::log(error) << "Error sending response \n";
+void UdpSocket::setPeer(const struct sockaddr *address, socklen_t length) {
+  sfd = socket(address->sa_family, SOCK_DGRAM, 0);
+  if (sfd == -1)
+    throw std::ios_base::failure("UDP socket failed: " +
+                                 std::string(strerror(errno)));
+  memcpy(&peer_addr, address, length);
+  peer_addr_len = length;
+  this->hasPeer = true;
+}
+
+UdpSocket::~UdpSocket() {
+  {
+    std::lock_guard<std::mutex> lock(this->batchMutex);
+    this->stopping = true;
+  }
+  this->flusherWake.notify_all();
+  if (this->flusher.joinable())
+    this->flusher.join();
+  this->flush();
+}
+
+void UdpSocket::send(char *buf, int size, const StreamRecordInfo &info) {
+  struct iovec iov = {buf, (size_t)size};
+  this->send(&iov, 1, info);
+}
+
+void UdpSocket::send(const struct iovec *iov, int iovcnt,
+                     const StreamRecordInfo &info) {
+  // The control thread may replace the arguments while the record is sent
+  const std::shared_ptr<const Args> snapshot = Arguments::snapshot();
+  const Args &args = *snapshot;
+  this->subscriptions.publish(iov, iovcnt, info);
+  if (!args.shmName.empty())
+    this->publishShm(iov, iovcnt, info, args);
+  if (!args.streamListen.empty())
+    this->publishStream(iov, iovcnt, args);
+  if (!args.multicastGroup.empty())
+    this->publishMulticast(iov, iovcnt, args);
+  if (!args.aggregator.empty())
+    this->publishUplink(iov, iovcnt, info, args);
+  if (!this->hasPeer)
+    return;
+
+  if (args.udpFrame) {
+    this->sendFramed(iov, iovcnt, args);
+  } else if (args.udpBatch <= 1) {
+    this->sendDatagram(iov, iovcnt);
+  } else {
+    StreamRecordData record = gatherRecord(iov, iovcnt);
+    this->queueDatagram(record, nullptr, record->data(), record->size(), args);
+  }
+}
+
+void UdpSocket::publishShm(const struct iovec *iov, int iovcnt,
+                           const StreamRecordInfo &recordInfo, const Args &args) {
+  std::lock_guard<std::mutex> lock(this->shmMutex);
+  const std::string &name = args.shmName;
+  if (!this->shm || this->shm->getName() != name) {
+    if (name == this->shmFailed)
+      return;
+    this->shm.reset();
+    try {
+      this->shm = std::make_unique<ShmRingSink>(
+          name, (size_t)args.shmSize << 20);
+      Logger::log(info) << "Shared memory ring /dev/shm/" << name << "\n";
+    } catch (const std::ios_base::failure &e) {
+      Logger::log(error) << e.what() << "\n";
+      this->shmFailed = name;
+      return;
+    }
+  }
+  this->shm->publish(iov, iovcnt, recordInfo);
+}
+
+void UdpSocket::publishStream(const struct iovec *iov, int iovcnt,
+                              const Args &args) {
+  std::shared_ptr<StreamServer> stream;
+  {
+    std::lock_guard<std::mutex> lock(this->streamMutex);
+    const std::string config = args.streamListen + " " +
+                               std::to_string(args.streamBuffer) + " " +
+                               args.streamBackpressure;
+    if (config != this->streamConfig) {
+      this->streamConfig = config;
+      this->stream.reset();
+      try {
+        this->stream = std::make_shared<StreamServer>(
+            args.streamListen, (size_t)args.streamBuffer << 20,
+            StreamServer::parseBackpressure(args.streamBackpressure));
+      } catch (const std::exception &e) {
+        Logger::log(error) << e.what() << "\n";
+      }
+    }
+    stream = this->stream;
+  }
+  // Without the lock, blocking backpressure must not hold up other senders
+  if (stream)
+    stream->publish(iov, iovcnt);
+}
+
+void UdpSocket::publishMulticast(const struct iovec *iov, int iovcnt,
+                                 const Args &args) {
+  std::lock_guard<std::mutex> lock(this->multicastMutex);
+  const uint32_t mtu = args.udpFrame ? args.udpFrame : STREAM_DEFAULT_MTU;
+  const std::string config = args.multicastGroup + " " +
+                             std::to_string(args.multicastTtl) + " " +
+                             args.multicastInterface + " " + std::to_string(mtu);
+  if (config != this->multicastConfig) {
+    this->multicastConfig = config;
+    this->multicast.reset();
+    try {
+      this->multicast = std::make_unique<MulticastSink>(
+          args.multicastGroup, args.multicastTtl, args.multicastInterface, mtu);
+    } catch (const std::exception &e) {
+      Logger::log(error) << e.what() << "\n";
+    }
+  }
+  if (this->multicast)
+    this->multicast->publish(iov, iovcnt);
+}
+
+void UdpSocket::publishUplink(const struct iovec *iov, int iovcnt,
+                              const StreamRecordInfo &recordInfo,
+                              const Args &args) {
+  std::lock_guard<std::mutex> lock(this->uplinkMutex);
+  const uint32_t mtu = args.udpFrame ? args.udpFrame : STREAM_DEFAULT_MTU;
+  const std::string config = args.aggregator + " " + std::to_string(mtu);
+  if (config != this->uplinkConfig) {
+    this->uplinkConfig = config;
+    StreamUplink::release(std::move(this->uplink));
+    try {
+      this->uplink = std::make_unique<StreamUplink>(args.aggregator, mtu);
+    } catch (const std::exception &e) {
+      Logger::log(error) << e.what() << "\n";
+    }
+  }
+  if (this->uplink)
+    this->uplink->publish(iov, iovcnt, recordInfo);
+}
+
+void UdpSocket::sendFramed(const struct iovec *iov, int iovcnt,
+                           const Args &args) {
+  std::lock_guard<std::mutex> lock(this->framerMutex);
+  const StreamHistoryRecord *record =
+      this->framer.add(gatherRecord(iov, iovcnt), args.udpFrame);
+  if (!record) {
+    this->dropped++;
+    return;
+  }
+  for (uint16_t i = 0; i < record->fragmentCount; i++)
+    this->sendFragment(*record, i, 0, args);
+}
+
+void UdpSocket::sendFragment(const StreamHistoryRecord &record, uint16_t index,
+                             uint8_t flags, const Args &args) {
+  StreamFrameHeader h;
+  struct iovec iov[2] = {{&h, sizeof(h)}, {}};
+  this->framer.fragment(record, index, flags, h, iov[1]);
+  if (args.udpBatch <= 1)
+    this->sendDatagram(iov, 2);
+  else
+    this->queueDatagram(record.data, &h, static_cast<const char *>(iov[1].iov_base),
+                        iov[1].iov_len, args);
+}
+
+// Copy of the record the batch and the framer history keep, the caller's
+// buffers are freed right after send returns
+StreamRecordData UdpSocket::gatherRecord(const struct iovec *iov, int iovcnt) {
+  size_t size = 0;
+  for (int i = 0; i < iovcnt; i++)
+    size += iov[i].iov_len;
+  auto data = std::make_shared<std::vector<char>>();
+  data->reserve(size);
+  for (int i = 0; i < iovcnt; i++) {
+    const char *base = static_cast<const char *>(iov[i].iov_base);
+    data->insert(data->end(), base, base + iov[i].iov_len);
+  }
+  return data;
+}
+
+void UdpSocket::sendDatagram(const struct iovec *iov, int iovcnt) {
+  struct msghdr msg = {};
+  msg.msg_name = &peer_addr;
+  msg.msg_namelen = peer_addr_len;
+  msg.msg_iov = const_cast<struct iovec *>(iov);
+  msg.msg_iovlen = iovcnt;
+  ssize_t n = sendmsg(sfd, &msg, MSG_DONTWAIT);
+  if (n < 0) {
+    this->dropped++;
+  } else {
+    this->sent++;
+    this->batches++;
+    this->bytes += n;
+  }
+}
+
+void UdpSocket::queueDatagram(const StreamRecordData &record,
+                              const StreamFrameHeader *header,
+                              const char *payload, size_t payloadSize,
+                              const Args &args) {
+  std::unique_lock<std::mutex> lock(this->batchMutex);
+  const bool first = this->queued.empty();
+  if (first)
+    this->oldest = std::chrono::steady_clock::now();
+
+  // Fragments of one record share its buffer, it is referenced once
+  QueuedDatagram &datagram = this->queued.emplace_back();
+  datagram.framed = header != nullptr;
+  if (header)
+    datagram.header = *header;
+  datagram.payload = payload;
+  datagram.payloadSize = payloadSize;
+  if (this->records.empty() || this->records.back() != record)
+    this->records.push_back(record);
+
+  if (this->queued.size() >= args.udpBatch) {
+    this->flushLocked();
+  } else if (!this->flusher.joinable()) {
+    this->flusher = std::thread(&UdpSocket::flushLoop, this);
+  } else if (first) {
+    // Arms the flush timer of the new batch
+    this->flusherWake.notify_one();
+  }
+}
+
+void UdpSocket::flush() {
+  std::lock_guard<std::mutex> lock(this->batchMutex);
+  this->flushLocked();
+}
+
+void UdpSocket::flushLocked() {
+  const size_t count = this->queued.size();
+  if (count == 0)
+    return;
+
+  // Built only now, queued is not moved any more until it is cleared
+  std::vector<struct iovec> &iovs = this->iovs;
+  std::vector<struct mmsghdr> &messages = this->messages;
+  iovs.resize(2 * count);
+  messages.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    QueuedDatagram &datagram = this->queued[i];
+    struct iovec *iov = &iovs[2 * i];
+    size_t iovcnt = 0;
+    if (datagram.framed)
+      iov[iovcnt++] = {&datagram.header, sizeof(datagram.header)};
+    iov[iovcnt++] = {const_cast<char *>(datagram.payload), datagram.payloadSize};
+    memset(&messages[i], 0, sizeof(struct mmsghdr));
+    messages[i].msg_hdr.msg_name = &peer_addr;
+    messages[i].msg_hdr.msg_namelen = peer_addr_len;
+    messages[i].msg_hdr.msg_iov = iov;
+    messages[i].msg_hdr.msg_iovlen = iovcnt;
+  }
+
+  size_t first = 0;
+  while (first < count) {
+    int n = sendmmsg(sfd, &messages[first], count - first, MSG_DONTWAIT);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+        // Socket buffer is full, the rest of the batch is dropped
+        this->dropped += count - first;
+        break;
+      }
+      // Only the first message failed, e.g. too big for a datagram
+      this->dropped++;
+      first++;
+      continue;
+    }
+    this->batches++;
+    for (int i = 0; i < n; i++)
+      this->bytes += messages[first + i].msg_len;
+    this->sent += n;
+    first += n;
+  }
+
+  this->queued.clear();
+  this->records.clear();
+}
+
+void UdpSocket::flushLoop() {
+  const auto interval = std::chrono::microseconds(UDP_FLUSH_INTERVAL_US);
+  std::unique_lock<std::mutex> lock(this->batchMutex);
+  while (!this->stopping) {
+    // Sleeps without a timeout while nothing is queued
+    if (this->queued.empty()) {
+      this->flusherWake.wait(lock);
+      continue;
+    }
+    const auto deadline = this->oldest + interval;
+    if (std::chrono::steady_clock::now() >= deadline)
+      this->flushLocked();
+    else
+      this->flusherWake.wait_until(lock, deadline);
+  }
+}
+
+UdpStats UdpSocket::getStats() const {
+  UdpStats stats;
+  stats.sent = this->sent;
+  stats.dropped = this->dropped;
+  stats.batches = this->batches;
+  stats.bytes = this->bytes;
+  stats.retransmitted = this->retransmitted;
+  return stats;
+}
+
+// Rates since the previous call, CPU time is of the whole process
+void UdpSocket::logStats() {
+  const UdpStats stats = this->getStats();
+  const auto now = std::chrono::steady_clock::now();
+  struct timespec cpu;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+  const double cpuTime = cpu.tv_sec + cpu.tv_nsec * 1e-9;
+
+  if (this->lastStatsTime.time_since_epoch().count()) {
+    const double seconds =
+        std::chrono::duration<double>(now - this->lastStatsTime).count();
+    const uint64_t packets = stats.sent - this->lastStats.sent;
+    const uint64_t batches = stats.batches - this->lastStats.batches;
+    Logger::log(info) << "UDP " << packets / seconds << " packets/s, "
+                      << (stats.bytes - this->lastStats.bytes) / seconds / 1e6
+                      << " MB/s, "
+                      << (batches ? (double)packets / batches : 0)
+                      << " packets/batch, "
+                      << (packets ? (cpuTime - this->lastCpuTime) * 1e6 / packets : 0)
+                      << " us CPU/packet, " << stats.dropped << " dropped, "
+                      << stats.retransmitted << " retransmitted\n";
+  }
+  this->lastStats = stats;
+  this->lastStatsTime = now;
+  this->lastCpuTime = cpuTime;
+  this->subscriptions.logStats();
+  {
+    std::lock_guard<std::mutex> lock(this->multicastMutex);
+    if (this->multicast)
+      this->multicast->logStats();
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->uplinkMutex);
+    if (this->uplink)
+      this->uplink->logStats();
   }
+  std::lock_guard<std::mutex> lock(this->streamMutex);
+  if (this->stream)
+    this->stream->logStats();
 }
\ No newline at end of file
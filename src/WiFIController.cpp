@@ -512,7 +512,7 @@ int WiFIController::setInterfaceStatus(const std::string interfaceName, bool up)
         return err;
     }
 
-    if (Arguments::arguments.verbose) {
+    if (Arguments::snapshot()->verbose) {
         Logger::log(info) << "Interface " << interfaceName << " has been brought "
                           << (up ? "up" : "down") << "\n";
     }
@@ -554,7 +554,7 @@ void WiFIController::createMonitorInterface(uint32_t phy_index,
     std::this_thread::sleep_for(std::chrono::milliseconds(250));
 
     while ((err = setInterfaceFrequency(MONITOR_INTERFACE_NAME, frequency,
-                                        Arguments::arguments.bandwidth.c_str())) < 0) {
+                                        Arguments::snapshot()->bandwidth.c_str())) < 0) {
         Logger::log(error) << "Failed to set frequency (" << err << ")\n";
         rfkill_unblock();
         std::this_thread::sleep_for(std::chrono::milliseconds(250));
@@ -579,7 +579,7 @@ void WiFIController::createApInterface(uint32_t phy_index,
     std::this_thread::sleep_for(std::chrono::milliseconds(250));
 
     while ((err = setInterfaceFrequency(MONITOR_INTERFACE_NAME, frequency,
-                                        Arguments::arguments.bandwidth.c_str())) < 0) {
+                                        Arguments::snapshot()->bandwidth.c_str())) < 0) {
         Logger::log(error) << "Failed to set frequency (" << err << ")\n";
         rfkill_unblock();
         std::this_thread::sleep_for(std::chrono::milliseconds(250));
@@ -36,6 +36,7 @@
 
 void WiFiCsiController::init() {
     Netlink::init();
+    this->graph = ProcessingGraph::create();
     this->enableCsi();
 }
 
@@ -64,8 +65,11 @@ nla_put_failure:
 }
 
 int WiFiCsiController::processListenToCsiHandler(struct nl_msg* msg, void* arg) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     struct nlattr* attrs[MAX_CMD + 1];
     struct nlmsghdr* nlh = nlmsg_hdr(msg);
+    void** arguments = (void**)arg;
+    WiFiCsiController* wcc = (WiFiCsiController*)arguments[0];
 
     nlmsg_parse(nlh, 32, attrs, MAX_CMD, NULL);
     if (attrs[IWL_MVM_VENDOR_ATTR_CSI_HDR]) {
@@ -86,50 +90,50 @@ int WiFiCsiController::processListenToCsiHandler(struct nl_msg* msg, void* arg)
 
             Csi* c = new Csi();
             c->loadFromMemory(header, dataCsi);
+            bool queued = false;
 
             if ((c->channelWidth == RATE_MCS_CHAN_WIDTH_20 &&
-                 Arguments::arguments.channelWidth == 20) ||
+                 args->channelWidth == 20) ||
                 (c->channelWidth == RATE_MCS_CHAN_WIDTH_40 &&
-                 Arguments::arguments.channelWidth == 40) ||
+                 args->channelWidth == 40) ||
                 (c->channelWidth == RATE_MCS_CHAN_WIDTH_80 &&
-                 Arguments::arguments.channelWidth == 80) ||
+                 args->channelWidth == 80) ||
                 (c->channelWidth == RATE_MCS_CHAN_WIDTH_160 &&
-                 Arguments::arguments.channelWidth == 160)
+                 args->channelWidth == 160)
 
             ) {
                 if ((c->format == RATE_MCS_LEGACY_OFDM_MSK &&
-                     Arguments::arguments.format == "NOHT") ||
-                    (c->format == RATE_MCS_HT_MSK && Arguments::arguments.format == "HT") ||
-                    (c->format == RATE_MCS_VHT_MSK && Arguments::arguments.format == "VHT") ||
-                    (c->format == RATE_MCS_HE_MSK && Arguments::arguments.format == "HESU") ||
-                    (c->format == RATE_MCS_EHT_MSK && Arguments::arguments.format == "EHT")
+                     args->format == "NOHT") ||
+                    (c->format == RATE_MCS_HT_MSK && args->format == "HT") ||
+                    (c->format == RATE_MCS_VHT_MSK && args->format == "VHT") ||
+                    (c->format == RATE_MCS_HE_MSK && args->format == "HESU") ||
+                    (c->format == RATE_MCS_EHT_MSK && args->format == "EHT")
 
                 ) {
-                    if (!Arguments::arguments.strict ||
-                        (Arguments::arguments.strict &&
+                    if (!args->strict ||
+                        (args->strict &&
                          (c->rawHeaderData.rateNflag & RATE_LEGACY_RATE_MSK) ==
-                             Arguments::arguments.mcs)) {
-                        if (Arguments::arguments.verbose) {
+                             args->mcs)) {
+                        if (args->verbose) {
                             printDetail(c);
                         }
-                        if (MainController::getInstance()->udpSocket) {
-                            c->sendUDP(MainController::getInstance()->udpSocket);
-                        } else {
-                            c->save();
-                        }
-                        if (Arguments::arguments.plot) {
+                        wcc->output(c);
+                        if (args->plot) {
                             WiFiCsiController::csiQueueMutex.lock();
                             WiFiCsiController::csiQueue.push(c);
                             WiFiCsiController::csiQueueMutex.unlock();
+                            queued = true;
                         }
                     }
                 }
             }
+
+            if (!queued) {
+                delete c;
+            }
         }
     }
 
-    void** arguments = (void**)arg;
-    WiFiCsiController* wcc = (WiFiCsiController*)arguments[0];
     auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
                    std::chrono::system_clock::now().time_since_epoch())
                    .count();
@@ -140,6 +144,18 @@ int WiFiCsiController::processListenToCsiHandler(struct nl_msg* msg, void* arg)
     return NL_SKIP;
 }
 
+void WiFiCsiController::output(Csi* c) {
+    this->graph->run(*c, MainController::getInstance()->udpSocket);
+
+    this->processedCount++;
+    if (Arguments::snapshot()->verbose && this->processedCount % 1000 == 0) {
+        this->graph->logTimings();
+        if (MainController::getInstance()->udpSocket) {
+            MainController::getInstance()->udpSocket->logStats();
+        }
+    }
+}
+
 void WiFiCsiController::printDetail(Csi* c) {
     Logger::log(info) << "Subcarrier count: " << c->rawHeaderData.numSubCarriers << ", ";
     Logger::log(info, true) << "RX: " << +c->rawHeaderData.numRx << ", ";
@@ -182,7 +198,7 @@ void WiFiCsiController::printDetail(Csi* c) {
 }
 
 void WiFiCsiController::enableCsi(bool enable) {
-    if (Arguments::arguments.verbose) {
+    if (Arguments::snapshot()->verbose) {
         if (enable) {
             Logger::log(info) << "Enabling CSI measurement\n";
         } else {
@@ -217,5 +233,8 @@ void WiFiCsiController::enableCsi(bool enable) {
 }
 
 WiFiCsiController::~WiFiCsiController() {
+    if (this->graph && Arguments::snapshot()->verbose) {
+        this->graph->logTimings();
+    }
     this->enableCsi(false);
 }
\ No newline at end of file
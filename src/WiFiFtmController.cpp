@@ -23,8 +23,10 @@
 #include <filesystem>
 #include <fstream>
 #include "Arguments.h"
+#include "ClockSync.h"
 #include "Logger.h"
 #include "MainController.h"
+#include "TofFusion.h"
 #include "main.h"
 
 uint8_t beaconHeader[] = {0x80, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xea, 0xb9,
@@ -77,43 +79,44 @@ int WiFiFtmController::setApMode() {
 }
 
 int WiFiFtmController::ftmHandler(struct nl80211_state* state, struct nl_msg* msg, void* arg) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     struct nlattr *pmsr, *peers, *peer, *req, *reqdata, *ftm, *chan;
 
     pmsr = nla_nest_start(msg, NL80211_ATTR_PEER_MEASUREMENTS);
     peers = nla_nest_start(msg, NL80211_PMSR_ATTR_PEERS);
 
     peer = nla_nest_start(msg, 1);  // TODO multiple peers
-    NLA_PUT(msg, NL80211_PMSR_PEER_ATTR_ADDR, ETH_ALEN, Arguments::arguments.ftmTargetMac);
+    NLA_PUT(msg, NL80211_PMSR_PEER_ATTR_ADDR, ETH_ALEN, args->ftmTargetMac);
 
     req = nla_nest_start(msg, NL80211_PMSR_PEER_ATTR_REQ);
     reqdata = nla_nest_start(msg, NL80211_PMSR_REQ_ATTR_DATA);
     ftm = nla_nest_start(msg, NL80211_PMSR_TYPE_FTM);
 
-    if (Arguments::arguments.ftmBurstExp) {
-        NLA_PUT_U8(msg, NL80211_PMSR_FTM_REQ_ATTR_NUM_BURSTS_EXP, Arguments::arguments.ftmBurstExp);
+    if (args->ftmBurstExp) {
+        NLA_PUT_U8(msg, NL80211_PMSR_FTM_REQ_ATTR_NUM_BURSTS_EXP, args->ftmBurstExp);
     }
-    if (Arguments::arguments.ftmBurstPeriod) {
+    if (args->ftmBurstPeriod) {
         NLA_PUT_U16(msg, NL80211_PMSR_FTM_REQ_ATTR_BURST_PERIOD,
-                    Arguments::arguments.ftmBurstPeriod);
+                    args->ftmBurstPeriod);
     }
-    if (Arguments::arguments.ftmBurstDuration) {
+    if (args->ftmBurstDuration) {
         NLA_PUT_U8(msg, NL80211_PMSR_FTM_REQ_ATTR_BURST_DURATION,
-                   Arguments::arguments.ftmBurstDuration);
+                   args->ftmBurstDuration);
     }
-    if (Arguments::arguments.ftmPerBurst) {
-        NLA_PUT_U8(msg, NL80211_PMSR_FTM_REQ_ATTR_FTMS_PER_BURST, Arguments::arguments.ftmPerBurst);
+    if (args->ftmPerBurst) {
+        NLA_PUT_U8(msg, NL80211_PMSR_FTM_REQ_ATTR_FTMS_PER_BURST, args->ftmPerBurst);
     }
-    if (Arguments::arguments.ftmAsap) {
+    if (args->ftmAsap) {
         NLA_PUT_FLAG(msg, NL80211_PMSR_FTM_REQ_ATTR_ASAP);
     }
 
-    if (Arguments::arguments.format == "NOHT") {
+    if (args->format == "NOHT") {
         NLA_PUT_U32(msg, NL80211_PMSR_FTM_REQ_ATTR_PREAMBLE, NL80211_PREAMBLE_LEGACY);
-    } else if (Arguments::arguments.format == "HT") {
+    } else if (args->format == "HT") {
         NLA_PUT_U32(msg, NL80211_PMSR_FTM_REQ_ATTR_PREAMBLE, NL80211_PREAMBLE_HT);
-    } else if (Arguments::arguments.format == "VHT") {
+    } else if (args->format == "VHT") {
         NLA_PUT_U32(msg, NL80211_PMSR_FTM_REQ_ATTR_PREAMBLE, NL80211_PREAMBLE_VHT);
-    } else if (Arguments::arguments.format == "HESU") {
+    } else if (args->format == "HESU") {
         NLA_PUT_U32(msg, NL80211_PMSR_FTM_REQ_ATTR_PREAMBLE, NL80211_PREAMBLE_HE);
     }
 
@@ -122,9 +125,9 @@ int WiFiFtmController::ftmHandler(struct nl80211_state* state, struct nl_msg* ms
     nla_nest_end(msg, req);
 
     chan = nla_nest_start(msg, NL80211_PMSR_PEER_ATTR_CHAN);
-    NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_FREQ, (uint32_t)Arguments::arguments.frequency);
+    NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_FREQ, (uint32_t)args->frequency);
 
-    switch (Arguments::arguments.channelWidth) {
+    switch (args->channelWidth) {
         case 20:
             NLA_PUT_U32(msg, NL80211_ATTR_CHANNEL_WIDTH, NL80211_CHAN_WIDTH_20);
             break;
@@ -155,6 +158,7 @@ nla_put_failure:
 int WiFiFtmController::ftmResponderHandler(struct nl80211_state* state,
                                            struct nl_msg* msg,
                                            void* arg) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     NLA_PUT(msg, NL80211_ATTR_BEACON_HEAD, 58, beaconHeader);
 
     NLA_PUT_U32(msg, NL80211_ATTR_BEACON_INTERVAL, 100);
@@ -168,8 +172,8 @@ int WiFiFtmController::ftmResponderHandler(struct nl80211_state* state,
     NLA_PUT_FLAG(msg, NL80211_FTM_RESP_ATTR_ENABLED);
     nla_nest_end(msg, ftm);
 
-    NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_FREQ, (uint32_t)Arguments::arguments.frequency);
-    switch (Arguments::arguments.channelWidth) {
+    NLA_PUT_U32(msg, NL80211_ATTR_WIPHY_FREQ, (uint32_t)args->frequency);
+    switch (args->channelWidth) {
         case 20:
             NLA_PUT_U32(msg, NL80211_ATTR_CHANNEL_WIDTH, NL80211_CHAN_WIDTH_20);
             break;
@@ -206,6 +210,7 @@ nla_put_failure:
 }
 
 int WiFiFtmController::processFtmHandler(struct nl_msg* msg, void* arg) {
+    const std::shared_ptr<const Args> args = Arguments::snapshot();
     struct genlmsghdr* gnlh = (genlmsghdr*)nlmsg_data(nlmsg_hdr(msg));
     struct nlattr* tb[NL80211_ATTR_MAX + 1];
 
@@ -263,13 +268,14 @@ int WiFiFtmController::processFtmHandler(struct nl_msg* msg, void* arg) {
         WiFiFtmController* wfc = (WiFiFtmController*)arg;
         if (ftm[NL80211_PMSR_FTM_RESP_ATTR_FAIL_REASON]) {
             uint32_t reason = nla_get_u32(ftm[NL80211_PMSR_FTM_RESP_ATTR_FAIL_REASON]);
-            if (Arguments::arguments.verbose) {
+            if (args->verbose) {
                 Logger::log(info) << "FTM failed to measure " << reason << "\n";
             }
             wfc->lastRttIsSuccess = false;
             return NL_OK;
         }
 
+        uint32_t clockUncertainty;
         Ftm ftmData{
             .burstIndex = (uint32_t)(ftm[NL80211_PMSR_FTM_RESP_ATTR_BURST_INDEX]
                                          ? nla_get_u32(ftm[NL80211_PMSR_FTM_RESP_ATTR_BURST_INDEX])
@@ -320,21 +326,22 @@ int WiFiFtmController::processFtmHandler(struct nl_msg* msg, void* arg) {
             .distSpread = (uint64_t)(ftm[NL80211_PMSR_FTM_RESP_ATTR_DIST_SPREAD]
                                          ? nla_get_u64(ftm[NL80211_PMSR_FTM_RESP_ATTR_DIST_SPREAD])
                                          : 0),
-            .timestamp = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
-                             std::chrono::system_clock::now().time_since_epoch())
-                             .count(),
+            .timestamp = ClockSync::getInstance().now(&clockUncertainty),
         };
 
-        if (Arguments::arguments.verbose) {
+        if (args->verbose) {
             Logger::log(info) << "FTM average RTT: " << ftmData.rttAvg << "ps\n";
         }
+        TofFusion::addFtm(ftmData);
 
         if (MainController::getInstance()->udpSocket) {
-            MainController::getInstance()->udpSocket->send(reinterpret_cast<char*>(&ftmData),
-                                                           FTM_SIZE);
+            MainController::getInstance()->udpSocket->send(
+                reinterpret_cast<char*>(&ftmData), FTM_SIZE,
+                {STREAM_FORMAT_FTM, 0, args->ftmTargetMac, ftmData.timestamp,
+                 clockUncertainty});
         } else {
             std::ofstream outfile;
-            std::string filename = std::string("FTM_") + Arguments::arguments.outputFile;
+            std::string filename = std::string("FTM_") + args->outputFile;
             outfile.open(filename, std::ios_base::app | std::ios::binary);
             if (outfile.fail()) {
                 throw std::ios_base::failure("Open file failed: " +
@@ -54,6 +54,7 @@ void CsiProcessingWindow::init(Glib::RefPtr<Gtk::Builder> &builder)
 void CsiProcessingWindow::inputFileChange()
 {
     Arguments::arguments.inputFile = this->inputFile->get_filename();
+    Arguments::publish();
     csiProcessor.loadCsi();
     this->refresh();
 }
@@ -96,6 +97,7 @@ void CsiProcessingWindow::interpolationLinearRadioButtonClicked()
     if (!this->csiProcessor.csiData.empty())
     {
         Arguments::arguments.processors[processor::interpolateLinear] = this->interpolationLinearRadioButton->get_active();
+        Arguments::publish();
         this->csiProcessor.process(*this->csiProcessor.csiData[this->currentIndex]);
         this->refresh();
     }
@@ -106,6 +108,7 @@ void CsiProcessingWindow::interpolationCubicRadioButtonClicked()
     if (!this->csiProcessor.csiData.empty())
     {
         Arguments::arguments.processors[processor::interpolateCubic] = this->interpolationCubicRadioButton->get_active();
+        Arguments::publish();
         this->csiProcessor.process(*this->csiProcessor.csiData[this->currentIndex]);
         this->refresh();
     }
@@ -116,6 +119,7 @@ void CsiProcessingWindow::interpolationCosineButtonClicked()
     if (!this->csiProcessor.csiData.empty())
     {
         Arguments::arguments.processors[processor::interpolateCosine] = this->interpolationCosineButton->get_active();
+        Arguments::publish();
         this->csiProcessor.process(*this->csiProcessor.csiData[this->currentIndex]);
         this->refresh();
     }
@@ -126,6 +130,7 @@ void CsiProcessingWindow::phaseLinearTransformCheckButtonClicked()
     if (!this->csiProcessor.csiData.empty())
     {
         Arguments::arguments.processors[processor::phaseCalibrationLinearTransform] = this->phaseLinearTransformCheckButton->get_active();
+        Arguments::publish();
         this->csiProcessor.process(*this->csiProcessor.csiData[this->currentIndex]);
         this->refresh();
     }
@@ -136,6 +141,7 @@ void CsiProcessingWindow::processingSaveGtkButtonClicked()
     if (!this->csiProcessor.csiData.empty())
     {
         Arguments::arguments.outputFile = "processedCsi.bin";
+        Arguments::publish();
         this->csiProcessor.saveCsi();
     }
 }
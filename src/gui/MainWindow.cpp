@@ -146,6 +146,7 @@ void MainWindow::frequencyChange()
 {
     int v = std::atoi(this->frequency->get_text().raw().c_str());
     Arguments::arguments.frequency = (uint16_t)v;
+    Arguments::publish();
 }
 
 void MainWindow::channelWidthChange()
@@ -153,63 +154,74 @@ void MainWindow::channelWidthChange()
     Arguments::arguments.bandwidth = this->channelWidth->get_active_text().raw();
     struct ChanMode chMode = WiFIController::getChanMode(Arguments::arguments.bandwidth.c_str());
     Arguments::arguments.channelWidth = WiFIController::chanModeToWidth(chMode);
+    Arguments::publish();
 }
 
 void MainWindow::outputFileChange()
 {
     Arguments::arguments.outputFile = this->outputFile->get_filename();
+    Arguments::publish();
     this->filePath->set_text(Arguments::arguments.outputFile);
 }
 
 void MainWindow::formatChange()
 {
     Arguments::arguments.format = this->format->get_active_text().raw();
+    Arguments::publish();
 }
 
 void MainWindow::mcsChange()
 {
     int v = std::atoi(this->mcs->get_active_text().raw().c_str());
     Arguments::arguments.mcs = (uint8_t)v;
+    Arguments::publish();
 }
 
 void MainWindow::spatialStreamsChange()
 {
     int v = std::atoi(this->spatialStreams->get_active_text().raw().c_str());
     Arguments::arguments.spatialStreams = (uint8_t)v;
+    Arguments::publish();
 }
 
 void MainWindow::ltfChange()
 {
     Arguments::arguments.ltf = this->ltf->get_active_text().raw();
+    Arguments::publish();
 }
 
 void MainWindow::guardIntervalChange()
 {
     int v = std::atoi(this->guardInterval->get_active_text().raw().c_str());
     Arguments::arguments.guardInterval = (uint16_t)v;
+    Arguments::publish();
 }
 
 void MainWindow::txPowerChange()
 {
     int v = std::atoi(this->txPower->get_active_text().raw().c_str());
     Arguments::arguments.txPower = (uint8_t)v;
+    Arguments::publish();
 }
 
 void MainWindow::codingChange()
 {
     Arguments::arguments.coding = this->coding->get_active_text().raw();
+    Arguments::publish();
 }
 
 void MainWindow::injectDelayChange()
 {
     int v = std::atoi(this->injectDelay->get_text().raw().c_str());
     Arguments::arguments.injectDelay = (uint32_t)v;
+    Arguments::publish();
 }
 
 void MainWindow::injectRepeatChange()
 {
     int v = std::atoi(this->injectRepeat->get_text().raw().c_str());
     Arguments::arguments.injectRepeat = (uint32_t)v;
+    Arguments::publish();
 }
 
 void MainWindow::updateErrorMessages()
@@ -38,10 +38,11 @@ void Plot::init(Glib::RefPtr<Gtk::Box> box)
     show();
 }
 
-void Plot::updateData(Csi *csi, std::vector<double> *data)
+void Plot::updateData(Csi *csi, std::vector<double> *data, uint32_t numPoints)
 {
     this->csi = csi;
     this->data = data;
+    this->numPoints = numPoints ? numPoints : csi->numSubCarriers;
     queue_draw();
 }
 
@@ -51,7 +52,7 @@ bool Plot::on_draw(const Cairo::RefPtr<Cairo::Context> &cr)
     const int width = allocation.get_width();
     const int height = allocation.get_height();
     const double offset = 50;
-    const double xTicks = csi ? csi->numSubCarriers : 56;
+    const double xTicks = csi ? this->numPoints : 56;
     bool redraw = false;
 
     // Set background color
@@ -107,10 +108,15 @@ bool Plot::on_draw(const Cairo::RefPtr<Cairo::Context> &cr)
         {
             for (uint32_t tx = 0; tx < csi->numTx; tx++)
             {
+                // Derived data may hold fewer series than rx/tx pairs
+                if (index + this->numPoints > this->data->size())
+                {
+                    break;
+                }
                 cr->set_source_rgb(colors[colorNumber][0], colors[colorNumber][1], colors[colorNumber][2]); // Black color
                 cr->set_line_width(2.0);
-                cr->move_to(offset, (height - offset) - (this->yTicksMin < 0 ? ((this->yTicksMin * -1) + (*this->data)[0]) : (*this->data)[0]) * yScale);
-                for (uint32_t n = 0; n < csi->numSubCarriers; n++)
+                cr->move_to(offset, (height - offset) - (this->yTicksMin < 0 ? ((this->yTicksMin * -1) + (*this->data)[index]) : (*this->data)[index]) * yScale);
+                for (uint32_t n = 0; n < this->numPoints; n++)
                 {
                     double x = n * xScale + offset;
                     double y = (height - offset) - (this->yTicksMin < 0 ? ((this->yTicksMin * -1) + (*this->data)[index]) : (*this->data)[index]) * yScale;
@@ -19,6 +19,7 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <signal.h>
 #include "Csi.h"
 #include "WiFIController.h"
 #include "WiFiCsiController.h"
@@ -28,6 +29,10 @@
 #include "MainController.h"
 #include "Logger.h"
 #include "Arguments.h"
+#include "CsiProcessor.h"
+#include "DatasetExporter.h"
+#include "Aggregator.h"
+#include "ClockSync.h"
 
 int main(int argc, char *argv[])
 {
@@ -40,6 +45,7 @@ int main(int argc, char *argv[])
         const auto t = std::chrono::system_clock::now();
         int64_t tInt = std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch()).count();
         Arguments::arguments.outputFile = "FeitCSI_" + std::to_string(tInt) + ".dat";
+        Arguments::publish();
     }
 
     // all arguments ok and sanitized go next
@@ -49,6 +55,59 @@ int main(int argc, char *argv[])
     {
         mainController->runGui();
     }
+    else if (!Arguments::arguments.exportDirectory.empty())
+    {
+        const Args &a = Arguments::arguments;
+        ExportConfig config;
+        config.directory = a.exportDirectory;
+        config.window = a.exportWindow;
+        config.hop = a.exportHop;
+        config.int8 = a.exportInt8;
+        config.complex = a.exportComplex;
+        config.shardSize = a.exportShard;
+        config.seed = a.exportSeed;
+
+        std::vector<ExportInput> inputs;
+        if (!a.exportInputs.empty())
+        {
+            inputs = DatasetExporter::readInputs(a.exportInputs);
+        }
+        else if (!a.inputFile.empty())
+        {
+            inputs.push_back(DatasetExporter::input(a.inputFile));
+        }
+        DatasetExporter(config).run(inputs);
+    }
+    else if (!Arguments::arguments.aggregateListen.empty())
+    {
+        const Args &a = Arguments::arguments;
+        AggregateConfig config;
+        config.listen = a.aggregateListen;
+        config.directory = a.aggregateOutput;
+        config.jitter = a.aggregateJitter;
+        config.threads = a.aggregateThreads;
+        config.shardSize = a.aggregateShard;
+
+        // Blocked before any thread exists so all of them inherit it and the
+        // aggregator run loop is the only one taking these signals
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        if (!a.clockSync.empty())
+        {
+            ClockSync::getInstance().start(a.clockSync, a.clockInterval);
+        }
+        Aggregator(config).run();
+    }
+    else if (!Arguments::arguments.inputFile.empty())
+    {
+        CsiProcessor csiProcessor;
+        csiProcessor.loadCsi();
+        csiProcessor.run();
+    }
     else if (Arguments::arguments.udpSocket)
     {
         mainController->runUdpSocket();
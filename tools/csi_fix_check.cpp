@@ -0,0 +1,182 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Regression check of Csi::fixCsiBug against the copy loop it replaced.
+ *
+ *   csi_fix_check [FILE...]
+ *
+ * Runs synthetic 160 MHz VHT and HE records with 1 to 4 rx/tx chains and
+ * every record of the given recorded CSI files through both and compares
+ * header and payload byte by byte. Exits with 1 on the first mismatch.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <vector>
+#include "Csi.h"
+#include "rs.h"
+
+struct Record {
+    RawHeaderData header;
+    std::vector<uint8_t> data;
+};
+
+// Copy loop of fixCsiBug before the in place repair
+static bool legacyFix(Record& r) {
+    const uint32_t format = r.header.rateNflag & RATE_MCS_MOD_TYPE_MSK;
+    const uint32_t channelWidth = r.header.rateNflag & RATE_MCS_CHAN_WIDTH_MSK;
+    if (channelWidth != RATE_MCS_CHAN_WIDTH_160) {
+        return true;
+    }
+    if (format != RATE_MCS_VHT_MSK && format != RATE_MCS_HE_MSK) {
+        return true;
+    }
+
+    uint32_t newSubcarrierSize = 0;
+    if (format == RATE_MCS_VHT_MSK) {
+        if (r.header.numSubCarriers == 484) {
+            return true;
+        }
+        newSubcarrierSize = 484;
+    } else {
+        if (r.header.numSubCarriers == 1992) {
+            return true;
+        }
+        newSubcarrierSize = 1992;
+    }
+
+    // The old loop only produced a valid payload for the exact gap sizes
+    const uint32_t gap = format == RATE_MCS_VHT_MSK ? 14 : 28;
+    if (r.header.numSubCarriers != newSubcarrierSize + gap) {
+        return false;
+    }
+
+    const uint32_t newTotalSize = newSubcarrierSize * 4 * r.header.numRx * r.header.numTx;
+    std::vector<uint8_t> fixed(newTotalSize);
+    uint32_t newIndex = 0;
+    uint32_t oldIndex = 0;
+    for (uint32_t rx = 0; rx < r.header.numRx; rx++) {
+        for (uint32_t tx = 0; tx < r.header.numTx; tx++) {
+            for (uint32_t n = 0; n < r.header.numSubCarriers; n++) {
+                if (format == RATE_MCS_VHT_MSK && n > 241 && n < 256) {
+                    oldIndex += 4;
+                    continue;
+                }
+                if (format == RATE_MCS_HE_MSK && n > 995 && n < 1024) {
+                    oldIndex += 4;
+                    continue;
+                }
+                memcpy(&fixed[newIndex], &r.data[oldIndex], 4);
+                oldIndex += 4;
+                newIndex += 4;
+            }
+        }
+    }
+
+    r.header.numSubCarriers = newSubcarrierSize;
+    r.header.csiDataSize = newTotalSize;
+    r.data = std::move(fixed);
+    return true;
+}
+
+static bool check(const Record& record, const char* name) {
+    Record expected = record;
+    if (!legacyFix(expected)) {
+        printf("%s: skipped, subcarrier count %u not handled by the old loop\n", name,
+               record.header.numSubCarriers);
+        return true;
+    }
+
+    std::vector<uint8_t> raw(CSI_HEADER_LENGTH + record.data.size());
+    memcpy(raw.data(), &record.header, CSI_HEADER_LENGTH);
+    memcpy(raw.data() + CSI_HEADER_LENGTH, record.data.data(), record.data.size());
+    Csi csi;
+    csi.loadFromMemory(raw.data());
+
+    const bool same =
+        memcmp(&csi.rawHeaderData, &expected.header, CSI_HEADER_LENGTH) == 0 &&
+        memcmp(csi.getRawCsiData(), expected.data.data(), expected.data.size()) == 0;
+    printf("%s: %s\n", name, same ? "ok" : "MISMATCH");
+    return same;
+}
+
+static Record synthetic(uint32_t format, uint32_t numSubCarriers, uint8_t numRx, uint8_t numTx,
+                        std::mt19937& random) {
+    Record r;
+    memset(&r.header, 0, CSI_HEADER_LENGTH);
+    r.header.rateNflag = format | RATE_MCS_CHAN_WIDTH_160;
+    r.header.numRx = numRx;
+    r.header.numTx = numTx;
+    r.header.numSubCarriers = numSubCarriers;
+    r.header.csiDataSize = numSubCarriers * 4 * numRx * numTx;
+    r.data.resize(r.header.csiDataSize);
+    for (uint8_t& b : r.data) {
+        b = random();
+    }
+    return r;
+}
+
+static bool checkFile(const char* fileName) {
+    std::ifstream ifs(fileName, std::ios::binary);
+    if (!ifs) {
+        printf("%s: cannot open\n", fileName);
+        return false;
+    }
+    bool ok = true;
+    char name[512];
+    for (uint32_t i = 0;; i++) {
+        Record r;
+        if (!ifs.read((char*)&r.header, CSI_HEADER_LENGTH)) {
+            break;
+        }
+        r.data.resize(r.header.csiDataSize);
+        if (!ifs.read((char*)r.data.data(), r.data.size())) {
+            printf("%s: truncated record %u\n", fileName, i);
+            return false;
+        }
+        snprintf(name, sizeof(name), "%s #%u", fileName, i);
+        ok &= check(r, name);
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    std::mt19937 random(160);
+    bool ok = true;
+    char name[64];
+    for (const uint32_t format : {RATE_MCS_VHT_MSK, RATE_MCS_HE_MSK}) {
+        const uint32_t fixed = format == RATE_MCS_VHT_MSK ? 484 : 1992;
+        const uint32_t gap = format == RATE_MCS_VHT_MSK ? 14 : 28;
+        for (uint8_t numRx = 1; numRx <= 2; numRx++) {
+            for (uint8_t numTx = 1; numTx <= 2; numTx++) {
+                // With the bogus subcarriers and already repaired
+                for (const uint32_t n : {fixed + gap, fixed}) {
+                    snprintf(name, sizeof(name), "%s %u subcarriers %ux%u",
+                             format == RATE_MCS_VHT_MSK ? "VHT160" : "HE160", n, numRx, numTx);
+                    ok &= check(synthetic(format, n, numRx, numTx, random), name);
+                }
+            }
+        }
+    }
+    for (int i = 1; i < argc; i++) {
+        ok &= checkFile(argv[i]);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Times the planned FFT at the sizes the CIR stage uses, the OFDM tone
+ * counts of every channel width and power-of-two padded sizes, against a
+ * direct DFT of the same input.
+ *
+ *   fft_bench [REPEATS]
+ *
+ * Reported are the time per forward transform of both and the largest
+ * difference between them and of inverse(forward(x)) from x.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "Fft.h"
+
+static double nowSeconds() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void dft(const std::vector<std::complex<double>>& x, std::vector<std::complex<double>>& y) {
+    const uint64_t n = x.size();
+    for (uint64_t k = 0; k < n; k++) {
+        std::complex<double> sum = 0;
+        for (uint64_t j = 0; j < n; j++) {
+            sum += x[j] * std::polar(1.0, -2 * M_PI * (double)(j * k % n) / n);
+        }
+        y[k] = sum;
+    }
+}
+
+static void bench(uint32_t size, uint32_t repeats) {
+    std::mt19937 generator(size);
+    std::normal_distribution<double> normal;
+    std::vector<std::complex<double>> x(size);
+    for (std::complex<double>& v : x) {
+        v = {normal(generator), normal(generator)};
+    }
+
+    std::shared_ptr<const Fft> plan = Fft::plan(size);
+    std::vector<std::complex<double>> y;
+    double start = nowSeconds();
+    for (uint32_t r = 0; r < repeats; r++) {
+        y = x;
+        plan->forward(y.data());
+    }
+    const double fftUs = (nowSeconds() - start) * 1e6 / repeats;
+
+    std::vector<std::complex<double>> reference(size);
+    start = nowSeconds();
+    dft(x, reference);
+    const double dftUs = (nowSeconds() - start) * 1e6;
+
+    double error = 0;
+    for (uint32_t k = 0; k < size; k++) {
+        error = std::max(error, std::abs(y[k] - reference[k]));
+    }
+    plan->inverse(y.data());
+    double roundTrip = 0;
+    for (uint32_t k = 0; k < size; k++) {
+        roundTrip = std::max(roundTrip, std::abs(y[k] - x[k]));
+    }
+
+    printf("%5u %-10s: fft %9.2f us, dft %11.2f us, max error %.1e, round trip %.1e\n", size,
+           (size & (size - 1)) ? "bluestein" : "radix-2", fftUs, dftUs, error, roundTrip);
+}
+
+int main(int argc, char* argv[]) {
+    const uint32_t repeats = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+    if (!repeats) {
+        fprintf(stderr, "Usage: %s [REPEATS]\n", argv[0]);
+        return 1;
+    }
+
+    for (uint32_t size : {52u, 56u, 114u, 242u, 484u, 996u, 1992u, 64u, 128u, 256u, 512u, 1024u,
+                          2048u, 4096u}) {
+        bench(size, repeats);
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Times the music stage on synthetic 40 MHz HT records of two rx chains
+ * receiving two paths with a random STO per record, on one thread and on
+ * all cores.
+ *
+ *   music_bench [RECORDS] [WINDOW]
+ *
+ * Reported are the time per record and the mean AoA error of the two
+ * strongest paths found against the simulated ones.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include "Arguments.h"
+#include "MusicEstimator.h"
+#include "Resampler.h"
+#include "rs.h"
+
+#define BENCH_FREQUENCY 5190e6
+#define BENCH_SPACING 0.026
+
+struct BenchPath {
+    double aoa;  // degrees
+    double tof;  // ns
+    std::complex<double> amplitude;
+};
+
+static const BenchPath paths[] = {{20, 10, 1}, {-40, 45, {0.3, 0.4}}};
+
+static double nowSeconds() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static Csi makeRecord(std::mt19937& generator) {
+    std::normal_distribution<double> normal;
+    Csi csi;
+    memset(&csi.rawHeaderData, 0, sizeof(csi.rawHeaderData));
+    csi.numRx = 2;
+    csi.numTx = 1;
+    csi.numSubCarriers = 114;
+    csi.format = RATE_MCS_HT_MSK;
+    csi.channelWidth = RATE_MCS_CHAN_WIDTH_40;
+
+    const double sto = normal(generator) * 50;
+    const double wavelength = 299792458.0 / BENCH_FREQUENCY;
+    for (uint32_t rx = 0; rx < csi.numRx; rx++) {
+        for (double frequency : Resampler::subcarrierFrequencies(csi)) {
+            std::complex<double> h = 0;
+            for (const BenchPath& path : paths) {
+                const double delay = rx * BENCH_SPACING * sin(path.aoa * M_PI / 180) / wavelength +
+                                     frequency * 1e6 * (path.tof + sto) * 1e-9;
+                h += path.amplitude * std::polar(1.0, -2 * M_PI * delay);
+            }
+            csi.csi.push_back(h * 100.0 + std::complex<double>(normal(generator), normal(generator)));
+        }
+    }
+    return csi;
+}
+
+static void bench(const std::vector<Csi>& records, uint32_t window, uint32_t threads) {
+    MusicConfig config;
+    config.window = window;
+    config.frequency = BENCH_FREQUENCY;
+    config.antennaSpacing = BENCH_SPACING;
+    config.threads = threads;
+    MusicEstimator music;
+    music.configure(config);
+
+    double error = 0;
+    uint32_t estimated = 0;
+    const double start = nowSeconds();
+    for (const Csi& csi : records) {
+        std::unique_ptr<DerivedRecord> record = music.update(csi);
+        if (!record) {
+            continue;
+        }
+
+        // Strongest paths come first, match each simulated path to the nearest
+        const float* values = reinterpret_cast<const float*>(record->data.data());
+        for (uint32_t r = 0; r < record->header.numRecords; r++) {
+            const float* found = &values[r * config.maxPaths * 3];
+            for (const BenchPath& path : paths) {
+                double nearest = 180;
+                for (uint32_t p = 0; p < 2; p++) {
+                    if (!std::isnan(found[p * 3])) {
+                        nearest = std::min(nearest, std::fabs(found[p * 3] - path.aoa));
+                    }
+                }
+                error += nearest;
+            }
+            estimated++;
+        }
+    }
+    const double elapsed = nowSeconds() - start;
+
+    printf("%2u threads: %.3f ms/record, mean AoA error %.2f degrees over %u records\n",
+           threads ? threads : std::thread::hardware_concurrency(), elapsed * 1e3 / records.size(),
+           estimated ? error / (estimated * std::size(paths)) : NAN, estimated);
+}
+
+int main(int argc, char* argv[]) {
+    const uint32_t numRecords = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200;
+    const uint32_t window = argc > 2 ? strtoul(argv[2], nullptr, 10) : 10;
+    if (!numRecords || !window) {
+        fprintf(stderr, "Usage: %s [RECORDS] [WINDOW]\n", argv[0]);
+        return 1;
+    }
+
+    Arguments::init();
+    Arguments::publish();
+    std::mt19937 generator(1);
+    std::vector<Csi> records;
+    for (uint32_t i = 0; i < numRecords; i++) {
+        records.push_back(makeRecord(generator));
+    }
+
+    bench(records, window, 1);
+    bench(records, window, 0);
+    return 0;
+}
@@ -0,0 +1,238 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Compares handing records to local consumers through the shared memory
+ * ring (--shm) with loopback UDP, the way FeitCSI sends them to a peer.
+ *
+ *   shm_bench [RECORDS] [RECORD_SIZE] [READERS]
+ *
+ * Throughput is the time the writer spends per record while sending flat
+ * out, latency the average time from publish to a reader seeing the record
+ * while sending one record every 100 us. Ring readers run as nobody when
+ * started as root, they only need read access to the region.
+ */
+
+#include <arpa/inet.h>
+#include <pwd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "ShmRing.h"
+#include "ShmRingSink.h"
+
+#define BENCH_SHM_NAME "feitcsi_bench"
+#define BENCH_UDP_PORT 39300
+#define BENCH_PACE_US 100
+
+struct BenchResult {
+    uint64_t received = 0;
+    double latencyUs = 0;  // average
+};
+
+static uint64_t nowNs() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+static void dropPrivileges() {
+    if (getuid() != 0) {
+        return;
+    }
+    const struct passwd* nobody = getpwnam("nobody");
+    if (!nobody || setgid(nobody->pw_gid) < 0 || setuid(nobody->pw_uid) < 0) {
+        perror("Drop privileges");
+        _exit(1);
+    }
+}
+
+// Reader process, writes its result to fd
+static void readRing(uint64_t records, int fd) {
+    dropPrivileges();
+    struct feitcsi_shm_reader reader;
+    const int err = feitcsi_shm_open(&reader, BENCH_SHM_NAME);
+    if (err) {
+        fprintf(stderr, "Open ring failed: %s\n", strerror(-err));
+        _exit(1);
+    }
+    BenchResult result;
+    double latency = 0;
+    while (result.received < records && !reader.header->closed) {
+        const struct feitcsi_shm_record* record;
+        const int r = feitcsi_shm_next(&reader, &record);
+        if (r == 0) {
+            feitcsi_shm_wait(&reader, 100);
+            continue;
+        }
+        if (r < 0) {
+            continue;
+        }
+        uint64_t sent;
+        memcpy(&sent, feitcsi_shm_data(record), sizeof(sent));
+        const uint64_t now = nowNs();
+        if (feitcsi_shm_valid(&reader)) {
+            latency += (now - sent) / 1e3;
+            result.received++;
+        }
+    }
+    result.latencyUs = result.received ? latency / result.received : 0;
+    write(fd, &result, sizeof(result));
+    feitcsi_shm_close(&reader);
+    _exit(0);
+}
+
+static void readUdp(int sfd, int fd) {
+    BenchResult result;
+    double latency = 0;
+    std::vector<char> buf(65536);
+    while (true) {
+        const ssize_t n = recv(sfd, buf.data(), buf.size(), 0);
+        if (n < (ssize_t)sizeof(uint64_t)) {
+            break;  // timeout after the last record
+        }
+        uint64_t sent;
+        memcpy(&sent, buf.data(), sizeof(sent));
+        latency += (nowNs() - sent) / 1e3;
+        result.received++;
+    }
+    result.latencyUs = result.received ? latency / result.received : 0;
+    write(fd, &result, sizeof(result));
+    _exit(0);
+}
+
+static std::vector<BenchResult> collect(const std::vector<std::pair<pid_t, int>>& readers) {
+    std::vector<BenchResult> results;
+    for (const auto& [pid, fd] : readers) {
+        BenchResult result;
+        if (read(fd, &result, sizeof(result)) != sizeof(result)) {
+            result = BenchResult();
+        }
+        close(fd);
+        waitpid(pid, nullptr, 0);
+        results.push_back(result);
+    }
+    return results;
+}
+
+template <typename Send>
+static double sendAll(uint64_t records, std::vector<char>& record, bool paced, Send send) {
+    const uint64_t start = nowNs();
+    for (uint64_t i = 0; i < records; i++) {
+        const uint64_t now = nowNs();
+        memcpy(record.data(), &now, sizeof(now));
+        send();
+        if (paced) {
+            std::this_thread::sleep_for(std::chrono::microseconds(BENCH_PACE_US));
+        }
+    }
+    return (nowNs() - start) / 1e3 / records;
+}
+
+static void benchShm(uint64_t records, size_t size, int numReaders, bool paced) {
+    std::vector<std::pair<pid_t, int>> readers;
+    ShmRingSink sink(BENCH_SHM_NAME, 64 << 20);
+    for (int i = 0; i < numReaders; i++) {
+        int fds[2];
+        if (pipe(fds) < 0) {
+            perror("pipe");
+            exit(1);
+        }
+        const pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            readRing(records, fds[1]);
+        }
+        close(fds[1]);
+        readers.emplace_back(pid, fds[0]);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::vector<char> record(size, 3);
+    const StreamRecordInfo info = {STREAM_FORMAT_CSI, 0, nullptr};
+    const double perRecord = sendAll(records, record, paced, [&] {
+        struct iovec iov = {record.data(), record.size()};
+        sink.publish(&iov, 1, info);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    printf("shm %s: writer %.2f us/record\n", paced ? "paced" : "flat out", perRecord);
+    for (const BenchResult& r : collect(readers)) {
+        printf("  reader %lu of %lu records, latency %.2f us\n", r.received, records, r.latencyUs);
+    }
+}
+
+static void benchUdp(uint64_t records, size_t size, bool paced) {
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(BENCH_UDP_PORT);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    const int rx = socket(AF_INET, SOCK_DGRAM, 0);
+    const int buffer = 16 << 20;
+    setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    const struct timeval timeout = {0, 300000};
+    setsockopt(rx, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (bind(rx, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        perror("bind");
+        exit(1);
+    }
+
+    int fds[2];
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        exit(1);
+    }
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        readUdp(rx, fds[1]);
+    }
+    close(fds[1]);
+    close(rx);
+
+    const int tx = socket(AF_INET, SOCK_DGRAM, 0);
+    std::vector<char> record(size, 3);
+    const double perRecord = sendAll(records, record, paced, [&] {
+        sendto(tx, record.data(), record.size(), 0, (struct sockaddr*)&address, sizeof(address));
+    });
+    close(tx);
+    printf("udp %s: writer %.2f us/record\n", paced ? "paced" : "flat out", perRecord);
+    for (const BenchResult& r : collect({{pid, fds[0]}})) {
+        printf("  reader %lu of %lu records, latency %.2f us\n", r.received, records, r.latencyUs);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const uint64_t records = argc > 1 ? strtoull(argv[1], nullptr, 10) : 200000;
+    const size_t size = argc > 2 ? strtoul(argv[2], nullptr, 10) : 2000;
+    const int readers = argc > 3 ? atoi(argv[3]) : 1;
+    if (!records || size < sizeof(uint64_t) || size > 65000 || readers < 1) {
+        fprintf(stderr, "Usage: %s [RECORDS] [RECORD_SIZE] [READERS]\n", argv[0]);
+        return 1;
+    }
+
+    benchShm(records, size, readers, false);
+    benchUdp(records, size, false);
+    const uint64_t paced = std::min<uint64_t>(records, 5000);
+    benchShm(paced, size, readers, true);
+    benchUdp(paced, size, true);
+    return 0;
+}
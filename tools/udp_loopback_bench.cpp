@@ -0,0 +1,127 @@
+/*
+ * FeitCSI is the tool for extracting CSI information from supported intel NICs.
+ * Copyright (C) 2026 Miroslav Hutar.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Sends records through UdpSocket to a receiver on loopback with every
+ * combination of --udp-batch and --udp-frame, the way FeitCSI streams to a
+ * peer.
+ *
+ *   udp_loopback_bench [RECORDS] [RECORD_SIZE]
+ *
+ * Reported are the sender time and process CPU time per record, the
+ * datagrams per sendmmsg call and the records the receiver got complete.
+ * Framed records are reassembled by StreamReceiver.
+ */
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "Arguments.h"
+#include "StreamReceiver.h"
+#include "UdpSocket.h"
+
+#define BENCH_UDP_PORT 39301
+
+static double nowSeconds(clockid_t clock) {
+    struct timespec t;
+    clock_gettime(clock, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void bench(uint64_t records, size_t size, uint32_t batch, uint32_t frame) {
+    Arguments::arguments.udpBatch = batch;
+    Arguments::arguments.udpFrame = frame;
+    Arguments::publish();
+
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(BENCH_UDP_PORT);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    const int rx = socket(AF_INET, SOCK_DGRAM, 0);
+    const int buffer = 64 << 20;
+    setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    const struct timeval timeout = {0, 300000};
+    setsockopt(rx, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (bind(rx, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        perror("bind");
+        exit(1);
+    }
+
+    // Unframed datagrams are whole records, framed ones are reassembled
+    std::atomic<uint64_t> received = 0;
+    std::thread receiver([&] {
+        StreamReceiver stream(1024, 0);
+        stream.onRecord = [&](uint32_t, const std::vector<uint8_t>&) { received++; };
+        std::vector<uint8_t> buf(65536);
+        ssize_t n;
+        while ((n = recv(rx, buf.data(), buf.size(), 0)) > 0) {
+            if (frame) {
+                stream.receive(buf.data(), n);
+            } else {
+                received++;
+            }
+        }
+    });
+
+    std::vector<char> record(size, 3);
+    const StreamRecordInfo info = {STREAM_FORMAT_CSI, 0, nullptr};
+    UdpStats stats;
+    const double start = nowSeconds(CLOCK_MONOTONIC);
+    const double cpuStart = nowSeconds(CLOCK_PROCESS_CPUTIME_ID);
+    {
+        UdpSocket socket;
+        socket.setPeer((struct sockaddr*)&address, sizeof(address));
+        for (uint64_t i = 0; i < records; i++) {
+            memcpy(record.data(), &i, sizeof(i));
+            socket.send(record.data(), record.size(), info);
+        }
+        socket.flush();
+        stats = socket.getStats();
+    }
+    const double elapsed = nowSeconds(CLOCK_MONOTONIC) - start;
+    const double cpu = nowSeconds(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+    receiver.join();
+    close(rx);
+
+    printf("batch %2u frame %5u: %.2f us/record, %.2f us CPU/record, %.1f datagrams/call, "
+           "%lu of %lu records received\n",
+           batch, frame, elapsed * 1e6 / records, cpu * 1e6 / records,
+           stats.batches ? (double)stats.sent / stats.batches : 0, received.load(), records);
+}
+
+int main(int argc, char* argv[]) {
+    const uint64_t records = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000;
+    const size_t size = argc > 2 ? strtoul(argv[2], nullptr, 10) : 2000;
+    if (!records || size < sizeof(uint64_t) || size > 65000) {
+        fprintf(stderr, "Usage: %s [RECORDS] [RECORD_SIZE]\n", argv[0]);
+        return 1;
+    }
+
+    Arguments::init();
+    for (uint32_t frame : {0u, (uint32_t)STREAM_DEFAULT_MTU}) {
+        for (uint32_t batch : {1u, (uint32_t)UDP_BATCH_SIZE}) {
+            bench(records, size, batch, frame);
+        }
+    }
+    return 0;
+}